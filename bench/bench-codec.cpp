@@ -0,0 +1,240 @@
+/*! Cost per message of the decode, encode and transcode kernels
+ * \file bench-codec.cpp
+ *
+ * Runs each kernel over a set of typical messages or strings held in memory, and reports the time per operation
+ * alongside cycles per byte, IPC, branch misses and cache misses where the hardware counters can be read:
+ *
+ *     ndef-lite-bench-codec [--messages N] [--rounds N]
+ *
+ * Built against the shared library (ndef-lite-bench-codec) and, with NDEF_LITE_BUILD_STATIC, against the static one
+ * (ndef-lite-bench-codec-static).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ndef-lite/corpus-snapshot.hpp"
+#include "ndef-lite/encoding.hpp"
+#include "ndef-lite/exemplar-recorder.hpp"
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/message.hpp"
+
+#include "harness.hpp"
+
+using namespace std;
+
+namespace {
+struct BenchOptions
+{
+  size_t messages = 2000;
+  size_t rounds = 20;
+};
+
+[[noreturn]] void usage()
+{
+  cerr << "usage: ndef-lite-bench-codec [--messages N] [--rounds N]" << endl;
+  exit(2);
+}
+
+/// Text of \p i th message. Every fourth is not ASCII, so the transcoders take their slow paths too
+string make_text(size_t i)
+{
+  string text = "Opening hours for store " + to_string(i) + ": 9am to 6pm, closed on public holidays";
+  if (i % 4 == 0) {
+    text += " \xC3\xA9t\xC3\xA9 \xE2\x82\xAC";
+  }
+
+  return text;
+}
+
+/// Messages a tag reader typically sees: a URI, a text and sometimes an External record
+vector<NDEFMessage> make_messages(size_t count)
+{
+  vector<NDEFMessage> messages;
+
+  for (size_t i = 0; i < count; i++) {
+    NDEFMessage msg;
+    msg.append_record(NDEFRecord::create_uri_record("https://example.com/store/" + to_string(i)));
+    msg.append_record(NDEFRecord::create_text_record(make_text(i), "en"));
+    if (i % 4 == 0) {
+      msg.append_record(NDEFRecord{ vector<uint8_t>(48, 0x5A),
+                                    NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:sensor" } });
+    }
+
+    messages.push_back(msg);
+  }
+
+  return messages;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  BenchOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--messages" && has_value) {
+      options.messages = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--rounds" && has_value) {
+      options.rounds = strtoul(argv[++i], nullptr, 10);
+    } else {
+      usage();
+    }
+  }
+
+  if (options.messages == 0 || options.rounds == 0) {
+    usage();
+  }
+
+  const auto messages = make_messages(options.messages);
+
+  vector<vector<uint8_t>> encoded;
+  size_t encoded_bytes = 0;
+  for (auto&& msg : messages) {
+    encoded.push_back(msg.as_bytes());
+    encoded_bytes += encoded.back().size();
+  }
+
+  vector<string> texts;
+  vector<u16string> texts16;
+  size_t text_bytes = 0;
+  size_t text16_bytes = 0;
+  for (size_t i = 0; i < options.messages; i++) {
+    texts.push_back(make_text(i));
+    texts16.push_back(encoding::to_utf16(texts.back()));
+    text_bytes += texts.back().size();
+    text16_bytes += texts16.back().size() * sizeof(char16_t);
+  }
+
+  cout << options.messages << " messages, " << encoded_bytes << " encoded bytes, " << text_bytes << " text bytes\n";
+
+  PerfCounters counters;
+  print_heading(counters);
+  uint64_t checksum = 0;
+  const size_t count = options.messages;
+
+  checksum += measure(counters, "decode from_bytes", options.rounds, count, encoded_bytes, [&]() {
+    uint64_t records = 0;
+    for (auto&& bytes : encoded) {
+      records += NDEFMessage::from_bytes(bytes).record_count();
+    }
+    return records;
+  });
+
+  checksum += measure(counters, "decode trusted", options.rounds, count, encoded_bytes, [&]() {
+    uint64_t records = 0;
+    for (auto&& bytes : encoded) {
+      records += NDEFMessage::decode<TrustedDecode>(bytes.data(), bytes.size()).record_count();
+    }
+    return records;
+  });
+
+  auto encode = [&]() {
+    uint64_t bytes = 0;
+    for (auto&& msg : messages) {
+      bytes += msg.as_bytes().size();
+    }
+    return bytes;
+  };
+  checksum += measure(counters, "encode as_bytes", options.rounds, count, encoded_bytes, encode);
+
+  // The same calls again while an exemplar recorder times every one of them
+  ExemplarRecorder::install(make_shared<ExemplarRecorder>());
+  checksum += measure(counters, "decode with exemplars", options.rounds, count, encoded_bytes, [&]() {
+    uint64_t records = 0;
+    for (auto&& bytes : encoded) {
+      records += NDEFMessage::from_bytes(bytes).record_count();
+    }
+    return records;
+  });
+  checksum += measure(counters, "encode with exemplars", options.rounds, count, encoded_bytes, encode);
+  ExemplarRecorder::install(nullptr);
+
+  // Restoring the decoded index of every message from a snapshot, against decoding them all as above
+  vector<uint8_t> corpus_bytes;
+  for (auto&& bytes : encoded) {
+    corpus_bytes.insert(corpus_bytes.end(), bytes.begin(), bytes.end());
+  }
+  NDEFCorpus corpus{ corpus_bytes.data(), corpus_bytes.size() };
+
+  char snapshot_path[] = "/tmp/ndef-lite-bench-XXXXXX";
+  int snapshot_fd = mkstemp(snapshot_path);
+  if (snapshot_fd < 0) {
+    cerr << "unable to create snapshot file" << endl;
+    return 1;
+  }
+  close(snapshot_fd);
+  NDEFCorpusSnapshot::write(snapshot_path, corpus);
+
+  checksum += measure(counters, "open snapshot", options.rounds, count, encoded_bytes, [&]() {
+    NDEFCorpusSnapshot snapshot{ snapshot_path, corpus };
+    return static_cast<uint64_t>(snapshot.record_count());
+  });
+  remove(snapshot_path);
+
+  // Rewriting the URI record of every message, by decoding and re-encoding it or by editing the encoded bytes
+  const vector<NDEFRecord> uris{ NDEFRecord::create_uri_record("https://example.org/gateway/redirect"),
+                                 NDEFRecord::create_uri_record("https://example.org/gw") };
+  checksum += measure(counters, "rewrite URI decoded", options.rounds, count, encoded_bytes, [&]() {
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < encoded.size(); i++) {
+      auto msg = NDEFMessage::from_bytes(encoded[i]);
+      msg.set_record(uris[i % 2], 0);
+      bytes += msg.as_bytes().size();
+    }
+    return bytes;
+  });
+
+  vector<NDEFMessageBuffer> buffers(encoded.size());
+  for (size_t i = 0; i < encoded.size(); i++) {
+    buffers[i].assign(encoded[i]);
+  }
+  const vector<vector<uint8_t>> uri_payloads{ uris[0].payload(), uris[1].payload() };
+  size_t rewrites = 0;
+  checksum += measure(counters, "rewrite URI in place", options.rounds, count, encoded_bytes, [&]() {
+    uint64_t bytes = 0;
+    rewrites++;
+    for (size_t i = 0; i < buffers.size(); i++) {
+      buffers[i].replace_payload(0, uri_payloads[(i + rewrites) % 2]);
+      bytes += buffers[i].view().size();
+    }
+    return bytes;
+  });
+
+  // Transcoders are measured per string, against the size of their input
+  checksum += measure(counters, "encoding::to_utf16", options.rounds, count, text_bytes, [&]() {
+    uint64_t units = 0;
+    for (auto&& text : texts) {
+      units += encoding::to_utf16(text).size();
+    }
+    return units;
+  });
+
+  checksum += measure(counters, "encoding::to_utf8", options.rounds, count, text16_bytes, [&]() {
+    uint64_t bytes = 0;
+    for (auto&& text : texts16) {
+      bytes += encoding::to_utf8(text).size();
+    }
+    return bytes;
+  });
+
+  checksum += measure(counters, "to_utf16le_bytes", options.rounds, count, text16_bytes, [&]() {
+    uint64_t bytes = 0;
+    for (auto&& text : texts16) {
+      bytes += encoding::to_utf16le_bytes(text).size();
+    }
+    return bytes;
+  });
+
+  cout << "checksum " << checksum << '\n';
+  return 0;
+}
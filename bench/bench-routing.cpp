@@ -0,0 +1,157 @@
+/*! Per-record cost of the framing, routing and header encoding hot paths
+ * \file bench-routing.cpp
+ *
+ * Runs the tight loops a record router spends its time in, over a corpus of small messages held in memory, and
+ * reports the time and hardware counters per record of each:
+ *
+ *     ndef-lite-bench-routing [--messages N] [--rounds N]
+ *
+ * The same source is built against the shared library (ndef-lite-bench-routing) and, with NDEF_LITE_BUILD_STATIC,
+ * against the static library with its hot paths inlined (ndef-lite-bench-routing-static), so that running both shows
+ * what the calls across the library boundary cost.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/record-layout.hpp"
+#include "ndef-lite/record-view.hpp"
+
+#include "harness.hpp"
+
+using namespace std;
+
+namespace {
+struct BenchOptions
+{
+  size_t messages = 20000;
+  size_t rounds = 50;
+};
+
+[[noreturn]] void usage()
+{
+  cerr << "usage: ndef-lite-bench-routing [--messages N] [--rounds N]" << endl;
+  exit(2);
+}
+
+/// Back to back messages of the records a tag reader typically sees
+vector<uint8_t> make_corpus(size_t count, size_t& num_records)
+{
+  vector<uint8_t> bytes;
+  num_records = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    NDEFMessage msg;
+    msg.append_record(NDEFRecord::create_uri_record("https://example.com/t/" + to_string(i)));
+    msg.append_record(NDEFRecord::create_text_record("tag " + to_string(i), "en"));
+    if (i % 4 == 0) {
+      msg.append_record(NDEFRecord{ vector<uint8_t>{ 0x01, 0x02 },
+                                    NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:sensor" } });
+    }
+
+    num_records += msg.record_count();
+    auto encoded = msg.as_bytes();
+    bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+  }
+
+  return bytes;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  BenchOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--messages" && has_value) {
+      options.messages = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--rounds" && has_value) {
+      options.rounds = strtoul(argv[++i], nullptr, 10);
+    } else {
+      usage();
+    }
+  }
+
+  if (options.messages == 0 || options.rounds == 0) {
+    usage();
+  }
+
+  size_t num_records = 0;
+  const auto corpus = make_corpus(options.messages, num_records);
+  cout << options.messages << " messages, " << num_records << " records, " << corpus.size() << " bytes\n";
+
+  PerfCounters counters;
+  print_heading(counters);
+  uint64_t checksum = 0;
+
+  // Header decoding alone: every header byte in the corpus, found by framing once up front
+  vector<uint8_t> header_bytes;
+  for (size_t pos = 0; pos < corpus.size();) {
+    NDEFRecordLayout layout;
+    frame_record(corpus.data() + pos, corpus.size() - pos, layout);
+    header_bytes.push_back(corpus[pos]);
+    pos += layout.total_length;
+  }
+
+  checksum += measure(counters, "header from_byte", options.rounds, num_records, header_bytes.size(), [&]() {
+    uint64_t sum = 0;
+    for (auto byte : header_bytes) {
+      auto header = NDEFRecordHeader::from_byte(byte);
+      sum += static_cast<uint64_t>(header.tnf) + header.sr + header.me;
+    }
+    return sum;
+  });
+
+  // Framing and routing: walk every record, dispatching on the TNF and the first type byte
+  checksum += measure(counters, "frame and route", options.rounds, num_records, corpus.size(), [&]() {
+    uint64_t routed[8] = {};
+    NDEFRecordLayout layout;
+    for (size_t pos = 0; pos < corpus.size(); pos += layout.total_length) {
+      frame_record(corpus.data() + pos, corpus.size() - pos, layout);
+      NDEFRecordView record{ corpus.data() + pos, layout };
+
+      auto tnf = static_cast<size_t>(record.tnf());
+      routed[tnf] += record.type().empty() ? 0 : record.type().data[0];
+    }
+    return routed[1] + routed[4];
+  });
+
+  // Message framing, as run by ingest and corpus opening
+  checksum += measure(counters, "frame messages", options.rounds, num_records, corpus.size(), [&]() {
+    uint64_t messages = 0;
+    size_t message_length = 0;
+    for (size_t pos = 0; pos < corpus.size(); pos += message_length) {
+      frame_message(corpus.data() + pos, corpus.size() - pos, message_length);
+      messages++;
+    }
+    return messages;
+  });
+
+  // Header encoding: the flags byte of every record of the first few decoded messages
+  vector<NDEFRecord> records;
+  size_t message_length = 0;
+  for (size_t pos = 0; pos < corpus.size() && records.size() < 64; pos += message_length) {
+    frame_message(corpus.data() + pos, corpus.size() - pos, message_length);
+    auto message = corpus.begin() + pos;
+    auto decoded = NDEFMessage::from_bytes(vector<uint8_t>{ message, message + message_length }).records();
+    records.insert(records.end(), decoded.begin(), decoded.end());
+  }
+  const size_t header_rounds = options.rounds * num_records / max<size_t>(1, records.size());
+  checksum += measure(counters, "record header()", header_rounds, records.size(), 0, [&]() {
+    uint64_t sum = 0;
+    for (auto&& record : records) {
+      sum += record.header();
+    }
+    return sum;
+  });
+
+  cout << "checksum " << checksum << '\n';
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "harness.hpp"
+
+using namespace std;
+
+namespace {
+#ifdef __linux__
+/// perf_event_attr type and config of each ::PerfEvent
+const uint64_t event_config[perf_event_count][2] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+const char* const event_names[perf_event_count] = { "cycles", "instructions", "branch-misses", "L1-dcache-load-misses",
+                                                    "LLC-load-misses" };
+
+/// Layout read(2) fills in for PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+struct EventReading
+{
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+};
+
+int open_event(size_t event)
+{
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = static_cast<uint32_t>(event_config[event][0]);
+  attr.config = event_config[event][1];
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  // Each event is its own group, so one the PMU cannot schedule alongside the others does not stop them all counting
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+/// Prints \p value, or "-" if it is not known
+void print_column(bool known, double value, int width, int precision)
+{
+  if (known) {
+    cout << fixed << setprecision(precision) << setw(width) << value;
+  } else {
+    cout << setw(width) << "-";
+  }
+}
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+  for (auto& fd : this->fds) {
+    fd = -1;
+  }
+
+#ifdef __linux__
+  for (size_t event = 0; event < perf_event_count; event++) {
+    this->fds[event] = open_event(event);
+    if (this->fds[event] < 0 && this->reason.empty()) {
+      this->reason = string{ event_names[event] } + ": " + strerror(errno);
+    }
+  }
+#else
+  this->reason = "perf_event_open is only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for (auto fd : this->fds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+bool PerfCounters::any_available() const
+{
+  for (auto fd : this->fds) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+  for (auto fd : this->fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+PerfSample PerfCounters::stop()
+{
+  PerfSample sample;
+
+#ifdef __linux__
+  for (auto fd : this->fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+
+  for (size_t event = 0; event < perf_event_count; event++) {
+    EventReading reading;
+    if (this->fds[event] < 0 || read(this->fds[event], &reading, sizeof(reading)) != sizeof(reading) ||
+        reading.time_running == 0) {
+      continue;
+    }
+
+    // The kernel only counts while the event holds a hardware counter, so extrapolate to the whole period
+    sample.available[event] = true;
+    sample.values[event] = static_cast<uint64_t>(static_cast<double>(reading.value) * reading.time_enabled /
+                                                 reading.time_running);
+  }
+#endif
+
+  return sample;
+}
+
+void print_heading(const PerfCounters& counters)
+{
+  if (!counters.any_available()) {
+    cout << "hardware counters unavailable (" << counters.unavailable_reason() << "), only times are reported\n";
+  }
+
+  cout << left << setw(24) << "operation" << right << setw(10) << "ns/op" << setw(10) << "cyc/byte" << setw(7) << "IPC"
+       << setw(11) << "br-miss/op" << setw(10) << "L1D/op" << setw(10) << "LLC/op" << '\n';
+}
+
+void print_measurement(const string& name, double elapsed_ns, uint64_t ops, uint64_t bytes, const PerfSample& sample)
+{
+  const double per_op = ops > 0 ? 1.0 / ops : 0.0;
+  const double cycles = static_cast<double>(sample[PerfEvent::Cycles]);
+
+  cout << left << setw(24) << name << right;
+  print_column(ops > 0, elapsed_ns * per_op, 10, 2);
+  print_column(sample.has(PerfEvent::Cycles) && bytes > 0, cycles / max<uint64_t>(1, bytes), 10, 2);
+  print_column(sample.has(PerfEvent::Cycles) && sample.has(PerfEvent::Instructions) && cycles > 0,
+               sample[PerfEvent::Instructions] / max(1.0, cycles), 7, 2);
+  print_column(sample.has(PerfEvent::BranchMisses), sample[PerfEvent::BranchMisses] * per_op, 11, 3);
+  print_column(sample.has(PerfEvent::L1DMisses), sample[PerfEvent::L1DMisses] * per_op, 10, 3);
+  print_column(sample.has(PerfEvent::LLCMisses), sample[PerfEvent::LLCMisses] * per_op, 10, 3);
+  cout << '\n';
+}
@@ -0,0 +1,115 @@
+/*! Timing and hardware performance counters around benchmarked operations
+ * \file harness.hpp
+ *
+ * measure() runs an operation repeatedly and prints one line per operation: the time it takes and, where the kernel
+ * lets this process count them, what the CPU did meanwhile. Cycles per byte and instructions per cycle tell a
+ * branch-bound kernel (low IPC, many branch misses) from a memory-bound one (low IPC, many cache misses) from one
+ * that is simply doing too much work (high IPC, many cycles per byte).
+ *
+ * Counters are read with perf_event_open(2) for the calling thread, in user space only. Where it is unavailable, such
+ * as outside Linux, in most virtual machines or when /proc/sys/kernel/perf_event_paranoid is above 2, the affected
+ * columns show "-" and the times are still reported.
+ */
+
+#ifndef BENCH_HARNESS_HPP
+#define BENCH_HARNESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Hardware events counted around each benchmarked operation
+enum class PerfEvent {
+  Cycles,
+  Instructions,
+  BranchMisses,
+
+  /// Level 1 data cache read misses
+  L1DMisses,
+
+  /// Last level cache read misses
+  LLCMisses,
+};
+
+const size_t perf_event_count = 5;
+
+/// Counts of each event over one measurement
+struct PerfSample
+{
+  /// Whether each event was counted. Events the CPU or kernel do not support, or that were never scheduled, are not
+  bool available[perf_event_count] = {};
+
+  /// Count of each event, scaled up for the time it was not scheduled when the kernel multiplexed the counters
+  uint64_t values[perf_event_count] = {};
+
+  bool has(PerfEvent event) const { return this->available[static_cast<size_t>(event)]; }
+  uint64_t operator[](PerfEvent event) const { return this->values[static_cast<size_t>(event)]; }
+};
+
+/// Hardware counters of the calling thread
+class PerfCounters {
+public:
+  /// Opens every event the kernel allows. Never throws, events that cannot be opened are left out
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /// \return whether any event could be opened
+  bool any_available() const;
+
+  /// \return why the first event that could not be opened failed, empty if all were opened
+  const std::string& unavailable_reason() const { return this->reason; }
+
+  /// Zeroes and starts every open counter
+  void start();
+
+  /// Stops every open counter
+  /// \return counts since start()
+  PerfSample stop();
+
+private:
+  /// File descriptor of each event, -1 if it could not be opened
+  int fds[perf_event_count];
+
+  std::string reason;
+};
+
+/// Prints the column headings of measure()'s lines, and a note if no counter could be opened
+void print_heading(const PerfCounters& counters);
+
+/// Prints one measurement, normalised per operation and per byte
+/// \param name name of the operation
+/// \param elapsed_ns time all \p ops took
+/// \param ops number of operations run
+/// \param bytes number of bytes those operations processed, 0 if they are not byte oriented
+/// \param sample counter values over the same period
+void print_measurement(const std::string& name, double elapsed_ns, uint64_t ops, uint64_t bytes,
+                       const PerfSample& sample);
+
+/// Runs \p body once untimed, to warm the caches and the branch predictors, then \p rounds times under the counters
+/// \param ops_per_round number of operations one call of \p body runs
+/// \param bytes_per_round number of bytes one call of \p body processes
+/// \param body operation to measure, returning a value that depends on its work so it cannot be optimised away
+/// \return sum of the values \p body returned
+template <typename Body>
+uint64_t measure(PerfCounters& counters, const std::string& name, size_t rounds, size_t ops_per_round,
+                 size_t bytes_per_round, Body body)
+{
+  uint64_t checksum = body();
+
+  const auto start = std::chrono::steady_clock::now();
+  counters.start();
+  for (size_t round = 0; round < rounds; round++) {
+    checksum += body();
+  }
+  const auto sample = counters.stop();
+  const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  print_measurement(name, elapsed_ns, rounds * ops_per_round, rounds * bytes_per_round, sample);
+  return checksum;
+}
+
+#endif // BENCH_HARNESS_HPP
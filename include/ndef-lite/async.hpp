@@ -0,0 +1,297 @@
+/*! C++20 coroutine API for reading and writing NDEF Messages over an asynchronous transport
+ * \file async.hpp
+ *
+ * Only available from the opt-in `ndef-lite-async` target, which requires C++20. The rest of the library stays C++14.
+ *
+ * A single NDEFEventLoop runs every coroutine on the thread that calls NDEFEventLoop::run(). Transports complete I/O
+ * by posting the waiting coroutine back to the loop, so one thread can service many connections:
+ *
+ * \code
+ * NDEFTask<void> handle(NDEFAsyncTransport& transport)
+ * {
+ *   NDEFAsyncReader reader{ transport };
+ *   NDEFMessage msg = co_await reader.read_message();
+ * }
+ * \endcode
+ */
+
+#ifndef ASYNC_HPP
+#define ASYNC_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/parser.hpp"
+
+template <typename T>
+class NDEFTask;
+
+namespace async_detail {
+/// Resumes whoever awaited the finished task
+struct FinalAwaiter
+{
+  bool await_ready() noexcept { return false; }
+
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+  {
+    auto continuation = handle.promise().continuation;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+
+  void await_resume() noexcept {}
+};
+
+/// State common to every task promise. Tasks are lazy, they only start once awaited
+struct PromiseBase
+{
+  std::coroutine_handle<> continuation;
+  std::exception_ptr error;
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { this->error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase
+{
+  std::optional<T> value;
+
+  NDEFTask<T> get_return_object();
+  void return_value(T result) { this->value = std::move(result); }
+
+  T result()
+  {
+    if (this->error) {
+      std::rethrow_exception(this->error);
+    }
+
+    return std::move(*this->value);
+  }
+};
+
+template <>
+struct Promise<void> : PromiseBase
+{
+  NDEFTask<void> get_return_object();
+  void return_void() {}
+
+  void result()
+  {
+    if (this->error) {
+      std::rethrow_exception(this->error);
+    }
+  }
+};
+} // namespace async_detail
+
+/// Lazily started coroutine producing a \p T. Awaiting the task starts it and resumes the awaiter once it finishes,
+/// rethrowing any exception the task threw
+template <typename T>
+class NDEFTask {
+public:
+  using promise_type = async_detail::Promise<T>;
+
+  explicit NDEFTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  NDEFTask(NDEFTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+  NDEFTask(const NDEFTask&) = delete;
+  NDEFTask& operator=(const NDEFTask&) = delete;
+
+  ~NDEFTask()
+  {
+    if (this->handle) {
+      this->handle.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+  {
+    this->handle.promise().continuation = awaiter;
+    return this->handle;
+  }
+
+  T await_resume() { return this->handle.promise().result(); }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+NDEFTask<T> async_detail::Promise<T>::get_return_object()
+{
+  return NDEFTask<T>{ std::coroutine_handle<Promise<T>>::from_promise(*this) };
+}
+
+inline NDEFTask<void> async_detail::Promise<void>::get_return_object()
+{
+  return NDEFTask<void>{ std::coroutine_handle<Promise<void>>::from_promise(*this) };
+}
+
+/// Single threaded scheduler for coroutines. Not thread safe: post() must be called from the thread running run()
+class NDEFEventLoop {
+public:
+  /// \param handle coroutine to resume on the next turn of the loop
+  void post(std::coroutine_handle<> handle) { this->ready.push_back(handle); }
+
+  /// Starts \p task on the next turn of the loop. The loop owns the task until it finishes
+  /// \param task task to run
+  void spawn(NDEFTask<void> task);
+
+  /// Resumes posted coroutines until none are left
+  /// \throws the first exception that escaped a spawned task
+  void run();
+
+  /// \return awaitable that suspends the current coroutine and posts it to the back of the loop
+  auto yield()
+  {
+    struct YieldAwaiter
+    {
+      NDEFEventLoop& loop;
+      bool await_ready() noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) { this->loop.post(handle); }
+      void await_resume() noexcept {}
+    };
+
+    return YieldAwaiter{ *this };
+  }
+
+private:
+  std::deque<std::coroutine_handle<>> ready;
+  std::exception_ptr error;
+};
+
+/// Completion slot for a single transport operation
+struct NDEFIoCompletion
+{
+  /// Number of bytes transferred, 0 on a read means the peer closed the connection
+  size_t result = 0;
+
+  /// Coroutine to post to the event loop once the operation finishes
+  std::coroutine_handle<> waiter;
+};
+
+/// Byte stream the async reader and writer run over
+///
+/// Implementations start the operation, then once it finishes set NDEFIoCompletion::result and post
+/// NDEFIoCompletion::waiter to their event loop. At most one read and one write are outstanding at a time
+class NDEFAsyncTransport {
+public:
+  virtual ~NDEFAsyncTransport() = default;
+
+  /// \param data destination for up to \p len bytes. Must stay valid until the read completes
+  /// \param len maximum number of bytes to read
+  /// \param completion slot to report the result through
+  virtual void start_read(uint8_t* data, size_t len, NDEFIoCompletion& completion) = 0;
+
+  /// \param data bytes to write. Must stay valid until the write completes
+  /// \param len number of bytes in \p data
+  /// \param completion slot to report the number of bytes written through
+  virtual void start_write(const uint8_t* data, size_t len, NDEFIoCompletion& completion) = 0;
+
+  /// \param data destination for up to \p len bytes
+  /// \param len maximum number of bytes to read
+  /// \return awaitable resolving to the number of bytes read, 0 once the peer has closed
+  auto read_some(uint8_t* data, size_t len) { return IoAwaiter{ *this, data, nullptr, len }; }
+
+  /// \param data bytes to write
+  /// \param len number of bytes in \p data
+  /// \return awaitable resolving to the number of bytes written
+  auto write_some(const uint8_t* data, size_t len) { return IoAwaiter{ *this, nullptr, data, len }; }
+
+private:
+  struct IoAwaiter
+  {
+    NDEFAsyncTransport& transport;
+    uint8_t* read_data;
+    const uint8_t* write_data;
+    size_t len;
+    NDEFIoCompletion completion{};
+
+    bool await_ready() noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+      this->completion.waiter = handle;
+      if (this->read_data) {
+        this->transport.start_read(this->read_data, this->len, this->completion);
+      } else {
+        this->transport.start_write(this->write_data, this->len, this->completion);
+      }
+    }
+
+    size_t await_resume() noexcept { return this->completion.result; }
+  };
+};
+
+/// In-memory transport. Endpoints are created in connected pairs, whatever one endpoint writes the other reads
+class NDEFLoopbackTransport : public NDEFAsyncTransport {
+public:
+  /// \param loop event loop both endpoints complete their operations on
+  /// \return two connected endpoints
+  static std::pair<std::unique_ptr<NDEFLoopbackTransport>, std::unique_ptr<NDEFLoopbackTransport>>
+  create_pair(NDEFEventLoop& loop);
+
+  void start_read(uint8_t* data, size_t len, NDEFIoCompletion& completion) override;
+  void start_write(const uint8_t* data, size_t len, NDEFIoCompletion& completion) override;
+
+  /// Closes this end. Pending and future reads on the peer complete with 0 once its buffered bytes are drained
+  void close();
+
+private:
+  struct Pipe;
+
+  NDEFLoopbackTransport(NDEFEventLoop& loop, std::shared_ptr<Pipe> inbound, std::shared_ptr<Pipe> outbound)
+      : loop(loop), inbound(std::move(inbound)), outbound(std::move(outbound))
+  {
+  }
+
+  NDEFEventLoop& loop;
+  std::shared_ptr<Pipe> inbound;
+  std::shared_ptr<Pipe> outbound;
+};
+
+/// Reads whole NDEF Messages off of a transport using the incremental parser
+class NDEFAsyncReader {
+public:
+  /// \param transport transport to read from
+  /// \param read_size maximum number of bytes requested from the transport per read
+  explicit NDEFAsyncReader(NDEFAsyncTransport& transport, size_t read_size = 256)
+      : transport(transport), read_buffer(read_size)
+  {
+  }
+
+  /// \return the next complete message from the transport
+  /// \throws NDEFException if the transport closes before a complete message arrives, or the bytes are malformed
+  NDEFTask<NDEFMessage> read_message();
+
+private:
+  NDEFAsyncTransport& transport;
+  NDEFMessageParser parser;
+  std::vector<uint8_t> read_buffer;
+};
+
+/// Writes NDEF Messages to a transport
+class NDEFAsyncWriter {
+public:
+  explicit NDEFAsyncWriter(NDEFAsyncTransport& transport) : transport(transport) {}
+
+  /// \param msg message to encode and write. Taken by value so the caller need not keep it alive while suspended
+  /// \throws NDEFException if the message is invalid or the transport stops accepting bytes
+  NDEFTask<void> write(NDEFMessage msg);
+
+private:
+  NDEFAsyncTransport& transport;
+};
+
+#endif // ASYNC_HPP
@@ -0,0 +1,206 @@
+/*! Codec service over a Unix domain socket
+ * \file codec-service.hpp
+ *
+ * Lets processes written in other languages use the library without binding to it. An NDEFCodecServer listens on a
+ * Unix domain socket and answers batches of decode, encode, validate and transcode requests from a pool of worker
+ * threads. Clients may pipeline as many batches as they like on one connection; responses carry the ID of the batch
+ * they answer and may arrive out of order.
+ *
+ * Every integer on the wire is little endian. A frame is
+ *
+ *     u32 length of everything after the 8 byte frame header
+ *     u32 batch ID, echoed in the response
+ *     u16 number of items
+ *     items, each: u8 op (request) or status (response), u32 body length, body
+ *
+ * Decode answers, and Encode takes, a flat record list: for each record u8 TNF, u8 flags (bit 0: chunked), u8 type
+ * length, u8 ID length, u32 payload length, then the type, ID and payload bytes. Validate answers with the u32 record
+ * count. Transcode takes a u8 ::TranscodeMode followed by an encoded message and answers with the re-encoded message.
+ * Failed items answer with a non-Ok status and an error message as their body.
+ *
+ * Request bodies are received straight into the buffer they are processed from, and payloads of decoded and encoded
+ * records are sent from that buffer with scatter-gather writes rather than copied into the response.
+ */
+
+#ifndef CODEC_SERVICE_HPP
+#define CODEC_SERVICE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+
+/// Operation requested by one item of a batch
+enum class CodecOp : uint8_t {
+  /// Encoded message in, flat record list out
+  Decode = 0x01,
+
+  /// Flat record list in, encoded message out
+  Encode = 0x02,
+
+  /// Encoded message in, record count out
+  Validate = 0x03,
+
+  /// ::TranscodeMode and encoded message in, re-encoded message out
+  Transcode = 0x04,
+};
+
+/// Outcome of one item of a batch
+enum class CodecStatus : uint8_t {
+  Ok = 0x00,
+
+  /// The request body could not be parsed
+  Malformed = 0x01,
+
+  /// Unknown op or transcode mode
+  Unsupported = 0x02,
+};
+
+/// How a Transcode request re-encodes its message
+enum class TranscodeMode : uint8_t {
+  /// Re-encode with minimal headers and correct MB/ME flags
+  Canonical = 0x00,
+
+  /// Compress records with an NDEFCompressionCodec without a dictionary
+  Compress = 0x01,
+
+  /// Undo Compress
+  Decompress = 0x02,
+};
+
+/// One item of a request batch
+struct CodecRequest
+{
+  CodecOp op;
+  std::vector<uint8_t> body;
+};
+
+/// One item of a response batch
+struct CodecResponse
+{
+  CodecStatus status;
+  std::vector<uint8_t> body;
+};
+
+/// Tuning for NDEFCodecServer
+struct CodecServerOptions
+{
+  /// Threads processing batches
+  size_t workers = 4;
+
+  /// Largest frame accepted. Connections sending larger frames are closed
+  size_t max_frame = 16 * 1024 * 1024;
+
+  /// Seconds a worker waits for a client to make room for a response before closing the connection
+  int send_timeout = 5;
+};
+
+/// Counters describing the work done by an NDEFCodecServer
+struct CodecServerStats
+{
+  size_t connections = 0;
+  size_t batches = 0;
+  size_t requests = 0;
+  size_t bytes_in = 0;
+  size_t bytes_out = 0;
+};
+
+class NDEFCodecServer {
+public:
+  /// \param path filesystem path of the socket. An existing socket at \p path is replaced
+  /// \param options tuning
+  explicit NDEFCodecServer(const std::string& path, CodecServerOptions options = CodecServerOptions{});
+
+  /// Stops the server if it is running
+  ~NDEFCodecServer();
+
+  NDEFCodecServer(const NDEFCodecServer&) = delete;
+  NDEFCodecServer& operator=(const NDEFCodecServer&) = delete;
+
+  /// Binds the socket and starts the I/O and worker threads
+  /// \throws NDEFException if the socket cannot be created or bound, or the server is already running
+  void start();
+
+  /// Stops accepting work, answers every batch already received and closes the socket
+  void stop();
+
+  /// \return counters since the server was constructed
+  CodecServerStats stats() const;
+
+  /// Processes a single request exactly as the server would
+  /// \param op requested operation
+  /// \param data request body
+  /// \param len number of bytes in \p data
+  /// \return response to the request
+  static CodecResponse process(CodecOp op, const uint8_t* data, size_t len);
+
+private:
+  struct Connection;
+  struct Shared;
+
+  std::string socket_path;
+  CodecServerOptions server_options;
+  std::unique_ptr<Shared> shared;
+  bool running = false;
+  std::thread io_thread;
+  std::vector<std::thread> worker_threads;
+
+  void run_io();
+  void run_worker();
+
+  /// Reads whatever \p connection has available, queueing every frame it completes
+  /// \return false once the connection should be closed
+  bool receive_frames(const std::shared_ptr<Connection>& connection);
+};
+
+class NDEFCodecClient {
+public:
+  /// \param path filesystem path of the server's socket
+  /// \throws NDEFException if the server cannot be reached
+  explicit NDEFCodecClient(const std::string& path);
+  ~NDEFCodecClient();
+
+  NDEFCodecClient(const NDEFCodecClient&) = delete;
+  NDEFCodecClient& operator=(const NDEFCodecClient&) = delete;
+
+  /// Sends a batch without waiting for its response. Request bodies are written in place, without being copied
+  /// \param id ID the response will carry
+  /// \param batch requests to send
+  /// \throws NDEFException if the batch is too large or the connection fails
+  void send(uint32_t id, const std::vector<CodecRequest>& batch);
+
+  /// Waits for the next response to arrive
+  /// \param responses replaced with the items of the response
+  /// \return ID of the batch the response answers
+  /// \throws NDEFException if the connection fails or the response is malformed
+  uint32_t receive(std::vector<CodecResponse>& responses);
+
+  /// Sends a batch and waits for its response. Must not be mixed with pipelined send() calls still in flight
+  /// \param batch requests to send
+  /// \return one response per request, in order
+  std::vector<CodecResponse> call(const std::vector<CodecRequest>& batch);
+
+  /// \param op requested operation
+  /// \param body request body
+  /// \return response to the single request
+  CodecResponse call(CodecOp op, const std::vector<uint8_t>& body);
+
+  /// \param records records to describe
+  /// \return \p records as a flat record list, the body of an Encode request
+  static std::vector<uint8_t> pack_records(const NDEFRecordList& records);
+
+  /// \param data flat record list, the body of a Decode response
+  /// \return records described by \p data
+  /// \throws NDEFException if \p data is malformed
+  static NDEFRecordList unpack_records(const std::vector<uint8_t>& data);
+
+private:
+  int fd;
+  uint32_t next_id = 0;
+};
+
+#endif // CODEC_SERVICE_HPP
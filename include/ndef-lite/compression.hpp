@@ -0,0 +1,93 @@
+/*! Compressed payload records
+ * \file compression.hpp
+ *
+ * Payloads are compressed in the LZ4 block format, optionally against a dictionary trained on typical payloads, and
+ * carried in an External record of type ::compressed_record_type. The compressed record's payload holds:
+ *
+ * - Flags - 1 byte, bit 0 set if a dictionary was used
+ * - Dictionary ID - 4 bytes big endian, only present if a dictionary was used
+ * - Original TNF - 1 byte
+ * - Original type length - 1 byte, followed by the original TYPE field
+ * - Original payload length - 4 bytes big endian
+ * - Compressed payload
+ *
+ * The ID field stays on the compressed record, so records can still be found by ID without decompressing them.
+ */
+
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/record-codec.hpp"
+#include "ndef-lite/record.hpp"
+
+/// TYPE of the External record that wraps a compressed record
+const std::string compressed_record_type = "ndef-lite:lz4";
+
+namespace lz4 {
+/// Largest distance a match can reach back, and so the most of a dictionary that is used
+const size_t window_size = 65535;
+
+/// Most bytes a single byte of LZ4 block can decompress to
+const size_t max_ratio = 255;
+
+/// \param data bytes to compress
+/// \param len number of bytes in \p data
+/// \param dictionary bytes that matches may reference as if they preceded \p data
+/// \return LZ4 block
+std::vector<uint8_t> compress(const uint8_t* data, size_t len, const std::vector<uint8_t>& dictionary = {});
+
+/// \param block LZ4 block
+/// \param len number of bytes in \p block
+/// \param out receives exactly \p out_len decompressed bytes
+/// \param out_len size of the original data
+/// \param dictionary dictionary the block was compressed with
+/// \throws NDEFException if the block is corrupt or does not decompress to exactly \p out_len bytes
+void decompress(const uint8_t* block, size_t len, uint8_t* out, size_t out_len,
+                const std::vector<uint8_t>& dictionary = {});
+} // namespace lz4
+
+/// Shared history that small payloads are compressed against
+struct NDEFCompressionDictionary
+{
+  /// Identifies the dictionary in compressed records, so a reader can tell it has the right one
+  uint32_t id;
+  std::vector<uint8_t> bytes;
+
+  /// Builds a dictionary from the byte sequences that occur most widely across \p samples
+  /// \param samples typical payloads
+  /// \param id dictionary ID to store in records compressed with it
+  /// \param capacity largest dictionary to build, at most lz4::window_size
+  /// \return trained dictionary
+  static NDEFCompressionDictionary train(const std::vector<std::vector<uint8_t>>& samples, uint32_t id,
+                                         size_t capacity = 4096);
+};
+
+/// Record codec that replaces records with compressed records when that makes them smaller
+class NDEFCompressionCodec : public NDEFRecordCodec {
+public:
+  /// \param dictionary dictionary to compress with, or nullptr for none
+  /// \param min_payload payloads shorter than this are left alone
+  /// \param max_payload largest payload a compressed record may decompress to
+  explicit NDEFCompressionCodec(std::shared_ptr<const NDEFCompressionDictionary> dictionary = nullptr,
+                                size_t min_payload = 16, size_t max_payload = 16 * 1024 * 1024);
+
+  /// Leaves chunked records, records with a payload source and records that do not shrink unchanged
+  bool encode(const NDEFRecord& record, NDEFRecord& encoded) const override;
+
+  /// \throws NDEFException if the record is corrupt, claims a payload larger than max_payload or than its block can
+  ///   hold, or was compressed with a dictionary other than this codec's
+  bool decode(const NDEFRecord& record, NDEFRecord& decoded) const override;
+
+private:
+  std::shared_ptr<const NDEFCompressionDictionary> dictionary;
+  size_t min_payload;
+  size_t max_payload;
+};
+
+#endif // COMPRESSION_HPP
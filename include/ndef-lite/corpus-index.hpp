@@ -0,0 +1,106 @@
+/*! Secondary index over the records of a corpus
+ * \file corpus-index.hpp
+ *
+ * An NDEFCorpusIndex cuts a corpus into blocks of consecutive messages and records, for each block, a Bloom filter
+ * over the URI hosts, the External type domains and the MIME types its records carry. A lookup only walks the blocks
+ * whose filter may hold the value, so a host found in a few messages costs a few blocks rather than the whole corpus.
+ * Filters never miss a value that is present, and a block that passes its filter is checked exactly.
+ *
+ * URI prefix codes have only 36 values, too few for a filter to tell blocks apart, so the index keeps an exact list
+ * of the messages holding each code instead.
+ *
+ * Hosts, domains and MIME types are compared without regard to ASCII case.
+ */
+
+#ifndef CORPUS_INDEX_HPP
+#define CORPUS_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/corpus-search.hpp"
+
+/// Value of each record an NDEFCorpusIndex can look up
+enum class IndexedField {
+  /// Host of URI records and Absolute URI records, for URIs that have an authority ("scheme://host")
+  UriHost,
+
+  /// Domain of External records, the part of the TYPE field before the colon
+  ExternalDomain,
+
+  /// TYPE field of MIME Media records, without parameters
+  MimeType,
+};
+
+/// Tuning for NDEFCorpusIndex
+struct CorpusIndexOptions
+{
+  /// Number of messages per block. Smaller blocks skip more precisely but take more memory
+  size_t block_messages = 1024;
+
+  /// Bloom filter bits per distinct value in a block. 10 bits give about 1% false positives
+  size_t bits_per_key = 10;
+};
+
+class NDEFCorpusIndex {
+public:
+  /// Walks every record of \p corpus once. \p corpus must outlive the index
+  /// \param corpus framed messages to index
+  /// \param options block size and filter density
+  /// \throws NDEFException if the block size or bits per key is 0
+  explicit NDEFCorpusIndex(const NDEFCorpus& corpus, const CorpusIndexOptions& options = CorpusIndexOptions{});
+
+  /// \return number of blocks the corpus was cut into
+  size_t block_count() const { return this->blocks.size(); }
+
+  /// \param block position of the block
+  /// \return position of the first message of \p block in the corpus
+  size_t block_start(size_t block) const { return this->blocks.at(block).first_message; }
+
+  /// \param field field to look in
+  /// \param value value to look for
+  /// \return blocks whose filter may hold \p value, in corpus order
+  std::vector<size_t> candidate_blocks(IndexedField field, const std::string& value) const;
+
+  /// Finds every record whose \p field equals \p value, reading only the candidate blocks
+  /// \param field field to look in
+  /// \param value value to look for
+  /// \return one hit per matching record, in corpus order. The position of a host is its offset in the expanded URI,
+  ///   the position of a domain or MIME type is 0
+  std::vector<SearchHit> find(IndexedField field, const std::string& value) const;
+
+  /// \param code URI identifier code, as stored in the first byte of a URI record's payload
+  /// \return messages holding at least one URI record with \p code, in corpus order. Codes reserved for future use
+  ///   are listed under 0x00
+  const std::vector<size_t>& messages_with_prefix(uint8_t code) const;
+
+private:
+  static constexpr size_t field_count = 3;
+
+  struct BloomFilter
+  {
+    /// Bit count minus one, the bit count being a power of two
+    uint64_t mask = 0;
+    std::vector<uint64_t> words;
+
+    void insert(uint64_t hash);
+    bool may_contain(uint64_t hash) const;
+  };
+
+  struct Block
+  {
+    size_t first_message;
+    size_t end_message;
+    BloomFilter filters[field_count];
+  };
+
+  const NDEFCorpus& corpus;
+  std::vector<Block> blocks;
+
+  /// Messages holding each URI identifier code
+  std::vector<std::vector<size_t>> prefix_postings;
+};
+
+#endif // CORPUS_INDEX_HPP
@@ -0,0 +1,135 @@
+/*! Substring search over the fields of many encoded messages
+ * \file corpus-search.hpp
+ *
+ * An NDEFCorpus holds back to back encoded messages, the layout of capture files: either a file mapped into memory or
+ * a buffer owned by the caller. Opening it runs the framing pass once, which records where every message starts
+ * without decoding any record.
+ *
+ * A search frames the records of each message and runs the vectorized substring kernel from simd.hpp over the one
+ * field asked for, never decoding the rest of the record. URIs are matched against their expanded form, abbreviated
+ * prefix included, without building a string per record. The messages are cut into contiguous segments of about the
+ * same number of bytes, each searched on its own thread, and the hits are returned in corpus order.
+ */
+
+#ifndef CORPUS_SEARCH_HPP
+#define CORPUS_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/payload-source.hpp"
+#include "ndef-lite/record-view.hpp"
+
+/// Field of each record a search looks in
+enum class SearchField {
+  /// PAYLOAD field of every record
+  Payload,
+
+  /// TYPE field of every record
+  Type,
+
+  /// ID field of every record
+  Id,
+
+  /// URI of URI records with the prefix expanded, and the TYPE field of Absolute URI records
+  Uri,
+
+  /// Text of Text records, after the locale, converted to UTF-8 if it is stored as UTF-16
+  Text,
+};
+
+/// Tuning for NDEFCorpus::search()
+struct SearchOptions
+{
+  /// Number of threads searching segments of the corpus. 0 uses one per hardware thread
+  size_t threads = 0;
+};
+
+/// Record holding a match. Each record is reported once, at its first match
+struct SearchHit
+{
+  /// Position of the message in the corpus
+  size_t message;
+
+  /// Position of the record in its message
+  size_t record;
+
+  /// Offset of the message's first byte from the start of the corpus
+  size_t offset;
+
+  /// Offset of the match within the searched field, in its decoded form for ::SearchField::Uri and ::SearchField::Text
+  size_t position;
+};
+
+class NDEFCorpus {
+public:
+  /// Maps a capture file of back to back messages into memory and frames it
+  /// \param path capture file to search
+  /// \throws NDEFException if the file cannot be mapped, holds a malformed message or ends in the middle of a message
+  explicit NDEFCorpus(const std::string& path);
+
+  /// Frames back to back messages held by the caller. \p data must outlive the corpus
+  /// \param data encoded messages
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if a message is malformed or \p data ends in the middle of a message
+  NDEFCorpus(const uint8_t* data, size_t len);
+
+  /// \return number of messages in the corpus
+  size_t message_count() const { return this->offsets.size(); }
+
+  /// \return pointer to the first byte of the corpus
+  const uint8_t* data() const { return this->bytes; }
+
+  /// \return number of bytes in the corpus
+  size_t size() const { return this->length; }
+
+  /// \param index position of the message in the corpus
+  /// \return offset of the message's first byte from the start of the corpus
+  size_t message_offset(size_t index) const { return this->offsets.at(index); }
+
+  /// \param index position of the message in the corpus
+  /// \return view of the message at \p index
+  NDEFMessageView message(size_t index) const;
+
+  /// Decodes the message at \p index into owning records. The framing pass has already checked its bytes, so they are
+  /// decoded with ::TrustedDecode
+  /// \param index position of the message in the corpus
+  /// \return message holding copies of its records
+  NDEFMessage to_message(size_t index) const;
+
+  /// Finds every record whose \p field contains \p pattern
+  /// \param field field to look in
+  /// \param pattern bytes to look for. An empty pattern matches every record that has the field
+  /// \param options number of threads
+  /// \return one hit per matching record, in corpus order
+  std::vector<SearchHit> search(SearchField field, const std::vector<uint8_t>& pattern,
+                                const SearchOptions& options = SearchOptions{}) const;
+
+  /// \param field field to look in
+  /// \param pattern UTF-8 text to look for
+  /// \param options number of threads
+  /// \return one hit per matching record, in corpus order
+  std::vector<SearchHit> search(SearchField field, const std::string& pattern,
+                                const SearchOptions& options = SearchOptions{}) const
+  {
+    return this->search(field, std::vector<uint8_t>{ pattern.begin(), pattern.end() }, options);
+  }
+
+private:
+  /// Mapping the bytes live in, null when they are borrowed from the caller
+  std::shared_ptr<const NDEFPayloadSource> source;
+
+  const uint8_t* bytes = nullptr;
+  size_t length = 0;
+
+  /// Offset of every message, found by the framing pass
+  std::vector<size_t> offsets;
+
+  /// Records where each message starts
+  void frame();
+};
+
+#endif // CORPUS_SEARCH_HPP
@@ -0,0 +1,195 @@
+/*! Persistent index of the decoded records of a corpus
+ * \file corpus-snapshot.hpp
+ *
+ * Rebuilding in-memory state from a large corpus means decoding every message again on each start. A snapshot file
+ * keeps the result of one decoding pass next to the corpus: where every message and record lies, each record's type
+ * as a handle into a table of distinct types, and the span of each URI and text. Opening a snapshot maps the file and
+ * checks it instead of decoding anything, and records are then read as views straight out of the corpus bytes.
+ *
+ * A snapshot stores the size and a 64 bit hash of the corpus it was built from, and a hash of its own contents.
+ * Opening it against a corpus that differs in either, or a snapshot that was truncated, corrupted or written by a
+ * different build, fails, and the snapshot has to be written again. The file is laid out in host byte order and is
+ * not meant to move between machines.
+ */
+
+#ifndef CORPUS_SNAPSHOT_HPP
+#define CORPUS_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ndef-lite/corpus-search.hpp"
+#include "ndef-lite/payload-source.hpp"
+#include "ndef-lite/record-type.hpp"
+#include "ndef-lite/record-view.hpp"
+
+/// Decoded value a snapshot keeps for a record
+enum class SnapshotValue : uint8_t {
+  /// Record is neither a URI nor a Text record, or its payload could not be decoded
+  None,
+
+  /// URI of a URI record after its prefix code, or the TYPE field of an Absolute URI record
+  Uri,
+
+  /// Text of a Text record after its locale, in UTF-8
+  Text,
+};
+
+/// One record as laid out in a snapshot file. Offsets are from the start of the corpus
+struct SnapshotRecord
+{
+  /// Offset of the record's header byte
+  uint64_t offset;
+
+  /// Offset of the decoded value, in the corpus or, if value_in_snapshot is set, in the snapshot's text area
+  uint64_t value_offset;
+
+  /// Position of the record's message in the corpus
+  uint32_t message;
+
+  /// Handle of the record's TNF and TYPE field, see NDEFCorpusSnapshot::type()
+  uint32_t type;
+
+  /// Length of the PAYLOAD field
+  uint32_t payload_length;
+
+  /// Length of the decoded value
+  uint32_t value_length;
+
+  /// Offset of the PAYLOAD field from the record's header byte
+  uint16_t payload_offset;
+
+  /// Header byte of the record, flags and TNF
+  uint8_t header;
+
+  /// Length of the ID field
+  uint8_t id_length;
+
+  /// ::SnapshotValue held in value_offset and value_length
+  uint8_t value;
+
+  /// Whether the value was converted from UTF-16 and lives in the snapshot rather than the corpus
+  uint8_t value_in_snapshot;
+
+  /// URI identifier code of URI records
+  uint8_t uri_prefix;
+
+  /// Length of the locale of Text records, which starts at the second byte of the payload
+  uint8_t locale_length;
+};
+
+/// Read-only snapshot of a corpus, mapped from a file
+class NDEFCorpusSnapshot {
+public:
+  /// Frames and decodes every message of \p corpus, and writes the snapshot to \p path. The file is written under a
+  /// temporary name and renamed into place, so a reader never sees a partial snapshot
+  /// \param path snapshot file to write
+  /// \param corpus framed messages
+  /// \throws NDEFException if the file cannot be written
+  static void write(const std::string& path, const NDEFCorpus& corpus);
+
+  /// Maps the snapshot at \p path and checks it against \p data without framing or decoding any message. \p data must
+  /// outlive the snapshot
+  /// \param path snapshot file to map
+  /// \param data back to back encoded messages the snapshot was written for
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if the file cannot be mapped, is corrupt, or was written for different corpus bytes
+  NDEFCorpusSnapshot(const std::string& path, const uint8_t* data, size_t len);
+
+  /// \param path snapshot file to map
+  /// \param corpus corpus the snapshot was written for. Must outlive the snapshot
+  /// \throws NDEFException if the file cannot be mapped, is corrupt, or was written for a different corpus
+  NDEFCorpusSnapshot(const std::string& path, const NDEFCorpus& corpus)
+      : NDEFCorpusSnapshot(path, corpus.data(), corpus.size())
+  {
+  }
+
+  /// Opens the snapshot at \p path, writing it again from \p corpus first if it is missing or does not match
+  /// \param path snapshot file
+  /// \param corpus corpus the snapshot is for. Must outlive the snapshot
+  /// \return snapshot of \p corpus
+  /// \throws NDEFException if the snapshot cannot be written
+  static std::unique_ptr<NDEFCorpusSnapshot> open_or_write(const std::string& path, const NDEFCorpus& corpus);
+
+  /// \return number of messages in the corpus
+  size_t message_count() const { return this->messages; }
+
+  /// \return number of records in the corpus
+  size_t record_count() const { return this->records; }
+
+  /// \return number of distinct record types in the corpus
+  size_t type_count() const { return this->types; }
+
+  /// \param message position of the message in the corpus
+  /// \return offset of the message's first byte from the start of the corpus
+  size_t message_offset(size_t message) const;
+
+  /// \param message position of the message in the corpus
+  /// \return position of the message's first record
+  size_t first_record(size_t message) const;
+
+  /// \param message position of the message in the corpus
+  /// \return position one past the message's last record
+  size_t end_record(size_t message) const { return this->first_record(message + 1); }
+
+  /// \param message position of the message in the corpus
+  /// \return view of the message, indexed from the snapshot
+  NDEFMessageView message(size_t message) const;
+
+  /// \param index position of the record in the corpus
+  /// \return record as stored in the snapshot
+  const SnapshotRecord& record(size_t index) const;
+
+  /// \param index position of the record in the corpus
+  /// \return view of the record, laid out from the snapshot
+  NDEFRecordView view(size_t index) const;
+
+  /// \param handle type handle from SnapshotRecord::type
+  /// \return TNF and TYPE field the handle stands for
+  NDEFRecordType type(uint32_t handle) const;
+
+  /// \param handle type handle from SnapshotRecord::type
+  /// \return TYPE field the handle stands for
+  ByteSpan type_name(uint32_t handle) const;
+
+  /// \param index position of the record in the corpus
+  /// \return decoded URI, after the prefix code, or text of the record. Empty if it has neither
+  ByteSpan value(size_t index) const;
+
+  /// \param index position of the record in the corpus
+  /// \return full URI of a URI or Absolute URI record, prefix expanded
+  /// \throws NDEFException if the record is not a URI record
+  std::string uri(size_t index) const;
+
+  /// \param index position of the record in the corpus
+  /// \return locale of a Text record, empty for other records
+  ByteSpan locale(size_t index) const;
+
+private:
+  struct Header;
+  struct Message;
+  struct Type;
+
+  /// Mapping of the snapshot file
+  std::shared_ptr<const NDEFPayloadSource> source;
+
+  const uint8_t* corpus = nullptr;
+  size_t corpus_length = 0;
+
+  size_t messages = 0;
+  size_t records = 0;
+  size_t types = 0;
+
+  const Message* message_table = nullptr;
+  const SnapshotRecord* record_table = nullptr;
+  const Type* type_table = nullptr;
+  const uint8_t* text = nullptr;
+  size_t text_length = 0;
+
+  /// Checks that every offset and handle in the tables stays within the corpus and the snapshot
+  void validate() const;
+};
+
+#endif // CORPUS_SNAPSHOT_HPP
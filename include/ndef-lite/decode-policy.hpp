@@ -0,0 +1,59 @@
+/*! Bounds checking policies for decoding encoded records
+ * \file decode-policy.hpp
+ *
+ * NDEFRecord::decode() and NDEFMessage::decode() are templated on one of these policies, which decides at compile time
+ * whether every length and character is checked:
+ *
+ * - CheckedDecode is for bytes from outside the library, such as a tag read over RF. Every field is bounds checked
+ *   and the TYPE field is validated, and malformed bytes throw an NDEFException. from_bytes() always decodes this way.
+ * - TrustedDecode is for bytes this library encoded itself, or that frame_message() has already accepted, such as a
+ *   cache or a capture file. The checks compile away entirely. Decoding malformed bytes with it is undefined
+ *   behaviour.
+ */
+
+#ifndef DECODE_POLICY_HPP
+#define DECODE_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ndef-lite/exceptions.hpp"
+
+/// Hardened decoding for untrusted input
+struct CheckedDecode
+{
+  static constexpr bool checked = true;
+
+  /// \param available number of bytes left in the input
+  /// \param needed number of bytes \p field occupies
+  /// \param field name of the field, for the error message
+  /// \throws NDEFException if fewer than \p needed bytes are available
+  static void require(size_t available, size_t needed, const char* field)
+  {
+    if (available < needed) {
+      throw NDEFException("Too few bytes for " + std::string{ field } + " field: require " + std::to_string(needed) +
+                          " have " + std::to_string(available));
+    }
+  }
+
+  /// \param chr byte of a TYPE field
+  /// \throws NDEFException if \p chr is a control character, which the NDEF standard forbids in the TYPE field
+  static void type_character(uint8_t chr)
+  {
+    if (chr <= 31 || chr == 127) {
+      throw NDEFException("Invalid character code " + std::to_string(chr) + " found in type field");
+    }
+  }
+};
+
+/// Unchecked decoding for bytes known to be well formed
+struct TrustedDecode
+{
+  static constexpr bool checked = false;
+
+  static void require(size_t, size_t, const char*) {}
+  static void type_character(uint8_t) {}
+};
+
+#endif // DECODE_POLICY_HPP
@@ -0,0 +1,164 @@
+/*! Capture of the slowest decodes and encodes, with their input bytes
+ * \file exemplar-recorder.hpp
+ *
+ * Latency percentiles say that some operations were slow, not which ones. Once installed, an ExemplarRecorder is
+ * told about every NDEFMessage::from_bytes() and NDEFMessage::as_bytes() call and keeps the slowest few of each per
+ * time window, along with the message bytes (capped) and the size of each record, so that the tag images behind a
+ * latency spike can be written out with dump() and replayed.
+ *
+ * While no recorder is installed the codec pays one relaxed atomic load per call. While one is installed, each call
+ * is timed, and calls faster than the slowest already kept for the window return without taking the recorder's lock.
+ */
+
+#ifndef EXEMPLAR_RECORDER_HPP
+#define EXEMPLAR_RECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/record-type.hpp"
+
+/// Codec call an exemplar was taken from
+enum class CodecOperation {
+  /// NDEFMessage::from_bytes(), the input being the encoded message
+  Decode,
+
+  /// NDEFMessage::as_bytes(), the input being the encoded message produced
+  Encode,
+};
+
+/// Tuning for ExemplarRecorder
+struct ExemplarOptions
+{
+  /// Number of operations of each kind kept per window
+  size_t slowest = 16;
+
+  /// Length of each window
+  std::chrono::milliseconds window{ 60000 };
+
+  /// Number of windows kept, the current one included. Older windows are dropped as new ones start
+  size_t windows_kept = 2;
+
+  /// Encoded bytes kept per operation. Longer messages are cut short, their full size still being reported
+  size_t max_input_bytes = 4096;
+};
+
+/// Size of one record of an exemplar
+struct ExemplarRecord
+{
+  NDEFRecordType::TypeID tnf;
+  size_t type_length;
+  size_t id_length;
+  size_t payload_length;
+};
+
+/// One slow operation
+struct Exemplar
+{
+  CodecOperation operation;
+
+  /// Number of the window it was kept in, counted from 0 at the recorder's first operation
+  uint64_t window;
+
+  /// Wall clock time the operation finished at
+  std::chrono::system_clock::time_point finished;
+
+  /// Time the operation took
+  std::chrono::nanoseconds duration;
+
+  /// Whether the operation threw. Failed decodes have no record breakdown
+  bool failed;
+
+  /// Size of the whole encoded message
+  size_t input_length;
+
+  /// Leading bytes of the encoded message, at most ExemplarOptions::max_input_bytes of them
+  std::vector<uint8_t> bytes;
+
+  /// Every record of the message, in order
+  std::vector<ExemplarRecord> records;
+};
+
+/// Thread-safe record of the slowest codec operations per time window
+class ExemplarRecorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \throws NDEFException if ExemplarOptions::slowest, ExemplarOptions::window or ExemplarOptions::windows_kept is 0
+  explicit ExemplarRecorder(const ExemplarOptions& options = ExemplarOptions{});
+
+  ExemplarRecorder(const ExemplarRecorder&) = delete;
+  ExemplarRecorder& operator=(const ExemplarRecorder&) = delete;
+
+  /// Makes \p recorder the one every NDEFMessage::from_bytes() and NDEFMessage::as_bytes() call reports to
+  /// \param recorder recorder to install, or nullptr to stop recording
+  static void install(std::shared_ptr<ExemplarRecorder> recorder);
+
+  /// \return installed recorder, or nullptr when none is
+  static std::shared_ptr<ExemplarRecorder> installed();
+
+  /// Reports one operation, kept if it is among the slowest of its kind in the window it finished in
+  /// \param operation kind of operation
+  /// \param start time the operation started
+  /// \param end time the operation finished
+  /// \param data encoded message
+  /// \param len number of bytes in \p data
+  /// \param records decoded or encoded records, nullptr if the operation threw
+  void offer(CodecOperation operation, Clock::time_point start, Clock::time_point end, const uint8_t* data,
+             size_t len, const NDEFRecordList* records);
+
+  /// \param operation kind of operation
+  /// \return kept operations of that kind across every kept window, newest window first and slowest first within it
+  std::vector<Exemplar> exemplars(CodecOperation operation) const;
+
+  /// Writes every kept operation to \p path as text, one block per operation:
+  ///
+  ///     exemplar operation=decode window=3 finished_unix_ns=... duration_ns=... failed=0 input_length=... records=2
+  ///     record tnf=1 type_length=1 id_length=0 payload_length=17
+  ///     record ...
+  ///     bytes d1010d55...
+  ///
+  /// \param path file to create or replace
+  /// \throws NDEFException if the file cannot be written
+  void dump(const std::string& path) const;
+
+  /// Drops every kept operation. The window count carries on
+  void clear();
+
+private:
+  static const size_t operation_count = 2;
+
+  /// Operations kept for one window, each list a min-heap on duration
+  struct Window
+  {
+    uint64_t index;
+    std::vector<Exemplar> slowest[operation_count];
+  };
+
+  ExemplarOptions options;
+
+  mutable std::mutex lock;
+  std::deque<Window> windows;
+
+  /// Start of window 0, set by the first operation
+  Clock::time_point origin;
+  bool started = false;
+
+  /// Read without the lock to turn away fast operations: the end of the current window, and the shortest duration
+  /// kept for each kind of operation once the window's list is full (0 until then)
+  std::atomic<int64_t> window_end_ns{ 0 };
+  std::atomic<int64_t> admission_ns[operation_count];
+
+  /// Starts the window \p end falls in, if it is not the current one. Called with the lock held
+  Window& window_for(Clock::time_point end);
+};
+
+#endif // EXEMPLAR_RECORDER_HPP
@@ -0,0 +1,92 @@
+/*! NFC Forum External Type names and dispatch on them
+ * \file external-type.hpp
+ *
+ * External records (TNF 0x04) are named "domain:type", for example "android.com:pkg" for an Android Application
+ * Record. The domain is an internet domain name and so is matched without regard to case. Names are split into views
+ * of the TYPE field in place, and an NDEFExternalDispatch routes records to handlers through a hash table keyed on the
+ * lowercased domain and the type, which is hashed straight from the record without building any strings.
+ */
+
+#ifndef EXTERNAL_TYPE_HPP
+#define EXTERNAL_TYPE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/record-view.hpp"
+
+/// Domain and type of an External type name, pointing into the TYPE field they were parsed from
+struct NDEFExternalType
+{
+  ByteSpan domain;
+  ByteSpan type;
+
+  /// Splits \p name at its first colon
+  /// \param name TYPE field of an External record
+  /// \param out receives the domain and type views
+  /// \return false if \p name has no colon or an empty domain
+  static bool parse(ByteSpan name, NDEFExternalType& out);
+
+  /// \param record record to parse
+  /// \param out receives the domain and type views
+  /// \return false if \p record is not an External record or its TYPE field is not a valid External type name
+  static bool parse(const NDEFRecordView& record, NDEFExternalType& out);
+
+  /// \param domain domain to compare against, in any case
+  /// \return whether #domain equals \p domain, ignoring ASCII case
+  bool domain_is(const std::string& domain) const;
+};
+
+/// \param record record to check
+/// \return whether \p record is an Android Application Record, whose payload is a package name
+bool is_android_application_record(const NDEFRecordView& record);
+
+/// Routes External records to handlers by domain and type
+class NDEFExternalDispatch {
+public:
+  using Handler = std::function<void(const NDEFRecordView&, const NDEFExternalType&)>;
+
+  /// Handler for a domain and type. A type of "*" handles every type of the domain that has no route of its own
+  struct Route
+  {
+    std::string domain;
+    std::string type;
+    Handler handler;
+  };
+
+  /// \param routes routes to build the table from
+  /// \return dispatch table
+  /// \throws NDEFException if two routes share a domain and type
+  static NDEFExternalDispatch compile(std::vector<Route> routes);
+
+  /// \param record record to route
+  /// \return handler for \p record, or nullptr if no route matches
+  const Handler* lookup(const NDEFRecordView& record) const;
+
+  /// Calls the handler for \p record, if there is one
+  /// \param record record to route
+  /// \return whether a handler was called
+  bool dispatch(const NDEFRecordView& record) const;
+
+private:
+  struct Slot
+  {
+    uint64_t hash;
+
+    /// Index into routes plus one, zero for an empty slot
+    uint32_t route;
+  };
+
+  std::vector<Route> routes;
+
+  /// Open addressing table with a power of two size
+  std::vector<Slot> slots;
+
+  const Route* find(uint64_t hash, ByteSpan domain, ByteSpan type, bool wildcard) const;
+  const Route* route_for(const NDEFRecordView& record, NDEFExternalType& name) const;
+};
+
+#endif // EXTERNAL_TYPE_HPP
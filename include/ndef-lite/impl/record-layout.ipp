@@ -0,0 +1,93 @@
+/*! Definitions of the record and message framing pass
+ * \file record-layout.ipp
+ *
+ * Included by record-layout.hpp when NDEF_LITE_INLINE_HOT_PATHS is defined, otherwise by record-layout.cpp.
+ */
+
+#ifndef RECORD_LAYOUT_IPP
+#define RECORD_LAYOUT_IPP
+
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/record-layout.hpp"
+
+/// Frames a single record in place, validating lengths against the bytes available
+NDEF_LITE_HOT FrameStatus frame_record(const uint8_t* data, size_t len, NDEFRecordLayout& layout)
+{
+  // Header and type length are always present
+  if (len < 2) {
+    return FrameStatus::Incomplete;
+  }
+
+  layout.header = NDEFRecordHeader::from_byte(data[0]);
+  layout.type_length = data[1];
+
+  size_t pos = 2;
+
+  // Payload length is 1 byte for short records, otherwise 4 bytes in big endian order
+  if (layout.header.sr) {
+    if (len < pos + 1) {
+      return FrameStatus::Incomplete;
+    }
+    layout.payload_length = data[pos++];
+  } else {
+    if (len < pos + 4) {
+      return FrameStatus::Incomplete;
+    }
+    layout.payload_length = static_cast<uint32_t>(data[pos]) << 24 | static_cast<uint32_t>(data[pos + 1]) << 16 |
+                            static_cast<uint32_t>(data[pos + 2]) << 8 | static_cast<uint32_t>(data[pos + 3]);
+    pos += 4;
+  }
+
+  // ID length is only present when the IL flag is set
+  layout.id_length = 0;
+  if (layout.header.il) {
+    if (len < pos + 1) {
+      return FrameStatus::Incomplete;
+    }
+    layout.id_length = data[pos++];
+  }
+
+  layout.type_offset = pos;
+  layout.id_offset = layout.type_offset + layout.type_length;
+  layout.payload_offset = layout.id_offset + layout.id_length;
+  layout.total_length = layout.payload_offset + layout.payload_length;
+
+  // Type characters can be validated as soon as they are available, no point waiting for the payload
+  size_t type_available = (len > layout.type_offset) ? len - layout.type_offset : 0;
+  for (size_t i = 0; i < layout.type_length && i < type_available; i++) {
+    uint8_t chr = data[layout.type_offset + i];
+    if (chr <= 31 || chr == 127) {
+      return FrameStatus::Malformed;
+    }
+  }
+
+  if (len < layout.total_length) {
+    return FrameStatus::Incomplete;
+  }
+
+  return FrameStatus::Complete;
+}
+
+/// Frames records one after another until the end of the message is found
+NDEF_LITE_HOT FrameStatus frame_message(const uint8_t* data, size_t len, size_t& message_length)
+{
+  size_t pos = 0;
+
+  while (true) {
+    NDEFRecordLayout layout;
+    auto status = frame_record(data + pos, len - pos, layout);
+
+    if (status != FrameStatus::Complete) {
+      return status;
+    }
+
+    pos += layout.total_length;
+
+    if (layout.header.me) {
+      message_length = pos;
+      return FrameStatus::Complete;
+    }
+  }
+}
+
+#endif // RECORD_LAYOUT_IPP
@@ -0,0 +1,47 @@
+/*! Definitions of the NDEFRecordView accessors
+ * \file record-view.ipp
+ *
+ * Included by record-view.hpp when NDEF_LITE_INLINE_HOT_PATHS is defined, otherwise by record-view.cpp.
+ */
+
+#ifndef RECORD_VIEW_IPP
+#define RECORD_VIEW_IPP
+
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/record-view.hpp"
+
+/// Maps the raw TNF bits to a usable type identifier
+NDEF_LITE_HOT NDEFRecordType::TypeID NDEFRecordView::tnf() const
+{
+  // According to NDEF standard any unknown/unsupported TNF field values should be treated as 0x05 Unknown
+  if (this->record_layout.header.tnf == NDEFRecordType::TypeID::Invalid) {
+    return NDEFRecordType::TypeID::Unknown;
+  }
+
+  return this->record_layout.header.tnf;
+}
+
+NDEF_LITE_HOT bool NDEFRecordView::is_well_known(char type) const
+{
+  return this->record_layout.header.tnf == NDEFRecordType::TypeID::WellKnown && this->record_layout.type_length == 1 &&
+         this->record_start[this->record_layout.type_offset] == static_cast<uint8_t>(type);
+}
+
+NDEF_LITE_HOT bool NDEFRecordView::text_span(ByteSpan& locale, ByteSpan& text) const
+{
+  auto payload = this->payload();
+  if (!this->is_well_known('T') || payload.size == 0) {
+    return false;
+  }
+
+  const size_t locale_length = payload.data[0] & 0x3F;
+  if (locale_length >= payload.size) {
+    return false;
+  }
+
+  locale = ByteSpan{ payload.data + 1, locale_length };
+  text = ByteSpan{ payload.data + 1 + locale_length, payload.size - 1 - locale_length };
+  return true;
+}
+
+#endif // RECORD_VIEW_IPP
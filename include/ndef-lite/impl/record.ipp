@@ -0,0 +1,34 @@
+/*! Definitions of the NDEFRecord header encoding
+ * \file record.ipp
+ *
+ * Included by record.hpp when NDEF_LITE_INLINE_HOT_PATHS is defined, otherwise by ndef-record.cpp.
+ */
+
+#ifndef RECORD_IPP
+#define RECORD_IPP
+
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/record.hpp"
+
+/// Creates header byte from information known to NDEF Record. Other values will be set by NDEFMessage
+NDEF_LITE_HOT uint8_t NDEFRecord::header() const
+{
+  uint8_t flags = 0x00;
+
+  // Set Type Name Format field
+  flags |= static_cast<uint8_t>(this->record_type.id());
+
+  // If record < 256 bytes then this is a short record
+  flags |= this->is_short() ? static_cast<uint8_t>(RecordFlag::SR) : 0;
+
+  // If ID field has any value, set ID_LENGTH field
+  flags |= (this->id_field.size() > 0) ? static_cast<uint8_t>(RecordFlag::IL) : 0;
+
+  // Check if record is chunked
+  flags |= this->is_chunked() ? static_cast<uint8_t>(RecordFlag::CF) : 0;
+
+  return flags;
+}
+
+#endif // RECORD_IPP
@@ -0,0 +1,74 @@
+/*! Bulk ingestion of capture files holding back to back NDEF Messages
+ * \file ingest.hpp
+ *
+ * Capture files are read in large blocks with many reads in flight at once. On Linux the reads go through io_uring,
+ * submitted in batches into buffers registered with the kernel up front; elsewhere, or when io_uring is unavailable,
+ * plain pread() is used instead. Messages are framed straight out of the completed blocks and handed to the handler
+ * as views, optionally on a pool of decode workers. Only a message that straddles two blocks is ever copied.
+ */
+
+#ifndef INGEST_HPP
+#define INGEST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/record-view.hpp"
+
+/// Tuning for NDEFCaptureIngest
+struct IngestOptions
+{
+  /// Bytes requested by a single read
+  size_t block_size = 1 << 20;
+
+  /// Maximum number of reads in flight. Twice as many blocks are allocated, so workers can hold on to some blocks
+  /// while reads continue into the others
+  size_t queue_depth = 16;
+
+  /// Number of threads calling the handler. 0 calls it on the thread running ingest()
+  size_t workers = 0;
+
+  /// Whether to try io_uring before falling back to pread()
+  bool use_io_uring = true;
+};
+
+/// Counters for a single call to NDEFCaptureIngest::ingest()
+struct IngestStats
+{
+  uint64_t files;
+  uint64_t bytes_read;
+  uint64_t messages;
+
+  /// Number of system calls made to submit reads and collect completions
+  uint64_t submissions;
+
+  /// Whether the reads went through io_uring
+  bool used_io_uring;
+};
+
+class NDEFCaptureIngest {
+public:
+  /// Called once per message. The view and the bytes under it are only valid until the handler returns
+  using MessageHandler = std::function<void(const NDEFMessageView&)>;
+
+  /// \param options block size, queue depth and worker count
+  /// \throws NDEFException if the block size or queue depth is 0
+  explicit NDEFCaptureIngest(const IngestOptions& options = IngestOptions{});
+
+  /// Reads every file in order, calling \p handler for each message. With workers, messages may be handled out of
+  /// order and \p handler must be safe to call concurrently
+  /// \param paths capture files to read
+  /// \param handler function called with each message
+  /// \return counters for this call
+  /// \throws NDEFException if a file cannot be read, holds a malformed message or ends in the middle of a message.
+  /// Exceptions thrown by \p handler are rethrown once every worker has stopped
+  IngestStats ingest(const std::vector<std::string>& paths, const MessageHandler& handler);
+
+private:
+  IngestOptions options;
+};
+
+#endif // INGEST_HPP
@@ -0,0 +1,23 @@
+/*! Inline hot path build mode
+ * \file inline.hpp
+ *
+ * The few functions that run once per record of every framing and routing loop, such as NDEFRecordHeader::from_byte()
+ * and frame_record(), are defined in the ndef-lite/impl/ files rather than in the sources. By default each is compiled
+ * once into the library, like the rest of it, so a program linked against the shared library calls across the library
+ * boundary for every record.
+ *
+ * Defining NDEF_LITE_INLINE_HOT_PATHS, which the static ndef-lite-static target does for everything that links it,
+ * makes the headers include those definitions as inline functions instead, so the compiler can inline them into the
+ * caller's loops. Every translation unit of a program, and the library it links, must agree on the macro.
+ */
+
+#ifndef NDEF_LITE_INLINE_HPP
+#define NDEF_LITE_INLINE_HPP
+
+#ifdef NDEF_LITE_INLINE_HOT_PATHS
+#define NDEF_LITE_HOT inline
+#else
+#define NDEF_LITE_HOT
+#endif
+
+#endif // NDEF_LITE_INLINE_HPP
@@ -0,0 +1,160 @@
+/*! Encoded message bytes together with a view over them
+ * \file message-buffer.hpp
+ *
+ * Besides holding bytes for the pipeline, a buffer can edit the message it holds without decoding it. Each edit
+ * rewrites only the fields of the records it touches (flags, length fields, TYPE, ID, PAYLOAD), moves the bytes after
+ * them once, and updates the view's record index instead of framing the message again.
+ */
+
+#ifndef MESSAGE_BUFFER_HPP
+#define MESSAGE_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/record-type.hpp"
+#include "ndef-lite/record-view.hpp"
+#include "ndef-lite/record.hpp"
+
+/// Owns the bytes of one encoded message and keeps an NDEFMessageView framed over them
+///
+/// Moving a buffer keeps the view valid, since moving the underlying vector does not move its storage. Buffers are
+/// meant to be recycled through a RecyclingChannel, so assign() reuses both the byte storage and the view's record
+/// index instead of allocating new ones
+class NDEFMessageBuffer {
+public:
+  NDEFMessageBuffer() {}
+  NDEFMessageBuffer(NDEFMessageBuffer&&) = default;
+  NDEFMessageBuffer& operator=(NDEFMessageBuffer&&) = default;
+
+  // Copying would leave the view pointing into the source buffer
+  NDEFMessageBuffer(const NDEFMessageBuffer&) = delete;
+  NDEFMessageBuffer& operator=(const NDEFMessageBuffer&) = delete;
+
+  /// Copies \p len bytes into the buffer and frames them
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if the bytes are truncated or malformed
+  void assign(const uint8_t* data, size_t len)
+  {
+    this->storage.assign(data, data + len);
+    this->message_view.open(this->storage.data(), this->storage.size());
+  }
+
+  /// \param bytes encoded message bytes to copy into the buffer and frame
+  /// \throws NDEFException if the bytes are truncated or malformed
+  void assign(const std::vector<uint8_t>& bytes) { this->assign(bytes.data(), bytes.size()); }
+
+  /// Takes ownership of \p bytes without copying and frames them
+  /// \param bytes encoded message bytes
+  /// \throws NDEFException if the bytes are truncated or malformed
+  void assign(std::vector<uint8_t>&& bytes)
+  {
+    this->storage = std::move(bytes);
+    this->message_view.open(this->storage.data(), this->storage.size());
+  }
+
+  /// Copies the bytes of a message that is already framed, taking over its record index instead of framing again
+  /// \param view framed message to copy
+  void assign(const NDEFMessageView& view);
+
+  /// Empties the buffer, keeping its capacity for reuse
+  void clear()
+  {
+    this->storage.clear();
+    this->message_view.clear();
+  }
+
+  /// \return view of the framed records
+  const NDEFMessageView& view() const { return this->message_view; }
+
+  /// \return encoded bytes held by the buffer
+  const std::vector<uint8_t>& bytes() const { return this->storage; }
+
+  // In-place editing. Every edit invalidates views and spans previously taken from view(), and the bytes passed to
+  // an edit must not point into this buffer. Edits of a record index outside the message throw std::out_of_range
+
+  /// Replaces the PAYLOAD field of a record, switching between short and long payload length as needed
+  /// \param index position of the record in the message
+  /// \param data new payload bytes
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if the payload is longer than a record can hold, or not empty for an Empty record
+  void replace_payload(size_t index, const uint8_t* data, size_t len);
+
+  /// \param index position of the record in the message
+  /// \param payload new payload bytes
+  /// \throws NDEFException if the payload is longer than a record can hold, or not empty for an Empty record
+  void replace_payload(size_t index, const std::vector<uint8_t>& payload)
+  {
+    this->replace_payload(index, payload.data(), payload.size());
+  }
+
+  /// Replaces the Type Name Format and TYPE field of a record
+  /// \param index position of the record in the message
+  /// \param type new type of the record
+  /// \throws NDEFException if the type is invalid, longer than 255 bytes or holds forbidden characters, or if the TNF
+  /// does not allow the record's fields: Empty records have no TYPE, ID or payload, Unknown and Unchanged ones no TYPE
+  void replace_type(size_t index, const NDEFRecordType& type);
+
+  /// Replaces the ID field of a record. An empty \p id removes the field and clears the IL flag
+  /// \param index position of the record in the message
+  /// \param id new ID of the record
+  /// \throws NDEFException if the ID is longer than 255 bytes, or not empty for an Empty record
+  void replace_id(size_t index, const std::string& id);
+
+  /// Encodes \p record in front of the record at \p index, or after the last one when \p index is record_count()
+  /// \param index position the record will have in the message
+  /// \param record record to insert
+  void insert_record(size_t index, const NDEFRecord& record);
+
+  /// Copies an encoded record, from any buffer, in front of the record at \p index
+  /// \param index position the record will have in the message
+  /// \param record view of the record to insert
+  void insert_record(size_t index, const NDEFRecordView& record);
+
+  /// \param index position of the record to remove. Removing the only record leaves an empty buffer
+  void remove_record(size_t index);
+
+  /// Moves a record so that it ends up at position \p to, shifting the records in between by one
+  /// \param from position of the record to move
+  /// \param to position the record will have in the message
+  void move_record(size_t from, size_t to);
+
+  /// Appends every record of \p other to this message
+  /// \param other message to append. May be this buffer
+  void append(const NDEFMessageBuffer& other);
+
+  /// Moves the records from \p index onwards into a message of their own
+  /// \param index position of the first record to move
+  /// \return buffer holding the moved records, empty when \p index is record_count()
+  NDEFMessageBuffer split(size_t index);
+
+private:
+  /// Re-encodes every field of a record in front of its payload, and the payload too if \p payload is given
+  void rewrite_record(size_t index, NDEFRecordType::TypeID tnf, ByteSpan type, ByteSpan id,
+                      const ByteSpan* payload);
+
+  /// Copies one encoded record with the given layout into the message at \p index
+  void insert_encoded(size_t index, const uint8_t* data, const NDEFRecordLayout& layout);
+
+  /// Makes room for \p new_len bytes in place of the \p old_len bytes at \p pos, moving the bytes after them once
+  /// \return pointer to the first byte of the room made
+  uint8_t* resize_range(size_t pos, size_t old_len, size_t new_len);
+
+  /// Adds \p delta to the offset of every record from \p first onwards and to the message length, and points the
+  /// view at the current storage
+  void shift_records(size_t first, ptrdiff_t delta);
+
+  /// Sets the MB and ME flags of the record at \p index to match its position in the message
+  void update_position_flags(size_t index);
+
+  /// \throws std::out_of_range if \p index does not refer to a record
+  void check_index(size_t index) const;
+
+  std::vector<uint8_t> storage;
+  NDEFMessageView message_view;
+};
+
+#endif // MESSAGE_BUFFER_HPP
@@ -1,9 +1,11 @@
 #ifndef MESSAGE_HPP
 #define MESSAGE_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "ndef-lite/record-codec.hpp"
 #include "ndef-lite/record-type.hpp"
 #include "ndef-lite/record.hpp"
 
@@ -28,12 +30,60 @@ public:
   size_t record_count() const { return this->message_records.size(); }
   bool is_valid() const;
 
+  /// Sets the codec applied to each record when the message is encoded. Records are held unencoded in the message
+  /// \param codec codec to apply, or nullptr to encode records as they are
+  void set_codec(std::shared_ptr<const NDEFRecordCodec> codec) { this->record_codec = std::move(codec); }
+
+  /// \return codec applied to each record when the message is encoded, or nullptr
+  const std::shared_ptr<const NDEFRecordCodec>& codec() const { return this->record_codec; }
+
+  /// \return encoded message, empty if the message is invalid. Reported to the installed ::ExemplarRecorder, if any
   std::vector<uint8_t> as_bytes() const;
 
+  /// Writes the encoded message to \p fd. Record headers and in-memory payloads are written from memory, payloads
+  /// with an NDEFPayloadSource are transferred by the source without passing through user space where possible
+  /// \param fd file, socket or pipe to write to
+  /// \throws NDEFException if the message is invalid or writing fails
+  void write_to(int fd) const;
+
+  /// Decodes every record in \p data with ::CheckedDecode, stopping early at a record whose TYPE field is longer than
+  /// the bytes left. Reported to the installed ::ExemplarRecorder, if any
+  /// \param data encoded message bytes
+  /// \param offset byte offset to start from
+  /// \return message holding the decoded records
+  /// \throws NDEFException if a record is truncated or malformed
   static NDEFMessage from_bytes(const std::vector<uint8_t>& data, uint offset = 0);
 
+  /// Decodes every record in \p data, checking them as \p Policy requires. Instantiated for ::CheckedDecode and
+  /// ::TrustedDecode
+  /// \tparam Policy ::CheckedDecode for untrusted bytes, ::TrustedDecode for bytes known to be well formed
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  /// \return message holding the decoded records
+  /// \throws NDEFException with ::CheckedDecode, if a record is truncated or malformed
+  template <typename Policy>
+  static NDEFMessage decode(const uint8_t* data, size_t len);
+
+  /// Decodes a message whose records were encoded with \p codec, which is then set on the returned message
+  /// \param data encoded message bytes
+  /// \param codec codec to undo on each record
+  /// \param offset byte offset to start from
+  /// \return message holding the decoded records
+  /// \throws NDEFException if \p codec fails to decode one of its records
+  static NDEFMessage from_bytes(const std::vector<uint8_t>& data, std::shared_ptr<const NDEFRecordCodec> codec,
+                                uint offset = 0);
+
 private:
   NDEFRecordList message_records;
+  std::shared_ptr<const NDEFRecordCodec> record_codec;
+
+  /// \param index position of the record in the message
+  /// \param scratch holds the encoded record if the codec rewrites it
+  /// \return record as it will be encoded, after the codec if there is one
+  const NDEFRecord& encoded_record(size_t index, NDEFRecord& scratch) const;
+
+  /// \return encoded message, empty if the message is invalid
+  std::vector<uint8_t> encode() const;
 };
 
 #endif // MESSAGE_HPP
\ No newline at end of file
@@ -0,0 +1,191 @@
+/*! C interface for FFI consumers
+ * \file ndef-lite.h
+ *
+ * A C ABI over the framing, view and in-place editing code, for Go, Python and other callers that cannot use the C++
+ * API. Nothing crosses the boundary by value except plain structs: messages are opaque handles, bytes coming out of
+ * the library are borrowed pointer and length views into buffers the caller or a handle owns, and bytes going into
+ * the library are written to buffers the caller provides. The batch calls decode or encode many messages per call, so
+ * a caller pays for one crossing per batch instead of several per record.
+ *
+ * No function throws. Each returns an ::ndef_status, and the text of the most recent failure on the calling thread
+ * is available from ndef_last_error(). Handles are not thread-safe, but distinct handles may be used from distinct
+ * threads.
+ *
+ * The layout of every struct in this header, and the meaning of every value, only changes together with
+ * NDEF_LITE_C_ABI_VERSION.
+ */
+
+#ifndef NDEF_LITE_H
+#define NDEF_LITE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Version of the C ABI described by this header, compare against ndef_abi_version() at load time
+#define NDEF_LITE_C_ABI_VERSION 1
+
+/// Outcome of a call
+typedef enum ndef_status {
+  NDEF_OK = 0,
+
+  /// A pointer was null, a length too large for its field, or a TNF or TYPE not allowed by the NDEF standard
+  NDEF_ERR_INVALID_ARGUMENT = -1,
+
+  /// Input bytes are not a well formed NDEF message
+  NDEF_ERR_MALFORMED = -2,
+
+  /// Input bytes end in the middle of a message
+  NDEF_ERR_TRUNCATED = -3,
+
+  /// An output buffer is too small. Calls say which count holds the size needed
+  NDEF_ERR_BUFFER_TOO_SMALL = -4,
+
+  /// A record index does not refer to a record of the message
+  NDEF_ERR_OUT_OF_RANGE = -5,
+
+  /// Memory could not be allocated, or any other failure
+  NDEF_ERR_INTERNAL = -6,
+} ndef_status;
+
+/// Type Name Format values, as stored in the low 3 bits of a record header
+typedef enum ndef_tnf {
+  NDEF_TNF_EMPTY = 0x00,
+  NDEF_TNF_WELL_KNOWN = 0x01,
+  NDEF_TNF_MIME_MEDIA = 0x02,
+  NDEF_TNF_ABSOLUTE_URI = 0x03,
+  NDEF_TNF_EXTERNAL = 0x04,
+  NDEF_TNF_UNKNOWN = 0x05,
+  NDEF_TNF_UNCHANGED = 0x06,
+} ndef_tnf;
+
+/// Borrowed range of bytes. Valid for as long as the buffer it points into, see each call
+typedef struct ndef_bytes {
+  const uint8_t* data;
+  size_t size;
+} ndef_bytes;
+
+/// Fields of one record. Filled with views into the decoded bytes by the library, or filled by the caller with the
+/// fields of a record to encode
+typedef struct ndef_record_info {
+  /// ::ndef_tnf of the record
+  uint8_t tnf;
+
+  /// Header byte of a decoded record, flags and TNF. Only the chunk flag (0x20) is read when encoding
+  uint8_t header;
+
+  ndef_bytes type;
+  ndef_bytes id;
+  ndef_bytes payload;
+} ndef_record_info;
+
+/// Where one message of a batch lies, and which of the batch's records are its own
+typedef struct ndef_message_info {
+  /// Offset of the message's first byte in the batch buffer
+  size_t offset;
+
+  /// Number of bytes the message occupies
+  size_t size;
+
+  /// Position of the message's first record in the batch's records
+  size_t first_record;
+
+  /// Number of records in the message
+  size_t record_count;
+} ndef_message_info;
+
+/// Opaque encoded message, either owning its bytes or borrowing the caller's
+typedef struct ndef_message ndef_message;
+
+/// \return NDEF_LITE_C_ABI_VERSION the library was built with
+int ndef_abi_version(void);
+
+/// \return text describing the most recent failure on the calling thread, never null. Valid until the next failing
+///   call on the same thread
+const char* ndef_last_error(void);
+
+/// \return new message without records, or null if memory runs out. Release with ndef_message_free()
+ndef_message* ndef_message_new(void);
+
+/// Releases \p msg and everything it owns. Accepts null
+void ndef_message_free(ndef_message* msg);
+
+/// Copies and frames one encoded message, replacing the contents of \p msg. Bytes after the message are ignored
+/// \return ::NDEF_OK, ::NDEF_ERR_MALFORMED or ::NDEF_ERR_TRUNCATED. \p msg is left empty on failure
+ndef_status ndef_message_decode(ndef_message* msg, const uint8_t* data, size_t len);
+
+/// Frames one encoded message without copying it. \p data must outlive \p msg or its next decode. The first edit of
+/// the message copies the bytes into \p msg
+/// \return ::NDEF_OK, ::NDEF_ERR_MALFORMED or ::NDEF_ERR_TRUNCATED. \p msg is left empty on failure
+ndef_status ndef_message_borrow(ndef_message* msg, const uint8_t* data, size_t len);
+
+/// \return number of records in \p msg
+size_t ndef_message_record_count(const ndef_message* msg);
+
+/// \param index position of the record in the message
+/// \param record set to views into the message's bytes, valid until \p msg is edited, decoded into or freed
+/// \return ::NDEF_OK or ::NDEF_ERR_OUT_OF_RANGE
+ndef_status ndef_message_record(const ndef_message* msg, size_t index, ndef_record_info* record);
+
+/// Fills \p records with every record of the message in one call
+/// \param records array of \p capacity entries, set to views valid until \p msg is edited, decoded into or freed
+/// \param count set to the number of records in the message
+/// \return ::NDEF_OK, or ::NDEF_ERR_BUFFER_TOO_SMALL if \p capacity is less than \p count
+ndef_status ndef_message_records(const ndef_message* msg, ndef_record_info* records, size_t capacity, size_t* count);
+
+/// \param bytes set to the encoded message, valid until \p msg is edited, decoded into or freed
+ndef_status ndef_message_bytes(const ndef_message* msg, ndef_bytes* bytes);
+
+/// Copies the encoded message into a caller buffer
+/// \param written set to the size of the encoded message, whether or not it fits
+/// \return ::NDEF_OK, or ::NDEF_ERR_BUFFER_TOO_SMALL if \p capacity is less than \p written
+ndef_status ndef_message_encode(const ndef_message* msg, uint8_t* out, size_t capacity, size_t* written);
+
+/// Encodes \p record in front of the record at \p index, or after the last one when \p index is the record count
+/// \return ::NDEF_OK, ::NDEF_ERR_INVALID_ARGUMENT or ::NDEF_ERR_OUT_OF_RANGE
+ndef_status ndef_message_insert(ndef_message* msg, size_t index, const ndef_record_info* record);
+
+/// Replaces the payload of a record in place, see NDEFMessageBuffer::replace_payload(). \p data must not point into
+/// the bytes of \p msg
+/// \return ::NDEF_OK, ::NDEF_ERR_INVALID_ARGUMENT or ::NDEF_ERR_OUT_OF_RANGE
+ndef_status ndef_message_replace_payload(ndef_message* msg, size_t index, const uint8_t* data, size_t len);
+
+/// \return ::NDEF_OK or ::NDEF_ERR_OUT_OF_RANGE
+ndef_status ndef_message_remove(ndef_message* msg, size_t index);
+
+/// Frames back to back encoded messages in one call, without copying any of them
+///
+/// Decoding stops when either output array is full, leaving the messages decoded so far in place, so a caller can
+/// resume at the end of the last message reported
+/// \param data encoded messages. Record views point into it
+/// \param len number of bytes in \p data
+/// \param messages array of \p message_capacity entries, set to one entry per decoded message
+/// \param message_count set to the number of messages decoded
+/// \param records array of \p record_capacity entries, set to the records of every decoded message in order
+/// \param record_count set to the number of records written
+/// \return ::NDEF_OK once every message is decoded, ::NDEF_ERR_BUFFER_TOO_SMALL if an array filled first, or
+///   ::NDEF_ERR_MALFORMED or ::NDEF_ERR_TRUNCATED for the message after the last one reported
+ndef_status ndef_decode_batch(const uint8_t* data, size_t len, ndef_message_info* messages, size_t message_capacity,
+                              size_t* message_count, ndef_record_info* records, size_t record_capacity,
+                              size_t* record_count);
+
+/// Encodes many messages back to back into a caller buffer, setting the MB and ME flags from record positions
+/// \param records fields of every record, the records of each message following those of the one before
+/// \param record_counts number of records in each message, none may be 0
+/// \param message_count number of entries in \p record_counts
+/// \param out buffer to encode into
+/// \param capacity number of bytes in \p out
+/// \param written set to the number of bytes all messages take, whether or not they fit
+/// \return ::NDEF_OK, ::NDEF_ERR_INVALID_ARGUMENT, or ::NDEF_ERR_BUFFER_TOO_SMALL if \p capacity is less than
+///   \p written, in which case nothing is written to \p out
+ndef_status ndef_encode_batch(const ndef_record_info* records, const size_t* record_counts, size_t message_count,
+                              uint8_t* out, size_t capacity, size_t* written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NDEF_LITE_H
@@ -0,0 +1,113 @@
+/*! Incremental NDEF Message parser
+ * \file parser.hpp
+ *
+ * Decodes an NDEF Message from bytes that arrive in pieces (eg. page by page off of a tag), keeping all partial
+ * progress between calls. Decoding can be bounded by a ::DecodeBudget so that a caller with a latency target can stop,
+ * respond, and resume later without re-parsing any of the records already decoded.
+ */
+
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+
+/// Upper bound on the work a single call to NDEFMessageParser::decode() may perform. A limit of 0 means unlimited
+struct DecodeBudget
+{
+  /// Maximum number of encoded bytes to consume
+  size_t max_bytes;
+
+  /// Maximum number of records to decode
+  size_t max_records;
+
+  /// \return budget with no limits
+  static constexpr DecodeBudget unlimited() { return DecodeBudget{ 0, 0 }; }
+
+  /// \param n maximum number of encoded bytes to consume
+  /// \return budget limited by bytes only
+  static constexpr DecodeBudget bytes(size_t n) { return DecodeBudget{ n, 0 }; }
+
+  /// \param n maximum number of records to decode
+  /// \return budget limited by records only
+  static constexpr DecodeBudget records(size_t n) { return DecodeBudget{ 0, n }; }
+};
+
+/// Outcome of a call to NDEFMessageParser::decode()
+enum class DecodeStatus {
+  /// The record flagged Message End has been decoded, the message is complete
+  Complete,
+
+  /// All buffered bytes have been decoded but the message is not complete yet. Call feed() then decode() again
+  NeedMoreData,
+
+  /// The budget ran out before all buffered bytes were decoded. Call decode() again to resume
+  BudgetExhausted,
+};
+
+class NDEFMessageParser {
+public:
+  NDEFMessageParser() {}
+  ~NDEFMessageParser() = default;
+
+  /// \param data bytes to append to the internal buffer. Nothing is decoded until decode() is called
+  void feed(const std::vector<uint8_t>& data);
+
+  /// \param data pointer to bytes to append to the internal buffer
+  /// \param len number of bytes in \p data
+  void feed(const uint8_t* data, size_t len);
+
+  /// Decodes as many buffered records as \p budget allows. A record is never split across calls; if the first record
+  /// of a call is larger than the byte budget it is decoded anyway so that every call makes progress
+  /// \param budget limit on the work this call may perform
+  /// \return ::DecodeStatus describing where decoding stopped
+  /// \throws NDEFException if the buffered bytes can never form a valid record
+  DecodeStatus decode(const DecodeBudget& budget = DecodeBudget::unlimited());
+
+  /// \return whether the record flagged Message End has been decoded
+  bool is_complete() const { return this->complete; }
+
+  /// \return number of encoded bytes decoded into records so far
+  size_t bytes_consumed() const { return this->consumed; }
+
+  /// \return number of bytes fed but not yet decoded
+  size_t bytes_buffered() const { return this->buffer.size() - this->read_offset; }
+
+  /// \return number of records decoded so far
+  size_t record_count() const { return this->partial.record_count(); }
+
+  /// \return message built from the records decoded so far
+  const NDEFMessage& message() const { return this->partial; }
+
+  /// Moves the decoded message out of the parser and resets it for the next message. Bytes already fed beyond the end
+  /// of the message are kept
+  /// \return message built from the records decoded so far
+  NDEFMessage take_message();
+
+  /// Discards all buffered bytes and decoded records
+  void reset();
+
+private:
+  /// Bytes fed but not yet consumed, starting at read_offset
+  std::vector<uint8_t> buffer;
+
+  /// Position of the next undecoded byte within buffer
+  size_t read_offset = 0;
+
+  /// Total number of bytes consumed into records for the current message
+  size_t consumed = 0;
+
+  /// Records decoded so far for the current message
+  NDEFMessage partial;
+
+  /// Whether the Message End record has been seen
+  bool complete = false;
+
+  /// Drops bytes before read_offset once they make up the bulk of the buffer
+  void compact();
+};
+
+#endif // PARSER_HPP
@@ -0,0 +1,94 @@
+/*! Record payloads that live outside of the record
+ * \file payload-source.hpp
+ *
+ * A payload source stands in for the payload bytes of an NDEFRecord, so that large payloads such as firmware images
+ * never have to be copied into memory. Sources are immutable and shared between copies of a record.
+ *
+ * When a message is written to a file descriptor with NDEFMessage::write_to(), record headers are written from memory
+ * and each payload is transferred by its source: file regions go through splice() or sendfile() so the bytes never
+ * enter user space, and mapped regions are written straight from the mapping.
+ */
+
+#ifndef PAYLOAD_SOURCE_HPP
+#define PAYLOAD_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class NDEFPayloadSource {
+public:
+  /// Length value meaning "up to the end of the file"
+  static constexpr uint64_t to_end = UINT64_MAX;
+
+  virtual ~NDEFPayloadSource() = default;
+
+  /// \return number of payload bytes
+  virtual size_t size() const = 0;
+
+  /// \return payload bytes if they are addressable in memory, otherwise nullptr
+  virtual const uint8_t* data() const { return nullptr; }
+
+  /// Copies the payload into memory
+  /// \return payload bytes
+  /// \throws NDEFException if the payload cannot be read
+  virtual std::vector<uint8_t> read() const = 0;
+
+  /// Writes the whole payload to \p fd, avoiding copies through user space where the platform allows
+  /// \param fd file, socket or pipe to write to
+  /// \throws NDEFException if writing fails
+  virtual void write_to(int fd) const = 0;
+
+  /// Creates a source holding \p bytes in memory. This is how records hold payloads given to NDEFRecord::set_payload()
+  /// \param bytes payload bytes
+  /// \return shared source whose data() is never nullptr
+  static std::shared_ptr<const NDEFPayloadSource> from_bytes(std::vector<uint8_t> bytes);
+
+  /// Creates a source backed by a region of an open file. The region is read on demand, so later changes to the file
+  /// are visible
+  /// \param fd open file. Duplicated, the caller keeps ownership of \p fd
+  /// \param offset first byte of the region
+  /// \param length number of bytes in the region, or ::to_end
+  /// \return shared source
+  /// \throws NDEFException if the region lies outside of the file or is too large for a record
+  static std::shared_ptr<const NDEFPayloadSource> from_fd(int fd, uint64_t offset = 0, uint64_t length = to_end);
+
+  /// Opens \p path and creates a source backed by a region of it
+  /// \param path file to open
+  /// \param offset first byte of the region
+  /// \param length number of bytes in the region, or ::to_end
+  /// \return shared source
+  /// \throws NDEFException if the file cannot be opened or the region lies outside of it
+  static std::shared_ptr<const NDEFPayloadSource> from_file(const std::string& path, uint64_t offset = 0,
+                                                            uint64_t length = to_end);
+
+  /// Maps a region of \p path read-only. The bytes are addressable through data() for as long as the source lives
+  /// \param path file to map
+  /// \param offset first byte of the region
+  /// \param length number of bytes in the region, or ::to_end
+  /// \return shared source
+  /// \throws NDEFException if the file cannot be mapped, the region lies outside of it or is too large for a record
+  static std::shared_ptr<const NDEFPayloadSource> map_file(const std::string& path, uint64_t offset = 0,
+                                                           uint64_t length = to_end);
+
+  /// Maps a region of \p path read-only like map_file(), without limiting it to the size of one record's payload.
+  /// For files holding many messages, such as capture files and corpus snapshots
+  /// \param path file to map
+  /// \param offset first byte of the region
+  /// \param length number of bytes in the region, or ::to_end
+  /// \return shared source
+  /// \throws NDEFException if the file cannot be mapped or the region lies outside of it
+  static std::shared_ptr<const NDEFPayloadSource> map_large_file(const std::string& path, uint64_t offset = 0,
+                                                                 uint64_t length = to_end);
+
+  /// Writes bytes from memory to \p fd, retrying short and interrupted writes
+  /// \param fd file, socket or pipe to write to
+  /// \param data bytes to write
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if writing fails
+  static void write_bytes(int fd, const uint8_t* data, size_t len);
+};
+
+#endif // PAYLOAD_SOURCE_HPP
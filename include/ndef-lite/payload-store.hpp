@@ -0,0 +1,88 @@
+/*! Content-addressed store of record payloads
+ * \file payload-store.hpp
+ *
+ * Large decoded corpora repeat the same payloads many times over: the same marketing URI or vCard on thousands of
+ * tags. Interning payloads into an NDEFPayloadStore keeps one copy of each distinct payload, shared by every record
+ * that carries it through the record's payload handle. Stored payloads are reference counted by their handles and
+ * leave the store when the last record holding them lets go. The store is split into shards, each with its own lock,
+ * chosen by the payload's hash so that threads interning different payloads rarely contend.
+ */
+
+#ifndef PAYLOAD_STORE_HPP
+#define PAYLOAD_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ndef-lite/payload-source.hpp"
+#include "ndef-lite/record-view.hpp"
+#include "ndef-lite/record.hpp"
+
+/// Counters describing the contents of an NDEFPayloadStore
+struct PayloadStoreStats
+{
+  /// Distinct payloads held
+  size_t payloads = 0;
+
+  /// Bytes held across distinct payloads
+  size_t bytes = 0;
+
+  /// intern() calls answered with a payload already in the store
+  size_t hits = 0;
+
+  /// intern() calls that added a payload
+  size_t misses = 0;
+};
+
+/// Thread-safe store that deduplicates payloads by content
+class NDEFPayloadStore {
+public:
+  /// \param shards number of independently locked shards, rounded up to a power of two
+  explicit NDEFPayloadStore(size_t shards = 16);
+  ~NDEFPayloadStore();
+
+  NDEFPayloadStore(const NDEFPayloadStore&) = delete;
+  NDEFPayloadStore& operator=(const NDEFPayloadStore&) = delete;
+
+  /// \param data payload bytes
+  /// \param len number of bytes in \p data
+  /// \return handle to the stored copy of the bytes, shared with every other handle to equal bytes
+  std::shared_ptr<const NDEFPayloadSource> intern(const uint8_t* data, size_t len);
+
+  /// \param bytes payload bytes, moved into the store if they are not already held
+  /// \return handle to the stored copy of the bytes
+  std::shared_ptr<const NDEFPayloadSource> intern(std::vector<uint8_t>&& bytes);
+
+  /// Replaces the payload of \p record with the stored copy of it. Records with a payload source that is not in
+  /// memory are left alone
+  /// \param record record to deduplicate
+  void intern(NDEFRecord& record);
+
+  /// Builds an owning record from a view, with its payload interned straight from the view's buffer
+  /// \param view record to copy
+  /// \return record whose payload handle points into the store
+  NDEFRecord to_record(const NDEFRecordView& view);
+
+  /// \return current counters, summed over every shard
+  PayloadStoreStats stats() const;
+
+  /// \param data bytes to hash
+  /// \param len number of bytes in \p data
+  /// \return 64 bit content hash used to address payloads
+  static uint64_t hash(const uint8_t* data, size_t len);
+
+private:
+  struct Shard;
+  class StoredPayload;
+
+  /// Shared with each stored payload, so payloads can remove themselves after the store is gone
+  std::vector<std::shared_ptr<Shard>> shards;
+
+  template <typename MakeBytes>
+  std::shared_ptr<const NDEFPayloadSource> intern_hashed(uint64_t hash, const uint8_t* data, size_t len,
+                                                         MakeBytes make_bytes);
+};
+
+#endif // PAYLOAD_STORE_HPP
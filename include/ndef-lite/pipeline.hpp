@@ -0,0 +1,134 @@
+/*! Staged processing pipeline from raw reader bytes to a sink
+ * \file pipeline.hpp
+ *
+ * A pipeline is a fixed chain of stages:
+ *
+ * source (byte chunks) -> frame -> filter by record -> transform -> encode -> sink
+ *
+ * Stages hand NDEFMessageBuffer objects to each other through bounded SPSC queues, in batches. A full queue stalls
+ * the stage feeding it, so a slow sink throttles the source instead of growing memory. Buffers come from a shared
+ * pool and are returned to it by whichever stage drops or finishes with them.
+ *
+ * Messages stay as encoded bytes and views for as long as possible: filtering works on record views, and a message is
+ * only decoded into an NDEFMessage if a transform is installed.
+ */
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/record-type.hpp"
+#include "ndef-lite/record-view.hpp"
+
+/// Result of running one step of a stage
+enum class StageStatus {
+  /// The stage moved at least one item
+  Progress,
+
+  /// The stage could not move anything, its input is empty or its output is full
+  Idle,
+
+  /// The stage has processed everything it will ever receive
+  Done,
+};
+
+/// A single step of a pipeline stage. Steps never block, so any executor can interleave them
+using StageStep = std::function<StageStatus()>;
+
+/// Runs pipeline stages until every one of them reports ::StageStatus::Done
+class PipelineExecutor {
+public:
+  virtual ~PipelineExecutor() = default;
+
+  /// \param stages steps of every stage, in pipeline order
+  virtual void run(const std::vector<StageStep>& stages) = 0;
+};
+
+/// Runs every stage on its own thread, yielding the thread whenever a stage is idle
+class ThreadPerStageExecutor : public PipelineExecutor {
+public:
+  void run(const std::vector<StageStep>& stages) override;
+};
+
+/// Runs every stage on the calling thread, stepping them round robin like cooperatively scheduled coroutines
+class CooperativeExecutor : public PipelineExecutor {
+public:
+  void run(const std::vector<StageStep>& stages) override;
+};
+
+/// Tuning for queues between stages
+struct PipelineOptions
+{
+  /// Minimum number of buffers each inter-stage queue holds
+  size_t queue_capacity = 64;
+
+  /// Maximum number of buffers a stage takes from its input per step
+  size_t batch_size = 16;
+};
+
+/// Counters describing one run of a pipeline
+struct PipelineStats
+{
+  /// Messages framed from the source
+  size_t messages_in = 0;
+
+  /// Messages dropped because the filter rejected all of their records
+  size_t messages_dropped = 0;
+
+  /// Messages handed to the sink
+  size_t messages_out = 0;
+};
+
+class NDEFPipeline {
+public:
+  /// Produces the next chunk of raw bytes. Chunks need not be aligned to message or record boundaries
+  /// \return false once the source is exhausted
+  using Source = std::function<bool(std::vector<uint8_t>& chunk)>;
+
+  /// \return whether the record should be kept
+  using RecordFilter = std::function<bool(const NDEFRecordView& record)>;
+
+  /// Modifies a decoded message in place before it is re-encoded
+  using Transform = std::function<void(NDEFMessage& message)>;
+
+  /// Consumes a finished message. The buffer is recycled as soon as the sink returns
+  using Sink = std::function<void(const NDEFMessageBuffer& message)>;
+
+  explicit NDEFPipeline(const PipelineOptions& options = PipelineOptions{}) : options(options) {}
+
+  NDEFPipeline& source(Source fn);
+
+  /// Keeps only records for which \p fn returns true. Messages left without records are dropped
+  NDEFPipeline& filter(RecordFilter fn);
+
+  /// Keeps only records with exactly the type \p type
+  NDEFPipeline& filter_type(const NDEFRecordType& type);
+
+  NDEFPipeline& transform(Transform fn);
+  NDEFPipeline& sink(Sink fn);
+
+  /// Runs the pipeline until the source is exhausted and every framed message has reached the sink or been dropped
+  /// \param executor executor to run the stages on
+  /// \throws NDEFException if the source or sink are missing, and rethrows the first exception thrown by any stage
+  void run(PipelineExecutor& executor);
+
+  /// \return counters from the most recent run
+  const PipelineStats& stats() const { return this->run_stats; }
+
+private:
+  PipelineOptions options;
+  PipelineStats run_stats;
+
+  Source source_fn;
+  RecordFilter filter_fn;
+  Transform transform_fn;
+  Sink sink_fn;
+};
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,317 @@
+/*! Lock-free bounded queues for handing messages between threads
+ * \file queue.hpp
+ *
+ * Both queues preallocate every slot up front and never allocate afterwards. Items are moved in and out of the
+ * slots, so queueing an NDEFMessageBuffer or an NDEFMessage only moves the pointers to their storage.
+ */
+
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace queue_detail {
+/// Assumed size of a cache line, used to keep producer and consumer state from sharing one
+constexpr size_t cache_line_size = 64;
+
+/// \param n requested capacity
+/// \return smallest power of two >= \p n, at least 2
+inline size_t round_up_pow2(size_t n)
+{
+  size_t capacity = 2;
+  while (capacity < n) {
+    capacity <<= 1;
+  }
+
+  return capacity;
+}
+} // namespace queue_detail
+
+/// Bounded single-producer/single-consumer queue
+///
+/// Exactly one thread may push and exactly one (possibly different) thread may pop
+/// \tparam T type of queued items. Must be default constructible and move assignable
+template <typename T>
+class SPSCQueue {
+public:
+  /// \param capacity minimum number of items the queue can hold, rounded up to a power of two
+  explicit SPSCQueue(size_t capacity)
+      : slots(queue_detail::round_up_pow2(capacity)), mask(queue_detail::round_up_pow2(capacity) - 1)
+  {
+  }
+
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  /// \param item item to move into the queue. Left untouched if the queue is full
+  /// \return false if the queue is full
+  bool try_push(T&& item) { return this->try_push_batch(&item, 1) == 1; }
+
+  /// \param item destination for the popped item
+  /// \return false if the queue is empty
+  bool try_pop(T& item) { return this->try_pop_batch(&item, 1) == 1; }
+
+  /// Moves as many items as fit into the queue, publishing them to the consumer all at once
+  /// \tparam It iterator to items that will be moved from
+  /// \param first iterator to the first item to push
+  /// \param n number of items available from \p first
+  /// \return number of items pushed, the first that many items of the range have been moved from
+  template <typename It>
+  size_t try_push_batch(It first, size_t n)
+  {
+    const size_t tail = this->tail_pos.load(std::memory_order_relaxed);
+
+    // Only re-read the consumer position when the cached copy says the queue is full
+    if (this->slots.size() - (tail - this->cached_head) < n) {
+      this->cached_head = this->head_pos.load(std::memory_order_acquire);
+    }
+
+    const size_t free_slots = this->slots.size() - (tail - this->cached_head);
+    const size_t count = (n < free_slots) ? n : free_slots;
+
+    for (size_t i = 0; i < count; i++, ++first) {
+      this->slots[(tail + i) & this->mask] = std::move(*first);
+    }
+
+    this->tail_pos.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /// Moves up to \p max items out of the queue, releasing their slots to the producer all at once
+  /// \tparam OutIt iterator that popped items will be move assigned to
+  /// \param out iterator to the first destination
+  /// \param max maximum number of items to pop
+  /// \return number of items popped
+  template <typename OutIt>
+  size_t try_pop_batch(OutIt out, size_t max)
+  {
+    const size_t head = this->head_pos.load(std::memory_order_relaxed);
+
+    // Only re-read the producer position when the cached copy says the queue is empty
+    if (this->cached_tail - head < max) {
+      this->cached_tail = this->tail_pos.load(std::memory_order_acquire);
+    }
+
+    const size_t available = this->cached_tail - head;
+    const size_t count = (max < available) ? max : available;
+
+    for (size_t i = 0; i < count; i++, ++out) {
+      *out = std::move(this->slots[(head + i) & this->mask]);
+    }
+
+    this->head_pos.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  /// \return number of items the queue can hold
+  size_t capacity() const { return this->slots.size(); }
+
+  /// \return number of queued items. Only exact when neither side is running concurrently
+  size_t size_approx() const
+  {
+    return this->tail_pos.load(std::memory_order_acquire) - this->head_pos.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<T> slots;
+  const size_t mask;
+
+  // Consumer owned state
+  char pad0[queue_detail::cache_line_size];
+  std::atomic<size_t> head_pos{ 0 };
+  size_t cached_tail = 0;
+
+  // Producer owned state
+  char pad1[queue_detail::cache_line_size];
+  std::atomic<size_t> tail_pos{ 0 };
+  size_t cached_head = 0;
+  char pad2[queue_detail::cache_line_size];
+};
+
+/// Bounded multi-producer/multi-consumer queue
+///
+/// Any number of threads may push and pop concurrently. Each slot carries a sequence number recording which lap of
+/// the ring it was last written or read on, so producers and consumers only contend on the shared position they CAS
+/// \tparam T type of queued items. Must be default constructible and move assignable
+template <typename T>
+class MPMCQueue {
+public:
+  /// \param capacity minimum number of items the queue can hold, rounded up to a power of two
+  explicit MPMCQueue(size_t capacity)
+      : cells(new Cell[queue_detail::round_up_pow2(capacity)]), mask(queue_detail::round_up_pow2(capacity) - 1)
+  {
+    for (size_t i = 0; i <= this->mask; i++) {
+      this->cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  /// \param item item to move into the queue. Left untouched if the queue is full
+  /// \return false if the queue is full
+  bool try_push(T&& item) { return this->try_push_batch(&item, 1) == 1; }
+
+  /// \param item destination for the popped item
+  /// \return false if the queue is empty
+  bool try_pop(T& item) { return this->try_pop_batch(&item, 1) == 1; }
+
+  /// Claims up to \p n consecutive slots with a single CAS and moves items into them
+  /// \tparam It iterator to items that will be moved from
+  /// \param first iterator to the first item to push
+  /// \param n number of items available from \p first
+  /// \return number of items pushed, the first that many items of the range have been moved from
+  template <typename It>
+  size_t try_push_batch(It first, size_t n)
+  {
+    size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+    size_t count = this->claim(this->enqueue_pos, pos, n, 0);
+
+    for (size_t i = 0; i < count; i++, ++first) {
+      Cell& cell = this->cells[(pos + i) & this->mask];
+      cell.data = std::move(*first);
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+
+    return count;
+  }
+
+  /// Claims up to \p max consecutive filled slots with a single CAS and moves items out of them
+  /// \tparam OutIt iterator that popped items will be move assigned to
+  /// \param out iterator to the first destination
+  /// \param max maximum number of items to pop
+  /// \return number of items popped
+  template <typename OutIt>
+  size_t try_pop_batch(OutIt out, size_t max)
+  {
+    size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+    size_t count = this->claim(this->dequeue_pos, pos, max, 1);
+
+    for (size_t i = 0; i < count; i++, ++out) {
+      Cell& cell = this->cells[(pos + i) & this->mask];
+      *out = std::move(cell.data);
+      cell.sequence.store(pos + i + this->mask + 1, std::memory_order_release);
+    }
+
+    return count;
+  }
+
+  /// \return number of items the queue can hold
+  size_t capacity() const { return this->mask + 1; }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  /// Claims consecutive cells starting at \p pos whose sequence shows them ready, advancing \p position past them
+  /// \param position shared enqueue or dequeue position
+  /// \param pos in: last observed value of \p position, out: first claimed position
+  /// \param max maximum number of cells to claim
+  /// \param lag how far a ready cell's sequence is ahead of its position (0 for producers, 1 for consumers)
+  /// \return number of cells claimed, 0 if the queue is full (producers) or empty (consumers)
+  size_t claim(std::atomic<size_t>& position, size_t& pos, size_t max, size_t lag)
+  {
+    while (max > 0) {
+      // Count how many cells from pos onwards are ready for this side on this lap
+      size_t ready = 0;
+      while (ready < max && ready <= this->mask) {
+        size_t seq = this->cells[(pos + ready) & this->mask].sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + ready + lag);
+
+        if (diff != 0) {
+          // A first cell from an older lap means the ring is full/empty, a newer lap means pos is stale
+          if (ready == 0 && diff > 0) {
+            ready = SIZE_MAX;
+          }
+          break;
+        }
+
+        ready++;
+      }
+
+      if (ready == SIZE_MAX) {
+        pos = position.load(std::memory_order_relaxed);
+        continue;
+      }
+
+      if (ready == 0) {
+        return 0;
+      }
+
+      // Claiming succeeds only if no one else moved the position since the cells were inspected
+      if (position.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+        return ready;
+      }
+    }
+
+    return 0;
+  }
+
+  std::unique_ptr<Cell[]> cells;
+  const size_t mask;
+
+  char pad0[queue_detail::cache_line_size];
+  std::atomic<size_t> enqueue_pos{ 0 };
+  char pad1[queue_detail::cache_line_size];
+  std::atomic<size_t> dequeue_pos{ 0 };
+  char pad2[queue_detail::cache_line_size];
+};
+
+/// Pair of SPSC queues carrying items forward to a consumer and back to the producer once the consumer is finished
+/// with them. Once as many items as the pipeline holds have been created, every acquire() is served from returned
+/// items and steady state performs no allocation
+/// \tparam T type of the recycled items, eg. NDEFMessageBuffer
+template <typename T>
+class RecyclingChannel {
+public:
+  /// \param capacity minimum number of items in flight in each direction
+  explicit RecyclingChannel(size_t capacity) : forward(capacity), returned(capacity) {}
+
+  /// Producer side. Takes a previously released item, or creates a new one if none are waiting
+  /// \return item ready to be filled in and sent
+  T acquire()
+  {
+    T item;
+    this->returned.try_pop(item);
+
+    return item;
+  }
+
+  /// Producer side
+  /// \param item filled in item to hand to the consumer. Left untouched if the channel is full
+  /// \return false if the channel is full
+  bool try_send(T&& item) { return this->forward.try_push(std::move(item)); }
+
+  /// Consumer side
+  /// \param item destination for the received item
+  /// \return false if nothing has been sent
+  bool try_receive(T& item) { return this->forward.try_pop(item); }
+
+  /// Consumer side
+  /// \param out iterator that received items will be move assigned to
+  /// \param max maximum number of items to receive
+  /// \return number of items received
+  template <typename OutIt>
+  size_t try_receive_batch(OutIt out, size_t max)
+  {
+    return this->forward.try_pop_batch(out, max);
+  }
+
+  /// Consumer side. Hands an item back to the producer for reuse. If the return path is full the item is destroyed
+  /// \param item item the consumer is finished with
+  void release(T&& item) { this->returned.try_push(std::move(item)); }
+
+private:
+  SPSCQueue<T> forward;
+  SPSCQueue<T> returned;
+};
+
+#endif // QUEUE_HPP
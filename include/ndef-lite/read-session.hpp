@@ -0,0 +1,125 @@
+/*! Reads of a tag that survive it leaving the field
+ * \file read-session.hpp
+ *
+ * A tag pulled away mid-read tears the read, and reading it again from byte 0 on the next tap repeats every command
+ * that already succeeded. An NDEFReadSession holds everything an interrupted read had: the leading bytes of tag
+ * memory read so far, where the message lies in them, and the incremental parser with the records already decoded.
+ * NDEFReadSessionCache keeps sessions between taps, keyed by the UID the tag reports when it is activated.
+ *
+ * A reader resuming a session starts its next read command a few bytes before the end of what it had, and only
+ * trusts the session if those bytes read back the same. A tag rewritten between taps almost always differs there,
+ * and its session is then dropped and the tag read from the start.
+ */
+
+#ifndef READ_SESSION_HPP
+#define READ_SESSION_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ndef-lite/parser.hpp"
+
+/// Progress of one read of a tag
+struct NDEFReadSession
+{
+  /// Leading bytes of the tag's data area (Type 2) or NDEF file (Type 4) read so far. Reading resumes at the end
+  std::vector<uint8_t> bytes;
+
+  /// Offset of the encoded message in bytes, once the TLV or NLEN field in front of it has been read
+  size_t message_offset = 0;
+
+  /// Length of the encoded message, 0 until the TLV or NLEN field has been read
+  size_t message_length = 0;
+
+  /// Number of message bytes fed to the parser
+  size_t fed = 0;
+
+  /// Parser holding the records decoded so far
+  NDEFMessageParser parser;
+};
+
+/// Tuning for NDEFReadSessionCache
+struct ReadSessionOptions
+{
+  /// Sessions kept at most. Storing one more evicts the session stored longest ago
+  size_t max_sessions = 256;
+
+  /// Time after which a session is no longer resumed
+  std::chrono::milliseconds max_age{ 30000 };
+
+  /// Bytes re-read, and compared, before a session is trusted. Type 2 readers round this up to whole pages
+  size_t overlap = 8;
+};
+
+/// Counters describing the use of an NDEFReadSessionCache
+struct ReadSessionStats
+{
+  /// Sessions stored after a torn read
+  uint64_t stored = 0;
+
+  /// Sessions handed back to a reader
+  uint64_t resumed = 0;
+
+  /// Sessions dropped by the reader because the overlap read back differently
+  uint64_t mismatched = 0;
+
+  /// Sessions dropped because they were too old or the cache was full
+  uint64_t expired = 0;
+};
+
+/// Thread-safe cache of interrupted reads, keyed by tag UID
+class NDEFReadSessionCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \throws NDEFException if ReadSessionOptions::max_sessions is 0
+  explicit NDEFReadSessionCache(const ReadSessionOptions& options = ReadSessionOptions{});
+
+  NDEFReadSessionCache(const NDEFReadSessionCache&) = delete;
+  NDEFReadSessionCache& operator=(const NDEFReadSessionCache&) = delete;
+
+  /// \return bytes a reader re-reads before resuming a session
+  size_t overlap() const { return this->options.overlap; }
+
+  /// Keeps \p session until the tag comes back, replacing any session already kept for it
+  /// \param uid UID of the tag
+  /// \param session progress of the torn read
+  void store(const std::vector<uint8_t>& uid, NDEFReadSession session);
+
+  /// Removes the session kept for a tag
+  /// \param uid UID of the tag
+  /// \param session set to the kept session
+  /// \return whether a session younger than ReadSessionOptions::max_age was kept for the tag
+  bool take(const std::vector<uint8_t>& uid, NDEFReadSession& session);
+
+  /// Counts a session taken from the cache that did not match the tag it was taken for
+  void mismatched();
+
+  /// \return number of sessions kept
+  size_t size() const;
+
+  /// \return counters accumulated since construction
+  ReadSessionStats stats() const;
+
+  /// Drops every session
+  void clear();
+
+private:
+  struct Entry
+  {
+    NDEFReadSession session;
+    Clock::time_point stored;
+  };
+
+  ReadSessionOptions options;
+
+  mutable std::mutex lock;
+  std::map<std::vector<uint8_t>, Entry> sessions;
+  ReadSessionStats counters;
+};
+
+#endif // READ_SESSION_HPP
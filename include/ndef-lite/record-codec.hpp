@@ -0,0 +1,28 @@
+/*! Hook for transforming records as messages are encoded and decoded
+ * \file record-codec.hpp
+ */
+
+#ifndef RECORD_CODEC_HPP
+#define RECORD_CODEC_HPP
+
+#include "ndef-lite/record.hpp"
+
+/// Rewrites records on their way to and from bytes, eg. to compress payloads. A codec set on an NDEFMessage is applied
+/// to every record by NDEFMessage::as_bytes() and NDEFMessage::write_to(), and NDEFMessage::from_bytes() undoes it
+class NDEFRecordCodec {
+public:
+  virtual ~NDEFRecordCodec() = default;
+
+  /// \param record record about to be encoded
+  /// \param encoded receives the record to encode in its place
+  /// \return false to encode \p record unchanged
+  virtual bool encode(const NDEFRecord& record, NDEFRecord& encoded) const = 0;
+
+  /// \param record record just decoded
+  /// \param decoded receives the record it stands for
+  /// \return false if \p record was not produced by encode()
+  /// \throws NDEFException if \p record was produced by encode() but cannot be decoded
+  virtual bool decode(const NDEFRecord& record, NDEFRecord& decoded) const = 0;
+};
+
+#endif // RECORD_CODEC_HPP
@@ -1,6 +1,7 @@
 #ifndef RECORD_HEADER_H
 #define RECORD_HEADER_H
 
+#include "ndef-lite/inline.hpp"
 #include "ndef-lite/record-type.hpp"
 
 /// NDEF Record type binary flags in header
@@ -37,10 +38,10 @@ struct NDEFRecordHeader
 
   /// \param value octet (byte) of data to create NDEFRecordHeader object from
   /// \return ::NDEFRecordHeader object
-  static NDEFRecordHeader from_byte(const uint8_t value);
+  static NDEF_LITE_HOT NDEFRecordHeader from_byte(const uint8_t value);
 
   /// \return byte representation of ::NDEFRecordHeader
-  uint8_t asByte();
+  NDEF_LITE_HOT uint8_t asByte();
 
   bool inline constexpr operator==(const NDEFRecordHeader& rhs) const
   {
@@ -57,4 +58,9 @@ struct NDEFRecordHeader
   }
 };
 
-#endif // RECORD_HEADER_H
\ No newline at end of file
+
+#ifdef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record-header.ipp"
+#endif
+
+#endif // RECORD_HEADER_H
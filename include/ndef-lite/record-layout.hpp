@@ -0,0 +1,71 @@
+/*! Zero-copy framing of encoded NDEF records
+ * \file record-layout.hpp
+ *
+ * Locates the fields of an encoded NDEF record inside a byte buffer without copying any of them. This is the framing
+ * pass that the incremental parser and the other raw-buffer helpers are built on.
+ */
+
+#ifndef RECORD_LAYOUT_H
+#define RECORD_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/record-header.hpp"
+
+/// Result of attempting to frame a single record
+enum class FrameStatus {
+  /// All fields of the record are present in the buffer
+  Complete,
+
+  /// The buffer ends before the record does, more bytes are required
+  Incomplete,
+
+  /// The record can never be valid, regardless of how many more bytes are supplied
+  Malformed,
+};
+
+/// Location of each field of an encoded record, relative to the first (header) byte of the record
+struct NDEFRecordLayout
+{
+  /// Decoded header flags and TNF
+  NDEFRecordHeader header;
+
+  /// Offset and length of the TYPE field
+  size_t type_offset;
+  uint8_t type_length;
+
+  /// Offset and length of the ID field. Length is 0 when the IL flag is not set
+  size_t id_offset;
+  uint8_t id_length;
+
+  /// Offset and length of the PAYLOAD field
+  size_t payload_offset;
+  uint32_t payload_length;
+
+  /// Number of bytes the whole record occupies, header through payload
+  size_t total_length;
+};
+
+/// \param data pointer to the header byte of the record
+/// \param len number of bytes available from \p data onwards
+/// \param layout layout to be populated. Only meaningful when ::FrameStatus::Complete is returned
+/// \return ::FrameStatus::Complete if the whole record is available, ::FrameStatus::Incomplete if more bytes are
+///   needed, ::FrameStatus::Malformed if the TYPE field contains characters forbidden by the NDEF standard
+NDEF_LITE_HOT FrameStatus frame_record(const uint8_t* data, size_t len, NDEFRecordLayout& layout);
+
+/// Walks records from \p data until the one flagged Message End, without decoding any of them
+/// \param data pointer to the header byte of the first record of the message
+/// \param len number of bytes available from \p data onwards
+/// \param message_length set to the number of bytes the whole message occupies when ::FrameStatus::Complete is
+///   returned
+/// \return ::FrameStatus::Complete if the Message End record is available, ::FrameStatus::Incomplete if more bytes
+///   are needed, ::FrameStatus::Malformed if any record is malformed
+NDEF_LITE_HOT FrameStatus frame_message(const uint8_t* data, size_t len, size_t& message_length);
+
+#ifdef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record-layout.ipp"
+#endif
+
+#endif // RECORD_LAYOUT_H
@@ -0,0 +1,172 @@
+/*! Non-owning views of encoded NDEF records and messages
+ * \file record-view.hpp
+ *
+ * Views give access to the fields of an encoded record without copying them out of the buffer they live in. The
+ * buffer must outlive every view created over it.
+ */
+
+#ifndef RECORD_VIEW_HPP
+#define RECORD_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/record-layout.hpp"
+#include "ndef-lite/record.hpp"
+
+/// Borrowed, read-only range of bytes
+struct ByteSpan
+{
+  const uint8_t* data;
+  size_t size;
+
+  const uint8_t* begin() const { return this->data; }
+  const uint8_t* end() const { return this->data + this->size; }
+  bool empty() const { return this->size == 0; }
+
+  /// \return copy of the bytes as a vector
+  std::vector<uint8_t> to_vector() const { return std::vector<uint8_t>{ this->begin(), this->end() }; }
+
+  /// \return copy of the bytes as a string
+  std::string to_string() const { return std::string{ this->begin(), this->end() }; }
+
+  /// \param prefix string to compare the start of the span against
+  /// \return whether the span starts with \p prefix
+  bool starts_with(const std::string& prefix) const
+  {
+    return prefix.size() <= this->size && std::memcmp(this->data, prefix.data(), prefix.size()) == 0;
+  }
+
+  bool operator==(const std::string& rhs) const
+  {
+    return rhs.size() == this->size && std::memcmp(this->data, rhs.data(), this->size) == 0;
+  }
+
+  bool operator!=(const std::string& rhs) const { return !(*this == rhs); }
+};
+
+/// View of a single framed record within a buffer
+class NDEFRecordView {
+public:
+  NDEFRecordView(const uint8_t* data, const NDEFRecordLayout& layout) : record_start(data), record_layout(layout) {}
+
+  /// \return pointer to the header byte of the record
+  const uint8_t* data() const { return this->record_start; }
+
+  /// \return location of each field relative to data()
+  const NDEFRecordLayout& layout() const { return this->record_layout; }
+
+  /// \return decoded header flags
+  const NDEFRecordHeader& header() const { return this->record_layout.header; }
+
+  /// \return Type Name Format of the record, with reserved values mapped to ::TypeID::Unknown
+  NDEF_LITE_HOT NDEFRecordType::TypeID tnf() const;
+
+  /// \param type single character TYPE, eg. 'U' for URI records or 'T' for Text records
+  /// \return whether the record is a Well Known record of TYPE \p type
+  NDEF_LITE_HOT bool is_well_known(char type) const;
+
+  /// Splits the payload of a Text record at the end of its locale, whose length is in the low 6 bits of the status byte
+  /// \param locale set to the IANA language code
+  /// \param text set to the encoded text, UTF-16 if the status byte's top bit is set
+  /// \return false if the record is not a Text record, or its payload is too short for the locale it claims
+  NDEF_LITE_HOT bool text_span(ByteSpan& locale, ByteSpan& text) const;
+
+  /// \return TYPE field of the record
+  ByteSpan type() const
+  {
+    return ByteSpan{ this->record_start + this->record_layout.type_offset, this->record_layout.type_length };
+  }
+
+  /// \return ID field of the record, empty if the record has none
+  ByteSpan id() const
+  {
+    return ByteSpan{ this->record_start + this->record_layout.id_offset, this->record_layout.id_length };
+  }
+
+  /// \return PAYLOAD field of the record
+  ByteSpan payload() const
+  {
+    return ByteSpan{ this->record_start + this->record_layout.payload_offset, this->record_layout.payload_length };
+  }
+
+  /// \return all bytes of the encoded record, header through payload
+  ByteSpan bytes() const { return ByteSpan{ this->record_start, this->record_layout.total_length }; }
+
+  /// \return owning record object with each field copied out of the buffer
+  NDEFRecord to_record() const;
+
+private:
+  const uint8_t* record_start;
+  NDEFRecordLayout record_layout;
+};
+
+/// View of every record of an encoded message. The record index is kept between open() calls so that reusing one
+/// view for many messages does not allocate once it has grown to the largest message seen
+class NDEFMessageView {
+public:
+  NDEFMessageView() {}
+
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if the bytes are truncated or malformed
+  NDEFMessageView(const uint8_t* data, size_t len) { this->open(data, len); }
+
+  /// Frames every record in \p data, replacing whatever the view previously pointed to. Framing stops after the
+  /// record flagged Message End, so size() may be smaller than \p len when trailing bytes follow the message
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  /// \throws NDEFException if the bytes are truncated or malformed
+  void open(const uint8_t* data, size_t len);
+
+  /// Points the view at \p data without framing it, for callers that already know where every record is. Records
+  /// must then be added in order with add_record()
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  void open_indexed(const uint8_t* data, size_t len);
+
+  /// \param offset offset of the record's header byte from the start of the message
+  /// \param layout precomputed layout of the record
+  void add_record(size_t offset, const NDEFRecordLayout& layout);
+
+  /// Empties the view, keeping the capacity of the record index
+  void clear();
+
+  /// \return number of records in the message
+  size_t record_count() const { return this->layouts.size(); }
+
+  /// \param index position of the record in the message
+  /// \return view of the record at \p index
+  NDEFRecordView record(size_t index) const;
+
+  /// \return pointer to the first byte of the message
+  const uint8_t* data() const { return this->message_start; }
+
+  /// \return number of bytes the framed records occupy
+  size_t size() const { return this->message_length; }
+
+  /// \return owning message object with every record copied out of the buffer
+  NDEFMessage to_message() const;
+
+private:
+  // Edits the bytes a view points at, and keeps the record index in step with them
+  friend class NDEFMessageBuffer;
+
+  const uint8_t* message_start = nullptr;
+  size_t message_length = 0;
+
+  /// Offset of each record from message_start
+  std::vector<size_t> offsets;
+  std::vector<NDEFRecordLayout> layouts;
+};
+
+#ifdef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record-view.ipp"
+#endif
+
+#endif // RECORD_VIEW_HPP
@@ -5,9 +5,13 @@
 #ifndef NDEF_H
 #define NDEF_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "ndef-lite/decode-policy.hpp"
+#include "ndef-lite/inline.hpp"
+#include "ndef-lite/payload-source.hpp"
 #include "ndef-lite/record-type.hpp"
 #include "ndef-lite/util.hpp"
 
@@ -26,8 +30,24 @@ public:
   NDEFRecord(const std::vector<uint8_t>& payload, const NDEFRecordType& type, size_t offset = 0, bool chunked = false);
   NDEFRecord(const std::vector<uint8_t>& payload, const NDEFRecordType& type, const std::string& id, size_t offset = 0,
              bool chunked = false);
+
+  /// Creates a record whose payload stays in \p payload instead of being copied into the record
+  /// \param payload source of the payload bytes, shared with every copy of the record
+  /// \param type record type, eg. a MIME type for firmware images
+  /// \param id optional ID field
+  NDEFRecord(std::shared_ptr<const NDEFPayloadSource> payload, const NDEFRecordType& type,
+             const std::string& id = "");
+  NDEFRecord(const NDEFRecord& other) = default;
+
+  /// Takes over the fields of \p other, leaving it an empty record with a shared empty payload
+  NDEFRecord(NDEFRecord&& other) noexcept;
   ~NDEFRecord() = default;
 
+  NDEFRecord& operator=(const NDEFRecord& other) = default;
+
+  /// Takes over the fields of \p other, leaving it an empty record with a shared empty payload
+  NDEFRecord& operator=(NDEFRecord&& other) noexcept;
+
   void validate();
 
   // Conversion helpers
@@ -36,6 +56,11 @@ public:
   /// \return vector of uint8 byte values
   std::vector<uint8_t> as_bytes(uint8_t flags = 0x00) const;
 
+  /// Encodes every field that precedes the payload, so that the payload can be written separately
+  /// \param flags 8 bit value of header flags to combine with internal flags
+  /// \return vector of uint8 byte values
+  std::vector<uint8_t> header_bytes(uint8_t flags = 0x00) const;
+
   /// \param bytes array of bytes (uint8_t) that will be used to attempt to create an NDEFRecord object
   /// \param len number of elements in \p bytes array
   /// \param offset byte offset to start from
@@ -45,7 +70,20 @@ public:
   /// \param bytes vector of bytes (uint8_t) that will be used to attempt to create an NDEFRecord object
   /// \param offset byte offset to start from
   /// \return NDEFRecord object created from bytes
-  static NDEFRecord from_bytes(std::vector<uint8_t> bytes, size_t offset = 0, size_t& bytes_used = default_bytes_used);
+  static NDEFRecord from_bytes(const std::vector<uint8_t>& bytes, size_t offset = 0,
+                               size_t& bytes_used = default_bytes_used);
+
+  /// Decodes the record at the start of \p data, checking it as \p Policy requires. Instantiated for ::CheckedDecode
+  /// and ::TrustedDecode
+  /// \tparam Policy ::CheckedDecode for untrusted bytes, ::TrustedDecode for bytes known to be well formed
+  /// \param data pointer to the header byte of the record
+  /// \param len number of bytes available from \p data onwards
+  /// \param bytes_used set to the number of bytes the record occupies
+  /// \return decoded record. With ::CheckedDecode, a record of type ::TypeID::Invalid if the TYPE field is longer
+  ///   than the whole input
+  /// \throws NDEFException with ::CheckedDecode, if the bytes are truncated or the TYPE field holds a control character
+  template <typename Policy>
+  static NDEFRecord decode(const uint8_t* data, size_t len, size_t& bytes_used);
 
   // Accessors/Mutators
   void set_id(const std::string& new_id) { this->id_field = new_id; }
@@ -58,14 +96,32 @@ public:
   bool constexpr is_chunked() const { return this->chunked; }
 
   void set_payload(const std::vector<uint8_t>& data);
-  std::vector<uint8_t> payload() const { return this->payload_data; }
+
+  /// \return payload bytes, read from the payload source if the record has one
+  std::vector<uint8_t> payload() const
+  {
+    return this->payload_bytes ? std::vector<uint8_t>(this->payload_bytes, this->payload_bytes + this->payload_size)
+                               : this->payload_ref->read();
+  }
+
+  /// Replaces the payload with one that stays outside of the record
+  /// \param source source of the payload bytes
+  void set_payload_source(std::shared_ptr<const NDEFPayloadSource> source);
+
+  /// \return source of the payload bytes, or nullptr if the payload is held in the record, interned ones included
+  const std::shared_ptr<const NDEFPayloadSource>& payload_source() const;
+
+  /// Handle to the payload bytes wherever they are held. Copies of a record share one handle until either is given a
+  /// new payload
+  /// \return payload handle, never nullptr
+  const std::shared_ptr<const NDEFPayloadSource>& payload_handle() const { return this->payload_ref; }
 
   /// Access number of bytes in the payload
   /// \return size_t number of bytes in the payload
-  size_t payload_length() const { return this->payload_data.size(); }
+  size_t payload_length() const { return this->payload_size; }
 
   // General information
-  uint8_t header() const;
+  NDEF_LITE_HOT uint8_t header() const;
 
   bool is_short() const { return (this->payload_length() < 256); }
   bool constexpr is_empty() const { return (this->record_type.id() == NDEFRecordType::TypeID::Empty); }
@@ -107,6 +163,10 @@ public:
   /// \return NDEFRecord object with URI encoded
   static NDEFRecord create_uri_record(const std::string& uri);
 
+  /// \param code URI identifier code, the first byte of a URI record's payload
+  /// \return URI prefix abbreviated by \p code, empty for codes reserved for future use
+  static const std::string& uri_prefix(uint8_t code);
+
   /// \param payload vector of bytes to have URI protocol extracted from
   /// \return UTF-8 encoded string of record in byte's URI protocol
   static std::string get_uri_protocol(const std::vector<uint8_t>& payload);
@@ -122,6 +182,14 @@ public:
   std::string get_uri() const;
 
 private:
+  /// Interns payloads without handing them to the record as an external source
+  friend class NDEFPayloadStore;
+
+  /// Points payload_ref at \p handle and caches its size and bytes, without validating the record
+  /// \param handle payload handle, never nullptr
+  /// \param owned whether the record holds the payload itself, see payload_source()
+  void assign_payload(std::shared_ptr<const NDEFPayloadSource> handle, bool owned);
+
   // NDEF Record Fields
 
   /// Specifies record type. Must follow the structure, encoding, and format implied by the value of the TNF field.
@@ -138,8 +206,17 @@ private:
   /// Only included if the `IL` flag is set in the record header and the ID_LENGTH field is > 0
   std::string id_field;
 
-  /// Payload - A slice of octets, the length of which is retrievable via ::payload_length()
-  std::vector<uint8_t> payload_data;
+  /// Payload - A slice of octets, the length of which is retrievable via ::payload_length(). Immutable and shared
+  /// between copies of the record
+  std::shared_ptr<const NDEFPayloadSource> payload_ref;
+
+  /// Whether payload_ref was created by set_payload() or interned, rather than handed to the record as a source
+  bool owns_payload = true;
+
+  /// Size and in-memory bytes of payload_ref, cached so the per-record accessors need not call through the handle.
+  /// payload_bytes is nullptr if the source does not hold its bytes in memory
+  size_t payload_size = 0;
+  const uint8_t* payload_bytes = nullptr;
 
   /// Whether this is a part of a chunked record or not
   bool chunked;
@@ -178,4 +255,8 @@ private:
   //   uint8_t idLength;
 };
 
+#ifdef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record.ipp"
+#endif
+
 #endif // NDEF_H
@@ -0,0 +1,141 @@
+/*! Compiled rules for routing records by their raw fields
+ * \file rule-set.hpp
+ *
+ * A rule is a conjunction of predicates over the TNF, TYPE and ID fields of a record, the prefix code and body of a
+ * URI record, and the locale of a Text record. An NDEFRuleSet compiles many rules into one lookup table per field:
+ * a table indexed by TNF and by URI prefix code, and a byte trie for each string field. Every table entry holds the
+ * bit mask of rules satisfied by reaching it, so matching a record walks each field once and ANDs a handful of masks,
+ * however many rules there are. Records are matched straight from an NDEFRecordView without building an NDEFRecord.
+ */
+
+#ifndef RULE_SET_HPP
+#define RULE_SET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/record-type.hpp"
+#include "ndef-lite/record-view.hpp"
+
+/// Set of predicates that a record must satisfy to match. Fields without a predicate match any record
+class NDEFRule {
+public:
+  /// \param id value reported by NDEFRuleSet::match() when a record matches this rule
+  explicit NDEFRule(uint32_t id) : rule_id(id) {}
+
+  uint32_t id() const { return this->rule_id; }
+
+  /// Requires the Type Name Format of the record to be \p value
+  NDEFRule& tnf(NDEFRecordType::TypeID value);
+
+  /// Requires the TYPE field to be exactly \p value
+  NDEFRule& type_is(const std::string& value) { return this->set(Field::Type, value, false); }
+
+  /// Requires the TYPE field to start with \p value
+  NDEFRule& type_starts_with(const std::string& value) { return this->set(Field::Type, value, true); }
+
+  /// Requires the ID field to be exactly \p value
+  NDEFRule& id_is(const std::string& value) { return this->set(Field::Id, value, false); }
+
+  /// Requires the ID field to start with \p value
+  NDEFRule& id_starts_with(const std::string& value) { return this->set(Field::Id, value, true); }
+
+  /// Requires a URI record whose prefix code is \p code, eg. 0x04 for "https://"
+  NDEFRule& uri_prefix_code(uint8_t code);
+
+  /// Requires a URI record whose URI, after the abbreviated prefix, is exactly \p value
+  NDEFRule& uri_body_is(const std::string& value) { return this->set(Field::UriBody, value, false); }
+
+  /// Requires a URI record whose URI, after the abbreviated prefix, starts with \p value
+  NDEFRule& uri_body_starts_with(const std::string& value) { return this->set(Field::UriBody, value, true); }
+
+  /// Requires a Text record whose locale is exactly \p value
+  NDEFRule& text_locale_is(const std::string& value) { return this->set(Field::TextLocale, value, false); }
+
+private:
+  friend class NDEFRuleSet;
+
+  /// String fields, in the order the rule set checks them
+  enum class Field { Type, Id, UriBody, TextLocale, Count };
+
+  struct StringPredicate
+  {
+    bool active = false;
+    bool prefix = false;
+    std::string value;
+  };
+
+  uint32_t rule_id;
+
+  bool tnf_set = false;
+  NDEFRecordType::TypeID tnf_value = NDEFRecordType::TypeID::Empty;
+
+  bool uri_code_set = false;
+  uint8_t uri_code = 0;
+
+  StringPredicate strings[static_cast<size_t>(Field::Count)];
+
+  NDEFRule& set(Field field, const std::string& value, bool prefix);
+};
+
+/// Rules compiled into per-field lookup tables
+class NDEFRuleSet {
+public:
+  /// \param rules rules to compile. Matching rules are reported in this order
+  /// \return compiled rule set
+  static NDEFRuleSet compile(const std::vector<NDEFRule>& rules);
+
+  /// \return number of compiled rules
+  size_t rule_count() const { return this->rule_ids.size(); }
+
+  /// \param record record to match
+  /// \param matches cleared, then filled with the ID of every rule \p record satisfies
+  void match(const NDEFRecordView& record, std::vector<uint32_t>& matches) const;
+
+  /// \param message framed message
+  /// \return IDs of the rules each record satisfies, indexed by record
+  std::vector<std::vector<uint32_t>> match(const NDEFMessageView& message) const;
+
+private:
+  /// Byte trie over the values of one string field. Each node stores the mask of rules satisfied by a field that
+  /// ends at the node and by one that continues past it; masks_for() returns the latter when the field leaves the
+  /// trie
+  struct Trie
+  {
+    struct Node
+    {
+      uint32_t first_edge;
+      uint32_t edge_count;
+    };
+
+    std::vector<Node> nodes;
+
+    /// Edges of each node, sorted by byte
+    std::vector<uint8_t> edge_bytes;
+    std::vector<uint32_t> edge_targets;
+
+    /// Two masks per node: satisfied if the field ends here, and if it continues
+    std::vector<uint64_t> masks;
+
+    /// Rules without a predicate on the field, which is all that is satisfied when the field does not apply
+    std::vector<uint64_t> unconstrained;
+
+    const uint64_t* walk(ByteSpan value, size_t words) const;
+  };
+
+  size_t words = 0;
+  std::vector<uint32_t> rule_ids;
+
+  /// Mask per Type Name Format value
+  std::vector<uint64_t> tnf_masks;
+
+  /// Mask per URI prefix code, and for records that are not URI records
+  std::vector<uint64_t> uri_code_masks;
+  std::vector<uint64_t> not_uri_mask;
+
+  Trie tries[static_cast<size_t>(NDEFRule::Field::Count)];
+};
+
+#endif // RULE_SET_HPP
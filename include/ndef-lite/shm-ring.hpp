@@ -0,0 +1,108 @@
+/*! Shared memory ring for passing encoded messages between processes
+ * \file shm-ring.hpp
+ *
+ * The ring lives in a memfd that the producer creates and shares with the consumer (eg. over a Unix socket with
+ * SCM_RIGHTS, or by fork()). Each entry carries the encoded message together with the record index the producer
+ * computed while framing it, so the consumer opens an NDEFMessageView straight onto the shared pages without copying
+ * or re-parsing any lengths. Blocking reads and writes sleep on futexes in the shared region.
+ *
+ * There must be exactly one producer and one consumer. Linux only.
+ */
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ndef-lite/record-view.hpp"
+
+class NDEFShmRing {
+public:
+  /// Creates a new ring in an anonymous memfd
+  /// \param capacity minimum number of bytes available for entries, rounded up to a power of two
+  /// \return producer side of the ring. Share fd() with the consumer
+  /// \throws NDEFException if the memfd cannot be created or mapped
+  static NDEFShmRing create(size_t capacity);
+
+  /// Maps a ring created by create() in this or another process
+  /// \param fd file descriptor of the ring's memfd. Duplicated, the caller keeps ownership of \p fd
+  /// \return handle onto the existing ring
+  /// \throws NDEFException if \p fd does not hold a ring
+  static NDEFShmRing attach(int fd);
+
+  NDEFShmRing(NDEFShmRing&& other) noexcept;
+  NDEFShmRing& operator=(NDEFShmRing&& other) noexcept;
+  NDEFShmRing(const NDEFShmRing&) = delete;
+  NDEFShmRing& operator=(const NDEFShmRing&) = delete;
+  ~NDEFShmRing();
+
+  /// \return memfd backing the ring
+  int fd() const { return this->ring_fd; }
+
+  /// \return number of bytes available for entries
+  size_t capacity() const;
+
+  // Producer side
+
+  /// Copies an already framed message and its record index into the ring
+  /// \param view framed message to publish
+  /// \return false if there is not enough free space right now
+  /// \throws NDEFException if the message can never fit in the ring
+  bool try_write(const NDEFMessageView& view);
+
+  /// Frames \p data into an NDEFMessageView and publishes it
+  /// \param data encoded message bytes
+  /// \param len number of bytes in \p data
+  /// \return false if there is not enough free space right now
+  /// \throws NDEFException if the message is malformed or can never fit in the ring
+  bool try_write(const uint8_t* data, size_t len);
+
+  /// Publishes \p view, sleeping until the consumer frees enough space
+  /// \param view framed message to publish
+  /// \param timeout_ms maximum time to wait, negative waits forever
+  /// \return false if the timeout expired first
+  bool write(const NDEFMessageView& view, int timeout_ms = -1);
+
+  /// Tells the consumer no more messages will be written
+  void close();
+
+  // Consumer side
+
+  /// Opens \p view onto the oldest unread message. The bytes stay valid until release() is called
+  /// \param view view to point at the shared pages
+  /// \return false if the ring is empty
+  /// \throws NDEFException if the previous entry was not released, or the next entry's lengths or record index do not
+  ///   lie within it
+  bool try_read(NDEFMessageView& view);
+
+  /// Like try_read(), sleeping until a message arrives
+  /// \param view view to point at the shared pages
+  /// \param timeout_ms maximum time to wait, negative waits forever
+  /// \return false if the timeout expired, or the producer closed the ring and every message has been read
+  bool read(NDEFMessageView& view, int timeout_ms = -1);
+
+  /// Frees the entry opened by the last successful read, views onto it must no longer be used
+  void release();
+
+private:
+  struct Control;
+
+  NDEFShmRing(int fd, void* mapping, size_t mapping_size);
+
+  int ring_fd = -1;
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+
+  /// Size of the entry opened by the last read, 0 if none is open
+  uint64_t open_entry = 0;
+
+  Control* control() const;
+  uint8_t* data() const;
+};
+
+#endif // __linux__
+
+#endif // SHM_RING_HPP
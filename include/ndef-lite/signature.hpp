@@ -0,0 +1,203 @@
+/*! NFC Forum Signature RTD ("Sig") records
+ * \file signature.hpp
+ *
+ * A Signature record signs the records that precede it in the message, back to the start of the message or the
+ * previous Signature record. Each covered record contributes every byte except its header flags byte, which changes
+ * with the record's position in the message. Digests are computed with a streaming SHA-256 straight over the raw
+ * message bytes held by an NDEFMessageView, so records are never decoded or re-encoded to be verified.
+ *
+ * The cryptographic check itself is delegated to an NDEFSignatureVerifier. A keyed HMAC-SHA-256 verifier is bundled
+ * for closed systems that provision a shared key; asymmetric schemes plug in through the same interface.
+ */
+
+#ifndef SIGNATURE_HPP
+#define SIGNATURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ndef-lite/record-view.hpp"
+#include "ndef-lite/record.hpp"
+
+/// Incremental SHA-256 (FIPS 180-4)
+class NDEFSha256 {
+public:
+  static constexpr size_t digest_size = 32;
+
+  NDEFSha256() { this->reset(); }
+
+  /// Starts a new digest
+  void reset();
+
+  /// \param data bytes to add to the digest
+  /// \param len number of bytes in \p data
+  void update(const uint8_t* data, size_t len);
+
+  /// Completes the digest. The object must be reset() before it is used again
+  /// \param out receives the 32 byte digest
+  void finish(uint8_t out[digest_size]);
+
+private:
+  uint32_t state[8];
+  uint64_t total_length;
+  uint8_t block[64];
+  size_t block_length;
+
+  void compress(const uint8_t* chunk);
+};
+
+/// Values of the Signature Type field defined by the Signature RTD
+enum class SignatureType : uint8_t {
+  /// Marks the start of a signed range without carrying a signature
+  None = 0x00,
+  RSASSA_PSS_1024 = 0x01,
+  RSASSA_PKCS1_1024 = 0x02,
+  DSA_1024 = 0x03,
+  ECDSA_P192 = 0x04,
+  RSASSA_PSS_2048 = 0x05,
+  RSASSA_PKCS1_2048 = 0x06,
+  DSA_2048 = 0x07,
+  ECDSA_P224 = 0x08,
+  ECDSA_K233 = 0x09,
+  ECDSA_B233 = 0x0A,
+  ECDSA_P256 = 0x0B,
+};
+
+/// Hash Type field value for SHA-256, the only hash supported
+const uint8_t signature_hash_sha256 = 0x02;
+
+/// Fields of a Signature record payload. Spans point into the payload they were parsed from
+struct NDEFSignature
+{
+  uint8_t version;
+  uint8_t signature_type;
+  uint8_t hash_type;
+
+  /// Whether #signature holds a URI to fetch the signature from rather than the signature itself
+  bool signature_is_uri;
+  ByteSpan signature;
+
+  uint8_t certificate_format;
+  std::vector<ByteSpan> certificates;
+
+  /// URI of the next certificate in the chain, empty if absent
+  ByteSpan certificate_uri;
+
+  /// \param payload payload of a Signature record
+  /// \return parsed fields, referencing \p payload
+  /// \throws NDEFException if the payload is truncated or has an unsupported version
+  static NDEFSignature parse(ByteSpan payload);
+
+  /// Creates a Signature record
+  /// \param signature_type value of the Signature Type field
+  /// \param signature signature bytes
+  /// \param certificates certificate chain, at most 15 certificates
+  /// \param certificate_format value of the Certificate Format field
+  /// \return Signature record, to be appended after the records it signs
+  /// \throws NDEFException if a field is too long for its length field
+  static NDEFRecord create_record(uint8_t signature_type, const std::vector<uint8_t>& signature,
+                                  const std::vector<std::vector<uint8_t>>& certificates = {},
+                                  uint8_t certificate_format = 0);
+};
+
+/// Outcome of verifying a signature, or a whole message
+enum class SignatureStatus {
+  /// Every signature checked out
+  Valid,
+
+  /// A signature did not match the records it covers
+  Invalid,
+
+  /// The hash type, signature type or remote signature URI cannot be handled by the verifier
+  Unsupported,
+
+  /// A Signature record payload could not be parsed
+  Malformed,
+
+  /// The message holds no signatures
+  Unsigned,
+
+  /// Every signature checked out, but records after the last one are not covered by any signature
+  PartiallySigned,
+};
+
+/// Checks a signature against the digest of the records it covers. Must be safe to call from several threads at once
+class NDEFSignatureVerifier {
+public:
+  virtual ~NDEFSignatureVerifier() = default;
+
+  /// \param signature_type value of the Signature Type field
+  /// \return whether verify() can check signatures of this type
+  virtual bool supports(uint8_t signature_type) const = 0;
+
+  /// \param signature parsed Signature record
+  /// \param digest SHA-256 digest of the covered records
+  /// \return whether the signature matches
+  virtual bool verify(const NDEFSignature& signature, const uint8_t digest[NDEFSha256::digest_size]) const = 0;
+};
+
+/// Bundled verifier for HMAC-SHA-256 signatures made with a shared key
+///
+/// The Signature RTD defines no code for HMAC, so signer and verifier agree on a Signature Type from the reserved
+/// range
+class NDEFHmacVerifier : public NDEFSignatureVerifier {
+public:
+  /// \param key shared secret
+  /// \param signature_type Signature Type written by sign() and accepted by verify()
+  explicit NDEFHmacVerifier(const std::vector<uint8_t>& key, uint8_t signature_type = 0x7F);
+
+  bool supports(uint8_t signature_type) const override { return signature_type == this->type; }
+  bool verify(const NDEFSignature& signature, const uint8_t digest[NDEFSha256::digest_size]) const override;
+
+  /// \param data bytes to authenticate
+  /// \param len number of bytes in \p data
+  /// \param out receives the 32 byte HMAC
+  void mac(const uint8_t* data, size_t len, uint8_t out[NDEFSha256::digest_size]) const;
+
+  /// Signs every record of \p msg after its last Signature record
+  /// \param msg message to sign
+  /// \return Signature record to append to \p msg
+  /// \throws NDEFException if there are no records to sign
+  NDEFRecord sign(const NDEFMessage& msg) const;
+
+private:
+  uint8_t type;
+  uint8_t inner_pad[64];
+  uint8_t outer_pad[64];
+};
+
+/// \param record record to check
+/// \return whether \p record is a Signature record
+bool is_signature_record(const NDEFRecordView& record);
+
+/// Hashes the canonical bytes of records [\p first, \p last) of \p view
+/// \param view framed message
+/// \param first index of the first covered record
+/// \param last index one past the last covered record
+/// \param out receives the 32 byte digest
+void signature_digest(const NDEFMessageView& view, size_t first, size_t last, uint8_t out[NDEFSha256::digest_size]);
+
+/// Verifies every Signature record of a message
+/// \param view framed message
+/// \param verifier checks each signature
+/// \return status of each Signature record, in message order
+std::vector<SignatureStatus> verify_signatures(const NDEFMessageView& view, const NDEFSignatureVerifier& verifier);
+
+/// Verifies a message as a whole
+/// \param view framed message
+/// \param verifier checks each signature
+/// \return ::SignatureStatus::Valid if the message is signed, every signature is valid and the last record is covered
+///   by one, otherwise the status of the first signature that is not valid, ::SignatureStatus::PartiallySigned or
+///   ::SignatureStatus::Unsigned
+SignatureStatus verify_message(const NDEFMessageView& view, const NDEFSignatureVerifier& verifier);
+
+/// Verifies many messages, spreading them across threads
+/// \param messages framed messages
+/// \param verifier checks each signature
+/// \param threads number of threads to use, 0 for one per hardware thread
+/// \return result of verify_message() for each message, in order
+std::vector<SignatureStatus> verify_messages(const std::vector<NDEFMessageView>& messages,
+                                             const NDEFSignatureVerifier& verifier, size_t threads = 0);
+
+#endif // SIGNATURE_HPP
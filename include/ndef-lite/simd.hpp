@@ -0,0 +1,119 @@
+/*! Runtime selection of vectorized kernels
+ * \file simd.hpp
+ *
+ * One build of the library runs on every CPU of a target architecture, and picks the widest kernels the CPU running
+ * it supports. The CPU is inspected once, on first use (cpuid on x86, HWCAP on ARM), and the chosen kernels are
+ * published as a table of function pointers that every later call goes through.
+ *
+ * The level can be forced, for tests that cover every variant and for benchmarks that compare them: with
+ * simd::force_level() or simd::ScopedLevel in code, or by setting the NDEF_LITE_SIMD environment variable to a level
+ * name ("scalar", "sse2", "avx2", "avx512", "neon") before the first kernel call.
+ */
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace simd {
+/// Instruction set a table of kernels is written for
+enum class Level {
+  /// Portable C++, also the reference the vector kernels are tested against
+  Scalar,
+
+  /// 128 bit x86 vectors, available on every x86-64 CPU
+  SSE2,
+
+  /// 256 bit x86 vectors
+  AVX2,
+
+  /// 512 bit x86 vectors with byte and word instructions (AVX-512F and AVX-512BW)
+  AVX512,
+
+  /// 128 bit ARM vectors (Advanced SIMD)
+  NEON,
+};
+
+/// One implementation of every kernel
+struct Kernels
+{
+  Level level;
+
+  /// \return offset of the first \p byte in \p data, or \p len if there is none
+  size_t (*find_byte)(const uint8_t* data, size_t len, uint8_t byte);
+
+  /// \return offset of the first occurrence of \p pattern in \p data, 0 if \p pattern is empty, or \p len if there is
+  ///   none
+  size_t (*find_substring)(const uint8_t* data, size_t len, const uint8_t* pattern, size_t pattern_len);
+
+  /// \return number of leading ASCII bytes in \p data
+  size_t (*ascii_length)(const uint8_t* data, size_t len);
+
+  /// Widens the leading ASCII bytes of \p src to UTF-16, stopping at the first byte that is not ASCII
+  /// \return number of code units written to \p dst
+  size_t (*widen_ascii)(const uint8_t* src, size_t len, char16_t* dst);
+
+  /// Narrows the leading ASCII code units of \p src, stopping at the first code unit that is not ASCII
+  /// \return number of bytes written to \p dst
+  size_t (*narrow_ascii)(const char16_t* src, size_t len, uint8_t* dst);
+};
+
+/// \return name of \p level, as accepted by NDEF_LITE_SIMD
+const char* level_name(Level level);
+
+/// \return widest level the running CPU supports
+Level detected_level();
+
+/// \return every level the running CPU supports, narrowest first
+std::vector<Level> supported_levels();
+
+/// \return kernels every call currently goes through, resolved on first use
+const Kernels& kernels();
+
+/// \return level of the active kernels
+inline Level active_level() { return kernels().level; }
+
+/// Switches every later kernel call to \p level
+/// \param level level to use
+/// \throws NDEFException if the running CPU does not support \p level
+void force_level(Level level);
+
+/// Returns to the level chosen on first use, NDEF_LITE_SIMD if it names a supported level or the detected one
+void reset_level();
+
+/// Forces a level for the lifetime of the object, then restores the one that was active before
+class ScopedLevel {
+public:
+  /// \throws NDEFException if the running CPU does not support \p level
+  explicit ScopedLevel(Level level) : previous(active_level()) { force_level(level); }
+  ~ScopedLevel() { force_level(this->previous); }
+
+  ScopedLevel(const ScopedLevel&) = delete;
+  ScopedLevel& operator=(const ScopedLevel&) = delete;
+
+private:
+  Level previous;
+};
+
+inline size_t find_byte(const uint8_t* data, size_t len, uint8_t byte) { return kernels().find_byte(data, len, byte); }
+inline size_t ascii_length(const uint8_t* data, size_t len) { return kernels().ascii_length(data, len); }
+
+inline size_t find_substring(const uint8_t* data, size_t len, const uint8_t* pattern, size_t pattern_len)
+{
+  return kernels().find_substring(data, len, pattern, pattern_len);
+}
+
+inline size_t widen_ascii(const uint8_t* src, size_t len, char16_t* dst)
+{
+  return kernels().widen_ascii(src, len, dst);
+}
+
+inline size_t narrow_ascii(const char16_t* src, size_t len, uint8_t* dst)
+{
+  return kernels().narrow_ascii(src, len, dst);
+}
+} // namespace simd
+
+#endif // SIMD_HPP
@@ -0,0 +1,176 @@
+/*! Simulated NFC reader and tag for end-to-end testing without hardware
+ * \file tag-sim.hpp
+ *
+ * NDEFSimulatedTag holds the memory image of an NFC Forum Type 2 or Type 4 tag. NDEFSimulatedReader talks to it with
+ * the commands a real reader would use (Type 2 READ/WRITE of 4 byte pages, Type 4 READ BINARY/UPDATE BINARY of the
+ * NDEF file), one fragment at a time, feeding each response into an NDEFMessageParser as it arrives. Every command is
+ * charged against a virtual RF clock and may tear (the tag leaving the field), so decode, read-ahead and write paths
+ * can be load-tested with realistic latency and failures on any machine.
+ *
+ * Given an NDEFReadSessionCache, a torn read is kept under the tag's UID and the next read of the same tag resumes it,
+ * as a reader would after the tag is tapped again.
+ */
+
+#ifndef TAG_SIM_HPP
+#define TAG_SIM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/parser.hpp"
+#include "ndef-lite/read-session.hpp"
+
+/// NFC Forum tag platform being simulated
+enum class NFCTagType {
+  /// Memory addressed in 4 byte pages, NDEF Message stored in a TLV after the Capability Container
+  Type2,
+
+  /// ISO 7816-4 file system, NDEF Message stored in a file prefixed with its 2 byte length
+  Type4,
+};
+
+/// RF link characteristics of a simulated reader
+struct NFCLinkProfile
+{
+  /// Largest response to a single read command. Type 2 READ always returns 16 bytes, so this only applies to Type 4
+  size_t max_fragment = 64;
+
+  /// Fixed cost of every command: frame delay, turnaround and processing on the tag
+  uint32_t command_us = 500;
+
+  /// Cost of every byte sent in either direction. About 76us at 106 kbit/s
+  uint32_t byte_us = 76;
+
+  /// Probability that any single command tears because the tag leaves the field
+  double tear_rate = 0.0;
+
+  /// Seed for the tear generator, so failures are reproducible
+  uint32_t seed = 1;
+
+  /// Whether to actually sleep for the simulated time rather than just accounting for it
+  bool real_time = false;
+};
+
+/// Counters accumulated by a simulated reader
+struct NFCLinkStats
+{
+  /// Number of commands sent to the tag
+  uint64_t commands;
+
+  /// Bytes sent and received, including command headers
+  uint64_t bytes;
+
+  /// Simulated time spent on the RF link
+  uint64_t elapsed_us;
+
+  /// Number of commands that tore
+  uint64_t tears;
+};
+
+class NDEFSimulatedTag {
+public:
+  /// Creates a blank, formatted tag
+  /// \param type tag platform
+  /// \param capacity bytes available for the NDEF Message and its framing. Type 2 tags round this up to 8 bytes
+  /// \param uid UID the tag reports, or empty for a fixed 7 byte UID. Type 2 tags hold it in their first pages
+  /// \throws NDEFException if \p capacity is too large for the tag platform, or a Type 2 \p uid is not 7 bytes
+  NDEFSimulatedTag(NFCTagType type, size_t capacity, const std::vector<uint8_t>& uid = std::vector<uint8_t>{});
+
+  /// \return tag platform
+  NFCTagType type() const { return this->tag_type; }
+
+  /// \return UID the tag reports when it is activated
+  const std::vector<uint8_t>& uid() const { return this->tag_uid; }
+
+  /// \return bytes available for the NDEF Message and its framing
+  size_t capacity() const { return this->data_capacity; }
+
+  /// Raw tag memory: every page of a Type 2 tag, or the NDEF file of a Type 4 tag
+  /// \return tag memory
+  const std::vector<uint8_t>& memory() const { return this->tag_memory; }
+
+  /// Writes an encoded message straight into the tag memory, bypassing the RF link
+  /// \param message encoded NDEF Message
+  /// \throws NDEFException if the message does not fit
+  void store(const std::vector<uint8_t>& message);
+
+  /// \param offset first byte of tag memory to read
+  /// \param len number of bytes to read. Bytes beyond the end of memory read as 0
+  /// \return copy of the bytes
+  std::vector<uint8_t> read(size_t offset, size_t len) const;
+
+  /// \param offset first byte of tag memory to write
+  /// \param data bytes to write
+  /// \param len number of bytes in \p data
+  /// \throws std::out_of_range if the write extends past the end of memory
+  void write(size_t offset, const uint8_t* data, size_t len);
+
+private:
+  NFCTagType tag_type;
+  size_t data_capacity;
+  std::vector<uint8_t> tag_uid;
+  std::vector<uint8_t> tag_memory;
+};
+
+class NDEFSimulatedReader {
+public:
+  /// \param tag tag in the field of the reader. Must outlive the reader
+  /// \param profile RF link characteristics
+  /// \throws NDEFException if the fragment size is too small for the tag platform
+  NDEFSimulatedReader(NDEFSimulatedTag& tag, const NFCLinkProfile& profile = NFCLinkProfile{});
+
+  /// Reads the NDEF Message off of the tag, decoding each fragment as it arrives
+  /// \return message stored on the tag
+  /// \throws NDEFException if the tag tears, holds no message, or the message is malformed
+  NDEFMessage read_message();
+
+  /// Reads the NDEF Message off of the tag, resuming the tag's session in \p sessions if it has one. A torn read is
+  /// stored back into \p sessions, and a completed one leaves none behind
+  /// \param sessions interrupted reads, keyed by tag UID
+  /// \return message stored on the tag
+  /// \throws NDEFException if the tag tears, holds no message, or the message is malformed
+  NDEFMessage read_message(NDEFReadSessionCache& sessions);
+
+  /// Writes a message to the tag. A torn write leaves the tag partially written, exactly as a real tag would be
+  /// \param msg message to write
+  /// \throws NDEFException if the message is invalid, does not fit, or the tag tears
+  void write_message(const NDEFMessage& msg);
+
+  /// \return counters accumulated since construction
+  const NFCLinkStats& stats() const { return this->link_stats; }
+
+private:
+  NDEFSimulatedTag& tag;
+  NFCLinkProfile profile;
+  NFCLinkStats link_stats{ 0, 0, 0, 0 };
+  std::mt19937 tear_generator;
+
+  /// Accounts for one command and decides whether it tears
+  /// \param sent bytes sent to the tag
+  /// \param received bytes returned by the tag
+  /// \return whether the command tore
+  bool transceive(size_t sent, size_t received);
+
+  /// \return bytes of tag memory returned by a single read command at \p offset
+  std::vector<uint8_t> read_fragment(size_t offset, size_t len);
+
+  /// Writes \p len bytes at \p offset with as many write commands as the platform requires
+  void write_fragments(size_t offset, const uint8_t* data, size_t len);
+
+  /// Re-reads the last \p overlap bytes of \p session together with the bytes after them
+  /// \return whether the re-read bytes match, in which case the new ones are added to the session
+  bool resume(NDEFReadSession& session, size_t overlap);
+
+  NDEFMessage read_session(NDEFReadSession& session);
+  NDEFMessage read_type2(NDEFReadSession& session);
+  NDEFMessage read_type4(NDEFReadSession& session);
+
+  /// Feeds the message bytes read since the last call to the parser and decodes what it can
+  /// \return whether the message is complete
+  bool consume(NDEFReadSession& session);
+};
+
+#endif // TAG_SIM_HPP
@@ -61,7 +61,8 @@ inline std::vector<T> drain_deque(std::deque<T>& queue, size_t n)
 /// \return uint32 in little endian order
 constexpr inline uint32_t uint32FromBEBytes(uint8_t bytes[4])
 {
-  return static_cast<uint32_t>(bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3] << 0);
+  return static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 |
+         static_cast<uint32_t>(bytes[2]) << 8 | static_cast<uint32_t>(bytes[3]);
 }
 
 /// Confirms that the queue passed has at least n values available, throwing an exception if not
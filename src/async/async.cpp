@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "ndef-lite/async.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+using namespace std;
+
+namespace {
+/// Fire and forget coroutine owning a spawned task until it finishes
+struct Detached
+{
+  struct promise_type
+  {
+    Detached get_return_object() { return {}; }
+    suspend_never initial_suspend() noexcept { return {}; }
+    suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { terminate(); }
+  };
+};
+
+Detached run_detached(NDEFEventLoop& loop, NDEFTask<void> task, exception_ptr& error)
+{
+  // Start on the loop rather than inside spawn()
+  co_await loop.yield();
+
+  try {
+    co_await task;
+  } catch (...) {
+    if (!error) {
+      error = current_exception();
+    }
+  }
+}
+} // namespace
+
+/// Queues the task to start on the next turn of the loop
+void NDEFEventLoop::spawn(NDEFTask<void> task) { run_detached(*this, std::move(task), this->error); }
+
+/// Resumes ready coroutines in FIFO order until the queue drains
+void NDEFEventLoop::run()
+{
+  while (!this->ready.empty()) {
+    auto handle = this->ready.front();
+    this->ready.pop_front();
+    handle.resume();
+  }
+
+  if (this->error) {
+    rethrow_exception(exchange(this->error, nullptr));
+  }
+}
+
+/// One direction of a loopback connection
+struct NDEFLoopbackTransport::Pipe
+{
+  deque<uint8_t> bytes;
+  bool closed = false;
+
+  // Read waiting for bytes to arrive
+  uint8_t* read_data = nullptr;
+  size_t read_len = 0;
+  NDEFIoCompletion* read_completion = nullptr;
+
+  /// Completes the pending read if there is anything to report
+  void try_complete_read(NDEFEventLoop& loop)
+  {
+    if (!this->read_completion || (this->bytes.empty() && !this->closed)) {
+      return;
+    }
+
+    size_t n = min(this->read_len, this->bytes.size());
+    copy(this->bytes.begin(), this->bytes.begin() + n, this->read_data);
+    this->bytes.erase(this->bytes.begin(), this->bytes.begin() + n);
+
+    auto completion = exchange(this->read_completion, nullptr);
+    completion->result = n;
+    loop.post(completion->waiter);
+  }
+};
+
+/// Creates two endpoints whose pipes are cross connected
+pair<unique_ptr<NDEFLoopbackTransport>, unique_ptr<NDEFLoopbackTransport>>
+NDEFLoopbackTransport::create_pair(NDEFEventLoop& loop)
+{
+  auto a_to_b = make_shared<Pipe>();
+  auto b_to_a = make_shared<Pipe>();
+
+  return { unique_ptr<NDEFLoopbackTransport>{ new NDEFLoopbackTransport{ loop, b_to_a, a_to_b } },
+           unique_ptr<NDEFLoopbackTransport>{ new NDEFLoopbackTransport{ loop, a_to_b, b_to_a } } };
+}
+
+/// Registers the read, completing it straight away if bytes are already waiting
+void NDEFLoopbackTransport::start_read(uint8_t* data, size_t len, NDEFIoCompletion& completion)
+{
+  if (this->inbound->read_completion) {
+    throw NDEFException("Loopback transport already has a read outstanding");
+  }
+
+  this->inbound->read_data = data;
+  this->inbound->read_len = len;
+  this->inbound->read_completion = &completion;
+  this->inbound->try_complete_read(this->loop);
+}
+
+/// Hands the bytes to the peer. The pipe is unbounded, so writes always complete in full
+void NDEFLoopbackTransport::start_write(const uint8_t* data, size_t len, NDEFIoCompletion& completion)
+{
+  completion.result = 0;
+
+  if (!this->outbound->closed) {
+    this->outbound->bytes.insert(this->outbound->bytes.end(), data, data + len);
+    this->outbound->try_complete_read(this->loop);
+    completion.result = len;
+  }
+
+  this->loop.post(completion.waiter);
+}
+
+/// Marks this end closed so the peer sees end of stream
+void NDEFLoopbackTransport::close()
+{
+  this->outbound->closed = true;
+  this->outbound->try_complete_read(this->loop);
+}
+
+/// Reads from the transport until the parser has a complete message
+NDEFTask<NDEFMessage> NDEFAsyncReader::read_message()
+{
+  while (this->parser.decode() != DecodeStatus::Complete) {
+    size_t n = co_await this->transport.read_some(this->read_buffer.data(), this->read_buffer.size());
+
+    if (n == 0) {
+      if (this->parser.record_count() == 0 && this->parser.bytes_buffered() == 0) {
+        throw NDEFException("Transport closed before a message was received");
+      }
+
+      throw NDEFException("Transport closed in the middle of a message");
+    }
+
+    this->parser.feed(this->read_buffer.data(), n);
+  }
+
+  co_return this->parser.take_message();
+}
+
+/// Encodes the message and writes until every byte has been accepted
+NDEFTask<void> NDEFAsyncWriter::write(NDEFMessage msg)
+{
+  auto bytes = msg.as_bytes();
+  if (bytes.empty()) {
+    throw NDEFException("Unable to write invalid message");
+  }
+
+  size_t written = 0;
+  while (written < bytes.size()) {
+    size_t n = co_await this->transport.write_some(bytes.data() + written, bytes.size() - written);
+
+    if (n == 0) {
+      throw NDEFException("Transport closed after " + to_string(written) + " of " + to_string(bytes.size()) +
+                          " bytes were written");
+    }
+
+    written += n;
+  }
+}
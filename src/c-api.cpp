@@ -0,0 +1,484 @@
+#include <cstring>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/ndef-lite.h"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/record-layout.hpp"
+#include "ndef-lite/record-view.hpp"
+
+using namespace std;
+
+/// Handle behind the opaque C type. Borrowed bytes are only copied into the buffer once the message is edited
+struct ndef_message
+{
+  NDEFMessageBuffer buffer;
+
+  /// View over the caller's bytes while borrowing
+  NDEFMessageView borrowed;
+  bool borrowing = false;
+
+  const NDEFMessageView& view() const { return this->borrowing ? this->borrowed : this->buffer.view(); }
+
+  NDEFMessageBuffer& editable()
+  {
+    if (this->borrowing) {
+      this->buffer.assign(this->borrowed);
+      this->borrowed.clear();
+      this->borrowing = false;
+    }
+
+    return this->buffer;
+  }
+
+  void clear()
+  {
+    this->buffer.clear();
+    this->borrowed.clear();
+    this->borrowing = false;
+  }
+};
+
+namespace {
+thread_local string last_error;
+
+/// Records \p message as the calling thread's most recent failure
+ndef_status fail(ndef_status status, const char* message)
+{
+  try {
+    last_error = message;
+  } catch (...) {
+    // Keep whatever was there, the status still tells what went wrong
+  }
+
+  return status;
+}
+
+ndef_status fail(ndef_status status, const string& message) { return fail(status, message.c_str()); }
+
+/// Runs \p body, turning any exception into a status so none crosses into C
+template <typename Body>
+ndef_status guarded(Body body)
+{
+  try {
+    return body();
+  } catch (const out_of_range& e) {
+    return fail(NDEF_ERR_OUT_OF_RANGE, e.what());
+  } catch (const NDEFException& e) {
+    return fail(NDEF_ERR_INVALID_ARGUMENT, e.what());
+  } catch (const bad_alloc&) {
+    return fail(NDEF_ERR_INTERNAL, "Out of memory");
+  } catch (const exception& e) {
+    return fail(NDEF_ERR_INTERNAL, e.what());
+  } catch (...) {
+    return fail(NDEF_ERR_INTERNAL, "Unknown error");
+  }
+}
+
+/// \return failure status for a framing pass that stopped at byte \p pos
+ndef_status frame_failure(FrameStatus status, size_t pos)
+{
+  if (status == FrameStatus::Malformed) {
+    return fail(NDEF_ERR_MALFORMED, "Invalid character found in type field of record at byte " + to_string(pos));
+  }
+
+  return fail(NDEF_ERR_TRUNCATED, "Too few bytes for record at byte " + to_string(pos));
+}
+
+ndef_bytes bytes_of(ByteSpan span) { return ndef_bytes{ span.data, span.size }; }
+
+ndef_record_info record_info(const NDEFRecordView& record)
+{
+  const uint8_t header = record.data()[0];
+  return ndef_record_info{ static_cast<uint8_t>(header & 0x07), header, bytes_of(record.type()), bytes_of(record.id()),
+                           bytes_of(record.payload()) };
+}
+
+/// Checks the fields of a record to encode
+/// \param size set to the number of bytes the record takes once encoded
+ndef_status check_record(const ndef_record_info& record, size_t& size)
+{
+  if (record.tnf > NDEF_TNF_UNCHANGED) {
+    return fail(NDEF_ERR_INVALID_ARGUMENT, "TNF " + to_string(record.tnf) + " is reserved");
+  }
+
+  if (record.type.size > UINT8_MAX || record.id.size > UINT8_MAX || record.payload.size > UINT32_MAX) {
+    return fail(NDEF_ERR_INVALID_ARGUMENT, "Record field is too long for its length field");
+  }
+
+  if ((record.type.data == nullptr && record.type.size > 0) || (record.id.data == nullptr && record.id.size > 0) ||
+      (record.payload.data == nullptr && record.payload.size > 0)) {
+    return fail(NDEF_ERR_INVALID_ARGUMENT, "Record field has a length but no data");
+  }
+
+  switch (record.tnf) {
+  case NDEF_TNF_EMPTY:
+    if (record.type.size > 0 || record.id.size > 0 || record.payload.size > 0) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Empty record must not have a type, ID or payload");
+    }
+    break;
+  case NDEF_TNF_UNKNOWN:
+    if (record.type.size > 0) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Unknown record must not have a type");
+    }
+    break;
+  case NDEF_TNF_UNCHANGED:
+    // Only middle and terminating chunks use Unchanged, and those carry neither a type nor an ID
+    if (record.type.size > 0 || record.id.size > 0) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Unchanged record must not have a type or ID");
+    }
+    break;
+  default:
+    if (record.type.size == 0) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "TNF " + to_string(record.tnf) + " requires a record type");
+    }
+    break;
+  }
+
+  for (size_t i = 0; i < record.type.size; i++) {
+    const uint8_t chr = record.type.data[i];
+    if (chr <= 31 || chr == 127) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Invalid character found in record type");
+    }
+  }
+
+  size = 2 + ((record.payload.size <= UINT8_MAX) ? 1 : 4) + ((record.id.size > 0) ? 1 : 0) + record.type.size +
+         record.id.size + record.payload.size;
+  return NDEF_OK;
+}
+
+uint8_t* write_field(uint8_t* out, const ndef_bytes& field)
+{
+  if (field.size > 0) {
+    memcpy(out, field.data, field.size);
+  }
+
+  return out + field.size;
+}
+
+/// Encodes a record already checked by check_record()
+/// \return pointer one past the last byte written
+uint8_t* write_record(uint8_t* out, const ndef_record_info& record, bool first, bool last)
+{
+  NDEFRecordHeader header;
+  header.tnf = static_cast<NDEFRecordType::TypeID>(record.tnf);
+  header.il = record.id.size > 0;
+  header.sr = record.payload.size <= UINT8_MAX;
+  header.cf = (record.header & static_cast<uint8_t>(RecordFlag::CF)) != 0;
+  header.me = last;
+  header.mb = first;
+
+  *out++ = header.asByte();
+  *out++ = static_cast<uint8_t>(record.type.size);
+
+  // Payload length is 1 byte for short records, otherwise 4 bytes in big endian order
+  const size_t payload_size = record.payload.size;
+  if (header.sr) {
+    *out++ = static_cast<uint8_t>(payload_size);
+  } else {
+    *out++ = static_cast<uint8_t>(payload_size >> 24);
+    *out++ = static_cast<uint8_t>(payload_size >> 16);
+    *out++ = static_cast<uint8_t>(payload_size >> 8);
+    *out++ = static_cast<uint8_t>(payload_size >> 0);
+  }
+
+  if (header.il) {
+    *out++ = static_cast<uint8_t>(record.id.size);
+  }
+
+  out = write_field(out, record.type);
+  out = write_field(out, record.id);
+  return write_field(out, record.payload);
+}
+
+/// Frames one message for a handle, which then borrows the caller's bytes
+ndef_status frame_handle(ndef_message* msg, const uint8_t* data, size_t len)
+{
+  msg->clear();
+
+  if (data == nullptr && len > 0) {
+    return fail(NDEF_ERR_INVALID_ARGUMENT, "Message bytes are null");
+  }
+
+  size_t message_length = 0;
+  auto status = frame_message(data, len, message_length);
+  if (status != FrameStatus::Complete) {
+    // Find the record that failed, only to report where
+    size_t pos = 0;
+    NDEFRecordLayout layout;
+    while (frame_record(data + pos, len - pos, layout) == FrameStatus::Complete) {
+      pos += layout.total_length;
+    }
+    return frame_failure(status, pos);
+  }
+
+  msg->borrowed.open(data, message_length);
+  msg->borrowing = true;
+  return NDEF_OK;
+}
+} // namespace
+
+int ndef_abi_version(void) { return NDEF_LITE_C_ABI_VERSION; }
+
+const char* ndef_last_error(void) { return last_error.c_str(); }
+
+ndef_message* ndef_message_new(void) { return new (nothrow) ndef_message; }
+
+void ndef_message_free(ndef_message* msg) { delete msg; }
+
+ndef_status ndef_message_decode(ndef_message* msg, const uint8_t* data, size_t len)
+{
+  return guarded([&]() {
+    if (msg == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle is null");
+    }
+
+    auto status = frame_handle(msg, data, len);
+    if (status == NDEF_OK) {
+      msg->editable();
+    }
+    return status;
+  });
+}
+
+ndef_status ndef_message_borrow(ndef_message* msg, const uint8_t* data, size_t len)
+{
+  return guarded([&]() {
+    if (msg == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle is null");
+    }
+
+    return frame_handle(msg, data, len);
+  });
+}
+
+size_t ndef_message_record_count(const ndef_message* msg) { return (msg != nullptr) ? msg->view().record_count() : 0; }
+
+ndef_status ndef_message_record(const ndef_message* msg, size_t index, ndef_record_info* record)
+{
+  return guarded([&]() {
+    if (msg == nullptr || record == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle or record is null");
+    }
+
+    if (index >= msg->view().record_count()) {
+      return fail(NDEF_ERR_OUT_OF_RANGE, "Record " + to_string(index) + " outside of range of message");
+    }
+
+    *record = record_info(msg->view().record(index));
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_records(const ndef_message* msg, ndef_record_info* records, size_t capacity, size_t* count)
+{
+  return guarded([&]() {
+    if (msg == nullptr || count == nullptr || (records == nullptr && capacity > 0)) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle, records or count is null");
+    }
+
+    auto& view = msg->view();
+    *count = view.record_count();
+    if (capacity < view.record_count()) {
+      return fail(NDEF_ERR_BUFFER_TOO_SMALL, "Message has " + to_string(view.record_count()) + " records");
+    }
+
+    for (size_t i = 0; i < view.record_count(); i++) {
+      records[i] = record_info(view.record(i));
+    }
+
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_bytes(const ndef_message* msg, ndef_bytes* bytes)
+{
+  return guarded([&]() {
+    if (msg == nullptr || bytes == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle or bytes is null");
+    }
+
+    *bytes = ndef_bytes{ msg->view().data(), msg->view().size() };
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_encode(const ndef_message* msg, uint8_t* out, size_t capacity, size_t* written)
+{
+  return guarded([&]() {
+    if (msg == nullptr || written == nullptr || (out == nullptr && capacity > 0)) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle, output or written is null");
+    }
+
+    auto& view = msg->view();
+    *written = view.size();
+    if (capacity < view.size()) {
+      return fail(NDEF_ERR_BUFFER_TOO_SMALL, "Message takes " + to_string(view.size()) + " bytes");
+    }
+
+    if (view.size() > 0) {
+      memcpy(out, view.data(), view.size());
+    }
+
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_insert(ndef_message* msg, size_t index, const ndef_record_info* record)
+{
+  return guarded([&]() {
+    if (msg == nullptr || record == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle or record is null");
+    }
+
+    size_t size = 0;
+    auto status = check_record(*record, size);
+    if (status != NDEF_OK) {
+      return status;
+    }
+
+    if (index > msg->view().record_count()) {
+      return fail(NDEF_ERR_OUT_OF_RANGE, "Record " + to_string(index) + " outside of range of message");
+    }
+
+    vector<uint8_t> bytes(size);
+    write_record(bytes.data(), *record, true, true);
+
+    NDEFRecordLayout layout;
+    frame_record(bytes.data(), bytes.size(), layout);
+    msg->editable().insert_record(index, NDEFRecordView{ bytes.data(), layout });
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_replace_payload(ndef_message* msg, size_t index, const uint8_t* data, size_t len)
+{
+  return guarded([&]() {
+    if (msg == nullptr || (data == nullptr && len > 0)) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle or payload is null");
+    }
+
+    if (index >= msg->view().record_count()) {
+      return fail(NDEF_ERR_OUT_OF_RANGE, "Record " + to_string(index) + " outside of range of message");
+    }
+
+    // Checked on the view, so a borrowed message is not copied for an edit that is refused
+    if (msg->view().record(index).tnf() == NDEFRecordType::TypeID::Empty && len > 0) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Empty record must not have a payload");
+    }
+
+    msg->editable().replace_payload(index, data, len);
+    return NDEF_OK;
+  });
+}
+
+ndef_status ndef_message_remove(ndef_message* msg, size_t index)
+{
+  return guarded([&]() {
+    if (msg == nullptr) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Message handle is null");
+    }
+
+    msg->editable().remove_record(index);
+    return NDEF_OK;
+  });
+}
+
+/// Frames records straight into the caller's arrays, one pass and no allocation
+ndef_status ndef_decode_batch(const uint8_t* data, size_t len, ndef_message_info* messages, size_t message_capacity,
+                              size_t* message_count, ndef_record_info* records, size_t record_capacity,
+                              size_t* record_count)
+{
+  return guarded([&]() {
+    if (message_count == nullptr || record_count == nullptr || (data == nullptr && len > 0) ||
+        (messages == nullptr && message_capacity > 0) || (records == nullptr && record_capacity > 0)) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Batch bytes, arrays or counts are null");
+    }
+
+    *message_count = 0;
+    *record_count = 0;
+
+    size_t pos = 0;
+    while (pos < len) {
+      if (*message_count == message_capacity) {
+        return fail(NDEF_ERR_BUFFER_TOO_SMALL, "Message array is full at byte " + to_string(pos));
+      }
+
+      // Counts only move once the whole message is framed, so a message that does not fit is not reported at all
+      const size_t start = pos;
+      size_t used = *record_count;
+      while (true) {
+        NDEFRecordLayout layout;
+        auto status = frame_record(data + pos, len - pos, layout);
+        if (status != FrameStatus::Complete) {
+          return frame_failure(status, pos);
+        }
+
+        if (used == record_capacity) {
+          return fail(NDEF_ERR_BUFFER_TOO_SMALL, "Record array is full at byte " + to_string(pos));
+        }
+
+        records[used++] = record_info(NDEFRecordView{ data + pos, layout });
+        pos += layout.total_length;
+
+        if (layout.header.me) {
+          break;
+        }
+      }
+
+      messages[*message_count] = ndef_message_info{ start, pos - start, *record_count, used - *record_count };
+      (*message_count)++;
+      *record_count = used;
+    }
+
+    return NDEF_OK;
+  });
+}
+
+/// Sizes every message before writing any, so a buffer that is too small is left untouched
+ndef_status ndef_encode_batch(const ndef_record_info* records, const size_t* record_counts, size_t message_count,
+                              uint8_t* out, size_t capacity, size_t* written)
+{
+  return guarded([&]() {
+    if (written == nullptr || (message_count > 0 && (records == nullptr || record_counts == nullptr)) ||
+        (out == nullptr && capacity > 0)) {
+      return fail(NDEF_ERR_INVALID_ARGUMENT, "Batch records, counts, output or written is null");
+    }
+
+    size_t total = 0;
+    size_t record = 0;
+    for (size_t i = 0; i < message_count; i++) {
+      if (record_counts[i] == 0) {
+        return fail(NDEF_ERR_INVALID_ARGUMENT, "Message " + to_string(i) + " has no records");
+      }
+
+      for (size_t r = 0; r < record_counts[i]; r++, record++) {
+        size_t size = 0;
+        auto status = check_record(records[record], size);
+        if (status != NDEF_OK) {
+          return status;
+        }
+        total += size;
+      }
+    }
+
+    *written = total;
+    if (capacity < total) {
+      return fail(NDEF_ERR_BUFFER_TOO_SMALL, "Messages take " + to_string(total) + " bytes");
+    }
+
+    record = 0;
+    for (size_t i = 0; i < message_count; i++) {
+      for (size_t r = 0; r < record_counts[i]; r++, record++) {
+        out = write_record(out, records[record], r == 0, r + 1 == record_counts[i]);
+      }
+    }
+
+    return NDEF_OK;
+  });
+}
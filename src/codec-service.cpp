@@ -0,0 +1,962 @@
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ndef-lite/codec-service.hpp"
+#include "ndef-lite/compression.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/payload-source.hpp"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/record-view.hpp"
+
+using namespace std;
+
+namespace {
+/// Frame length and batch ID
+const size_t frame_header_size = 8;
+
+/// Op or status and body length
+const size_t item_header_size = 5;
+
+/// Referenced bytes shorter than this are copied into the response, since another iovec costs more than the copy
+const size_t min_reference = 128;
+
+/// Bytes read from a connection at once. Frames that fit are copied out of it, larger ones are received in place
+const size_t staging_size = 64 * 1024;
+
+/// Batches waiting for a worker, per worker, before the I/O thread stops reading
+const size_t jobs_per_worker = 64;
+
+void put_u16(uint8_t* out, uint16_t value)
+{
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put_u32(uint8_t* out, uint32_t value)
+{
+  for (int i = 0; i < 4; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint16_t get_u16(const uint8_t* in) { return static_cast<uint16_t>(in[0] | (in[1] << 8)); }
+
+uint32_t get_u32(const uint8_t* in)
+{
+  return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) | (static_cast<uint32_t>(in[2]) << 16) |
+         (static_cast<uint32_t>(in[3]) << 24);
+}
+
+/// Frame under construction, made of bytes it owns and of references to bytes that stay where they are until the
+/// frame has been sent
+class FrameBuilder {
+public:
+  /// Position to rewind to
+  struct Mark
+  {
+    size_t owned;
+    size_t segments;
+    size_t total;
+  };
+
+  void append(const uint8_t* data, size_t len)
+  {
+    if (len == 0) {
+      return;
+    }
+
+    if (this->segments.empty() || this->segments.back().ref != nullptr) {
+      this->segments.push_back(Segment{ nullptr, this->owned.size(), 0 });
+    }
+
+    this->owned.insert(this->owned.end(), data, data + len);
+    this->segments.back().len += len;
+    this->total += len;
+  }
+
+  void append_u8(uint8_t value) { this->append(&value, 1); }
+
+  void append_u16(uint16_t value)
+  {
+    uint8_t bytes[2];
+    put_u16(bytes, value);
+    this->append(bytes, sizeof(bytes));
+  }
+
+  void append_u32(uint32_t value)
+  {
+    uint8_t bytes[4];
+    put_u32(bytes, value);
+    this->append(bytes, sizeof(bytes));
+  }
+
+  void append(const string& text) { this->append(reinterpret_cast<const uint8_t*>(text.data()), text.size()); }
+
+  /// Adds bytes by reference, copying them only when that is cheaper
+  void reference(const uint8_t* data, size_t len)
+  {
+    if (len < min_reference) {
+      this->append(data, len);
+      return;
+    }
+
+    this->segments.push_back(Segment{ data, 0, len });
+    this->total += len;
+  }
+
+  void reference(const ByteSpan& span) { this->reference(span.data, span.size); }
+
+  /// Appends \p len zero bytes to be patched later
+  /// \return offset of the bytes among the owned bytes
+  size_t reserve(size_t len)
+  {
+    const size_t offset = this->owned.size();
+    const uint8_t zeros[8] = {};
+    this->append(zeros, len);
+    return offset;
+  }
+
+  uint8_t* owned_at(size_t offset) { return this->owned.data() + offset; }
+
+  size_t size() const { return this->total; }
+
+  Mark mark() const { return Mark{ this->owned.size(), this->segments.size(), this->total }; }
+
+  void rewind(const Mark& mark)
+  {
+    this->owned.resize(mark.owned);
+    this->segments.resize(mark.segments);
+    this->total = mark.total;
+
+    // The last owned segment may have grown since the mark was taken
+    if (!this->segments.empty() && this->segments.back().ref == nullptr) {
+      this->segments.back().len = this->owned.size() - this->segments.back().offset;
+    }
+  }
+
+  void clear() { this->rewind(Mark{ 0, 0, 0 }); }
+
+  /// \return iovecs covering the frame. Invalidated by any change to the frame
+  vector<iovec> iovecs()
+  {
+    vector<iovec> iov;
+    iov.reserve(this->segments.size());
+    for (auto&& segment : this->segments) {
+      auto base = segment.ref ? segment.ref : this->owned.data() + segment.offset;
+      iov.push_back(iovec{ const_cast<uint8_t*>(base), segment.len });
+    }
+
+    return iov;
+  }
+
+  /// \return copy of the whole frame
+  vector<uint8_t> flatten()
+  {
+    vector<uint8_t> bytes;
+    bytes.reserve(this->total);
+    for (auto&& part : this->iovecs()) {
+      auto base = static_cast<const uint8_t*>(part.iov_base);
+      bytes.insert(bytes.end(), base, base + part.iov_len);
+    }
+
+    return bytes;
+  }
+
+private:
+  /// Either \p len owned bytes from \p offset, or \p len bytes at \p ref
+  struct Segment
+  {
+    const uint8_t* ref;
+    size_t offset;
+    size_t len;
+  };
+
+  vector<uint8_t> owned;
+  vector<Segment> segments;
+  size_t total = 0;
+};
+
+/// Writes every iovec, retrying short and interrupted writes
+void send_iovecs(int fd, vector<iovec>& iov)
+{
+  size_t first = 0;
+
+  while (first < iov.size()) {
+    msghdr msg{};
+    msg.msg_iov = &iov[first];
+    msg.msg_iovlen = min<size_t>(iov.size() - first, IOV_MAX);
+
+    ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw NDEFException("Unable to send frame: " + string{ strerror(errno) });
+    }
+
+    auto remaining = static_cast<size_t>(sent);
+    while (first < iov.size() && remaining >= iov[first].iov_len) {
+      remaining -= iov[first].iov_len;
+      first++;
+    }
+
+    if (remaining > 0) {
+      iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + remaining;
+      iov[first].iov_len -= remaining;
+    }
+  }
+}
+
+/// Reads exactly \p len bytes, blocking until they arrive
+void receive_exactly(int fd, uint8_t* data, size_t len)
+{
+  while (len > 0) {
+    ssize_t got = recv(fd, data, len, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      throw NDEFException("Unable to receive frame: " + string{ got == 0 ? "connection closed" : strerror(errno) });
+    }
+
+    data += got;
+    len -= static_cast<size_t>(got);
+  }
+}
+
+/// Payload borrowed from a request buffer for as long as the request is processed
+class SpanPayload : public NDEFPayloadSource {
+public:
+  explicit SpanPayload(const ByteSpan& span) : span(span) {}
+
+  size_t size() const override { return this->span.size; }
+  const uint8_t* data() const override { return this->span.data; }
+  vector<uint8_t> read() const override { return this->span.to_vector(); }
+  void write_to(int fd) const override { NDEFPayloadSource::write_bytes(fd, this->span.data, this->span.size); }
+
+private:
+  ByteSpan span;
+};
+
+/// Record of a flat record list
+struct FlatRecord
+{
+  uint8_t tnf;
+  bool chunked;
+  ByteSpan type;
+  ByteSpan id;
+  ByteSpan payload;
+};
+
+vector<FlatRecord> parse_record_list(const uint8_t* data, size_t len)
+{
+  vector<FlatRecord> records;
+  size_t pos = 0;
+
+  while (pos < len) {
+    if (len - pos < 8) {
+      throw NDEFException("Truncated record list");
+    }
+
+    FlatRecord record;
+    record.tnf = data[pos];
+    record.chunked = (data[pos + 1] & 0x01) != 0;
+    const size_t type_length = data[pos + 2];
+    const size_t id_length = data[pos + 3];
+    const size_t payload_length = get_u32(data + pos + 4);
+    pos += 8;
+
+    if (len - pos < type_length + id_length || len - pos - type_length - id_length < payload_length) {
+      throw NDEFException("Truncated record list");
+    }
+
+    record.type = ByteSpan{ data + pos, type_length };
+    record.id = ByteSpan{ data + pos + type_length, id_length };
+    record.payload = ByteSpan{ data + pos + type_length + id_length, payload_length };
+    pos += type_length + id_length + payload_length;
+
+    records.push_back(record);
+  }
+
+  return records;
+}
+
+/// \return record whose payload is borrowed from the request
+NDEFRecord borrowed_record(NDEFRecordType::TypeID tnf, const ByteSpan& type, const ByteSpan& id,
+                           const ByteSpan& payload, bool chunked)
+{
+  NDEFRecord record{ make_shared<SpanPayload>(payload), NDEFRecordType{ tnf, type.to_string() }, id.to_string() };
+  record.set_chunked(chunked);
+  return record;
+}
+
+/// Appends the encoded record, referencing its payload where it is addressable
+void append_record(FrameBuilder& out, const NDEFRecord& record, size_t index, size_t num_records)
+{
+  const uint8_t mb = static_cast<uint8_t>(RecordFlag::MB);
+  const uint8_t me = static_cast<uint8_t>(RecordFlag::ME);
+
+  auto header = record.header_bytes();
+  header[0] &= ~mb & ~me;
+  header[0] |= (index == 0) ? mb : 0;
+  header[0] |= (index == num_records - 1) ? me : 0;
+  out.append(header.data(), header.size());
+
+  auto&& payload = record.payload_handle();
+  if (payload->data() != nullptr) {
+    out.reference(payload->data(), payload->size());
+  } else {
+    auto bytes = payload->read();
+    out.append(bytes.data(), bytes.size());
+  }
+}
+
+/// Frames a whole message, rejecting trailing bytes
+NDEFMessageView open_message(const uint8_t* data, size_t len)
+{
+  NDEFMessageView view{ data, len };
+  if (view.size() != len) {
+    throw NDEFException("Trailing bytes after message end");
+  }
+
+  return view;
+}
+
+void decode(FrameBuilder& out, const uint8_t* data, size_t len)
+{
+  auto view = open_message(data, len);
+
+  for (size_t i = 0; i < view.record_count(); i++) {
+    auto record = view.record(i);
+
+    out.append_u8(static_cast<uint8_t>(record.tnf()));
+    out.append_u8(record.header().cf ? 0x01 : 0x00);
+    out.append_u8(static_cast<uint8_t>(record.type().size));
+    out.append_u8(static_cast<uint8_t>(record.id().size));
+    out.append_u32(static_cast<uint32_t>(record.payload().size));
+    out.reference(record.type());
+    out.reference(record.id());
+    out.reference(record.payload());
+  }
+}
+
+void encode(FrameBuilder& out, const uint8_t* data, size_t len)
+{
+  auto records = parse_record_list(data, len);
+  if (records.empty()) {
+    throw NDEFException("Unable to encode a message without records");
+  }
+
+  for (size_t i = 0; i < records.size(); i++) {
+    auto&& flat = records[i];
+    if (flat.tnf > static_cast<uint8_t>(NDEFRecordType::TypeID::Unchanged)) {
+      throw NDEFException("Invalid TNF " + to_string(flat.tnf));
+    }
+
+    auto tnf = static_cast<NDEFRecordType::TypeID>(flat.tnf);
+    append_record(out, borrowed_record(tnf, flat.type, flat.id, flat.payload, flat.chunked), i, records.size());
+  }
+}
+
+/// \return false if the transcode mode is not supported
+bool transcode(FrameBuilder& out, const uint8_t* data, size_t len)
+{
+  static const auto codec = make_shared<const NDEFCompressionCodec>();
+
+  if (len < 1) {
+    throw NDEFException("Missing transcode mode");
+  }
+
+  auto mode = static_cast<TranscodeMode>(data[0]);
+  auto view = open_message(data + 1, len - 1);
+
+  switch (mode) {
+  case TranscodeMode::Canonical:
+    for (size_t i = 0; i < view.record_count(); i++) {
+      auto record = view.record(i);
+      auto borrowed = borrowed_record(record.tnf(), record.type(), record.id(), record.payload(), record.header().cf);
+      append_record(out, borrowed, i, view.record_count());
+    }
+    return true;
+  case TranscodeMode::Compress:
+  case TranscodeMode::Decompress: {
+    NDEFMessage msg;
+    for (size_t i = 0; i < view.record_count(); i++) {
+      auto record = view.record(i).to_record();
+      NDEFRecord decoded;
+      msg.append_record((mode == TranscodeMode::Decompress && codec->decode(record, decoded)) ? decoded : record);
+    }
+
+    msg.set_codec(mode == TranscodeMode::Compress ? codec : nullptr);
+    auto bytes = msg.as_bytes();
+    out.append(bytes.data(), bytes.size());
+    return true;
+  }
+  }
+
+  return false;
+}
+
+/// Appends one response item, answering a failed request with its error message
+void process_item(FrameBuilder& out, CodecOp op, const uint8_t* data, size_t len)
+{
+  const size_t item_header = out.reserve(item_header_size);
+  const auto body_start = out.mark();
+  auto status = CodecStatus::Ok;
+
+  try {
+    switch (op) {
+    case CodecOp::Decode:
+      decode(out, data, len);
+      break;
+    case CodecOp::Encode:
+      encode(out, data, len);
+      break;
+    case CodecOp::Validate:
+      out.append_u32(static_cast<uint32_t>(open_message(data, len).record_count()));
+      break;
+    case CodecOp::Transcode:
+      if (!transcode(out, data, len)) {
+        status = CodecStatus::Unsupported;
+        out.append("Unsupported transcode mode");
+      }
+      break;
+    default:
+      status = CodecStatus::Unsupported;
+      out.append("Unsupported op " + to_string(static_cast<int>(op)));
+    }
+  } catch (const exception& e) {
+    out.rewind(body_start);
+    status = CodecStatus::Malformed;
+    out.append(string{ e.what() });
+  }
+
+  out.owned_at(item_header)[0] = static_cast<uint8_t>(status);
+  put_u32(out.owned_at(item_header + 1), static_cast<uint32_t>(out.size() - body_start.total));
+}
+
+/// Builds the response frame to a request frame
+/// \return false if the request frame is malformed
+bool build_response(FrameBuilder& out, uint32_t id, const vector<uint8_t>& request)
+{
+  if (request.size() < 2) {
+    return false;
+  }
+
+  const size_t frame_header = out.reserve(frame_header_size);
+  const uint16_t count = get_u16(request.data());
+  out.append_u16(count);
+
+  size_t pos = 2;
+  for (uint16_t i = 0; i < count; i++) {
+    if (request.size() - pos < item_header_size) {
+      return false;
+    }
+
+    auto op = static_cast<CodecOp>(request[pos]);
+    const size_t len = get_u32(request.data() + pos + 1);
+    pos += item_header_size;
+    if (request.size() - pos < len) {
+      return false;
+    }
+
+    process_item(out, op, request.data() + pos, len);
+    pos += len;
+  }
+
+  put_u32(out.owned_at(frame_header), static_cast<uint32_t>(out.size() - frame_header_size));
+  put_u32(out.owned_at(frame_header + 4), id);
+  return pos == request.size();
+}
+} // namespace
+
+/// Client connection. Closed once the I/O thread and every worker answering it have let go
+struct NDEFCodecServer::Connection
+{
+  explicit Connection(int fd) : fd(fd), staging(staging_size) {}
+  ~Connection() { close(this->fd); }
+
+  int fd;
+
+  /// Keeps responses from interleaving
+  mutex write_lock;
+
+  // Read state, only touched by the I/O thread
+  vector<uint8_t> staging;
+  size_t staged = 0;
+
+  /// Frame too large for the staging buffer, received straight into its body
+  vector<uint8_t> partial;
+  size_t partial_fill = 0;
+  uint32_t partial_id = 0;
+  bool in_partial = false;
+};
+
+/// State shared between the I/O thread and the workers
+struct NDEFCodecServer::Shared
+{
+  struct Job
+  {
+    shared_ptr<Connection> connection;
+    uint32_t id;
+    vector<uint8_t> body;
+  };
+
+  mutex lock;
+  condition_variable work_ready;
+  condition_variable space_ready;
+  deque<Job> jobs;
+  size_t max_jobs = 0;
+  bool closing = false;
+
+  int listen_fd = -1;
+  int wake_pipe[2] = { -1, -1 };
+
+  atomic<size_t> connections{ 0 };
+  atomic<size_t> batches{ 0 };
+  atomic<size_t> requests{ 0 };
+  atomic<size_t> bytes_in{ 0 };
+  atomic<size_t> bytes_out{ 0 };
+
+  void push(const shared_ptr<Connection>& connection, uint32_t id, vector<uint8_t>&& body)
+  {
+    this->bytes_in += frame_header_size + body.size();
+
+    unique_lock<mutex> guard{ this->lock };
+    this->space_ready.wait(guard, [this]() { return this->jobs.size() < this->max_jobs; });
+    this->jobs.push_back(Job{ connection, id, std::move(body) });
+    guard.unlock();
+    this->work_ready.notify_one();
+  }
+};
+
+NDEFCodecServer::NDEFCodecServer(const string& path, CodecServerOptions options)
+    : socket_path(path), server_options(options), shared(new Shared)
+{
+  if (this->server_options.workers == 0) {
+    this->server_options.workers = 1;
+  }
+}
+
+NDEFCodecServer::~NDEFCodecServer() { this->stop(); }
+
+void NDEFCodecServer::start()
+{
+  if (this->running) {
+    throw NDEFException("Codec server already running");
+  }
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (this->socket_path.size() >= sizeof(addr.sun_path)) {
+    throw NDEFException("Socket path too long: " + this->socket_path);
+  }
+  memcpy(addr.sun_path, this->socket_path.c_str(), this->socket_path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw NDEFException("Unable to create socket: " + string{ strerror(errno) });
+  }
+
+  // Replace a socket left behind by a previous server, but never any other kind of file
+  struct stat existing;
+  if (stat(this->socket_path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+    unlink(this->socket_path.c_str());
+  }
+
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    auto error = string{ strerror(errno) };
+    close(fd);
+    throw NDEFException("Unable to listen on " + this->socket_path + ": " + error);
+  }
+
+  if (pipe2(this->shared->wake_pipe, O_CLOEXEC) < 0) {
+    auto error = string{ strerror(errno) };
+    close(fd);
+    unlink(this->socket_path.c_str());
+    throw NDEFException("Unable to create wake pipe: " + error);
+  }
+
+  this->shared->listen_fd = fd;
+  this->shared->closing = false;
+  this->shared->max_jobs = this->server_options.workers * jobs_per_worker;
+  this->running = true;
+
+  this->io_thread = thread{ &NDEFCodecServer::run_io, this };
+  for (size_t i = 0; i < this->server_options.workers; i++) {
+    this->worker_threads.emplace_back(&NDEFCodecServer::run_worker, this);
+  }
+}
+
+void NDEFCodecServer::stop()
+{
+  if (!this->running) {
+    return;
+  }
+
+  // Wake the I/O thread, which stops reading and drops its connections
+  const uint8_t wake = 0;
+  while (write(this->shared->wake_pipe[1], &wake, 1) < 0 && errno == EINTR) {
+  }
+  this->io_thread.join();
+
+  // Workers drain the batches already queued before they exit
+  {
+    lock_guard<mutex> guard{ this->shared->lock };
+    this->shared->closing = true;
+  }
+  this->shared->work_ready.notify_all();
+  for (auto&& worker : this->worker_threads) {
+    worker.join();
+  }
+  this->worker_threads.clear();
+
+  close(this->shared->listen_fd);
+  close(this->shared->wake_pipe[0]);
+  close(this->shared->wake_pipe[1]);
+  unlink(this->socket_path.c_str());
+  this->running = false;
+}
+
+CodecServerStats NDEFCodecServer::stats() const
+{
+  CodecServerStats stats;
+  stats.connections = this->shared->connections;
+  stats.batches = this->shared->batches;
+  stats.requests = this->shared->requests;
+  stats.bytes_in = this->shared->bytes_in;
+  stats.bytes_out = this->shared->bytes_out;
+  return stats;
+}
+
+CodecResponse NDEFCodecServer::process(CodecOp op, const uint8_t* data, size_t len)
+{
+  FrameBuilder out;
+  process_item(out, op, data, len);
+
+  auto bytes = out.flatten();
+  return CodecResponse{ static_cast<CodecStatus>(bytes[0]), vector<uint8_t>{ bytes.begin() + item_header_size,
+                                                                             bytes.end() } };
+}
+
+/// Polls the listening socket and every connection, handing complete frames to the workers
+void NDEFCodecServer::run_io()
+{
+  auto&& shared = *this->shared;
+  vector<shared_ptr<Connection>> connections;
+  vector<pollfd> fds;
+
+  while (true) {
+    fds.clear();
+    fds.push_back(pollfd{ shared.wake_pipe[0], POLLIN, 0 });
+    fds.push_back(pollfd{ shared.listen_fd, POLLIN, 0 });
+    for (auto&& connection : connections) {
+      fds.push_back(pollfd{ connection->fd, POLLIN, 0 });
+    }
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (fds[0].revents != 0) {
+      break;
+    }
+
+    for (size_t i = connections.size(); i-- > 0;) {
+      if (fds[i + 2].revents != 0 && !this->receive_frames(connections[i])) {
+        connections.erase(connections.begin() + i);
+      }
+    }
+
+    if (fds[1].revents & POLLIN) {
+      int fd;
+      while ((fd = accept4(shared.listen_fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        // Bound how long a worker can be held up by a client that stops reading its responses
+        timeval timeout{ this->server_options.send_timeout, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        connections.push_back(make_shared<Connection>(fd));
+        shared.connections++;
+      }
+    }
+  }
+}
+
+bool NDEFCodecServer::receive_frames(const shared_ptr<Connection>& connection)
+{
+  auto&& conn = *connection;
+
+  while (true) {
+    uint8_t* dest;
+    size_t room;
+    if (conn.in_partial) {
+      dest = conn.partial.data() + conn.partial_fill;
+      room = conn.partial.size() - conn.partial_fill;
+    } else {
+      dest = conn.staging.data() + conn.staged;
+      room = conn.staging.size() - conn.staged;
+    }
+
+    ssize_t got = recv(conn.fd, dest, room, MSG_DONTWAIT);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (got == 0) {
+      return false;
+    }
+
+    if (conn.in_partial) {
+      conn.partial_fill += static_cast<size_t>(got);
+      if (conn.partial_fill == conn.partial.size()) {
+        conn.in_partial = false;
+        this->shared->push(connection, conn.partial_id, std::move(conn.partial));
+        conn.partial = vector<uint8_t>{};
+      }
+      continue;
+    }
+
+    conn.staged += static_cast<size_t>(got);
+
+    // Copy out every complete frame, and start receiving in place once a frame will not fit in the staging buffer
+    size_t pos = 0;
+    while (conn.staged - pos >= frame_header_size) {
+      const uint8_t* frame = conn.staging.data() + pos;
+      const size_t len = get_u32(frame);
+      const uint32_t id = get_u32(frame + 4);
+
+      if (len > this->server_options.max_frame) {
+        return false;
+      }
+
+      const size_t available = conn.staged - pos - frame_header_size;
+      if (available >= len) {
+        vector<uint8_t> body{ frame + frame_header_size, frame + frame_header_size + len };
+        this->shared->push(connection, id, std::move(body));
+        pos += frame_header_size + len;
+      } else if (frame_header_size + len > conn.staging.size()) {
+        conn.partial.resize(len);
+        memcpy(conn.partial.data(), frame + frame_header_size, available);
+        conn.partial_fill = available;
+        conn.partial_id = id;
+        conn.in_partial = true;
+        pos = conn.staged;
+        break;
+      } else {
+        break;
+      }
+    }
+
+    memmove(conn.staging.data(), conn.staging.data() + pos, conn.staged - pos);
+    conn.staged -= pos;
+  }
+}
+
+void NDEFCodecServer::run_worker()
+{
+  auto&& shared = *this->shared;
+  FrameBuilder out;
+
+  while (true) {
+    Shared::Job job;
+    {
+      unique_lock<mutex> guard{ shared.lock };
+      shared.work_ready.wait(guard, [&shared]() { return shared.closing || !shared.jobs.empty(); });
+      if (shared.jobs.empty()) {
+        return;
+      }
+
+      job = std::move(shared.jobs.front());
+      shared.jobs.pop_front();
+    }
+    shared.space_ready.notify_one();
+
+    out.clear();
+    if (!build_response(out, job.id, job.body)) {
+      // The connection can no longer be trusted to be in sync with its frames
+      shutdown(job.connection->fd, SHUT_RDWR);
+      continue;
+    }
+
+    shared.batches++;
+    shared.requests += get_u16(job.body.data());
+    shared.bytes_out += out.size();
+
+    auto iov = out.iovecs();
+    lock_guard<mutex> guard{ job.connection->write_lock };
+    try {
+      send_iovecs(job.connection->fd, iov);
+    } catch (const NDEFException&) {
+      shutdown(job.connection->fd, SHUT_RDWR);
+    }
+  }
+}
+
+NDEFCodecClient::NDEFCodecClient(const string& path)
+{
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw NDEFException("Socket path too long: " + path);
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (this->fd < 0) {
+    throw NDEFException("Unable to create socket: " + string{ strerror(errno) });
+  }
+
+  if (connect(this->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    auto error = string{ strerror(errno) };
+    close(this->fd);
+    throw NDEFException("Unable to connect to " + path + ": " + error);
+  }
+}
+
+NDEFCodecClient::~NDEFCodecClient() { close(this->fd); }
+
+void NDEFCodecClient::send(uint32_t id, const vector<CodecRequest>& batch)
+{
+  if (batch.size() > UINT16_MAX) {
+    throw NDEFException("Too many requests in one batch");
+  }
+
+  FrameBuilder frame;
+  const size_t frame_header = frame.reserve(frame_header_size);
+  frame.append_u16(static_cast<uint16_t>(batch.size()));
+
+  for (auto&& request : batch) {
+    if (request.body.size() > UINT32_MAX) {
+      throw NDEFException("Request body too large");
+    }
+
+    frame.append_u8(static_cast<uint8_t>(request.op));
+    frame.append_u32(static_cast<uint32_t>(request.body.size()));
+    frame.reference(request.body.data(), request.body.size());
+  }
+
+  if (frame.size() - frame_header_size > UINT32_MAX) {
+    throw NDEFException("Batch too large");
+  }
+  put_u32(frame.owned_at(frame_header), static_cast<uint32_t>(frame.size() - frame_header_size));
+  put_u32(frame.owned_at(frame_header + 4), id);
+
+  auto iov = frame.iovecs();
+  send_iovecs(this->fd, iov);
+}
+
+uint32_t NDEFCodecClient::receive(vector<CodecResponse>& responses)
+{
+  uint8_t header[frame_header_size];
+  receive_exactly(this->fd, header, sizeof(header));
+
+  vector<uint8_t> body(get_u32(header));
+  receive_exactly(this->fd, body.data(), body.size());
+
+  if (body.size() < 2) {
+    throw NDEFException("Truncated response");
+  }
+
+  const uint16_t count = get_u16(body.data());
+  responses.clear();
+  responses.reserve(count);
+
+  size_t pos = 2;
+  for (uint16_t i = 0; i < count; i++) {
+    if (body.size() - pos < item_header_size) {
+      throw NDEFException("Truncated response");
+    }
+
+    auto status = static_cast<CodecStatus>(body[pos]);
+    const size_t len = get_u32(body.data() + pos + 1);
+    pos += item_header_size;
+    if (body.size() - pos < len) {
+      throw NDEFException("Truncated response");
+    }
+
+    responses.push_back(CodecResponse{ status, vector<uint8_t>{ body.begin() + pos, body.begin() + pos + len } });
+    pos += len;
+  }
+
+  return get_u32(header + 4);
+}
+
+vector<CodecResponse> NDEFCodecClient::call(const vector<CodecRequest>& batch)
+{
+  const uint32_t id = this->next_id++;
+  this->send(id, batch);
+
+  vector<CodecResponse> responses;
+  if (this->receive(responses) != id) {
+    throw NDEFException("Response does not match request");
+  }
+
+  return responses;
+}
+
+CodecResponse NDEFCodecClient::call(CodecOp op, const vector<uint8_t>& body)
+{
+  return this->call(vector<CodecRequest>{ CodecRequest{ op, body } }).at(0);
+}
+
+vector<uint8_t> NDEFCodecClient::pack_records(const NDEFRecordList& records)
+{
+  vector<uint8_t> data;
+
+  for (auto&& record : records) {
+    auto type = record.type().name();
+    auto id = record.id();
+    auto payload = record.payload();
+    if (type.size() > UINT8_MAX || id.size() > UINT8_MAX) {
+      throw NDEFException("Record type or ID too long");
+    }
+
+    uint8_t header[8] = { static_cast<uint8_t>(record.type().id()), static_cast<uint8_t>(record.is_chunked() ? 1 : 0),
+                          static_cast<uint8_t>(type.size()), static_cast<uint8_t>(id.size()) };
+    put_u32(header + 4, static_cast<uint32_t>(payload.size()));
+
+    data.insert(data.end(), header, header + sizeof(header));
+    data.insert(data.end(), type.begin(), type.end());
+    data.insert(data.end(), id.begin(), id.end());
+    data.insert(data.end(), payload.begin(), payload.end());
+  }
+
+  return data;
+}
+
+NDEFRecordList NDEFCodecClient::unpack_records(const vector<uint8_t>& data)
+{
+  NDEFRecordList records;
+
+  for (auto&& flat : parse_record_list(data.data(), data.size())) {
+    if (flat.tnf > static_cast<uint8_t>(NDEFRecordType::TypeID::Unchanged)) {
+      throw NDEFException("Invalid TNF " + to_string(flat.tnf));
+    }
+
+    NDEFRecord record{ flat.payload.to_vector(),
+                       NDEFRecordType{ static_cast<NDEFRecordType::TypeID>(flat.tnf), flat.type.to_string() },
+                       flat.id.to_string() };
+    record.set_chunked(flat.chunked);
+    records.push_back(record);
+  }
+
+  return records;
+}
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ndef-lite/compression.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+using namespace std;
+
+namespace {
+/// The LZ4 block format ends with at least this many literals
+const size_t last_literals = 5;
+
+/// A match must start at least this many bytes before the end of the block
+const size_t match_start_limit = 12;
+
+const size_t min_match = 4;
+const unsigned hash_bits = 14;
+
+/// Bytes sampled by the dictionary trainer to score segments
+const size_t gram_length = 8;
+
+/// Bytes of sample copied into the dictionary per chosen segment
+const size_t segment_length = 32;
+
+const uint8_t flag_dictionary = 0x01;
+
+inline uint32_t read32(const uint8_t* ptr)
+{
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+inline uint64_t read64(const uint8_t* ptr)
+{
+  uint64_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+inline uint32_t hash4(const uint8_t* ptr) { return (read32(ptr) * 2654435761U) >> (32 - hash_bits); }
+
+/// Writes a length that did not fit in its token nibble as a run of 255s and a remainder
+void write_length(vector<uint8_t>& out, size_t length)
+{
+  for (; length >= 255; length -= 255) {
+    out.push_back(255);
+  }
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+void write_sequence(vector<uint8_t>& out, const uint8_t* literals, size_t literal_length, size_t offset,
+                    size_t match_length)
+{
+  size_t token_match = match_length >= min_match ? match_length - min_match : 0;
+  out.push_back(static_cast<uint8_t>((min<size_t>(literal_length, 15) << 4) | min<size_t>(token_match, 15)));
+
+  if (literal_length >= 15) {
+    write_length(out, literal_length - 15);
+  }
+  out.insert(out.end(), literals, literals + literal_length);
+
+  // The final sequence is literals only
+  if (match_length == 0) {
+    return;
+  }
+
+  out.push_back(static_cast<uint8_t>(offset));
+  out.push_back(static_cast<uint8_t>(offset >> 8));
+  if (token_match >= 15) {
+    write_length(out, token_match - 15);
+  }
+}
+
+/// Reads the extra bytes of a length whose token nibble was 15
+size_t read_length(const uint8_t*& in, const uint8_t* in_end)
+{
+  size_t length = 0;
+  uint8_t byte;
+  do {
+    if (in == in_end) {
+      throw NDEFException("Compressed block ends inside a length");
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+
+  return length;
+}
+
+void put_uint32(vector<uint8_t>& out, uint32_t value)
+{
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+uint32_t get_uint32(const vector<uint8_t>& in, size_t pos)
+{
+  return (static_cast<uint32_t>(in[pos]) << 24) | (static_cast<uint32_t>(in[pos + 1]) << 16) |
+         (static_cast<uint32_t>(in[pos + 2]) << 8) | static_cast<uint32_t>(in[pos + 3]);
+}
+} // namespace
+
+/// Greedy single-probe matcher over the dictionary tail followed by the data
+vector<uint8_t> lz4::compress(const uint8_t* data, size_t len, const vector<uint8_t>& dictionary)
+{
+  size_t history = min(dictionary.size(), window_size);
+
+  vector<uint8_t> buffer;
+  buffer.reserve(history + len);
+  buffer.insert(buffer.end(), dictionary.end() - history, dictionary.end());
+  buffer.insert(buffer.end(), data, data + len);
+
+  const uint8_t* base = buffer.data();
+  const size_t end = buffer.size();
+
+  vector<uint8_t> out;
+  out.reserve(len + len / 255 + 16);
+
+  size_t anchor = history;
+  if (len >= match_start_limit + 1) {
+    vector<int32_t> table(size_t{ 1 } << hash_bits, -1);
+    for (size_t pos = 0; pos + min_match <= history; pos++) {
+      table[hash4(base + pos)] = static_cast<int32_t>(pos);
+    }
+
+    const size_t match_limit = end - last_literals;
+    size_t pos = history;
+    while (pos < end - match_start_limit) {
+      uint32_t hash = hash4(base + pos);
+      int32_t candidate = table[hash];
+      table[hash] = static_cast<int32_t>(pos);
+
+      if (candidate < 0 || pos - static_cast<size_t>(candidate) > window_size ||
+          read32(base + candidate) != read32(base + pos)) {
+        pos++;
+        continue;
+      }
+
+      size_t ref = static_cast<size_t>(candidate);
+
+      // Take in any literals that also match, as long as the reference stays inside the buffer
+      while (pos > anchor && ref > 0 && base[pos - 1] == base[ref - 1]) {
+        pos--;
+        ref--;
+      }
+
+      size_t length = min_match;
+      while (pos + length < match_limit && base[ref + length] == base[pos + length]) {
+        length++;
+      }
+
+      write_sequence(out, base + anchor, pos - anchor, pos - ref, length);
+      pos += length;
+      anchor = pos;
+
+      if (pos < end - match_start_limit) {
+        table[hash4(base + pos - 2)] = static_cast<int32_t>(pos - 2);
+      }
+    }
+  }
+
+  write_sequence(out, base + anchor, end - anchor, 0, 0);
+  return out;
+}
+
+void lz4::decompress(const uint8_t* block, size_t len, uint8_t* out, size_t out_len, const vector<uint8_t>& dictionary)
+{
+  const uint8_t* in = block;
+  const uint8_t* in_end = block + len;
+  size_t produced = 0;
+
+  while (in < in_end) {
+    uint8_t token = *in++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == 15) {
+      literal_length += read_length(in, in_end);
+    }
+
+    if (literal_length > static_cast<size_t>(in_end - in) || literal_length > out_len - produced) {
+      throw NDEFException("Compressed block literals run past the end of the data");
+    }
+    if (literal_length > 0) {
+      memcpy(out + produced, in, literal_length);
+    }
+    in += literal_length;
+    produced += literal_length;
+
+    // The last sequence has no match
+    if (in == in_end) {
+      break;
+    }
+
+    if (in_end - in < 2) {
+      throw NDEFException("Compressed block ends inside a match offset");
+    }
+    size_t offset = static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+    in += 2;
+
+    size_t match_length = token & 0x0F;
+    if (match_length == 15) {
+      match_length += read_length(in, in_end);
+    }
+    match_length += min_match;
+
+    if (offset == 0 || offset > produced + dictionary.size()) {
+      throw NDEFException("Compressed block match offset " + to_string(offset) + " is out of range");
+    }
+    if (match_length > out_len - produced) {
+      throw NDEFException("Compressed block match runs past the end of the data");
+    }
+
+    // Part of the match may come from the end of the dictionary
+    if (offset > produced) {
+      size_t from_dictionary = min(offset - produced, match_length);
+      memcpy(out + produced, dictionary.data() + dictionary.size() - (offset - produced), from_dictionary);
+      produced += from_dictionary;
+      match_length -= from_dictionary;
+    }
+
+    if (match_length == 0) {
+      continue;
+    }
+
+    uint8_t* dst = out + produced;
+    const uint8_t* src = dst - offset;
+    if (offset >= match_length) {
+      memcpy(dst, src, match_length);
+    } else {
+      // Overlapping copy repeats the last offset bytes
+      for (size_t i = 0; i < match_length; i++) {
+        dst[i] = src[i];
+      }
+    }
+    produced += match_length;
+  }
+
+  if (produced != out_len) {
+    throw NDEFException("Compressed block holds " + to_string(produced) + " bytes, expected " + to_string(out_len));
+  }
+}
+
+/// Greedily picks the segments whose byte sequences appear in the most samples, discounting sequences that an earlier
+/// segment already covers
+NDEFCompressionDictionary NDEFCompressionDictionary::train(const vector<vector<uint8_t>>& samples, uint32_t id,
+                                                           size_t capacity)
+{
+  capacity = min(capacity, lz4::window_size);
+
+  // Number of samples each gram appears in
+  unordered_map<uint64_t, uint32_t> counts;
+  for (auto&& sample : samples) {
+    unordered_set<uint64_t> seen;
+    for (size_t pos = 0; pos + gram_length <= sample.size(); pos++) {
+      if (seen.insert(read64(sample.data() + pos)).second) {
+        counts[read64(sample.data() + pos)]++;
+      }
+    }
+  }
+
+  // A gram that appears in only one sample will not help compress another
+  auto score_of = [&counts](const uint8_t* gram) -> uint64_t {
+    auto found = counts.find(read64(gram));
+    return (found == counts.end() || found->second < 2) ? 0 : found->second;
+  };
+
+  vector<vector<uint8_t>> chosen;
+  size_t total = 0;
+
+  while (total < capacity) {
+    uint64_t best_score = 0;
+    const uint8_t* best = nullptr;
+    size_t best_length = 0;
+
+    for (auto&& sample : samples) {
+      size_t length = min(segment_length, sample.size());
+      if (length < gram_length) {
+        continue;
+      }
+
+      // Slide a window over the sample, keeping the sum of its gram scores
+      size_t grams = length - gram_length + 1;
+      uint64_t score = 0;
+      for (size_t i = 0; i < grams; i++) {
+        score += score_of(sample.data() + i);
+      }
+
+      for (size_t start = 0;; start++) {
+        if (score > best_score) {
+          best_score = score;
+          best = sample.data() + start;
+          best_length = length;
+        }
+
+        if (start + length >= sample.size()) {
+          break;
+        }
+        score -= score_of(sample.data() + start);
+        score += score_of(sample.data() + start + grams);
+      }
+    }
+
+    if (best == nullptr) {
+      break;
+    }
+
+    best_length = min(best_length, capacity - total);
+    chosen.emplace_back(best, best + best_length);
+    total += best_length;
+
+    for (size_t i = 0; i + gram_length <= best_length; i++) {
+      counts.erase(read64(best + i));
+    }
+  }
+
+  // Matches are cheapest when close, so the most valuable segments go last, nearest the data
+  NDEFCompressionDictionary dictionary{ id, {} };
+  dictionary.bytes.reserve(total);
+  for (auto segment = chosen.rbegin(); segment != chosen.rend(); ++segment) {
+    dictionary.bytes.insert(dictionary.bytes.end(), segment->begin(), segment->end());
+  }
+
+  return dictionary;
+}
+
+NDEFCompressionCodec::NDEFCompressionCodec(shared_ptr<const NDEFCompressionDictionary> dictionary, size_t min_payload,
+                                           size_t max_payload)
+    : dictionary(std::move(dictionary)), min_payload(min_payload), max_payload(max_payload)
+{
+}
+
+bool NDEFCompressionCodec::encode(const NDEFRecord& record, NDEFRecord& encoded) const
+{
+  auto type = record.type();
+  auto type_name = type.name();
+  if (record.is_chunked() || record.payload_source() || record.payload_length() < this->min_payload ||
+      type.id() == NDEFRecordType::TypeID::Empty || type_name.size() > 255 ||
+      (type.id() == NDEFRecordType::TypeID::External && type_name == compressed_record_type)) {
+    return false;
+  }
+
+  auto payload = record.payload();
+  static const vector<uint8_t> no_dictionary;
+  auto compressed =
+      lz4::compress(payload.data(), payload.size(), this->dictionary ? this->dictionary->bytes : no_dictionary);
+
+  vector<uint8_t> framed;
+  framed.reserve(compressed.size() + type_name.size() + 11);
+  framed.push_back(this->dictionary ? flag_dictionary : 0);
+  if (this->dictionary) {
+    put_uint32(framed, this->dictionary->id);
+  }
+  framed.push_back(static_cast<uint8_t>(type.id()));
+  framed.push_back(static_cast<uint8_t>(type_name.size()));
+  framed.insert(framed.end(), type_name.begin(), type_name.end());
+  put_uint32(framed, static_cast<uint32_t>(payload.size()));
+  framed.insert(framed.end(), compressed.begin(), compressed.end());
+
+  // Only worth it if the whole record shrinks, the TYPE field included
+  NDEFRecord candidate{ framed, NDEFRecordType{ NDEFRecordType::TypeID::External, compressed_record_type },
+                        record.id() };
+  if (candidate.as_bytes().size() >= record.as_bytes().size()) {
+    return false;
+  }
+
+  encoded = std::move(candidate);
+  return true;
+}
+
+bool NDEFCompressionCodec::decode(const NDEFRecord& record, NDEFRecord& decoded) const
+{
+  auto type = record.type();
+  if (type.id() != NDEFRecordType::TypeID::External || type.name() != compressed_record_type) {
+    return false;
+  }
+
+  auto framed = record.payload();
+  size_t pos = 0;
+  auto require = [&framed, &pos](size_t count) {
+    if (framed.size() - pos < count) {
+      throw NDEFException("Compressed record of " + to_string(framed.size()) + " bytes is truncated");
+    }
+  };
+
+  require(1);
+  uint8_t flags = framed[pos++];
+
+  const vector<uint8_t>* history = nullptr;
+  if (flags & flag_dictionary) {
+    require(4);
+    uint32_t id = get_uint32(framed, pos);
+    pos += 4;
+
+    if (!this->dictionary || this->dictionary->id != id) {
+      throw NDEFException("Compressed record needs dictionary " + to_string(id));
+    }
+    history = &this->dictionary->bytes;
+  }
+
+  require(2);
+  uint8_t tnf_byte = framed[pos++];
+  if (tnf_byte < static_cast<uint8_t>(NDEFRecordType::TypeID::WellKnown) ||
+      tnf_byte > static_cast<uint8_t>(NDEFRecordType::TypeID::Unknown)) {
+    throw NDEFException("Compressed record holds invalid TNF " + to_string(tnf_byte));
+  }
+  auto tnf = static_cast<NDEFRecordType::TypeID>(tnf_byte);
+  size_t type_length = framed[pos++];
+
+  require(type_length + 4);
+  string original_type{ framed.begin() + pos, framed.begin() + pos + type_length };
+  pos += type_length;
+
+  uint32_t original_length = get_uint32(framed, pos);
+  pos += 4;
+
+  // The length is untrusted, so check it before allocating for it
+  if (original_length > this->max_payload) {
+    throw NDEFException("Compressed record payload of " + to_string(original_length) + " bytes exceeds limit of " +
+                        to_string(this->max_payload));
+  }
+  if (original_length > (framed.size() - pos) * lz4::max_ratio) {
+    throw NDEFException("Compressed record of " + to_string(framed.size()) + " bytes cannot hold a payload of " +
+                        to_string(original_length) + " bytes");
+  }
+
+  static const vector<uint8_t> no_dictionary;
+  vector<uint8_t> payload(original_length);
+  lz4::decompress(framed.data() + pos, framed.size() - pos, payload.data(), payload.size(),
+                  history ? *history : no_dictionary);
+
+  decoded = NDEFRecord{ payload, NDEFRecordType{ tnf, original_type }, record.id() };
+  return true;
+}
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "ndef-lite/corpus-index.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/external-type.hpp"
+#include "ndef-lite/payload-store.hpp"
+
+using namespace std;
+
+namespace {
+/// Bits set per value. Near optimal for 10 bits per key, and cheap enough to test
+const size_t bloom_hashes = 7;
+
+inline char lower(char chr) { return (chr >= 'A' && chr <= 'Z') ? static_cast<char>(chr + ('a' - 'A')) : chr; }
+
+string to_lower(string value)
+{
+  transform(value.begin(), value.end(), value.begin(), lower);
+  return value;
+}
+
+/// Extracts the host of a URI with an authority: after "://", without user info or port
+/// \return false if \p uri has no authority or its host is empty
+bool uri_host(const string& uri, string& host, size_t& position)
+{
+  auto scheme_end = uri.find("://");
+  if (scheme_end == string::npos) {
+    return false;
+  }
+
+  const size_t authority_start = scheme_end + 3;
+  auto authority_end = uri.find_first_of("/?#", authority_start);
+  if (authority_end == string::npos) {
+    authority_end = uri.size();
+  }
+
+  size_t start = authority_start;
+  auto at = uri.rfind('@', authority_end - 1);
+  if (at != string::npos && at >= authority_start) {
+    start = at + 1;
+  }
+
+  size_t end = authority_end;
+  if (start < end && uri[start] == '[') {
+    // IPv6 literals contain colons, so the host runs to the closing bracket
+    auto bracket = uri.find(']', start);
+    end = (bracket != string::npos && bracket < authority_end) ? bracket + 1 : authority_end;
+  } else {
+    auto colon = uri.find(':', start);
+    end = (colon != string::npos && colon < authority_end) ? colon : authority_end;
+  }
+
+  if (start >= end) {
+    return false;
+  }
+
+  host = to_lower(uri.substr(start, end - start));
+  position = start;
+  return true;
+}
+
+/// Extracts the value \p field indexes from \p record
+/// \return false if the record does not carry the field
+bool record_key(const NDEFRecordView& record, IndexedField field, string& key, size_t& position)
+{
+  position = 0;
+
+  switch (field) {
+  case IndexedField::UriHost:
+    if (record.tnf() == NDEFRecordType::TypeID::AbsoluteURI) {
+      return uri_host(record.type().to_string(), key, position);
+    }
+    if (record.is_well_known('U') && !record.payload().empty()) {
+      auto payload = record.payload();
+      return uri_host(NDEFRecord::uri_prefix(payload.data[0]) + string{ payload.begin() + 1, payload.end() }, key,
+                      position);
+    }
+    return false;
+  case IndexedField::ExternalDomain: {
+    NDEFExternalType external;
+    if (!NDEFExternalType::parse(record, external)) {
+      return false;
+    }
+    key = to_lower(external.domain.to_string());
+    return true;
+  }
+  case IndexedField::MimeType: {
+    if (record.tnf() != NDEFRecordType::TypeID::MIMEMedia) {
+      return false;
+    }
+    // Parameters such as "; charset=utf-8" do not change the media type
+    auto type = record.type().to_string();
+    type = type.substr(0, type.find(';'));
+    type.erase(type.find_last_not_of(' ') + 1);
+    key = to_lower(type);
+    return !key.empty();
+  }
+  }
+
+  return false;
+}
+
+inline uint64_t key_hash(const string& key)
+{
+  return NDEFPayloadStore::hash(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+}
+
+/// \return prefix code \p code is listed under, reserved codes being treated as 0x00
+inline uint8_t posting_code(uint8_t code) { return NDEFRecord::uri_prefix(code).empty() ? 0 : code; }
+} // namespace
+
+/// Sets one bit per hash function, derived from the two halves of a single hash
+void NDEFCorpusIndex::BloomFilter::insert(uint64_t hash)
+{
+  const uint64_t step = (hash >> 32) | 1;
+  for (size_t i = 0; i < bloom_hashes; i++, hash += step) {
+    const uint64_t bit = hash & this->mask;
+    this->words[bit / 64] |= uint64_t{ 1 } << (bit % 64);
+  }
+}
+
+bool NDEFCorpusIndex::BloomFilter::may_contain(uint64_t hash) const
+{
+  if (this->words.empty()) {
+    return false;
+  }
+
+  const uint64_t step = (hash >> 32) | 1;
+  for (size_t i = 0; i < bloom_hashes; i++, hash += step) {
+    const uint64_t bit = hash & this->mask;
+    if (!(this->words[bit / 64] & (uint64_t{ 1 } << (bit % 64)))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+NDEFCorpusIndex::NDEFCorpusIndex(const NDEFCorpus& corpus, const CorpusIndexOptions& options)
+    : corpus(corpus), prefix_postings(256)
+{
+  if (options.block_messages == 0 || options.bits_per_key == 0) {
+    throw NDEFException("Corpus index block size and bits per key must be at least 1");
+  }
+
+  NDEFMessageView view;
+  unordered_set<string> keys[field_count];
+  string key;
+  size_t position;
+
+  for (size_t first = 0; first < corpus.message_count(); first += options.block_messages) {
+    Block block;
+    block.first_message = first;
+    block.end_message = min(first + options.block_messages, corpus.message_count());
+
+    for (size_t message = block.first_message; message < block.end_message; message++) {
+      const size_t offset = corpus.message_offset(message);
+      view.open(corpus.data() + offset, corpus.size() - offset);
+
+      for (size_t index = 0; index < view.record_count(); index++) {
+        auto record = view.record(index);
+
+        for (size_t field = 0; field < field_count; field++) {
+          if (record_key(record, static_cast<IndexedField>(field), key, position)) {
+            keys[field].insert(key);
+          }
+        }
+
+        if (record.is_well_known('U') && !record.payload().empty()) {
+          auto& postings = this->prefix_postings[posting_code(record.payload().data[0])];
+          if (postings.empty() || postings.back() != message) {
+            postings.push_back(message);
+          }
+        }
+      }
+    }
+
+    // Each filter is sized for the distinct values of its own block, rounded up to a power of two bits
+    for (size_t field = 0; field < field_count; field++) {
+      if (keys[field].empty()) {
+        continue;
+      }
+
+      uint64_t bits = 64;
+      while (bits < keys[field].size() * options.bits_per_key) {
+        bits *= 2;
+      }
+
+      auto& filter = block.filters[field];
+      filter.mask = bits - 1;
+      filter.words.assign(bits / 64, 0);
+      for (auto&& value : keys[field]) {
+        filter.insert(key_hash(value));
+      }
+      keys[field].clear();
+    }
+
+    this->blocks.push_back(std::move(block));
+  }
+}
+
+vector<size_t> NDEFCorpusIndex::candidate_blocks(IndexedField field, const string& value) const
+{
+  const uint64_t hash = key_hash(to_lower(value));
+  vector<size_t> candidates;
+
+  for (size_t block = 0; block < this->blocks.size(); block++) {
+    if (this->blocks[block].filters[static_cast<size_t>(field)].may_contain(hash)) {
+      candidates.push_back(block);
+    }
+  }
+
+  return candidates;
+}
+
+vector<SearchHit> NDEFCorpusIndex::find(IndexedField field, const string& value) const
+{
+  const string wanted = to_lower(value);
+  vector<SearchHit> hits;
+  NDEFMessageView view;
+  string key;
+  size_t position;
+
+  for (auto block : this->candidate_blocks(field, value)) {
+    // The filter may pass blocks that do not hold the value, so every record is checked exactly
+    for (size_t message = this->blocks[block].first_message; message < this->blocks[block].end_message; message++) {
+      const size_t offset = this->corpus.message_offset(message);
+      view.open(this->corpus.data() + offset, this->corpus.size() - offset);
+
+      for (size_t index = 0; index < view.record_count(); index++) {
+        if (record_key(view.record(index), field, key, position) && key == wanted) {
+          hits.push_back(SearchHit{ message, index, offset, position });
+        }
+      }
+    }
+  }
+
+  return hits;
+}
+
+const vector<size_t>& NDEFCorpusIndex::messages_with_prefix(uint8_t code) const
+{
+  return this->prefix_postings[posting_code(code)];
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "ndef-lite/corpus-search.hpp"
+#include "ndef-lite/encoding.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/simd.hpp"
+
+using namespace std;
+
+namespace {
+/// No match in the searched field
+const size_t no_match = SIZE_MAX;
+
+/// \return offset of \p pattern in \p span, or no_match
+size_t find_in(ByteSpan span, const vector<uint8_t>& pattern)
+{
+  if (pattern.size() > span.size) {
+    return no_match;
+  }
+
+  auto pos = simd::find_substring(span.data, span.size, pattern.data(), pattern.size());
+  return (pos == span.size && !pattern.empty()) ? no_match : pos;
+}
+
+/// Finds \p pattern in the URI \p prefix followed by \p body, without joining them
+/// \return offset of \p pattern in the joined URI, or no_match
+size_t find_in_uri(const string& prefix, ByteSpan body, const vector<uint8_t>& pattern)
+{
+  // Matches starting within the prefix are few enough to check one by one, whether or not they run into the body
+  for (size_t start = 0; start < prefix.size(); start++) {
+    const size_t in_prefix = min(pattern.size(), prefix.size() - start);
+    const size_t in_body = pattern.size() - in_prefix;
+
+    if (in_body <= body.size && equal(pattern.begin(), pattern.begin() + in_prefix, prefix.begin() + start) &&
+        equal(pattern.begin() + in_prefix, pattern.end(), body.data)) {
+      return start;
+    }
+  }
+
+  auto pos = find_in(body, pattern);
+  return (pos == no_match) ? no_match : prefix.size() + pos;
+}
+
+/// Finds \p pattern in the text of a Text record, decoding it only if it is stored as UTF-16
+/// \return offset of \p pattern in the UTF-8 text, or no_match
+size_t find_in_text(const NDEFRecordView& record, const vector<uint8_t>& pattern)
+{
+  ByteSpan locale;
+  ByteSpan text;
+  if (!record.text_span(locale, text)) {
+    return no_match;
+  }
+
+  if (!(record.payload().data[0] & static_cast<uint8_t>(RecordTextCodec::UTF16))) {
+    return find_in(text, pattern);
+  }
+
+  string utf8;
+  try {
+    utf8 = encoding::to_utf8(encoding::to_utf16(text.to_vector()));
+  } catch (const range_error&) {
+    // Text that is not valid UTF-16 contains nothing
+    return no_match;
+  }
+
+  return find_in(ByteSpan{ reinterpret_cast<const uint8_t*>(utf8.data()), utf8.size() }, pattern);
+}
+
+/// \return offset of \p pattern in \p field of \p record, or no_match if the record does not have the field
+size_t find_in_record(const NDEFRecordView& record, SearchField field, const vector<uint8_t>& pattern)
+{
+  switch (field) {
+  case SearchField::Payload:
+    return find_in(record.payload(), pattern);
+  case SearchField::Type:
+    return find_in(record.type(), pattern);
+  case SearchField::Id:
+    return find_in(record.id(), pattern);
+  case SearchField::Uri:
+    if (record.tnf() == NDEFRecordType::TypeID::AbsoluteURI) {
+      return find_in(record.type(), pattern);
+    }
+    if (record.is_well_known('U') && !record.payload().empty()) {
+      auto payload = record.payload();
+      return find_in_uri(NDEFRecord::uri_prefix(payload.data[0]), ByteSpan{ payload.data + 1, payload.size - 1 },
+                         pattern);
+    }
+    return no_match;
+  case SearchField::Text:
+    return find_in_text(record, pattern);
+  }
+
+  return no_match;
+}
+} // namespace
+
+NDEFCorpus::NDEFCorpus(const string& path) : source(NDEFPayloadSource::map_large_file(path))
+{
+  this->bytes = this->source->data();
+  this->length = this->source->size();
+  this->frame();
+}
+
+NDEFCorpus::NDEFCorpus(const uint8_t* data, size_t len) : bytes(data), length(len) { this->frame(); }
+
+/// Walks the message headers once, without decoding any record
+void NDEFCorpus::frame()
+{
+  size_t pos = 0;
+  while (pos < this->length) {
+    size_t message_length = 0;
+    auto status = frame_message(this->bytes + pos, this->length - pos, message_length);
+
+    if (status == FrameStatus::Malformed) {
+      throw NDEFException("Malformed message in corpus at byte " + to_string(pos));
+    }
+    if (status == FrameStatus::Incomplete) {
+      throw NDEFException("Corpus ends in the middle of a message at byte " + to_string(pos));
+    }
+
+    this->offsets.push_back(pos);
+    pos += message_length;
+  }
+}
+
+NDEFMessageView NDEFCorpus::message(size_t index) const
+{
+  const size_t offset = this->offsets.at(index);
+  return NDEFMessageView{ this->bytes + offset, this->length - offset };
+}
+
+NDEFMessage NDEFCorpus::to_message(size_t index) const
+{
+  const size_t offset = this->offsets.at(index);
+  const size_t end = (index + 1 < this->offsets.size()) ? this->offsets[index + 1] : this->length;
+  return NDEFMessage::decode<TrustedDecode>(this->bytes + offset, end - offset);
+}
+
+vector<SearchHit> NDEFCorpus::search(SearchField field, const vector<uint8_t>& pattern,
+                                     const SearchOptions& options) const
+{
+  size_t threads = options.threads != 0 ? options.threads : max(1u, thread::hardware_concurrency());
+  threads = max<size_t>(1, min(threads, this->offsets.size()));
+
+  // Cut the messages into segments of about length / threads bytes, always at a message boundary
+  vector<size_t> bounds{ 0 };
+  for (size_t i = 1; i < threads; i++) {
+    const size_t target = this->length / threads * i;
+    bounds.push_back(lower_bound(this->offsets.begin(), this->offsets.end(), target) - this->offsets.begin());
+  }
+  bounds.push_back(this->offsets.size());
+
+  vector<vector<SearchHit>> segment_hits(threads);
+  vector<exception_ptr> errors(threads);
+
+  auto search_segment = [&](size_t segment) {
+    try {
+      NDEFMessageView view;
+      for (size_t message = bounds[segment]; message < bounds[segment + 1]; message++) {
+        const size_t offset = this->offsets[message];
+        view.open(this->bytes + offset, this->length - offset);
+
+        for (size_t record = 0; record < view.record_count(); record++) {
+          auto position = find_in_record(view.record(record), field, pattern);
+          if (position != no_match) {
+            segment_hits[segment].push_back(SearchHit{ message, record, offset, position });
+          }
+        }
+      }
+    } catch (...) {
+      errors[segment] = current_exception();
+    }
+  };
+
+  // The calling thread searches the first segment itself
+  vector<thread> workers;
+  for (size_t segment = 1; segment < threads; segment++) {
+    workers.emplace_back(search_segment, segment);
+  }
+  search_segment(0);
+  for (auto&& worker : workers) {
+    worker.join();
+  }
+
+  vector<SearchHit> hits;
+  for (size_t segment = 0; segment < threads; segment++) {
+    if (errors[segment]) {
+      rethrow_exception(errors[segment]);
+    }
+    hits.insert(hits.end(), segment_hits[segment].begin(), segment_hits[segment].end());
+  }
+
+  return hits;
+}
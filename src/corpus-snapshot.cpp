@@ -0,0 +1,450 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ndef-lite/corpus-snapshot.hpp"
+#include "ndef-lite/encoding.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/payload-store.hpp"
+#include "ndef-lite/record.hpp"
+
+using namespace std;
+
+/// First bytes of every snapshot file
+struct NDEFCorpusSnapshot::Header
+{
+  char magic[8];
+  uint32_t version;
+
+  /// byte_order_mark as written by the host, reads back differently on a host of the other byte order
+  uint32_t byte_order;
+
+  /// sizeof(SnapshotRecord) of the build that wrote the file
+  uint32_t record_size;
+  uint32_t reserved;
+
+  uint64_t corpus_length;
+  uint64_t corpus_hash;
+
+  uint64_t message_count;
+  uint64_t record_count;
+  uint64_t type_count;
+  uint64_t text_length;
+
+  /// Hash of every byte after the header
+  uint64_t body_hash;
+};
+
+/// Where a message starts, one entry per message and one past the last
+struct NDEFCorpusSnapshot::Message
+{
+  uint64_t offset;
+  uint64_t first_record;
+};
+
+/// Distinct TNF and TYPE field, the name being held in the text area
+struct NDEFCorpusSnapshot::Type
+{
+  uint64_t name_offset;
+  uint8_t tnf;
+  uint8_t name_length;
+  uint8_t reserved[6];
+};
+
+namespace {
+const char snapshot_magic[8] = { 'N', 'D', 'E', 'F', 'S', 'N', 'A', 'P' };
+const uint32_t snapshot_version = 1;
+const uint32_t byte_order_mark = 0x01020304;
+
+static_assert(sizeof(SnapshotRecord) == 40, "Snapshot records are mapped straight from the file");
+
+/// Decodes the URI or text of a record into spans of the corpus. UTF-16 text is converted and appended to \p text
+void decode_value(const NDEFRecordView& record, uint64_t record_offset, SnapshotRecord& entry, vector<uint8_t>& text)
+{
+  auto payload = record.payload();
+  const uint64_t payload_offset = record_offset + record.layout().payload_offset;
+
+  if (record.tnf() == NDEFRecordType::TypeID::AbsoluteURI) {
+    entry.value = static_cast<uint8_t>(SnapshotValue::Uri);
+    entry.value_offset = record_offset + record.layout().type_offset;
+    entry.value_length = record.layout().type_length;
+    return;
+  }
+
+  if (record.is_well_known('U') && !payload.empty()) {
+    entry.value = static_cast<uint8_t>(SnapshotValue::Uri);
+    entry.uri_prefix = payload.data[0];
+    entry.value_offset = payload_offset + 1;
+    entry.value_length = static_cast<uint32_t>(payload.size - 1);
+    return;
+  }
+
+  ByteSpan locale;
+  ByteSpan text_bytes;
+  if (!record.text_span(locale, text_bytes)) {
+    return;
+  }
+
+  entry.locale_length = static_cast<uint8_t>(locale.size);
+  if (!(payload.data[0] & static_cast<uint8_t>(RecordTextCodec::UTF16))) {
+    entry.value = static_cast<uint8_t>(SnapshotValue::Text);
+    entry.value_offset = payload_offset + 1 + locale.size;
+    entry.value_length = static_cast<uint32_t>(text_bytes.size);
+    return;
+  }
+
+  string utf8;
+  try {
+    utf8 = encoding::to_utf8(encoding::to_utf16(text_bytes.to_vector()));
+  } catch (const range_error&) {
+    // Text that is not valid UTF-16 has no value
+    return;
+  }
+
+  if (utf8.size() > UINT32_MAX) {
+    return;
+  }
+
+  entry.value = static_cast<uint8_t>(SnapshotValue::Text);
+  entry.value_in_snapshot = 1;
+  entry.value_offset = text.size();
+  entry.value_length = static_cast<uint32_t>(utf8.size());
+  text.insert(text.end(), utf8.begin(), utf8.end());
+}
+
+template <typename T>
+void append_table(vector<uint8_t>& file, const vector<T>& table)
+{
+  auto bytes = reinterpret_cast<const uint8_t*>(table.data());
+  file.insert(file.end(), bytes, bytes + table.size() * sizeof(T));
+}
+
+/// \return whether \p len bytes from \p offset lie within \p size bytes
+bool in_bounds(uint64_t offset, uint64_t len, uint64_t size)
+{
+  return offset <= size && len <= size - offset;
+}
+} // namespace
+
+/// Runs the decoding pass once, building the whole file in memory so its hash can be written up front
+void NDEFCorpusSnapshot::write(const string& path, const NDEFCorpus& corpus)
+{
+  if (corpus.message_count() > UINT32_MAX) {
+    throw NDEFException("Corpus of " + to_string(corpus.message_count()) + " messages is too large to snapshot");
+  }
+
+  vector<Message> messages;
+  vector<SnapshotRecord> records;
+  vector<Type> types;
+  vector<uint8_t> text;
+  map<pair<uint8_t, string>, uint32_t> type_handles;
+
+  for (size_t i = 0; i < corpus.message_count(); i++) {
+    messages.push_back(Message{ corpus.message_offset(i), records.size() });
+
+    auto message = corpus.message(i);
+    for (size_t r = 0; r < message.record_count(); r++) {
+      auto record = message.record(r);
+      auto name = record.type();
+
+      // Types are interned, so records of the same type share a handle
+      const auto tnf = static_cast<uint8_t>(record.tnf());
+      auto handle = type_handles.emplace(make_pair(tnf, name.to_string()), static_cast<uint32_t>(types.size()));
+      if (handle.second) {
+        types.push_back(Type{ text.size(), tnf, static_cast<uint8_t>(name.size), {} });
+        text.insert(text.end(), name.begin(), name.end());
+      }
+
+      SnapshotRecord entry{};
+      entry.offset = static_cast<uint64_t>(record.data() - corpus.data());
+      entry.message = static_cast<uint32_t>(i);
+      entry.type = handle.first->second;
+      entry.payload_length = record.layout().payload_length;
+      entry.payload_offset = static_cast<uint16_t>(record.layout().payload_offset);
+      entry.header = record.data()[0];
+      entry.id_length = record.layout().id_length;
+      decode_value(record, entry.offset, entry, text);
+
+      records.push_back(entry);
+    }
+  }
+  messages.push_back(Message{ corpus.size(), records.size() });
+
+  vector<uint8_t> file(sizeof(Header));
+  append_table(file, messages);
+  append_table(file, records);
+  append_table(file, types);
+  file.insert(file.end(), text.begin(), text.end());
+
+  Header header{};
+  memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+  header.version = snapshot_version;
+  header.byte_order = byte_order_mark;
+  header.record_size = sizeof(SnapshotRecord);
+  header.corpus_length = corpus.size();
+  header.corpus_hash = NDEFPayloadStore::hash(corpus.data(), corpus.size());
+  header.message_count = corpus.message_count();
+  header.record_count = records.size();
+  header.type_count = types.size();
+  header.text_length = text.size();
+  header.body_hash = NDEFPayloadStore::hash(file.data() + sizeof(Header), file.size() - sizeof(Header));
+  memcpy(file.data(), &header, sizeof(Header));
+
+  string temporary = path + ".XXXXXX";
+  int fd = mkstemp(&temporary[0]);
+  if (fd < 0) {
+    throw NDEFException("Unable to create snapshot " + path + ": " + string{ strerror(errno) });
+  }
+
+  try {
+    NDEFPayloadSource::write_bytes(fd, file.data(), file.size());
+    if (fsync(fd) != 0) {
+      throw NDEFException("Unable to flush snapshot " + path + ": " + string{ strerror(errno) });
+    }
+  } catch (...) {
+    close(fd);
+    remove(temporary.c_str());
+    throw;
+  }
+
+  close(fd);
+  if (rename(temporary.c_str(), path.c_str()) != 0) {
+    remove(temporary.c_str());
+    throw NDEFException("Unable to move snapshot into place at " + path + ": " + string{ strerror(errno) });
+  }
+}
+
+/// Checks the header, both hashes and every table entry before handing out anything from the mapping
+NDEFCorpusSnapshot::NDEFCorpusSnapshot(const string& path, const uint8_t* data, size_t len)
+    : source(NDEFPayloadSource::map_large_file(path)), corpus(data), corpus_length(len)
+{
+  const uint8_t* bytes = this->source->data();
+  const size_t size = this->source->size();
+
+  if (size < sizeof(Header)) {
+    throw NDEFException("Snapshot " + path + " is truncated");
+  }
+
+  Header header;
+  memcpy(&header, bytes, sizeof(Header));
+
+  if (memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+    throw NDEFException("File " + path + " is not a corpus snapshot");
+  }
+
+  if (header.version != snapshot_version || header.byte_order != byte_order_mark ||
+      header.record_size != sizeof(SnapshotRecord)) {
+    throw NDEFException("Snapshot " + path + " was written by an incompatible build");
+  }
+
+  // Sections are sized one at a time against what is left of the file, so counts from a corrupt header cannot overflow
+  size_t expected = sizeof(Header);
+  auto add_section = [&expected, size](uint64_t count, size_t item_size) {
+    if (count > (size - expected) / item_size) {
+      return false;
+    }
+    expected += count * item_size;
+    return true;
+  };
+
+  if (header.message_count >= UINT32_MAX || !add_section(header.message_count + 1, sizeof(Message)) ||
+      !add_section(header.record_count, sizeof(SnapshotRecord)) || !add_section(header.type_count, sizeof(Type)) ||
+      !add_section(header.text_length, 1) || expected != size) {
+    throw NDEFException("Snapshot " + path + " is truncated or corrupt");
+  }
+
+  if (NDEFPayloadStore::hash(bytes + sizeof(Header), size - sizeof(Header)) != header.body_hash) {
+    throw NDEFException("Snapshot " + path + " is corrupt");
+  }
+
+  if (header.corpus_length != len || NDEFPayloadStore::hash(data, len) != header.corpus_hash) {
+    throw NDEFException("Snapshot " + path + " was written for a different corpus");
+  }
+
+  this->messages = header.message_count;
+  this->records = header.record_count;
+  this->types = header.type_count;
+  this->text_length = header.text_length;
+
+  // The mapping is page aligned and every table a multiple of 8 bytes long, so each table is suitably aligned
+  const uint8_t* pos = bytes + sizeof(Header);
+  this->message_table = reinterpret_cast<const Message*>(pos);
+  pos += (this->messages + 1) * sizeof(Message);
+  this->record_table = reinterpret_cast<const SnapshotRecord*>(pos);
+  pos += this->records * sizeof(SnapshotRecord);
+  this->type_table = reinterpret_cast<const Type*>(pos);
+  pos += this->types * sizeof(Type);
+  this->text = pos;
+
+  this->validate();
+}
+
+/// Rewrites the snapshot whenever opening it fails, whatever the reason
+unique_ptr<NDEFCorpusSnapshot> NDEFCorpusSnapshot::open_or_write(const string& path, const NDEFCorpus& corpus)
+{
+  try {
+    return unique_ptr<NDEFCorpusSnapshot>{ new NDEFCorpusSnapshot{ path, corpus } };
+  } catch (const NDEFException&) {
+    // Missing, stale and corrupt snapshots are all fixed by writing a fresh one
+  }
+
+  NDEFCorpusSnapshot::write(path, corpus);
+  return unique_ptr<NDEFCorpusSnapshot>{ new NDEFCorpusSnapshot{ path, corpus } };
+}
+
+size_t NDEFCorpusSnapshot::message_offset(size_t message) const
+{
+  if (message >= this->messages) {
+    throw std::out_of_range{ "Message " + to_string(message) + " outside of range of snapshot" };
+  }
+
+  return this->message_table[message].offset;
+}
+
+size_t NDEFCorpusSnapshot::first_record(size_t message) const
+{
+  // One entry past the last message marks the end of the record table
+  if (message > this->messages) {
+    throw std::out_of_range{ "Message " + to_string(message) + " outside of range of snapshot" };
+  }
+
+  return this->message_table[message].first_record;
+}
+
+/// Indexes the message from the record table, without framing it
+NDEFMessageView NDEFCorpusSnapshot::message(size_t message) const
+{
+  const size_t offset = this->message_offset(message);
+  const size_t end = this->message_table[message + 1].offset;
+
+  NDEFMessageView view;
+  view.open_indexed(this->corpus + offset, end - offset);
+  for (size_t i = this->first_record(message); i < this->end_record(message); i++) {
+    auto record = this->view(i);
+    view.add_record(this->record_table[i].offset - offset, record.layout());
+  }
+
+  return view;
+}
+
+const SnapshotRecord& NDEFCorpusSnapshot::record(size_t index) const
+{
+  if (index >= this->records) {
+    throw std::out_of_range{ "Record " + to_string(index) + " outside of range of snapshot" };
+  }
+
+  return this->record_table[index];
+}
+
+/// Rebuilds the record's layout from the stored fields, the TYPE and ID fields lying just in front of the payload
+NDEFRecordView NDEFCorpusSnapshot::view(size_t index) const
+{
+  auto& entry = this->record(index);
+
+  NDEFRecordLayout layout;
+  layout.header = NDEFRecordHeader::from_byte(entry.header);
+  layout.type_length = this->type_table[entry.type].name_length;
+  layout.id_length = entry.id_length;
+  layout.payload_offset = entry.payload_offset;
+  layout.payload_length = entry.payload_length;
+  layout.id_offset = layout.payload_offset - layout.id_length;
+  layout.type_offset = layout.id_offset - layout.type_length;
+  layout.total_length = layout.payload_offset + layout.payload_length;
+
+  return NDEFRecordView{ this->corpus + entry.offset, layout };
+}
+
+NDEFRecordType NDEFCorpusSnapshot::type(uint32_t handle) const
+{
+  auto name = this->type_name(handle);
+  return NDEFRecordType{ static_cast<NDEFRecordType::TypeID>(this->type_table[handle].tnf), name.to_string() };
+}
+
+ByteSpan NDEFCorpusSnapshot::type_name(uint32_t handle) const
+{
+  if (handle >= this->types) {
+    throw std::out_of_range{ "Type handle " + to_string(handle) + " outside of range of snapshot" };
+  }
+
+  auto& type = this->type_table[handle];
+  return ByteSpan{ this->text + type.name_offset, type.name_length };
+}
+
+ByteSpan NDEFCorpusSnapshot::value(size_t index) const
+{
+  auto& entry = this->record(index);
+  if (entry.value == static_cast<uint8_t>(SnapshotValue::None)) {
+    return ByteSpan{ nullptr, 0 };
+  }
+
+  const uint8_t* base = entry.value_in_snapshot ? this->text : this->corpus;
+  return ByteSpan{ base + entry.value_offset, entry.value_length };
+}
+
+string NDEFCorpusSnapshot::uri(size_t index) const
+{
+  auto& entry = this->record(index);
+  if (entry.value != static_cast<uint8_t>(SnapshotValue::Uri)) {
+    throw NDEFException("Record " + to_string(index) + " is not a URI record");
+  }
+
+  // Absolute URI records have no prefix code, and 0x00 abbreviates nothing
+  return NDEFRecord::uri_prefix(entry.uri_prefix) + this->value(index).to_string();
+}
+
+ByteSpan NDEFCorpusSnapshot::locale(size_t index) const
+{
+  auto& entry = this->record(index);
+  if (entry.value != static_cast<uint8_t>(SnapshotValue::Text)) {
+    return ByteSpan{ nullptr, 0 };
+  }
+
+  return ByteSpan{ this->corpus + entry.offset + entry.payload_offset + 1, entry.locale_length };
+}
+
+/// One pass over plain integers, far cheaper than framing the corpus again
+void NDEFCorpusSnapshot::validate() const
+{
+  for (size_t i = 0; i < this->types; i++) {
+    auto& type = this->type_table[i];
+    if (type.tnf > static_cast<uint8_t>(NDEFRecordType::TypeID::Invalid) ||
+        !in_bounds(type.name_offset, type.name_length, this->text_length)) {
+      throw NDEFException("Snapshot type " + to_string(i) + " is corrupt");
+    }
+  }
+
+  for (size_t i = 0; i <= this->messages; i++) {
+    auto& message = this->message_table[i];
+    const bool last = (i == this->messages);
+    if (message.offset > this->corpus_length || message.first_record > this->records ||
+        (i > 0 && (message.offset < this->message_table[i - 1].offset ||
+                   message.first_record < this->message_table[i - 1].first_record)) ||
+        (last && (message.offset != this->corpus_length || message.first_record != this->records))) {
+      throw NDEFException("Snapshot message " + to_string(i) + " is corrupt");
+    }
+  }
+
+  for (size_t i = 0; i < this->records; i++) {
+    auto& entry = this->record_table[i];
+    if (entry.message >= this->messages || i < this->message_table[entry.message].first_record ||
+        i >= this->message_table[entry.message + 1].first_record || entry.type >= this->types ||
+        entry.payload_offset < 2 + entry.id_length + this->type_table[entry.type].name_length ||
+        entry.value > static_cast<uint8_t>(SnapshotValue::Text) ||
+        (entry.value == static_cast<uint8_t>(SnapshotValue::Text) &&
+         uint64_t{ entry.locale_length } + 1 > entry.payload_length) ||
+        !in_bounds(entry.offset, entry.payload_offset + static_cast<uint64_t>(entry.payload_length),
+                   this->message_table[entry.message + 1].offset) ||
+        entry.offset < this->message_table[entry.message].offset ||
+        (entry.value != static_cast<uint8_t>(SnapshotValue::None) &&
+         !in_bounds(entry.value_offset, entry.value_length,
+                    entry.value_in_snapshot ? this->text_length : this->corpus_length))) {
+      throw NDEFException("Snapshot record " + to_string(i) + " is corrupt");
+    }
+  }
+}
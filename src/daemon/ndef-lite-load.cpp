@@ -0,0 +1,219 @@
+/*! Load generator for the codec service daemon
+ * \file ndef-lite-load.cpp
+ *
+ * Opens several connections to a running ndef-lited, keeps a number of batches in flight on each and reports the
+ * throughput and batch latency percentiles:
+ *
+ *     ndef-lite-load [--connections N] [--depth N] [--batch N] [--payload BYTES] [--seconds N]
+ *                    [--op decode|encode|validate|transcode] SOCKET_PATH
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ndef-lite/codec-service.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace {
+struct LoadOptions
+{
+  string path;
+  size_t connections = 4;
+  size_t depth = 8;
+  size_t batch = 32;
+  size_t payload = 256;
+  double seconds = 5;
+  CodecOp op = CodecOp::Decode;
+};
+
+/// Results gathered by one connection
+struct ConnectionResult
+{
+  vector<uint64_t> latencies_ns;
+  size_t requests = 0;
+  size_t failures = 0;
+  size_t bytes = 0;
+  string error;
+};
+
+[[noreturn]] void usage()
+{
+  cerr << "usage: ndef-lite-load [--connections N] [--depth N] [--batch N] [--payload BYTES] [--seconds N]\n"
+          "                      [--op decode|encode|validate|transcode] SOCKET_PATH"
+       << endl;
+  exit(2);
+}
+
+/// Request body exercising \p op on a three record message
+vector<uint8_t> sample_request(CodecOp op, size_t payload_size)
+{
+  vector<uint8_t> payload(payload_size);
+  for (size_t i = 0; i < payload.size(); i++) {
+    payload[i] = static_cast<uint8_t>('a' + (i * 7) % 26);
+  }
+
+  NDEFRecordList records{ NDEFRecord::create_uri_record("https://example.com/load"),
+                          NDEFRecord::create_text_record("load test", "en"),
+                          NDEFRecord{ payload, NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "text/plain" } } };
+
+  if (op == CodecOp::Encode) {
+    return NDEFCodecClient::pack_records(records);
+  }
+
+  auto message = NDEFMessage{ records }.as_bytes();
+  if (op == CodecOp::Transcode) {
+    message.insert(message.begin(), static_cast<uint8_t>(TranscodeMode::Canonical));
+  }
+
+  return message;
+}
+
+void run_connection(const LoadOptions& options, Clock::time_point deadline, ConnectionResult& result)
+{
+  try {
+    NDEFCodecClient client{ options.path };
+    vector<CodecRequest> batch(options.batch, CodecRequest{ options.op, sample_request(options.op, options.payload) });
+    size_t batch_bytes = 0;
+    for (auto&& request : batch) {
+      batch_bytes += request.body.size();
+    }
+
+    unordered_map<uint32_t, Clock::time_point> in_flight;
+    vector<CodecResponse> responses;
+    uint32_t next_id = 0;
+
+    while (true) {
+      while (in_flight.size() < options.depth && Clock::now() < deadline) {
+        in_flight[next_id] = Clock::now();
+        client.send(next_id++, batch);
+      }
+
+      if (in_flight.empty()) {
+        break;
+      }
+
+      const uint32_t id = client.receive(responses);
+      const auto now = Clock::now();
+      auto sent = in_flight.find(id);
+      if (sent == in_flight.end()) {
+        throw NDEFException("Response to unknown batch " + to_string(id));
+      }
+
+      result.latencies_ns.push_back(chrono::duration_cast<chrono::nanoseconds>(now - sent->second).count());
+      in_flight.erase(sent);
+
+      result.requests += responses.size();
+      result.bytes += batch_bytes;
+      for (auto&& response : responses) {
+        result.failures += (response.status != CodecStatus::Ok) ? 1 : 0;
+      }
+    }
+  } catch (const NDEFException& e) {
+    result.error = e.what();
+  }
+}
+
+double percentile_us(const vector<uint64_t>& sorted, double fraction)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  auto index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index] / 1000.0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  LoadOptions options;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if (arg == "--connections" && has_value) {
+      options.connections = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--depth" && has_value) {
+      options.depth = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--batch" && has_value) {
+      options.batch = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--payload" && has_value) {
+      options.payload = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--seconds" && has_value) {
+      options.seconds = strtod(argv[++i], nullptr);
+    } else if (arg == "--op" && has_value) {
+      string op = argv[++i];
+      if (op == "decode") {
+        options.op = CodecOp::Decode;
+      } else if (op == "encode") {
+        options.op = CodecOp::Encode;
+      } else if (op == "validate") {
+        options.op = CodecOp::Validate;
+      } else if (op == "transcode") {
+        options.op = CodecOp::Transcode;
+      } else {
+        usage();
+      }
+    } else if (arg[0] != '-' && options.path.empty()) {
+      options.path = arg;
+    } else {
+      usage();
+    }
+  }
+
+  if (options.path.empty() || options.connections == 0 || options.depth == 0 || options.batch == 0 ||
+      options.batch > UINT16_MAX) {
+    usage();
+  }
+
+  vector<ConnectionResult> results(options.connections);
+  vector<thread> threads;
+  const auto start = Clock::now();
+  const auto deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.seconds));
+
+  for (size_t i = 0; i < options.connections; i++) {
+    threads.emplace_back(run_connection, cref(options), deadline, ref(results[i]));
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+  const double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+  ConnectionResult total;
+  for (auto&& result : results) {
+    if (!result.error.empty()) {
+      cerr << "ndef-lite-load: " << result.error << endl;
+      return 1;
+    }
+
+    total.latencies_ns.insert(total.latencies_ns.end(), result.latencies_ns.begin(), result.latencies_ns.end());
+    total.requests += result.requests;
+    total.failures += result.failures;
+    total.bytes += result.bytes;
+  }
+  sort(total.latencies_ns.begin(), total.latencies_ns.end());
+
+  cout << fixed << setprecision(1);
+  cout << "batches     " << total.latencies_ns.size() << " (" << total.latencies_ns.size() / elapsed << "/s)\n";
+  cout << "requests    " << total.requests << " (" << total.requests / elapsed << "/s, " << total.failures
+       << " failed)\n";
+  cout << "throughput  " << total.bytes / elapsed / (1024 * 1024) << " MiB/s of request bodies\n";
+  cout << "latency us  p50 " << percentile_us(total.latencies_ns, 0.50) << "  p90 "
+       << percentile_us(total.latencies_ns, 0.90) << "  p99 " << percentile_us(total.latencies_ns, 0.99)
+       << "  p99.9 " << percentile_us(total.latencies_ns, 0.999) << "  max "
+       << (total.latencies_ns.empty() ? 0 : total.latencies_ns.back() / 1000.0) << endl;
+
+  return total.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+/*! Codec service daemon
+ * \file ndef-lited.cpp
+ *
+ * Serves NDEFCodecServer on a Unix domain socket until interrupted:
+ *
+ *     ndef-lited [--workers N] [--max-frame BYTES] SOCKET_PATH
+ */
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "ndef-lite/codec-service.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+using namespace std;
+
+namespace {
+[[noreturn]] void usage()
+{
+  cerr << "usage: ndef-lited [--workers N] [--max-frame BYTES] SOCKET_PATH" << endl;
+  exit(2);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  CodecServerOptions options;
+  string path;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--workers" && i + 1 < argc) {
+      options.workers = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--max-frame" && i + 1 < argc) {
+      options.max_frame = strtoul(argv[++i], nullptr, 10);
+    } else if (arg[0] != '-' && path.empty()) {
+      path = arg;
+    } else {
+      usage();
+    }
+  }
+
+  if (path.empty()) {
+    usage();
+  }
+
+  // Block the stop signals in every thread, so that only sigwait() below sees them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  NDEFCodecServer server{ path, options };
+  try {
+    server.start();
+  } catch (const NDEFException& e) {
+    cerr << "ndef-lited: " << e.what() << endl;
+    return 1;
+  }
+
+  cerr << "ndef-lited: listening on " << path << " with " << options.workers << " workers" << endl;
+
+  int signal = 0;
+  sigwait(&signals, &signal);
+  server.stop();
+
+  auto stats = server.stats();
+  cerr << "ndef-lited: " << strsignal(signal) << ", served " << stats.requests << " requests in " << stats.batches
+       << " batches over " << stats.connections << " connections" << endl;
+  return 0;
+}
@@ -2,9 +2,27 @@
 #include <locale>
 
 #include "ndef-lite/encoding.hpp"
+#include "ndef-lite/simd.hpp"
 
 using namespace std;
 
+namespace {
+/// Converts UTF-8 to UTF-16, widening leading ASCII with the vector kernels and converting the rest
+u16string widen_utf8(const uint8_t* first, const uint8_t* last)
+{
+  const size_t len = static_cast<size_t>(last - first);
+  u16string out(len, u'\0');
+  const size_t ascii = simd::widen_ascii(first, len, &out[0]);
+  out.resize(ascii);
+  if (ascii == len) {
+    return out;
+  }
+
+  wstring_convert<codecvt_utf8_utf16<char16_t>, char16_t> conv;
+  return out + conv.from_bytes(reinterpret_cast<const char*>(first + ascii), reinterpret_cast<const char*>(last));
+}
+} // namespace
+
 namespace encoding {
 
 // In theory, this union and system_endianness/all calls to it should be optimized away at compile-time.
@@ -29,17 +47,24 @@ string to_utf8(const string& src)
 /// Converts string to UTF-8 string from UTF-16 source
 string to_utf8(const u16string& src)
 {
+  // Leading ASCII is narrowed with the vector kernels, the converter only sees what follows it
+  string out(src.size(), '\0');
+  const size_t ascii = simd::narrow_ascii(src.data(), src.size(), reinterpret_cast<uint8_t*>(&out[0]));
+  if (ascii == src.size()) {
+    return out;
+  }
+
   // Conversion from UTF-16 to UTF-8 from basic_string<char16_t> string
   wstring_convert<codecvt_utf8_utf16<char16_t>, char16_t> conv;
-  return conv.to_bytes(src);
+  out.resize(ascii);
+  return out + conv.to_bytes(src.data() + ascii, src.data() + src.size());
 }
 
 /// Converts string to UTF-16 string from UTF-8/ASCII source
 u16string to_utf16(const string& src)
 {
-  // Conversion from UTF-8/ASCII to UTF-16 from basic_string<char> string
-  wstring_convert<codecvt_utf8_utf16<char16_t>, char16_t> conv;
-  return conv.from_bytes(src);
+  auto bytes = reinterpret_cast<const uint8_t*>(src.data());
+  return widen_utf8(bytes, bytes + src.size());
 }
 
 /// Converts string to UTF-16 string from UTF-16
@@ -49,6 +74,11 @@ u16string to_utf16(const u16string& src) { return src; }
 /// Converts byte vector to UTF-16 text
 u16string to_utf16(const vector<uint8_t>& src)
 {
+  // A byte order mark is not ASCII, so text starting with ASCII cannot start with one
+  if (src.empty() || (src[0] & 0x80) == 0) {
+    return widen_utf8(src.data(), src.data() + src.size());
+  }
+
   wstring_convert<codecvt_utf8_utf16<char16_t, 0x10ffff, codecvt_mode::consume_header>, char16_t> conv;
   return conv.from_bytes(string{ src.begin(), src.end() });
 }
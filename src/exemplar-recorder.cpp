@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/exemplar-recorder.hpp"
+#include "ndef-lite/payload-source.hpp"
+
+using namespace std;
+
+namespace {
+/// Whether a recorder is installed, checked before touching the shared pointer so that codec calls stay cheap when
+/// none is
+atomic<bool> recording{ false };
+shared_ptr<ExemplarRecorder> current_recorder;
+
+inline int64_t to_ns(chrono::nanoseconds duration) { return static_cast<int64_t>(duration.count()); }
+
+/// Orders the lists of kept operations as min-heaps, the fastest kept operation at the front
+bool slower(const Exemplar& lhs, const Exemplar& rhs) { return lhs.duration > rhs.duration; }
+
+const char* operation_name(CodecOperation operation)
+{
+  return operation == CodecOperation::Decode ? "decode" : "encode";
+}
+
+void append_hex(string& out, const vector<uint8_t>& bytes)
+{
+  static const char digits[] = "0123456789abcdef";
+  for (auto byte : bytes) {
+    out += digits[byte >> 4];
+    out += digits[byte & 0x0F];
+  }
+}
+} // namespace
+
+ExemplarRecorder::ExemplarRecorder(const ExemplarOptions& options) : options(options)
+{
+  if (options.slowest == 0 || options.window.count() <= 0 || options.windows_kept == 0) {
+    throw NDEFException("Exemplar recorder needs at least one operation, one window and a window length");
+  }
+
+  for (auto& admission : this->admission_ns) {
+    admission.store(0, memory_order_relaxed);
+  }
+}
+
+void ExemplarRecorder::install(shared_ptr<ExemplarRecorder> recorder)
+{
+  const bool enabled = recorder != nullptr;
+
+  // Stop new calls looking for the recorder before it goes, start them once it is in place
+  if (!enabled) {
+    recording.store(false, memory_order_release);
+  }
+  atomic_store(&current_recorder, std::move(recorder));
+  if (enabled) {
+    recording.store(true, memory_order_release);
+  }
+}
+
+shared_ptr<ExemplarRecorder> ExemplarRecorder::installed()
+{
+  if (!recording.load(memory_order_relaxed)) {
+    return nullptr;
+  }
+
+  return atomic_load(&current_recorder);
+}
+
+ExemplarRecorder::Window& ExemplarRecorder::window_for(Clock::time_point end)
+{
+  if (!this->started) {
+    this->origin = end;
+    this->started = true;
+  }
+
+  // Operations that finished just before the current window started, on another thread, are counted in it
+  const uint64_t index = (end > this->origin) ? static_cast<uint64_t>((end - this->origin) / this->options.window) : 0;
+  if (!this->windows.empty() && index <= this->windows.back().index) {
+    return this->windows.back();
+  }
+
+  this->windows.push_back(Window{ index, {} });
+  while (this->windows.size() > this->options.windows_kept) {
+    this->windows.pop_front();
+  }
+
+  for (auto& admission : this->admission_ns) {
+    admission.store(0, memory_order_relaxed);
+  }
+  const auto window_end = this->origin + this->options.window * (index + 1);
+  this->window_end_ns.store(to_ns(window_end.time_since_epoch()), memory_order_relaxed);
+
+  return this->windows.back();
+}
+
+void ExemplarRecorder::offer(CodecOperation operation, Clock::time_point start, Clock::time_point end,
+                             const uint8_t* data, size_t len, const NDEFRecordList* records)
+{
+  const auto kind = static_cast<size_t>(operation);
+  const auto duration = chrono::duration_cast<chrono::nanoseconds>(end - start);
+
+  // Most operations are faster than every one kept for the window so far, and need not wait for the lock
+  if (to_ns(end.time_since_epoch()) < this->window_end_ns.load(memory_order_relaxed) &&
+      to_ns(duration) <= this->admission_ns[kind].load(memory_order_relaxed)) {
+    return;
+  }
+
+  lock_guard<mutex> guard{ this->lock };
+  auto& window = this->window_for(end);
+  auto& slowest = window.slowest[kind];
+
+  if (slowest.size() >= this->options.slowest && duration <= slowest.front().duration) {
+    return;
+  }
+
+  Exemplar exemplar;
+  exemplar.operation = operation;
+  exemplar.window = window.index;
+  exemplar.finished = chrono::system_clock::now();
+  exemplar.duration = duration;
+  exemplar.failed = records == nullptr;
+  exemplar.input_length = len;
+  exemplar.bytes.assign(data, data + min(len, this->options.max_input_bytes));
+
+  if (records) {
+    for (auto&& record : *records) {
+      auto type = record.type();
+      exemplar.records.push_back(
+        ExemplarRecord{ type.id(), type.name().size(), record.id().size(), record.payload_length() });
+    }
+  }
+
+  if (slowest.size() >= this->options.slowest) {
+    pop_heap(slowest.begin(), slowest.end(), slower);
+    slowest.back() = std::move(exemplar);
+  } else {
+    slowest.push_back(std::move(exemplar));
+  }
+  push_heap(slowest.begin(), slowest.end(), slower);
+
+  if (slowest.size() >= this->options.slowest) {
+    this->admission_ns[kind].store(to_ns(slowest.front().duration), memory_order_relaxed);
+  }
+}
+
+vector<Exemplar> ExemplarRecorder::exemplars(CodecOperation operation) const
+{
+  vector<Exemplar> kept;
+  lock_guard<mutex> guard{ this->lock };
+
+  for (auto window = this->windows.rbegin(); window != this->windows.rend(); ++window) {
+    auto slowest = window->slowest[static_cast<size_t>(operation)];
+    sort(slowest.begin(), slowest.end(), slower);
+    kept.insert(kept.end(), make_move_iterator(slowest.begin()), make_move_iterator(slowest.end()));
+  }
+
+  return kept;
+}
+
+void ExemplarRecorder::dump(const string& path) const
+{
+  string text;
+
+  for (auto operation : { CodecOperation::Decode, CodecOperation::Encode }) {
+    for (auto&& exemplar : this->exemplars(operation)) {
+      const auto finished = chrono::duration_cast<chrono::nanoseconds>(exemplar.finished.time_since_epoch());
+
+      text += string{ "exemplar operation=" } + operation_name(operation) + " window=" + to_string(exemplar.window) +
+              " finished_unix_ns=" + to_string(finished.count()) + " duration_ns=" +
+              to_string(exemplar.duration.count()) + " failed=" + (exemplar.failed ? "1" : "0") +
+              " input_length=" + to_string(exemplar.input_length) + " records=" + to_string(exemplar.records.size()) +
+              "\n";
+
+      for (auto&& record : exemplar.records) {
+        text += "record tnf=" + to_string(static_cast<int>(record.tnf)) + " type_length=" +
+                to_string(record.type_length) + " id_length=" + to_string(record.id_length) + " payload_length=" +
+                to_string(record.payload_length) + "\n";
+      }
+
+      text += "bytes ";
+      append_hex(text, exemplar.bytes);
+      text += "\n";
+    }
+  }
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw NDEFException("Unable to create exemplar dump " + path + ": " + strerror(errno));
+  }
+
+  try {
+    NDEFPayloadSource::write_bytes(fd, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  close(fd);
+}
+
+void ExemplarRecorder::clear()
+{
+  lock_guard<mutex> guard{ this->lock };
+
+  for (auto& window : this->windows) {
+    for (auto& slowest : window.slowest) {
+      slowest.clear();
+    }
+  }
+
+  for (auto& admission : this->admission_ns) {
+    admission.store(0, memory_order_relaxed);
+  }
+}
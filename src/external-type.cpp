@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/external-type.hpp"
+
+using namespace std;
+
+namespace {
+const uint64_t fnv_offset = 0xcbf29ce484222325ULL;
+const uint64_t fnv_prime = 0x100000001b3ULL;
+
+/// Byte that ends a wildcard key. Control characters cannot appear in a TYPE field, so no exact key ends with it
+const uint8_t wildcard_marker = 0x00;
+
+inline uint8_t lower(uint8_t chr)
+{
+  return (chr >= 'A' && chr <= 'Z') ? static_cast<uint8_t>(chr + ('a' - 'A')) : chr;
+}
+
+inline uint64_t mix(uint64_t hash, uint8_t byte) { return (hash ^ byte) * fnv_prime; }
+
+uint64_t hash_domain(const uint8_t* data, size_t len)
+{
+  uint64_t hash = fnv_offset;
+  for (size_t i = 0; i < len; i++) {
+    hash = mix(hash, lower(data[i]));
+  }
+  return hash;
+}
+
+/// Continues a domain hash with the type, giving the key of an exact route
+uint64_t hash_type(uint64_t domain_hash, const uint8_t* data, size_t len)
+{
+  uint64_t hash = mix(domain_hash, ':');
+  for (size_t i = 0; i < len; i++) {
+    hash = mix(hash, data[i]);
+  }
+  return hash;
+}
+
+bool equals_ignore_case(ByteSpan lhs, const string& rhs)
+{
+  if (lhs.size != rhs.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < lhs.size; i++) {
+    if (lower(lhs.data[i]) != lower(static_cast<uint8_t>(rhs[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ByteSpan as_span(const string& value)
+{
+  return ByteSpan{ reinterpret_cast<const uint8_t*>(value.data()), value.size() };
+}
+} // namespace
+
+bool NDEFExternalType::parse(ByteSpan name, NDEFExternalType& out)
+{
+  auto colon = static_cast<const uint8_t*>(memchr(name.data, ':', name.size));
+  if (colon == nullptr || colon == name.data) {
+    return false;
+  }
+
+  size_t domain_length = static_cast<size_t>(colon - name.data);
+  out.domain = ByteSpan{ name.data, domain_length };
+  out.type = ByteSpan{ colon + 1, name.size - domain_length - 1 };
+  return true;
+}
+
+bool NDEFExternalType::parse(const NDEFRecordView& record, NDEFExternalType& out)
+{
+  return record.tnf() == NDEFRecordType::TypeID::External && parse(record.type(), out);
+}
+
+bool NDEFExternalType::domain_is(const string& domain) const { return equals_ignore_case(this->domain, domain); }
+
+bool is_android_application_record(const NDEFRecordView& record)
+{
+  NDEFExternalType name;
+  return NDEFExternalType::parse(record, name) && name.domain_is("android.com") && name.type == "pkg";
+}
+
+NDEFExternalDispatch NDEFExternalDispatch::compile(vector<Route> routes)
+{
+  NDEFExternalDispatch table;
+
+  // Keep the load factor at or below one half
+  size_t capacity = 8;
+  while (capacity < routes.size() * 2) {
+    capacity *= 2;
+  }
+  table.slots.assign(capacity, Slot{ 0, 0 });
+
+  for (auto& route : routes) {
+    transform(route.domain.begin(), route.domain.end(), route.domain.begin(),
+              [](char chr) { return static_cast<char>(lower(static_cast<uint8_t>(chr))); });
+  }
+  table.routes = std::move(routes);
+
+  for (size_t i = 0; i < table.routes.size(); i++) {
+    auto& route = table.routes[i];
+    bool wildcard = route.type == "*";
+    auto domain = as_span(route.domain);
+    auto type = as_span(route.type);
+
+    uint64_t domain_hash = hash_domain(domain.data, domain.size);
+    uint64_t hash = wildcard ? mix(domain_hash, wildcard_marker) : hash_type(domain_hash, type.data, type.size);
+
+    if (table.find(hash, domain, type, wildcard) != nullptr) {
+      throw NDEFException("Duplicate route for external type " + route.domain + ":" + route.type);
+    }
+
+    size_t slot = hash & (capacity - 1);
+    while (table.slots[slot].route != 0) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    table.slots[slot] = Slot{ hash, static_cast<uint32_t>(i + 1) };
+  }
+
+  return table;
+}
+
+const NDEFExternalDispatch::Route* NDEFExternalDispatch::find(uint64_t hash, ByteSpan domain, ByteSpan type,
+                                                              bool wildcard) const
+{
+  size_t mask = this->slots.size() - 1;
+
+  for (size_t slot = hash & mask; this->slots[slot].route != 0; slot = (slot + 1) & mask) {
+    if (this->slots[slot].hash != hash) {
+      continue;
+    }
+
+    auto& route = this->routes[this->slots[slot].route - 1];
+    bool type_matches = wildcard ? route.type == "*" : type == route.type;
+    if (type_matches && equals_ignore_case(domain, route.domain)) {
+      return &route;
+    }
+  }
+
+  return nullptr;
+}
+
+/// Tries the exact route first, then the wildcard route of the domain
+const NDEFExternalDispatch::Route* NDEFExternalDispatch::route_for(const NDEFRecordView& record,
+                                                                   NDEFExternalType& name) const
+{
+  if (this->slots.empty() || !NDEFExternalType::parse(record, name)) {
+    return nullptr;
+  }
+
+  uint64_t domain_hash = hash_domain(name.domain.data, name.domain.size);
+
+  auto route = this->find(hash_type(domain_hash, name.type.data, name.type.size), name.domain, name.type, false);
+  if (route == nullptr) {
+    route = this->find(mix(domain_hash, wildcard_marker), name.domain, name.type, true);
+  }
+
+  return route;
+}
+
+const NDEFExternalDispatch::Handler* NDEFExternalDispatch::lookup(const NDEFRecordView& record) const
+{
+  NDEFExternalType name;
+  auto route = this->route_for(record, name);
+  return route ? &route->handler : nullptr;
+}
+
+bool NDEFExternalDispatch::dispatch(const NDEFRecordView& record) const
+{
+  NDEFExternalType name;
+  auto route = this->route_for(record, name);
+  if (route == nullptr || !route->handler) {
+    return false;
+  }
+
+  route->handler(record, name);
+  return true;
+}
@@ -0,0 +1,622 @@
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define NDEF_LITE_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/ingest.hpp"
+#include "ndef-lite/queue.hpp"
+#include "ndef-lite/record-layout.hpp"
+
+using namespace std;
+
+namespace {
+/// Outcome of one read, in the style of a completion queue entry
+struct ReadCompletion
+{
+  size_t block;
+
+  /// Bytes read, or a negated errno
+  int result;
+};
+
+/// Issues block reads and reports their completions
+class BlockReader {
+public:
+  virtual ~BlockReader() = default;
+
+  /// Queues a read into \p data, which is always inside block \p block. Nothing is sent until wait()
+  virtual void submit(size_t block, int fd, uint64_t offset, uint8_t* data, size_t len) = 0;
+
+  /// Sends every queued read and waits until at least one completes
+  virtual void wait(vector<ReadCompletion>& completions) = 0;
+
+  uint64_t submissions = 0;
+};
+
+/// Runs each queued read synchronously with pread()
+class PreadReader : public BlockReader {
+public:
+  void submit(size_t block, int fd, uint64_t offset, uint8_t* data, size_t len) override
+  {
+    this->queued.push_back(Request{ block, fd, offset, data, len });
+  }
+
+  void wait(vector<ReadCompletion>& completions) override
+  {
+    for (auto&& request : this->queued) {
+      ssize_t n;
+      do {
+        n = pread(request.fd, request.data, request.len, static_cast<off_t>(request.offset));
+      } while (n < 0 && errno == EINTR);
+
+      completions.push_back(ReadCompletion{ request.block, (n < 0) ? -errno : static_cast<int>(n) });
+      this->submissions++;
+    }
+
+    this->queued.clear();
+  }
+
+private:
+  struct Request
+  {
+    size_t block;
+    int fd;
+    uint64_t offset;
+    uint8_t* data;
+    size_t len;
+  };
+
+  vector<Request> queued;
+};
+
+#ifdef NDEF_LITE_HAVE_IO_URING
+/// Talks to io_uring through the raw system calls, with every block registered as a fixed buffer when the memlock
+/// limit allows it
+class UringReader : public BlockReader {
+public:
+  /// \return reader, or nullptr if io_uring is not available to this process
+  static unique_ptr<UringReader> create(uint8_t* buffers, size_t block_size, size_t blocks)
+  {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(blocks), &params));
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    unique_ptr<UringReader> reader{ new UringReader{ fd } };
+    if (!reader->map(params)) {
+      return nullptr;
+    }
+
+    vector<iovec> iovecs(blocks);
+    for (size_t i = 0; i < blocks; i++) {
+      iovecs[i] = iovec{ buffers + i * block_size, block_size };
+    }
+
+    // Falls back to plain reads when the buffers would exceed RLIMIT_MEMLOCK
+    reader->fixed =
+        syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(blocks)) == 0;
+    return reader;
+  }
+
+  ~UringReader() override
+  {
+    // The kernel may still be writing into the blocks, so wait for every read before they are freed
+    try {
+      vector<ReadCompletion> ignored;
+      while (this->inflight > 0) {
+        this->wait(ignored);
+        ignored.clear();
+      }
+    } catch (...) {
+    }
+
+    if (this->sqes != MAP_FAILED) {
+      munmap(this->sqes, this->sqes_size);
+    }
+    if (this->cq_map != MAP_FAILED) {
+      munmap(this->cq_map, this->cq_map_size);
+    }
+    if (this->sq_map != MAP_FAILED) {
+      munmap(this->sq_map, this->sq_map_size);
+    }
+    close(this->ring_fd);
+  }
+
+  void submit(size_t block, int fd, uint64_t offset, uint8_t* data, size_t len) override
+  {
+    unsigned tail = *this->sq_tail;
+    unsigned index = tail & *this->sq_mask;
+
+    io_uring_sqe& sqe = static_cast<io_uring_sqe*>(this->sqes)[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = this->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.off = offset;
+    sqe.addr = reinterpret_cast<uint64_t>(data);
+    sqe.len = static_cast<uint32_t>(len);
+    sqe.buf_index = static_cast<uint16_t>(block);
+    sqe.user_data = block;
+
+    this->sq_array[index] = index;
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    this->queued++;
+    this->inflight++;
+  }
+
+  void wait(vector<ReadCompletion>& completions) override
+  {
+    size_t reaped = 0;
+
+    while (reaped == 0) {
+      int ret = static_cast<int>(
+          syscall(__NR_io_uring_enter, this->ring_fd, this->queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+      this->submissions++;
+
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw NDEFException("Unable to submit reads to io_uring: " + string{ strerror(errno) });
+      }
+      this->queued -= min(static_cast<unsigned>(ret), this->queued);
+
+      unsigned head = *this->cq_head;
+      unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+      for (; head != tail; head++) {
+        const io_uring_cqe& cqe = this->cqes[head & *this->cq_mask];
+        completions.push_back(ReadCompletion{ static_cast<size_t>(cqe.user_data), cqe.res });
+        reaped++;
+      }
+      __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    this->inflight -= reaped;
+  }
+
+private:
+  explicit UringReader(int fd) : ring_fd(fd) {}
+
+  /// Maps the submission queue, completion queue and submission entries
+  bool map(const io_uring_params& params)
+  {
+    this->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    this->sq_map = mmap(nullptr, this->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                        IORING_OFF_SQ_RING);
+    this->cq_map = mmap(nullptr, this->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                        IORING_OFF_CQ_RING);
+    this->sqes = mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                      IORING_OFF_SQES);
+
+    if (this->sq_map == MAP_FAILED || this->cq_map == MAP_FAILED || this->sqes == MAP_FAILED) {
+      return false;
+    }
+
+    auto sq = static_cast<uint8_t*>(this->sq_map);
+    this->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    this->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    this->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto cq = static_cast<uint8_t*>(this->cq_map);
+    this->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    this->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    this->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    this->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  int ring_fd;
+  bool fixed = false;
+
+  /// Entries written to the submission queue but not yet sent with io_uring_enter
+  unsigned queued = 0;
+
+  /// Reads sent whose completions have not been reaped
+  size_t inflight = 0;
+
+  void* sq_map = MAP_FAILED;
+  size_t sq_map_size = 0;
+  void* cq_map = MAP_FAILED;
+  size_t cq_map_size = 0;
+  void* sqes = MAP_FAILED;
+  size_t sqes_size = 0;
+
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  io_uring_cqe* cqes = nullptr;
+};
+#endif // NDEF_LITE_HAVE_IO_URING
+
+/// One read buffer. Referenced by its read while in flight, by ingest() while being framed, and by every message
+/// handed to a worker; it can only be reused once all of those are done
+struct Block
+{
+  size_t file = 0;
+  uint64_t offset = 0;
+  size_t requested = 0;
+  size_t filled = 0;
+  atomic<size_t> references{ 0 };
+};
+
+/// Progress through one capture file. Blocks may complete out of order but are framed in file order
+struct CaptureFile
+{
+  explicit CaptureFile(const string& path) : path(path) {}
+  CaptureFile(const CaptureFile&) = delete;
+  CaptureFile& operator=(const CaptureFile&) = delete;
+  ~CaptureFile()
+  {
+    if (this->fd >= 0) {
+      close(this->fd);
+    }
+  }
+
+  string path;
+  int fd = -1;
+  uint64_t size = 0;
+  uint64_t next_submit = 0;
+  uint64_t next_frame = 0;
+
+  /// Completed blocks waiting for the blocks before them, keyed by file offset
+  map<uint64_t, size_t> completed;
+
+  /// Start of a message that runs past the end of the last framed block
+  vector<uint8_t> carry;
+};
+
+/// A message handed to a worker, either inside a block or in its own copy
+struct WorkItem
+{
+  const uint8_t* data = nullptr;
+  size_t length = 0;
+  Block* block = nullptr;
+  shared_ptr<vector<uint8_t>> owned;
+};
+
+/// State shared with the workers
+struct WorkerState
+{
+  explicit WorkerState(size_t capacity) : queue(capacity) {}
+
+  MPMCQueue<WorkItem> queue;
+  atomic<bool> finished{ false };
+  atomic<bool> aborted{ false };
+  once_flag error_once;
+  exception_ptr error;
+};
+
+/// Calls the handler for queued messages until ingest() has finished and the queue is drained
+void run_worker(WorkerState& state, const NDEFCaptureIngest::MessageHandler& handler)
+{
+  NDEFMessageView view;
+  WorkItem item;
+
+  while (true) {
+    if (!state.queue.try_pop(item)) {
+      if (state.finished.load(memory_order_acquire)) {
+        return;
+      }
+      this_thread::yield();
+      continue;
+    }
+
+    // After a failure the remaining messages are only released, not handled
+    if (!state.aborted.load(memory_order_acquire)) {
+      try {
+        view.open(item.data, item.length);
+        handler(view);
+      } catch (...) {
+        call_once(state.error_once, [&state]() { state.error = current_exception(); });
+        state.aborted.store(true, memory_order_release);
+      }
+    }
+
+    if (item.block) {
+      item.block->references.fetch_sub(1, memory_order_release);
+    }
+    item = WorkItem{};
+  }
+}
+
+/// Stops and joins the workers however ingest() exits
+struct WorkerPool
+{
+  WorkerPool(WorkerState& state) : state(state) {}
+  ~WorkerPool() { this->join(); }
+
+  void join()
+  {
+    this->state.finished.store(true, memory_order_release);
+    for (auto&& thread : this->threads) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+
+  WorkerState& state;
+  vector<thread> threads;
+};
+} // namespace
+
+NDEFCaptureIngest::NDEFCaptureIngest(const IngestOptions& options) : options(options)
+{
+  if (options.block_size == 0 || options.queue_depth == 0) {
+    throw NDEFException("Ingest block size and queue depth must be at least 1");
+  }
+}
+
+/// Keeps up to queue_depth reads in flight, framing blocks of each file in order as their reads complete
+IngestStats NDEFCaptureIngest::ingest(const vector<string>& paths, const MessageHandler& handler)
+{
+  IngestStats stats{ 0, 0, 0, 0, false };
+  const size_t block_size = this->options.block_size;
+  const size_t block_count = this->options.queue_depth * 2;
+
+  // Declared before the reader, so that the reader finishes with them before they are freed
+  vector<uint8_t> storage(block_size * block_count);
+  deque<Block> blocks(block_count);
+  deque<CaptureFile> files;
+  for (auto&& path : paths) {
+    files.emplace_back(path);
+  }
+
+  unique_ptr<BlockReader> reader;
+#ifdef NDEF_LITE_HAVE_IO_URING
+  if (this->options.use_io_uring) {
+    reader = UringReader::create(storage.data(), block_size, block_count);
+    stats.used_io_uring = reader != nullptr;
+  }
+#endif
+  if (!reader) {
+    reader.reset(new PreadReader{});
+  }
+
+  WorkerState state{ block_count * 64 };
+  WorkerPool pool{ state };
+  for (size_t i = 0; i < this->options.workers; i++) {
+    pool.threads.emplace_back(run_worker, ref(state), cref(handler));
+  }
+
+  // The error is published before the abort flag, so it is safe to read once the flag is seen
+  auto check_workers = [&state]() {
+    if (state.aborted.load(memory_order_acquire)) {
+      rethrow_exception(state.error);
+    }
+  };
+
+  NDEFMessageView view;
+  auto dispatch = [&](const uint8_t* data, size_t length, Block* block, shared_ptr<vector<uint8_t>> owned) {
+    stats.messages++;
+
+    if (this->options.workers == 0) {
+      view.open(data, length);
+      handler(view);
+      return;
+    }
+
+    if (block) {
+      block->references.fetch_add(1, memory_order_relaxed);
+    }
+
+    WorkItem item{ data, length, block, std::move(owned) };
+    while (!state.queue.try_push(std::move(item))) {
+      check_workers();
+      this_thread::yield();
+    }
+  };
+
+  // Frames every whole message in the block, carrying a trailing partial message over to the next block
+  auto frame_block = [&](CaptureFile& file, size_t index) {
+    Block& block = blocks[index];
+    const uint8_t* data = storage.data() + index * block_size;
+    const size_t len = block.filled;
+    size_t pos = 0;
+    size_t message_length = 0;
+
+    if (!file.carry.empty()) {
+      // Grow the carried bytes until the message ends, doubling each time so long messages stay linear
+      const size_t carried = file.carry.size();
+      auto status = FrameStatus::Incomplete;
+      size_t taken = 0;
+
+      while (status == FrameStatus::Incomplete && taken < len) {
+        size_t chunk = min(len - taken, max<size_t>(256, file.carry.size()));
+        file.carry.insert(file.carry.end(), data + taken, data + taken + chunk);
+        taken += chunk;
+        status = frame_message(file.carry.data(), file.carry.size(), message_length);
+      }
+
+      if (status == FrameStatus::Malformed) {
+        throw NDEFException("Malformed message in " + file.path + " at byte " + to_string(block.offset - carried));
+      }
+
+      if (status == FrameStatus::Complete) {
+        file.carry.resize(message_length);
+        auto owned = make_shared<vector<uint8_t>>(std::move(file.carry));
+        file.carry = vector<uint8_t>{};
+        pos = message_length - carried;
+        const uint8_t* message = owned->data();
+        dispatch(message, message_length, nullptr, std::move(owned));
+      } else {
+        pos = len;
+      }
+    }
+
+    while (pos < len) {
+      auto status = frame_message(data + pos, len - pos, message_length);
+
+      if (status == FrameStatus::Malformed) {
+        throw NDEFException("Malformed message in " + file.path + " at byte " + to_string(block.offset + pos));
+      }
+
+      if (status == FrameStatus::Incomplete) {
+        file.carry.assign(data + pos, data + len);
+        break;
+      }
+
+      dispatch(data + pos, message_length, &block, nullptr);
+      pos += message_length;
+    }
+
+    file.next_frame += block.filled;
+    block.references.fetch_sub(1, memory_order_release);
+
+    if (file.next_frame == file.size) {
+      if (!file.carry.empty()) {
+        throw NDEFException("Capture file " + file.path + " ends in the middle of a message");
+      }
+
+      close(file.fd);
+      file.fd = -1;
+    }
+  };
+
+  auto find_free_block = [&]() -> size_t {
+    for (size_t i = 0; i < block_count; i++) {
+      if (blocks[i].references.load(memory_order_acquire) == 0) {
+        return i;
+      }
+    }
+    return block_count;
+  };
+
+  size_t submit_file = 0;
+  size_t inflight = 0;
+  vector<ReadCompletion> completions;
+
+  while (true) {
+    check_workers();
+
+    // Queue reads into every free block, moving on to the next file once the current one is fully requested
+    while (submit_file < files.size() && inflight < this->options.queue_depth) {
+      CaptureFile& file = files[submit_file];
+
+      if (file.fd < 0 && file.next_submit == 0) {
+        file.fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file.fd < 0) {
+          throw NDEFException("Unable to open " + file.path + ": " + strerror(errno));
+        }
+
+        struct stat info;
+        if (fstat(file.fd, &info) != 0) {
+          throw NDEFException("Unable to stat " + file.path + ": " + strerror(errno));
+        }
+
+        file.size = static_cast<uint64_t>(info.st_size);
+        stats.files++;
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      }
+
+      if (file.next_submit >= file.size) {
+        if (file.size == 0) {
+          close(file.fd);
+          file.fd = -1;
+        }
+        submit_file++;
+        continue;
+      }
+
+      size_t index = find_free_block();
+      if (index == block_count) {
+        break;
+      }
+
+      Block& block = blocks[index];
+      block.file = submit_file;
+      block.offset = file.next_submit;
+      block.requested = static_cast<size_t>(min<uint64_t>(block_size, file.size - file.next_submit));
+      block.filled = 0;
+      block.references.store(1, memory_order_relaxed);
+
+      reader->submit(index, file.fd, block.offset, storage.data() + index * block_size, block.requested);
+      file.next_submit += block.requested;
+      inflight++;
+    }
+
+    if (inflight == 0) {
+      if (submit_file == files.size()) {
+        break;
+      }
+
+      // Every block is held by a worker
+      this_thread::yield();
+      continue;
+    }
+
+    completions.clear();
+    reader->wait(completions);
+
+    for (auto&& completion : completions) {
+      Block& block = blocks[completion.block];
+      CaptureFile& file = files[block.file];
+      inflight--;
+
+      if (completion.result < 0) {
+        throw NDEFException("Unable to read " + file.path + ": " + strerror(-completion.result));
+      }
+
+      if (completion.result == 0) {
+        throw NDEFException("Capture file " + file.path + " shrank while being read");
+      }
+
+      block.filled += static_cast<size_t>(completion.result);
+      stats.bytes_read += static_cast<uint64_t>(completion.result);
+
+      // Short read, ask for the rest
+      if (block.filled < block.requested) {
+        reader->submit(completion.block, file.fd, block.offset + block.filled,
+                       storage.data() + completion.block * block_size + block.filled, block.requested - block.filled);
+        inflight++;
+        continue;
+      }
+
+      file.completed[block.offset] = completion.block;
+      for (auto next = file.completed.find(file.next_frame); next != file.completed.end();
+           next = file.completed.find(file.next_frame)) {
+        size_t index = next->second;
+        file.completed.erase(next);
+        frame_block(file, index);
+      }
+    }
+  }
+
+  // Wait for the workers to drain the queue before reporting
+  pool.join();
+  if (state.error) {
+    rethrow_exception(state.error);
+  }
+
+  stats.submissions = reader->submissions;
+  return stats;
+}
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/record-layout.hpp"
+
+using namespace std;
+
+namespace {
+/// Largest encoding of the fields in front of a payload: header, type length, long payload length, ID length, TYPE
+/// and ID
+const size_t max_fields_length = 1 + 1 + 4 + 1 + UINT8_MAX + UINT8_MAX;
+
+void copy_span(uint8_t* dest, ByteSpan span)
+{
+  if (!span.empty()) {
+    memcpy(dest, span.data, span.size);
+  }
+}
+
+ByteSpan span_of(const string& str)
+{
+  return ByteSpan{ reinterpret_cast<const uint8_t*>(str.data()), str.size() };
+}
+
+/// Checks the fields an edit would leave the record with against what its TNF allows
+void check_tnf_fields(NDEFRecordType::TypeID tnf, size_t type_length, size_t id_length, size_t payload_length)
+{
+  if (tnf == NDEFRecordType::TypeID::Empty && (type_length > 0 || id_length > 0 || payload_length > 0)) {
+    throw NDEFException("Empty record must not have a type, ID or payload");
+  }
+
+  if ((tnf == NDEFRecordType::TypeID::Unknown || tnf == NDEFRecordType::TypeID::Unchanged) && type_length > 0) {
+    throw NDEFException("Unknown and Unchanged records must not have a type");
+  }
+}
+} // namespace
+
+/// Copies the view's index as is, only the pointer to the first byte changes
+void NDEFMessageBuffer::assign(const NDEFMessageView& view)
+{
+  this->storage.assign(view.data(), view.data() + view.size());
+  this->message_view = view;
+  this->message_view.message_start = this->storage.data();
+}
+
+/// Rewrites the payload and its length field, leaving TYPE and ID as they were
+void NDEFMessageBuffer::replace_payload(size_t index, const uint8_t* data, size_t len)
+{
+  this->check_index(index);
+
+  auto record = this->message_view.record(index);
+  check_tnf_fields(record.tnf(), record.type().size, record.id().size, len);
+
+  ByteSpan payload{ data, len };
+  this->rewrite_record(index, record.header().tnf, record.type(), record.id(), &payload);
+}
+
+/// Rewrites the TNF and TYPE field, validating the type the same way framing does
+void NDEFMessageBuffer::replace_type(size_t index, const NDEFRecordType& type)
+{
+  this->check_index(index);
+
+  const string name = type.name();
+  if (type.id() == NDEFRecordType::TypeID::Invalid) {
+    throw NDEFException("Unable to set invalid record type");
+  }
+
+  if (name.size() > UINT8_MAX) {
+    throw NDEFException("Record type of " + to_string(name.size()) + " bytes is too long, at most 255 allowed");
+  }
+
+  for (unsigned char chr : name) {
+    if (chr <= 31 || chr == 127) {
+      throw NDEFException("Invalid character found in record type");
+    }
+  }
+
+  auto record = this->message_view.record(index);
+  check_tnf_fields(type.id(), name.size(), record.id().size, record.payload().size);
+  this->rewrite_record(index, type.id(), span_of(name), record.id(), nullptr);
+}
+
+/// Rewrites the ID field and the IL flag
+void NDEFMessageBuffer::replace_id(size_t index, const string& id)
+{
+  this->check_index(index);
+
+  if (id.size() > UINT8_MAX) {
+    throw NDEFException("Record ID of " + to_string(id.size()) + " bytes is too long, at most 255 allowed");
+  }
+
+  auto record = this->message_view.record(index);
+  check_tnf_fields(record.tnf(), record.type().size, id.size(), record.payload().size);
+  this->rewrite_record(index, record.header().tnf, record.type(), span_of(id), nullptr);
+}
+
+/// Inserts the record's own encoding, the position flags are fixed once it is in place
+void NDEFMessageBuffer::insert_record(size_t index, const NDEFRecord& record)
+{
+  auto bytes = record.as_bytes();
+
+  NDEFRecordLayout layout;
+  if (frame_record(bytes.data(), bytes.size(), layout) != FrameStatus::Complete) {
+    throw NDEFException("Unable to insert record, its encoding does not frame");
+  }
+
+  this->insert_encoded(index, bytes.data(), layout);
+}
+
+/// Inserts a copy of an already encoded record
+void NDEFMessageBuffer::insert_record(size_t index, const NDEFRecordView& record)
+{
+  // The record may live in this very buffer, whose bytes the insert is about to move
+  auto bytes = record.bytes().to_vector();
+  this->insert_encoded(index, bytes.data(), record.layout());
+}
+
+/// Cuts the record's bytes out and closes the gap
+void NDEFMessageBuffer::remove_record(size_t index)
+{
+  this->check_index(index);
+
+  auto& view = this->message_view;
+  const size_t length = view.layouts[index].total_length;
+  this->resize_range(view.offsets[index], length, 0);
+
+  view.offsets.erase(view.offsets.begin() + index);
+  view.layouts.erase(view.layouts.begin() + index);
+  this->shift_records(index, -static_cast<ptrdiff_t>(length));
+
+  // Whichever records now start or end the message take over the flags
+  if (index > 0) {
+    this->update_position_flags(index - 1);
+  }
+  if (index < view.layouts.size()) {
+    this->update_position_flags(index);
+  }
+}
+
+/// Rotates the bytes of the records between the two positions, so nothing outside them moves
+void NDEFMessageBuffer::move_record(size_t from, size_t to)
+{
+  this->check_index(from);
+  this->check_index(to);
+
+  if (from == to) {
+    return;
+  }
+
+  auto& view = this->message_view;
+  const size_t first = min(from, to);
+  const size_t last = max(from, to);
+  const size_t begin = view.offsets[first];
+  const size_t end = view.offsets[last] + view.layouts[last].total_length;
+  auto bytes = this->storage.begin();
+  auto layouts = view.layouts.begin();
+
+  if (from < to) {
+    rotate(bytes + begin, bytes + begin + view.layouts[from].total_length, bytes + end);
+    rotate(layouts + from, layouts + from + 1, layouts + to + 1);
+  } else {
+    rotate(bytes + begin, bytes + view.offsets[from], bytes + end);
+    rotate(layouts + to, layouts + from, layouts + from + 1);
+  }
+
+  size_t offset = begin;
+  for (size_t i = first; i <= last; i++) {
+    view.offsets[i] = offset;
+    offset += view.layouts[i].total_length;
+    this->update_position_flags(i);
+  }
+}
+
+/// Copies the other message's bytes and record index after the last record
+void NDEFMessageBuffer::append(const NDEFMessageBuffer& other)
+{
+  if (&other == this) {
+    // Appending moves the very bytes that are being copied
+    NDEFMessageBuffer copy;
+    copy.storage.assign(this->storage.begin(), this->storage.begin() + this->message_view.message_length);
+    copy.message_view = this->message_view;
+    this->append(copy);
+    return;
+  }
+
+  auto& view = this->message_view;
+  const auto& source = other.message_view;
+  if (source.layouts.empty()) {
+    return;
+  }
+
+  const size_t count = view.layouts.size();
+  const size_t offset = view.message_length;
+  memcpy(this->resize_range(offset, 0, source.message_length), other.storage.data(), source.message_length);
+
+  for (size_t i = 0; i < source.layouts.size(); i++) {
+    view.offsets.push_back(offset + source.offsets[i]);
+    view.layouts.push_back(source.layouts[i]);
+  }
+  this->shift_records(view.offsets.size(), static_cast<ptrdiff_t>(source.message_length));
+
+  // The old last record no longer ends the message, the other's first no longer begins it
+  if (count > 0) {
+    this->update_position_flags(count - 1);
+    this->update_position_flags(count);
+  }
+}
+
+/// Moves the tail of the message, and its slice of the record index, into a new buffer
+NDEFMessageBuffer NDEFMessageBuffer::split(size_t index)
+{
+  auto& view = this->message_view;
+  if (index > view.layouts.size()) {
+    throw std::out_of_range{ "Unable to split message. Index " + to_string(index) + " outside of range of message" };
+  }
+
+  NDEFMessageBuffer tail;
+  if (index == view.layouts.size()) {
+    return tail;
+  }
+
+  const size_t begin = view.offsets[index];
+  const size_t length = view.message_length - begin;
+  tail.storage.assign(this->storage.begin() + begin, this->storage.begin() + view.message_length);
+  tail.message_view.open_indexed(tail.storage.data(), length);
+  for (size_t i = index; i < view.layouts.size(); i++) {
+    tail.message_view.add_record(view.offsets[i] - begin, view.layouts[i]);
+  }
+  tail.update_position_flags(0);
+
+  this->resize_range(begin, length, 0);
+  view.offsets.resize(index);
+  view.layouts.resize(index);
+  this->shift_records(index, -static_cast<ptrdiff_t>(length));
+  if (index > 0) {
+    this->update_position_flags(index - 1);
+  }
+
+  return tail;
+}
+
+/// Assembles the new fields on the stack before splicing, since TYPE and ID may be copied from the old record
+void NDEFMessageBuffer::rewrite_record(size_t index, NDEFRecordType::TypeID tnf, ByteSpan type, ByteSpan id,
+                                       const ByteSpan* payload)
+{
+  auto& view = this->message_view;
+  const size_t offset = view.offsets[index];
+  NDEFRecordLayout& layout = view.layouts[index];
+
+  const size_t payload_length = (payload != nullptr) ? payload->size : layout.payload_length;
+  if (payload_length > UINT32_MAX) {
+    throw NDEFException("Payload of " + to_string(payload_length) + " bytes is too long for a record");
+  }
+
+  NDEFRecordHeader header = layout.header;
+  header.tnf = tnf;
+  header.il = !id.empty();
+  header.sr = payload_length <= UINT8_MAX;
+
+  uint8_t fields[max_fields_length];
+  size_t fields_length = 0;
+  fields[fields_length++] = header.asByte();
+  fields[fields_length++] = static_cast<uint8_t>(type.size);
+
+  // Payload length is 1 byte for short records, otherwise 4 bytes in big endian order
+  if (header.sr) {
+    fields[fields_length++] = static_cast<uint8_t>(payload_length);
+  } else {
+    fields[fields_length++] = static_cast<uint8_t>(payload_length >> 24);
+    fields[fields_length++] = static_cast<uint8_t>(payload_length >> 16);
+    fields[fields_length++] = static_cast<uint8_t>(payload_length >> 8);
+    fields[fields_length++] = static_cast<uint8_t>(payload_length >> 0);
+  }
+
+  if (header.il) {
+    fields[fields_length++] = static_cast<uint8_t>(id.size);
+  }
+
+  copy_span(fields + fields_length, type);
+  fields_length += type.size;
+  copy_span(fields + fields_length, id);
+  fields_length += id.size;
+
+  // Without a new payload only the fields in front of the old one are replaced, and the payload stays where it is
+  const size_t old_length = (payload != nullptr) ? layout.total_length : layout.payload_offset;
+  const size_t new_length = fields_length + ((payload != nullptr) ? payload->size : 0);
+
+  uint8_t* room = this->resize_range(offset, old_length, new_length);
+  memcpy(room, fields, fields_length);
+  if (payload != nullptr) {
+    copy_span(room + fields_length, *payload);
+  }
+
+  frame_record(this->storage.data() + offset, fields_length + payload_length, layout);
+  this->shift_records(index + 1, static_cast<ptrdiff_t>(new_length) - static_cast<ptrdiff_t>(old_length));
+}
+
+/// Splices the record in and hands the MB/ME flags to whichever records now start and end the message
+void NDEFMessageBuffer::insert_encoded(size_t index, const uint8_t* data, const NDEFRecordLayout& layout)
+{
+  auto& view = this->message_view;
+  if (index > view.layouts.size()) {
+    throw std::out_of_range{ "Unable to insert record. Index " + to_string(index) + " outside of range of message" };
+  }
+
+  const size_t offset = (index < view.offsets.size()) ? view.offsets[index] : view.message_length;
+  memcpy(this->resize_range(offset, 0, layout.total_length), data, layout.total_length);
+
+  view.offsets.insert(view.offsets.begin() + index, offset);
+  view.layouts.insert(view.layouts.begin() + index, layout);
+  this->shift_records(index + 1, static_cast<ptrdiff_t>(layout.total_length));
+
+  this->update_position_flags(index);
+  if (index > 0) {
+    this->update_position_flags(index - 1);
+  }
+  if (index + 1 < view.layouts.size()) {
+    this->update_position_flags(index + 1);
+  }
+}
+
+/// Grows or shrinks the storage around the range, so the bytes after it move exactly once
+uint8_t* NDEFMessageBuffer::resize_range(size_t pos, size_t old_len, size_t new_len)
+{
+  auto& bytes = this->storage;
+  const size_t tail = bytes.size() - pos - old_len;
+
+  if (new_len > old_len) {
+    bytes.resize(bytes.size() + (new_len - old_len));
+  }
+
+  if (new_len != old_len && tail > 0) {
+    memmove(bytes.data() + pos + new_len, bytes.data() + pos + old_len, tail);
+  }
+
+  if (new_len < old_len) {
+    bytes.resize(bytes.size() - (old_len - new_len));
+  }
+
+  return bytes.data() + pos;
+}
+
+/// Moves the offsets of the records behind an edit, the storage itself may also have moved
+void NDEFMessageBuffer::shift_records(size_t first, ptrdiff_t delta)
+{
+  auto& view = this->message_view;
+
+  // Offsets only ever shrink by the length of bytes in front of them, so the unsigned wrap around cancels out
+  for (size_t i = first; i < view.offsets.size(); i++) {
+    view.offsets[i] += static_cast<size_t>(delta);
+  }
+
+  view.message_length += static_cast<size_t>(delta);
+  view.message_start = this->storage.data();
+}
+
+/// Writes MB/ME into both the record's header byte and its layout
+void NDEFMessageBuffer::update_position_flags(size_t index)
+{
+  auto& view = this->message_view;
+  auto& header = view.layouts[index].header;
+
+  header.mb = (index == 0);
+  header.me = (index + 1 == view.layouts.size());
+  this->storage[view.offsets[index]] = header.asByte();
+}
+
+void NDEFMessageBuffer::check_index(size_t index) const
+{
+  if (index >= this->message_view.layouts.size()) {
+    throw std::out_of_range{ "Unable to edit record. Index " + to_string(index) + " outside of range of message" };
+  }
+}
@@ -1,9 +1,31 @@
+#include <algorithm>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/exemplar-recorder.hpp"
 #include "ndef-lite/message.hpp"
 #include "ndef-lite/record-header.hpp"
 #include "ndef-lite/record-type.hpp"
 
 using namespace std;
 
+namespace {
+/// Payloads already in memory up to this size are gathered with the headers rather than written on their own
+const size_t coalesce_limit = 64 * 1024;
+
+/// Overrides the MB/ME flags of an encoded record, since records serialize as if they were the only one in a message
+void set_position_flags(vector<uint8_t>& record_bytes, size_t index, size_t num_records)
+{
+  const uint8_t mb = static_cast<uint8_t>(RecordFlag::MB);
+  const uint8_t me = static_cast<uint8_t>(RecordFlag::ME);
+
+  record_bytes.at(0) &= ~mb & ~me;
+  // First record, set Message Begin flag
+  record_bytes.at(0) |= (index == 0) ? mb : 0;
+  // Last record, set Message End flag
+  record_bytes.at(0) |= (index == (num_records - 1)) ? me : 0;
+}
+} // namespace
+
 /// Creates NDEF Message object with single initial record
 NDEFMessage::NDEFMessage(const vector<uint8_t>& data, const NDEFRecordType& type, uint offset)
 {
@@ -68,7 +90,27 @@ bool NDEFMessage::is_valid() const
   return true;
 }
 
+/// Encodes the message, timing it for the exemplar recorder when one is installed
 std::vector<uint8_t> NDEFMessage::as_bytes() const
+{
+  auto recorder = ExemplarRecorder::installed();
+  if (!recorder) {
+    return this->encode();
+  }
+
+  const auto began = ExemplarRecorder::Clock::now();
+  try {
+    auto bytes = this->encode();
+    recorder->offer(CodecOperation::Encode, began, ExemplarRecorder::Clock::now(), bytes.data(), bytes.size(),
+                    &this->message_records);
+    return bytes;
+  } catch (...) {
+    recorder->offer(CodecOperation::Encode, began, ExemplarRecorder::Clock::now(), nullptr, 0, nullptr);
+    throw;
+  }
+}
+
+vector<uint8_t> NDEFMessage::encode() const
 {
   vector<uint8_t> byte_sequence;
 
@@ -78,42 +120,115 @@ std::vector<uint8_t> NDEFMessage::as_bytes() const
   }
 
   // Generate header for each record
-  uint8_t header = 0x00;
   size_t num_records = this->message_records.size();
+  NDEFRecord scratch;
   for (size_t i = 0; i < num_records; i++) {
-    // Immutable reference to current record to allow us to retrieve data without changing anything
-    auto&& record = this->message_records.at(i);
-
-    // Retrieve individual record's header, then set ME/MB bit flags appropriately
-    header = record.header();
-    // First record, set Message Begin flag
-    header |= (i == 0) ? static_cast<uint8_t>(RecordFlag::MB) : 0;
-    // Last record, set Message End flag
-    header |= (i == (num_records - 1)) ? static_cast<uint8_t>(RecordFlag::ME) : 0;
-
     // Create byte sequence, setting MB/ME header flags for record, then add the bytes to the ouput bytes
-    auto record_bytes = record.as_bytes(header);
+    auto record_bytes = this->encoded_record(i, scratch).as_bytes();
+    set_position_flags(record_bytes, i, num_records);
     byte_sequence.insert(byte_sequence.end(), record_bytes.begin(), record_bytes.end());
   }
 
   return byte_sequence;
 }
 
+/// Gathers headers and in-memory payloads into as few writes as possible, handing external payloads to their source
+void NDEFMessage::write_to(int fd) const
+{
+  if (!this->is_valid()) {
+    throw NDEFException("Unable to write invalid message");
+  }
+
+  vector<uint8_t> pending;
+  size_t num_records = this->message_records.size();
+  NDEFRecord scratch;
+  for (size_t i = 0; i < num_records; i++) {
+    auto&& record = this->encoded_record(i, scratch);
+    auto&& source = record.payload_source();
+
+    if (!source || (source->data() != nullptr && source->size() <= coalesce_limit)) {
+      auto record_bytes = record.as_bytes();
+      set_position_flags(record_bytes, i, num_records);
+      pending.insert(pending.end(), record_bytes.begin(), record_bytes.end());
+      continue;
+    }
+
+    auto header_bytes = record.header_bytes();
+    set_position_flags(header_bytes, i, num_records);
+    pending.insert(pending.end(), header_bytes.begin(), header_bytes.end());
+
+    NDEFPayloadSource::write_bytes(fd, pending.data(), pending.size());
+    pending.clear();
+    source->write_to(fd);
+  }
+
+  NDEFPayloadSource::write_bytes(fd, pending.data(), pending.size());
+}
+
+/// Runs the record through the codec, falling back to the record itself when the codec leaves it alone
+const NDEFRecord& NDEFMessage::encoded_record(size_t index, NDEFRecord& scratch) const
+{
+  auto&& record = this->message_records.at(index);
+
+  if (this->record_codec && this->record_codec->encode(record, scratch)) {
+    return scratch;
+  }
+
+  return record;
+}
+
+NDEFMessage NDEFMessage::from_bytes(const std::vector<uint8_t>& data, shared_ptr<const NDEFRecordCodec> codec,
+                                    uint offset)
+{
+  auto msg = NDEFMessage::from_bytes(data, offset);
+
+  if (codec) {
+    NDEFRecord decoded;
+    for (auto&& record : msg.message_records) {
+      if (codec->decode(record, decoded)) {
+        record = std::move(decoded);
+      }
+    }
+  }
+
+  msg.set_codec(std::move(codec));
+  return msg;
+}
+
 NDEFMessage NDEFMessage::from_bytes(const std::vector<uint8_t>& data, uint offset)
 {
-  NDEFMessage msg;
+  const size_t start = min<size_t>(offset, data.size());
+  const uint8_t* bytes = data.data() + start;
+  const size_t len = data.size() - start;
+
+  auto recorder = ExemplarRecorder::installed();
+  if (!recorder) {
+    return NDEFMessage::decode<CheckedDecode>(bytes, len);
+  }
+
+  // Failed decodes are offered too, malformed tags being as likely to be slow as any
+  const auto began = ExemplarRecorder::Clock::now();
+  try {
+    auto msg = NDEFMessage::decode<CheckedDecode>(bytes, len);
+    recorder->offer(CodecOperation::Decode, began, ExemplarRecorder::Clock::now(), bytes, len, &msg.message_records);
+    return msg;
+  } catch (...) {
+    recorder->offer(CodecOperation::Decode, began, ExemplarRecorder::Clock::now(), bytes, len, nullptr);
+    throw;
+  }
+}
 
-  // NOTE: Potentially should be using a deque due to removal from front of vector
-  // Get all bytes after offset position from input
-  auto buffer = vector<uint8_t>{ data.begin() + offset, data.end() };
+/// Decodes each record in place, moving along the buffer rather than erasing from the front of a copy
+template <typename Policy>
+NDEFMessage NDEFMessage::decode(const uint8_t* data, size_t len)
+{
+  NDEFMessage msg;
 
-  // Read in all bytes into records
-  while (!buffer.empty()) {
+  size_t pos = 0;
+  while (pos < len) {
     // Number of bytes used by record during creation
     size_t bytes_used = 0;
-
-    // Create record from current byte array (offset already handled)
-    auto record = NDEFRecord::from_bytes(buffer, 0, bytes_used);
+    auto record = NDEFRecord::decode<Policy>(data + pos, len - pos, bytes_used);
 
     // If the record was invalid, then quit now, ignoring all current/remaining bytes
     if (record.type().id() == NDEFRecordType::TypeID::Invalid) {
@@ -121,11 +236,12 @@ NDEFMessage NDEFMessage::from_bytes(const std::vector<uint8_t>& data, uint offse
     }
 
     // Record is valid, add it to the message
-    msg.append_record(record);
-
-    // Remove bytes read by record creation
-    buffer.erase(buffer.begin(), buffer.begin() + bytes_used);
+    msg.message_records.push_back(std::move(record));
+    pos += bytes_used;
   }
 
   return msg;
-}
\ No newline at end of file
+}
+
+template NDEFMessage NDEFMessage::decode<CheckedDecode>(const uint8_t* data, size_t len);
+template NDEFMessage NDEFMessage::decode<TrustedDecode>(const uint8_t* data, size_t len);
\ No newline at end of file
@@ -58,9 +58,9 @@
  * \bug No known bugs
  */
 
+#include <algorithm>
 #include <cassert>
 #include <codecvt>
-#include <deque>
 #include <iostream>
 #include <locale>
 #include <string>
@@ -71,6 +71,10 @@
 #include "ndef-lite/record.hpp"
 #include "ndef-lite/util.hpp"
 
+#ifndef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record.ipp"
+#endif
+
 #define BOM_BE_1ST static_cast<char>('\xef')
 #define BOM_LE_2ND static_cast<char>('\xff')
 
@@ -78,11 +82,11 @@ using namespace std;
 using namespace util;
 
 /// Default constructor creates empty NDEF record
-NDEFRecord::NDEFRecord()
+NDEFRecord::NDEFRecord() : chunked(false)
 {
   this->record_type = NDEFRecordType{};
   this->id_field = "";
-  this->payload_data = vector<uint8_t>{};
+  this->set_payload(vector<uint8_t>{});
 }
 
 NDEFRecord::NDEFRecord(const vector<uint8_t>& payload, const NDEFRecordType& type, const string& id, size_t offset,
@@ -100,146 +104,152 @@ NDEFRecord::NDEFRecord(const vector<uint8_t>& payload, const NDEFRecordType& typ
   this->set_payload(vector<uint8_t>{ payload.begin() + offset, payload.end() });
 }
 
-/// Creates header byte from information known to NDEF Record. Other values will be set by NDEFMessage
-uint8_t NDEFRecord::header() const
+NDEFRecord::NDEFRecord(shared_ptr<const NDEFPayloadSource> payload, const NDEFRecordType& type, const string& id)
+    : record_type(type), id_field(id), chunked(false)
 {
-  uint8_t flags = 0x00;
-
-  // Set Type Name Format field
-  flags |= static_cast<uint8_t>(this->record_type.id());
-
-  // If record < 256 bytes then this is a short record
-  flags |= this->is_short() ? static_cast<uint8_t>(RecordFlag::SR) : 0;
+  this->set_payload_source(std::move(payload));
+}
 
-  // If ID field has any value, set ID_LENGTH field
-  flags |= (this->id_field.size() > 0) ? static_cast<uint8_t>(RecordFlag::IL) : 0;
+NDEFRecord::NDEFRecord(NDEFRecord&& other) noexcept : chunked(false) { *this = std::move(other); }
 
-  // Check if record is chunked
-  flags |= this->is_chunked() ? static_cast<uint8_t>(RecordFlag::CF) : 0;
+/// The cached payload size and bytes move with the handle, so the moved-from record gets an empty payload of its own
+NDEFRecord& NDEFRecord::operator=(NDEFRecord&& other) noexcept
+{
+  if (this == &other) {
+    return *this;
+  }
 
-  return flags;
+  this->record_type = std::move(other.record_type);
+  this->id_field = std::move(other.id_field);
+  this->payload_ref = std::move(other.payload_ref);
+  this->owns_payload = other.owns_payload;
+  this->payload_size = other.payload_size;
+  this->payload_bytes = other.payload_bytes;
+  this->chunked = other.chunked;
+
+  other.record_type = NDEFRecordType{};
+  other.id_field.clear();
+  other.assign_payload(NDEFPayloadSource::from_bytes(vector<uint8_t>{}), true);
+  other.chunked = false;
+  return *this;
 }
 
-/// Wrapper around from_byte(vector<uint8_t>) that converts the array to a vector
+/// Decodes straight out of the array, without copying it into a vector first
 NDEFRecord NDEFRecord::from_bytes(uint8_t bytes[], size_t size, size_t offset)
 {
-  // Create vector from byte array
-  vector<uint8_t> bytesVec(bytes, bytes + size);
+  size_t bytes_used = 0;
+  offset = min(offset, size);
 
-  return from_bytes(bytesVec, offset);
+  return NDEFRecord::decode<CheckedDecode>(bytes + offset, size - offset, bytes_used);
 }
 
 /// Allows us to convert from the raw bytes from the NFC tag into a NDEFRecord struct
-NDEFRecord NDEFRecord::from_bytes(vector<uint8_t> bytes, size_t offset, size_t& bytes_used)
+NDEFRecord NDEFRecord::from_bytes(const vector<uint8_t>& bytes, size_t offset, size_t& bytes_used)
+{
+  offset = min(offset, bytes.size());
+
+  return NDEFRecord::decode<CheckedDecode>(bytes.data() + offset, bytes.size() - offset, bytes_used);
+}
+
+/// Walks the fields once, in place. Every check goes through the policy, so the trusted instantiation has none
+template <typename Policy>
+NDEFRecord NDEFRecord::decode(const uint8_t* data, size_t len, size_t& bytes_used)
 {
-  // Keep track of number of bytes used
   bytes_used = 0;
 
-  if (bytes.size() < 4) {
+  if (Policy::checked && len < 4) {
     // There are at least 4 required octets (field)
     throw NDEFException("Invalid number of octets, must have at least 4");
   }
 
-  // Generate type field from first byte
-  auto record_type = NDEFRecordType::from_bytes(bytes, offset);
+  const auto header = NDEFRecordHeader::from_byte(data[0]);
+  const uint8_t type_length = data[1];
+  size_t pos = 2;
 
-  // If the bytes were invalid then return early without further parsing (indicates lack of bytes)
-  if (record_type.id() == NDEFRecordType::TypeID::Invalid) {
-    // No payload and not chunked, invalid payload
-    return NDEFRecord{ vector<uint8_t>{}, record_type };
+  if (Policy::checked && len < type_length) {
+    // Too few bytes to even hold the type, these are not a record. NDEFMessage stops decoding here
+    return NDEFRecord{ vector<uint8_t>{}, NDEFRecordType::invalid_record_type() };
   }
 
-  // Create deque to allow pop_front
-  deque<uint8_t> vals(make_move_iterator(bytes.begin()), make_move_iterator(bytes.end()));
-
-  // Pop off front byte (header already created)
-  auto header = NDEFRecordHeader::from_byte(pop_front(vals));
-  uint8_t type_length = pop_front(vals);
-
-  // Header/type length bytes
-  bytes_used += 2;
-
   uint32_t payload_length;
   if (header.sr) {
     // Payload is a short record, payload is at most 255 bytes long and length is contained in 1 byte
-    payload_length = pop_front(vals);
-
-    // One byte used for short record length
-    bytes_used += 1;
+    payload_length = data[pos++];
   } else {
-    assertHasValues(vals, 4, "payload length");
-
-    // Create uint32 from next four bytes
-    uint8_t payloadLenBytes[4]{ pop_front(vals), pop_front(vals), pop_front(vals), pop_front(vals) };
-    payload_length = uint32FromBEBytes(payloadLenBytes);
-
-    // Four bytes used for record length
-    bytes_used += 4;
+    // Payload length is four bytes in big endian order
+    Policy::require(len - pos, 4, "payload length");
+    payload_length = static_cast<uint32_t>(data[pos]) << 24 | static_cast<uint32_t>(data[pos + 1]) << 16 |
+                     static_cast<uint32_t>(data[pos + 2]) << 8 | static_cast<uint32_t>(data[pos + 3]);
+    pos += 4;
   }
 
   uint8_t id_length = 0;
   if (header.il) {
-    assertHasValue(vals, "ID length");
-    id_length = pop_front(vals);
-
-    // One byte used for ID field
-    bytes_used += 1;
+    Policy::require(len - pos, 1, "ID length");
+    id_length = data[pos++];
   }
 
-  // Confirm there are enough bytes to complete type field then populate type characters from bytes
-  assertHasValues(vals, type_length, "type length");
-  vector<uint8_t> type_bytes = drain_deque(vals, type_length);
-
-  // Create the type field from the bytes, converting them into ASCII characters after validating them
-  string type_field;
-  for (auto&& chr : type_bytes) {
-    if (chr <= 31 || chr == 127) {
-      // Invalid character, no ASCII characters [0-31] or 127
-      throw NDEFException("Invalid character code " + to_string(chr) + " found in type field");
-    }
-
-    // Append valid character to type string
-    type_field += chr;
+  // Type characters must be printable ASCII, no ASCII characters [0-31] or 127
+  Policy::require(len - pos, type_length, "type length");
+  for (size_t i = 0; i < type_length; i++) {
+    Policy::type_character(data[pos + i]);
   }
+  string type_field{ data + pos, data + pos + type_length };
+  pos += type_length;
 
-  // type_field length # of bytes used to create type field string
-  bytes_used += type_field.length();
-
-  string id_field;
-
-  // Only attempt to extract ID field if the length is > 0
-  if (id_length > 0) {
-    // Check if there are enough bytes to pull out id field
-    assertHasValues(vals, id_length, "ID");
+  Policy::require(len - pos, id_length, "ID");
+  string id_field{ data + pos, data + pos + id_length };
+  pos += id_length;
 
-    // Checked that the bytes we require are available, now collect them
-    auto id_bytes = drain_deque(vals, id_length);
+  Policy::require(len - pos, payload_length, "payload");
 
-    // Create string from UTF-8 bytes
-    for (auto&& chr : id_bytes) {
-      id_field += chr;
-    }
+  // According to NDEF standard any unknown/unsupported TNF field values should be treated as 0x05 Unknown
+  auto tnf = header.tnf;
+  if (tnf == NDEFRecordType::TypeID::Invalid) {
+    tnf = NDEFRecordType::TypeID::Unknown;
   }
 
-  // id_field length # of bytes used to create ID field string
-  bytes_used += id_field.length();
-
-  // Collect remaining data as payload after validating length
-  assertHasValues(vals, payload_length, "payload");
-  auto payload = drain_deque(vals, payload_length);
+  // Fields are moved into place, so the payload is copied exactly once
+  NDEFRecord record;
+  record.record_type = NDEFRecordType{ tnf, type_field };
+  record.id_field = std::move(id_field);
+  record.chunked = header.cf;
+  record.assign_payload(NDEFPayloadSource::from_bytes(vector<uint8_t>{ data + pos, data + pos + payload_length }),
+                        true);
+  record.validate();
 
-  // payload # of bytes used as the payload
-  bytes_used += payload.size();
+  bytes_used = pos + payload_length;
 
   // Successfully built Record object from uint8_t array
-  return NDEFRecord{ payload, record_type, id_field, header.cf };
+  return record;
 }
 
+template NDEFRecord NDEFRecord::decode<CheckedDecode>(const uint8_t* data, size_t len, size_t& bytes_used);
+template NDEFRecord NDEFRecord::decode<TrustedDecode>(const uint8_t* data, size_t len, size_t& bytes_used);
+
 /// Creates the bytes representation of the Record object passed
 vector<uint8_t> NDEFRecord::as_bytes(uint8_t flags) const
+{
+  vector<uint8_t> bytes = this->header_bytes(flags);
+
+  // Add payload bytes, straight from memory when the handle allows
+  if (this->payload_bytes) {
+    bytes.insert(bytes.end(), this->payload_bytes, this->payload_bytes + this->payload_size);
+  } else {
+    auto payload = this->payload_ref->read();
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+  }
+
+  // Return span pointing to location of vector in memory with number of bytes in vector
+  return bytes;
+}
+
+/// Creates the bytes of every field up to, but not including, the payload
+vector<uint8_t> NDEFRecord::header_bytes(uint8_t flags) const
 {
   // Vector to create record byte array from
   vector<uint8_t> bytes;
+  const size_t payload_size = this->payload_length();
 
   NDEFRecordHeader header{ .tnf = this->record_type.id(),
                            .il = (this->id().length() > 0),
@@ -257,14 +267,14 @@ vector<uint8_t> NDEFRecord::as_bytes(uint8_t flags) const
 
   // Add payload length, dependant on the Short Record flag
   if (this->is_short()) {
-    assert(payload_data.size() < 256);
-    bytes.push_back(static_cast<uint8_t>(payload_data.size()));
+    assert(payload_size < 256);
+    bytes.push_back(static_cast<uint8_t>(payload_size));
   } else {
     uint8_t payloadLen[4] = {
-      static_cast<uint8_t>(payload_data.size() >> 24),
-      static_cast<uint8_t>(payload_data.size() >> 16),
-      static_cast<uint8_t>(payload_data.size() >> 8),
-      static_cast<uint8_t>(payload_data.size() >> 0),
+      static_cast<uint8_t>(payload_size >> 24),
+      static_cast<uint8_t>(payload_size >> 16),
+      static_cast<uint8_t>(payload_size >> 8),
+      static_cast<uint8_t>(payload_size >> 0),
     };
     // Not a short record, append all 4 bytes in big endian order
     bytes.insert(bytes.end(), { payloadLen[0], payloadLen[1], payloadLen[2], payloadLen[3] });
@@ -291,27 +301,52 @@ vector<uint8_t> NDEFRecord::as_bytes(uint8_t flags) const
     bytes.insert(bytes.end(), id_field.begin(), id_field.end());
   }
 
-  // Add payload bytes
-  bytes.insert(bytes.end(), payload_data.begin(), payload_data.end());
-
-  // Return span pointing to location of vector in memory with number of bytes in vector
   return bytes;
 }
 
 /// Update the payload stored in this NDEFRecord object, validating the record after doing so
 void NDEFRecord::set_payload(const vector<uint8_t>& data)
 {
-  payload_data = data;
+  this->assign_payload(NDEFPayloadSource::from_bytes(data), true);
 
   // Validate the record type is still valid
   this->validate();
 }
 
+/// Points the payload at an external source, releasing any payload bytes held in the record
+void NDEFRecord::set_payload_source(shared_ptr<const NDEFPayloadSource> source)
+{
+  // A missing source is an empty payload
+  if (!source) {
+    this->set_payload(vector<uint8_t>{});
+    return;
+  }
+
+  this->assign_payload(std::move(source), false);
+
+  // Validate the record type is still valid
+  this->validate();
+}
+
+void NDEFRecord::assign_payload(shared_ptr<const NDEFPayloadSource> handle, bool owned)
+{
+  this->payload_size = handle->size();
+  this->payload_bytes = handle->data();
+  this->payload_ref = std::move(handle);
+  this->owns_payload = owned;
+}
+
+const shared_ptr<const NDEFPayloadSource>& NDEFRecord::payload_source() const
+{
+  static const shared_ptr<const NDEFPayloadSource> none;
+  return this->owns_payload ? none : this->payload_ref;
+}
+
 /// Validates that if the payload has changed size then the type is no longer empty
 void NDEFRecord::validate()
 {
   // Not sure how this would happen, but reflecting their
-  if (payload_data.size() > 0 && (record_type.id() == NDEFRecordType::TypeID::Empty)) {
+  if (this->payload_length() > 0 && (record_type.id() == NDEFRecordType::TypeID::Empty)) {
     record_type = NDEFRecordType(NDEFRecordType::TypeID::Unknown);
   }
 }
@@ -0,0 +1,91 @@
+#include "ndef-lite/parser.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/record-layout.hpp"
+#include "ndef-lite/record-view.hpp"
+
+using namespace std;
+
+/// Appends bytes to the parse buffer
+void NDEFMessageParser::feed(const vector<uint8_t>& data) { this->feed(data.data(), data.size()); }
+
+/// Appends bytes to the parse buffer
+void NDEFMessageParser::feed(const uint8_t* data, size_t len)
+{
+  this->compact();
+  this->buffer.insert(this->buffer.end(), data, data + len);
+}
+
+/// Decodes buffered records until the message ends, the buffer runs dry, or the budget is spent
+DecodeStatus NDEFMessageParser::decode(const DecodeBudget& budget)
+{
+  size_t bytes_this_call = 0;
+  size_t records_this_call = 0;
+
+  while (!this->complete) {
+    // Record budget is checked up front, a record is either decoded entirely or not at all
+    if (budget.max_records > 0 && records_this_call >= budget.max_records) {
+      return DecodeStatus::BudgetExhausted;
+    }
+
+    NDEFRecordLayout layout;
+    const uint8_t* start = this->buffer.data() + this->read_offset;
+    auto status = frame_record(start, this->bytes_buffered(), layout);
+
+    if (status == FrameStatus::Malformed) {
+      throw NDEFException("Invalid character found in type field of record at byte " + to_string(this->consumed));
+    }
+
+    if (status == FrameStatus::Incomplete) {
+      return DecodeStatus::NeedMoreData;
+    }
+
+    // Always decode at least one record per call, otherwise a record larger than the budget would never be decoded
+    if (budget.max_bytes > 0 && records_this_call > 0 && bytes_this_call + layout.total_length > budget.max_bytes) {
+      return DecodeStatus::BudgetExhausted;
+    }
+
+    this->partial.append_record(NDEFRecordView{ start, layout }.to_record());
+    this->read_offset += layout.total_length;
+    this->consumed += layout.total_length;
+    this->complete = layout.header.me;
+
+    bytes_this_call += layout.total_length;
+    records_this_call++;
+  }
+
+  return DecodeStatus::Complete;
+}
+
+/// Hands the decoded message to the caller and prepares for the next message
+NDEFMessage NDEFMessageParser::take_message()
+{
+  NDEFMessage msg = std::move(this->partial);
+
+  this->partial = NDEFMessage{};
+  this->consumed = 0;
+  this->complete = false;
+
+  return msg;
+}
+
+/// Clears all parser state
+void NDEFMessageParser::reset()
+{
+  this->buffer.clear();
+  this->read_offset = 0;
+  this->consumed = 0;
+  this->partial = NDEFMessage{};
+  this->complete = false;
+}
+
+/// Removes consumed bytes from the front of the buffer when doing so is cheaper than keeping them around
+void NDEFMessageParser::compact()
+{
+  // Only worth shifting the remaining bytes once the consumed prefix is the larger part of the buffer
+  if (this->read_offset == 0 || this->read_offset < this->buffer.size() / 2) {
+    return;
+  }
+
+  this->buffer.erase(this->buffer.begin(), this->buffer.begin() + this->read_offset);
+  this->read_offset = 0;
+}
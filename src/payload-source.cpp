@@ -0,0 +1,318 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/payload-source.hpp"
+
+using namespace std;
+
+namespace {
+/// Bytes copied per step when neither splice() nor sendfile() can be used
+const size_t copy_chunk = 64 * 1024;
+
+/// Validates the region against the size of the file, resolving NDEFPayloadSource::to_end
+/// \param record whether the region is a single record's payload, and so limited by the 32-bit PAYLOAD_LENGTH field
+size_t region_length(int fd, uint64_t offset, uint64_t length, bool record = true)
+{
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    throw NDEFException("Unable to stat payload file: " + string{ strerror(errno) });
+  }
+
+  uint64_t file_size = static_cast<uint64_t>(info.st_size);
+  if (offset > file_size) {
+    throw NDEFException("Payload offset " + to_string(offset) + " is past the end of the " + to_string(file_size) +
+                        " byte file");
+  }
+
+  if (length == NDEFPayloadSource::to_end) {
+    length = file_size - offset;
+  }
+
+  if (length > file_size - offset) {
+    throw NDEFException("Payload region of " + to_string(length) + " bytes at offset " + to_string(offset) +
+                        " runs past the end of the " + to_string(file_size) + " byte file");
+  }
+
+  // The PAYLOAD_LENGTH field is 32 bits
+  if (record && length > UINT32_MAX) {
+    throw NDEFException("Payload of " + to_string(length) + " bytes is too large for a record");
+  }
+
+  if (length > SIZE_MAX) {
+    throw NDEFException("Region of " + to_string(length) + " bytes is too large to address");
+  }
+
+  return static_cast<size_t>(length);
+}
+
+/// Payload held in memory
+class MemoryPayload : public NDEFPayloadSource {
+public:
+  explicit MemoryPayload(vector<uint8_t> bytes) : bytes(std::move(bytes)) {}
+
+  size_t size() const override { return this->bytes.size(); }
+
+  const uint8_t* data() const override
+  {
+    static const uint8_t empty = 0;
+    return this->bytes.empty() ? &empty : this->bytes.data();
+  }
+
+  vector<uint8_t> read() const override { return this->bytes; }
+  void write_to(int out) const override { NDEFPayloadSource::write_bytes(out, this->bytes.data(), this->bytes.size()); }
+
+private:
+  vector<uint8_t> bytes;
+};
+
+/// Payload read on demand from a region of a file
+class FilePayload : public NDEFPayloadSource {
+public:
+  FilePayload(int fd, uint64_t offset, size_t length) : fd(fd), offset(offset), length(length) {}
+  ~FilePayload() override { close(this->fd); }
+
+  size_t size() const override { return this->length; }
+
+  vector<uint8_t> read() const override
+  {
+    vector<uint8_t> bytes(this->length);
+    this->copy_range(0, this->length, [&bytes](size_t pos, const uint8_t* data, size_t len) {
+      memcpy(bytes.data() + pos, data, len);
+    });
+    return bytes;
+  }
+
+  /// Splices into pipes and uses sendfile() for everything else, copying only if the kernel supports neither
+  void write_to(int out) const override
+  {
+    size_t written = 0;
+
+#ifdef __linux__
+    struct stat info;
+    bool to_pipe = fstat(out, &info) == 0 && S_ISFIFO(info.st_mode);
+
+    while (written < this->length) {
+      ssize_t n;
+      if (to_pipe) {
+        loff_t pos = static_cast<loff_t>(this->offset + written);
+        n = splice(this->fd, &pos, out, nullptr, this->length - written, SPLICE_F_MOVE | SPLICE_F_MORE);
+      } else {
+        off_t pos = static_cast<off_t>(this->offset + written);
+        n = sendfile(out, this->fd, &pos, this->length - written);
+      }
+
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        // Not supported for this pair of descriptors, copy the rest instead
+        if (errno == EINVAL || errno == ENOSYS) {
+          break;
+        }
+
+        throw NDEFException("Unable to write payload: " + string{ strerror(errno) });
+      }
+
+      if (n == 0) {
+        throw NDEFException("Payload file ended after " + to_string(written) + " of " + to_string(this->length) +
+                            " bytes");
+      }
+
+      written += static_cast<size_t>(n);
+    }
+#endif
+
+    this->copy_range(written, this->length - written, [out](size_t, const uint8_t* data, size_t len) {
+      NDEFPayloadSource::write_bytes(out, data, len);
+    });
+  }
+
+private:
+  int fd;
+  uint64_t offset;
+  size_t length;
+
+  /// Reads [pos, pos + len) of the region in chunks, passing each to \p sink
+  template <typename Sink>
+  void copy_range(size_t pos, size_t len, Sink sink) const
+  {
+    vector<uint8_t> chunk(min(len, copy_chunk));
+    size_t done = 0;
+
+    while (done < len) {
+      ssize_t n = pread(this->fd, chunk.data(), min(chunk.size(), len - done),
+                        static_cast<off_t>(this->offset + pos + done));
+
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw NDEFException("Unable to read payload: " + string{ strerror(errno) });
+      }
+
+      if (n == 0) {
+        throw NDEFException("Payload file ended after " + to_string(pos + done) + " of " + to_string(this->length) +
+                            " bytes");
+      }
+
+      sink(pos + done, chunk.data(), static_cast<size_t>(n));
+      done += static_cast<size_t>(n);
+    }
+  }
+};
+
+/// Payload held in a read-only mapping of a file
+class MappedPayload : public NDEFPayloadSource {
+public:
+  MappedPayload(void* mapping, size_t mapping_size, const uint8_t* start, size_t length)
+      : mapping(mapping), mapping_size(mapping_size), start(start), length(length)
+  {
+  }
+
+  ~MappedPayload() override
+  {
+    if (this->mapping) {
+      munmap(this->mapping, this->mapping_size);
+    }
+  }
+
+  size_t size() const override { return this->length; }
+  const uint8_t* data() const override { return this->start; }
+  vector<uint8_t> read() const override { return vector<uint8_t>(this->start, this->start + this->length); }
+  void write_to(int out) const override { NDEFPayloadSource::write_bytes(out, this->start, this->length); }
+
+private:
+  void* mapping;
+  size_t mapping_size;
+  const uint8_t* start;
+  size_t length;
+};
+
+/// Opens \p path read-only, throwing on failure
+int open_payload(const string& path)
+{
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw NDEFException("Unable to open payload file " + path + ": " + strerror(errno));
+  }
+
+  return fd;
+}
+
+/// Maps from the page containing \p offset, since mappings have to start on a page boundary
+shared_ptr<const NDEFPayloadSource> map_region(const string& path, uint64_t offset, uint64_t length, bool record)
+{
+  int fd = open_payload(path);
+  size_t region;
+
+  try {
+    region = region_length(fd, offset, length, record);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  // An empty region cannot be mapped, but still needs a valid data() pointer
+  if (region == 0) {
+    close(fd);
+    static const uint8_t empty = 0;
+    return make_shared<MappedPayload>(nullptr, 0, &empty, 0);
+  }
+
+  uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  uint64_t aligned = offset - offset % page;
+  size_t mapping_size = static_cast<size_t>(offset - aligned) + region;
+
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(aligned));
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    throw NDEFException("Unable to map payload file " + path + ": " + strerror(errno));
+  }
+
+  auto start = static_cast<const uint8_t*>(mapping) + (offset - aligned);
+  return make_shared<MappedPayload>(mapping, mapping_size, start, region);
+}
+} // namespace
+
+constexpr uint64_t NDEFPayloadSource::to_end;
+
+/// Every empty payload shares one source, so default constructed records do not allocate one each
+shared_ptr<const NDEFPayloadSource> NDEFPayloadSource::from_bytes(vector<uint8_t> bytes)
+{
+  if (bytes.empty()) {
+    static const shared_ptr<const NDEFPayloadSource> empty = make_shared<MemoryPayload>(vector<uint8_t>{});
+    return empty;
+  }
+
+  return make_shared<MemoryPayload>(std::move(bytes));
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadSource::from_fd(int fd, uint64_t offset, uint64_t length)
+{
+  int own_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (own_fd < 0) {
+    throw NDEFException("Unable to duplicate payload fd: " + string{ strerror(errno) });
+  }
+
+  try {
+    size_t region = region_length(own_fd, offset, length);
+    return make_shared<FilePayload>(own_fd, offset, region);
+  } catch (...) {
+    close(own_fd);
+    throw;
+  }
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadSource::from_file(const string& path, uint64_t offset, uint64_t length)
+{
+  int fd = open_payload(path);
+
+  try {
+    size_t region = region_length(fd, offset, length);
+    return make_shared<FilePayload>(fd, offset, region);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadSource::map_file(const string& path, uint64_t offset, uint64_t length)
+{
+  return map_region(path, offset, length, true);
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadSource::map_large_file(const string& path, uint64_t offset,
+                                                                      uint64_t length)
+{
+  return map_region(path, offset, length, false);
+}
+
+void NDEFPayloadSource::write_bytes(int fd, const uint8_t* data, size_t len)
+{
+  size_t written = 0;
+
+  while (written < len) {
+    ssize_t n = write(fd, data + written, len - written);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw NDEFException("Unable to write bytes: " + string{ strerror(errno) });
+    }
+
+    written += static_cast<size_t>(n);
+  }
+}
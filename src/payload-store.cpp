@@ -0,0 +1,203 @@
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "ndef-lite/payload-store.hpp"
+
+using namespace std;
+
+namespace {
+inline uint64_t read64(const uint8_t* ptr)
+{
+  uint64_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+inline uint64_t rotl(uint64_t value, unsigned bits) { return (value << bits) | (value >> (64 - bits)); }
+
+/// Final avalanche of MurmurHash3
+inline uint64_t fmix(uint64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+} // namespace
+
+/// One lock and one index per shard
+struct NDEFPayloadStore::Shard
+{
+  mutex lock;
+
+  /// Keyed by content hash. The raw pointer identifies the entry when its payload removes itself, since the weak
+  /// reference has already expired by then
+  unordered_multimap<uint64_t, pair<const void*, weak_ptr<const NDEFPayloadSource>>> entries;
+
+  PayloadStoreStats stats;
+};
+
+/// Payload bytes owned by the store, removed from their shard when the last handle is released
+class NDEFPayloadStore::StoredPayload : public NDEFPayloadSource {
+public:
+  StoredPayload(shared_ptr<Shard> shard, uint64_t hash, vector<uint8_t> bytes)
+      : shard(std::move(shard)), content_hash(hash), bytes(std::move(bytes))
+  {
+  }
+
+  ~StoredPayload() override
+  {
+    lock_guard<mutex> guard{ this->shard->lock };
+
+    auto range = this->shard->entries.equal_range(this->content_hash);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+      if (entry->second.first == this) {
+        this->shard->entries.erase(entry);
+        break;
+      }
+    }
+
+    this->shard->stats.payloads--;
+    this->shard->stats.bytes -= this->bytes.size();
+  }
+
+  size_t size() const override { return this->bytes.size(); }
+
+  const uint8_t* data() const override
+  {
+    static const uint8_t empty = 0;
+    return this->bytes.empty() ? &empty : this->bytes.data();
+  }
+
+  vector<uint8_t> read() const override { return this->bytes; }
+  void write_to(int out) const override { NDEFPayloadSource::write_bytes(out, this->bytes.data(), this->bytes.size()); }
+
+private:
+  shared_ptr<Shard> shard;
+  uint64_t content_hash;
+  vector<uint8_t> bytes;
+};
+
+NDEFPayloadStore::NDEFPayloadStore(size_t shards)
+{
+  size_t count = 1;
+  while (count < shards) {
+    count *= 2;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    this->shards.push_back(make_shared<Shard>());
+  }
+}
+
+NDEFPayloadStore::~NDEFPayloadStore() = default;
+
+/// Word-at-a-time multiply-rotate hash, finished with a full avalanche so the low bits can pick a shard and bucket
+uint64_t NDEFPayloadStore::hash(const uint8_t* data, size_t len)
+{
+  const uint64_t prime_1 = 0x9e3779b97f4a7c15ULL;
+  const uint64_t prime_2 = 0xc2b2ae3d27d4eb4fULL;
+
+  uint64_t hash = len * prime_1;
+  size_t pos = 0;
+
+  for (; pos + 8 <= len; pos += 8) {
+    hash ^= rotl(read64(data + pos) * prime_2, 31) * prime_1;
+    hash = rotl(hash, 27) * prime_1 + prime_2;
+  }
+
+  uint64_t tail = 0;
+  for (size_t shift = 0; pos < len; pos++, shift += 8) {
+    tail |= static_cast<uint64_t>(data[pos]) << shift;
+  }
+  hash ^= rotl(tail * prime_2, 31) * prime_1;
+
+  return fmix(hash);
+}
+
+/// Looks for equal bytes under the shard lock, calling \p make_bytes for a copy to keep only on a miss
+template <typename MakeBytes>
+shared_ptr<const NDEFPayloadSource> NDEFPayloadStore::intern_hashed(uint64_t hash, const uint8_t* data, size_t len,
+                                                                    MakeBytes make_bytes)
+{
+  auto& shard = this->shards[hash & (this->shards.size() - 1)];
+
+  // Colliding payloads locked below may be their last handle. They are released after the guard, since releasing them
+  // under it would have them take the shard lock again to remove themselves
+  vector<shared_ptr<const NDEFPayloadSource>> collisions;
+  lock_guard<mutex> guard{ shard->lock };
+
+  auto range = shard->entries.equal_range(hash);
+  for (auto entry = range.first; entry != range.second; ++entry) {
+    // An expired entry belongs to a payload that is waiting for the lock to remove itself
+    auto existing = entry->second.second.lock();
+    if (existing && existing->size() == len && (len == 0 || memcmp(existing->data(), data, len) == 0)) {
+      shard->stats.hits++;
+      return existing;
+    }
+
+    if (existing) {
+      collisions.push_back(std::move(existing));
+    }
+  }
+
+  auto stored = make_shared<StoredPayload>(shard, hash, make_bytes());
+  weak_ptr<const NDEFPayloadSource> ref{ stored };
+  shard->entries.emplace(hash, make_pair(static_cast<const void*>(stored.get()), std::move(ref)));
+
+  shard->stats.misses++;
+  shard->stats.payloads++;
+  shard->stats.bytes += len;
+  return stored;
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadStore::intern(const uint8_t* data, size_t len)
+{
+  return this->intern_hashed(hash(data, len), data, len, [data, len]() { return vector<uint8_t>(data, data + len); });
+}
+
+shared_ptr<const NDEFPayloadSource> NDEFPayloadStore::intern(vector<uint8_t>&& bytes)
+{
+  return this->intern_hashed(hash(bytes.data(), bytes.size()), bytes.data(), bytes.size(),
+                             [&bytes]() { return std::move(bytes); });
+}
+
+void NDEFPayloadStore::intern(NDEFRecord& record)
+{
+  if (record.payload_bytes == nullptr) {
+    return;
+  }
+
+  // Interned bytes are held in memory, so the record reports that it holds its payload rather than having a source
+  record.assign_payload(this->intern(record.payload_bytes, record.payload_size), true);
+}
+
+NDEFRecord NDEFPayloadStore::to_record(const NDEFRecordView& view)
+{
+  auto payload = view.payload();
+
+  NDEFRecord record{ std::vector<uint8_t>{}, NDEFRecordType{ view.tnf(), view.type().to_string() },
+                     view.id().to_string() };
+  record.assign_payload(this->intern(payload.data, payload.size), true);
+  record.set_chunked(view.header().cf);
+  record.validate();
+  return record;
+}
+
+PayloadStoreStats NDEFPayloadStore::stats() const
+{
+  PayloadStoreStats total;
+
+  for (auto&& shard : this->shards) {
+    lock_guard<mutex> guard{ shard->lock };
+    total.payloads += shard->stats.payloads;
+    total.bytes += shard->stats.bytes;
+    total.hits += shard->stats.hits;
+    total.misses += shard->stats.misses;
+  }
+
+  return total;
+}
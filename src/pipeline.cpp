@@ -0,0 +1,456 @@
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/pipeline.hpp"
+#include "ndef-lite/queue.hpp"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/record-layout.hpp"
+
+using namespace std;
+
+namespace {
+using BufferQueue = SPSCQueue<NDEFMessageBuffer>;
+using BufferPool = MPMCQueue<NDEFMessageBuffer>;
+
+/// Everything the stages of one run share
+struct RunState
+{
+  RunState(size_t pool_capacity) : pool(pool_capacity) {}
+
+  /// Buffers released by any stage, picked up again by the framing stage
+  BufferPool pool;
+
+  /// Set once any stage throws, every stage then finishes immediately
+  atomic<bool> aborted{ false };
+  once_flag error_once;
+  exception_ptr error;
+
+  atomic<size_t> messages_in{ 0 };
+  atomic<size_t> messages_dropped{ 0 };
+  atomic<size_t> messages_out{ 0 };
+
+  /// Takes a recycled buffer from the pool, only allocating a new one while the pipeline is filling up
+  NDEFMessageBuffer acquire()
+  {
+    NDEFMessageBuffer buffer;
+    this->pool.try_pop(buffer);
+    return buffer;
+  }
+
+  /// Hands a buffer back to the pool. If the pool is full the buffer is freed instead
+  void release(NDEFMessageBuffer&& buffer)
+  {
+    buffer.clear();
+    this->pool.try_push(std::move(buffer));
+  }
+};
+
+/// Output side shared by every stage that feeds a queue. Items that do not fit are held back until they do
+class StageOutput {
+public:
+  StageOutput(BufferQueue& queue) : queue(queue) {}
+
+  /// \return number of items moved into the queue
+  size_t flush()
+  {
+    size_t count = this->pending.size() - this->flushed;
+    size_t pushed = this->queue.try_push_batch(this->pending.begin() + this->flushed, count);
+    this->flushed += pushed;
+
+    // Keep the vector's capacity, it is reused for every batch
+    if (this->flushed == this->pending.size()) {
+      this->pending.clear();
+      this->flushed = 0;
+    }
+
+    return pushed;
+  }
+
+  bool has_pending() const { return !this->pending.empty(); }
+  void emit(NDEFMessageBuffer&& buffer) { this->pending.push_back(std::move(buffer)); }
+
+  atomic<bool> done{ false };
+
+private:
+  BufferQueue& queue;
+  vector<NDEFMessageBuffer> pending;
+  size_t flushed = 0;
+};
+
+/// Pulls chunks from the source and frames complete messages into pooled buffers
+class FrameStage {
+public:
+  FrameStage(NDEFPipeline::Source& source, RunState& state, BufferQueue& out, size_t batch_size)
+      : output(out), source(source), state(state), batch_size(batch_size)
+  {
+  }
+
+  StageStatus step()
+  {
+    size_t pushed = this->output.flush();
+    if (this->output.has_pending()) {
+      return (pushed > 0) ? StageStatus::Progress : StageStatus::Idle;
+    }
+
+    // Frame whatever complete messages are already buffered before asking the source for more
+    if (this->frame_buffered() > 0) {
+      this->output.flush();
+      return StageStatus::Progress;
+    }
+
+    if (this->exhausted) {
+      if (this->read_offset != this->carry.size()) {
+        throw NDEFException("Source ended in the middle of a message, " +
+                            to_string(this->carry.size() - this->read_offset) + " bytes left over");
+      }
+
+      this->output.done.store(true, memory_order_release);
+      return StageStatus::Done;
+    }
+
+    // Drop already framed bytes before appending more
+    this->carry.erase(this->carry.begin(), this->carry.begin() + this->read_offset);
+    this->read_offset = 0;
+
+    this->chunk.clear();
+    if (this->source(this->chunk)) {
+      this->carry.insert(this->carry.end(), this->chunk.begin(), this->chunk.end());
+    } else {
+      this->exhausted = true;
+    }
+
+    return StageStatus::Progress;
+  }
+
+  StageOutput output;
+
+private:
+  /// \return number of messages framed
+  size_t frame_buffered()
+  {
+    size_t framed = 0;
+
+    while (framed < this->batch_size && this->read_offset < this->carry.size()) {
+      size_t length = 0;
+      const uint8_t* start = this->carry.data() + this->read_offset;
+      auto status = frame_message(start, this->carry.size() - this->read_offset, length);
+
+      if (status == FrameStatus::Malformed) {
+        throw NDEFException("Malformed record in source stream near byte " + to_string(this->read_offset));
+      }
+
+      if (status == FrameStatus::Incomplete) {
+        break;
+      }
+
+      // The only copy of the message bytes, from the source chunk into a recycled buffer
+      auto buffer = this->state.acquire();
+      buffer.assign(start, length);
+      this->output.emit(std::move(buffer));
+
+      this->read_offset += length;
+      this->state.messages_in++;
+      framed++;
+    }
+
+    return framed;
+  }
+
+  NDEFPipeline::Source& source;
+  RunState& state;
+  size_t batch_size;
+
+  vector<uint8_t> chunk;
+  vector<uint8_t> carry;
+  size_t read_offset = 0;
+  bool exhausted = false;
+};
+
+/// Stage that takes buffers from one queue and emits zero or more buffers to the next
+class TransformStage {
+public:
+  /// Processes one buffer, emitting the result to output or releasing it to the pool
+  using Process = function<void(NDEFMessageBuffer&& buffer, StageOutput& output)>;
+
+  TransformStage(BufferQueue& in, StageOutput& upstream, BufferQueue& out, size_t batch_size, Process process)
+      : output(out), in(in), upstream(upstream), batch(batch_size), process(process)
+  {
+  }
+
+  StageStatus step()
+  {
+    size_t pushed = this->output.flush();
+    if (this->output.has_pending()) {
+      return (pushed > 0) ? StageStatus::Progress : StageStatus::Idle;
+    }
+
+    // Read the upstream flag first, so an empty queue afterwards really means nothing else is coming
+    bool upstream_done = this->upstream.done.load(memory_order_acquire);
+    size_t n = this->in.try_pop_batch(this->batch.begin(), this->batch.size());
+
+    if (n == 0) {
+      if (upstream_done) {
+        this->output.done.store(true, memory_order_release);
+        return StageStatus::Done;
+      }
+
+      return StageStatus::Idle;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      this->process(std::move(this->batch[i]), this->output);
+    }
+
+    this->output.flush();
+    return StageStatus::Progress;
+  }
+
+  StageOutput output;
+
+private:
+  BufferQueue& in;
+  StageOutput& upstream;
+  vector<NDEFMessageBuffer> batch;
+  Process process;
+};
+
+/// Hands finished messages to the sink and recycles their buffers
+class SinkStage {
+public:
+  SinkStage(NDEFPipeline::Sink& sink, RunState& state, BufferQueue& in, StageOutput& upstream, size_t batch_size)
+      : sink(sink), state(state), in(in), upstream(upstream), batch(batch_size)
+  {
+  }
+
+  StageStatus step()
+  {
+    bool upstream_done = this->upstream.done.load(memory_order_acquire);
+    size_t n = this->in.try_pop_batch(this->batch.begin(), this->batch.size());
+
+    if (n == 0) {
+      return upstream_done ? StageStatus::Done : StageStatus::Idle;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      this->sink(this->batch[i]);
+      this->state.messages_out++;
+      this->state.release(std::move(this->batch[i]));
+    }
+
+    return StageStatus::Progress;
+  }
+
+private:
+  NDEFPipeline::Sink& sink;
+  RunState& state;
+  BufferQueue& in;
+  StageOutput& upstream;
+  vector<NDEFMessageBuffer> batch;
+};
+
+/// Copies the encoded bytes of the kept records of \p view into \p out, fixing up the MB/ME flags
+void splice_records(const NDEFMessageView& view, const vector<size_t>& kept, vector<uint8_t>& out)
+{
+  const uint8_t begin_end = static_cast<uint8_t>(RecordFlag::MB) | static_cast<uint8_t>(RecordFlag::ME);
+
+  out.clear();
+  for (size_t i = 0; i < kept.size(); i++) {
+    auto bytes = view.record(kept[i]).bytes();
+    size_t header_pos = out.size();
+    out.insert(out.end(), bytes.begin(), bytes.end());
+
+    out[header_pos] &= ~begin_end;
+    out[header_pos] |= (i == 0) ? static_cast<uint8_t>(RecordFlag::MB) : 0;
+    out[header_pos] |= (i == kept.size() - 1) ? static_cast<uint8_t>(RecordFlag::ME) : 0;
+  }
+}
+} // namespace
+
+/// Steps every stage on a dedicated thread
+void ThreadPerStageExecutor::run(const vector<StageStep>& stages)
+{
+  vector<thread> threads;
+
+  for (auto&& stage : stages) {
+    threads.emplace_back([&stage]() {
+      StageStatus status;
+      while ((status = stage()) != StageStatus::Done) {
+        if (status == StageStatus::Idle) {
+          this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Steps every unfinished stage in turn until all are done
+void CooperativeExecutor::run(const vector<StageStep>& stages)
+{
+  vector<bool> done(stages.size(), false);
+  size_t remaining = stages.size();
+
+  while (remaining > 0) {
+    for (size_t i = 0; i < stages.size(); i++) {
+      if (!done[i] && stages[i]() == StageStatus::Done) {
+        done[i] = true;
+        remaining--;
+      }
+    }
+  }
+}
+
+NDEFPipeline& NDEFPipeline::source(Source fn)
+{
+  this->source_fn = fn;
+  return *this;
+}
+
+NDEFPipeline& NDEFPipeline::filter(RecordFilter fn)
+{
+  this->filter_fn = fn;
+  return *this;
+}
+
+NDEFPipeline& NDEFPipeline::filter_type(const NDEFRecordType& type)
+{
+  return this->filter([type](const NDEFRecordView& record) {
+    return record.tnf() == type.id() && record.type() == type.name();
+  });
+}
+
+NDEFPipeline& NDEFPipeline::transform(Transform fn)
+{
+  this->transform_fn = fn;
+  return *this;
+}
+
+NDEFPipeline& NDEFPipeline::sink(Sink fn)
+{
+  this->sink_fn = fn;
+  return *this;
+}
+
+/// Wires up the stages for the configured functions and runs them to completion
+void NDEFPipeline::run(PipelineExecutor& executor)
+{
+  if (!this->source_fn || !this->sink_fn) {
+    throw NDEFException("Pipeline requires both a source and a sink");
+  }
+
+  const size_t capacity = this->options.queue_capacity;
+  const size_t batch = this->options.batch_size;
+
+  // Enough pooled buffers to fill every queue, plus each stage's batch
+  RunState state{ capacity * 4 + batch * 4 };
+  vector<unique_ptr<BufferQueue>> queues;
+  queues.emplace_back(new BufferQueue{ capacity });
+
+  FrameStage frame{ this->source_fn, state, *queues.back(), batch };
+  StageOutput* upstream = &frame.output;
+  vector<unique_ptr<TransformStage>> transforms;
+
+  if (this->filter_fn) {
+    auto& filter = this->filter_fn;
+    auto kept = make_shared<vector<size_t>>();
+    auto scratch = make_shared<vector<uint8_t>>();
+
+    auto process = [&filter, &state, kept, scratch](NDEFMessageBuffer&& buffer, StageOutput& output) {
+      const auto& view = buffer.view();
+
+      kept->clear();
+      for (size_t i = 0; i < view.record_count(); i++) {
+        if (filter(view.record(i))) {
+          kept->push_back(i);
+        }
+      }
+
+      if (kept->empty()) {
+        state.messages_dropped++;
+        state.release(std::move(buffer));
+        return;
+      }
+
+      // Only rewrite the buffer when records were actually removed
+      if (kept->size() != view.record_count()) {
+        splice_records(view, *kept, *scratch);
+        buffer.assign(*scratch);
+      }
+
+      output.emit(std::move(buffer));
+    };
+
+    BufferQueue& in = *queues.back();
+    queues.emplace_back(new BufferQueue{ capacity });
+    transforms.emplace_back(new TransformStage{ in, *upstream, *queues.back(), batch, process });
+    upstream = &transforms.back()->output;
+  }
+
+  if (this->transform_fn) {
+    auto& transform = this->transform_fn;
+
+    auto process = [&transform, &state](NDEFMessageBuffer&& buffer, StageOutput& output) {
+      auto message = buffer.view().to_message();
+      transform(message);
+
+      // A transform that leaves the message unencodable drops it
+      auto bytes = message.as_bytes();
+      if (bytes.empty()) {
+        state.messages_dropped++;
+        state.release(std::move(buffer));
+        return;
+      }
+
+      buffer.assign(bytes);
+      output.emit(std::move(buffer));
+    };
+
+    BufferQueue& in = *queues.back();
+    queues.emplace_back(new BufferQueue{ capacity });
+    transforms.emplace_back(new TransformStage{ in, *upstream, *queues.back(), batch, process });
+    upstream = &transforms.back()->output;
+  }
+
+  SinkStage sink{ this->sink_fn, state, *queues.back(), *upstream, batch };
+
+  // Every stage stops as soon as any of them fails, the first failure is rethrown once all have stopped
+  auto guard = [&state](function<StageStatus()> step) -> StageStep {
+    return [&state, step]() {
+      if (state.aborted.load(memory_order_acquire)) {
+        return StageStatus::Done;
+      }
+
+      try {
+        return step();
+      } catch (...) {
+        call_once(state.error_once, [&state]() { state.error = current_exception(); });
+        state.aborted.store(true, memory_order_release);
+        return StageStatus::Done;
+      }
+    };
+  };
+
+  vector<StageStep> steps;
+  steps.push_back(guard([&frame]() { return frame.step(); }));
+  for (auto&& stage : transforms) {
+    TransformStage* ptr = stage.get();
+    steps.push_back(guard([ptr]() { return ptr->step(); }));
+  }
+  steps.push_back(guard([&sink]() { return sink.step(); }));
+
+  executor.run(steps);
+
+  this->run_stats.messages_in = state.messages_in;
+  this->run_stats.messages_dropped = state.messages_dropped;
+  this->run_stats.messages_out = state.messages_out;
+
+  if (state.error) {
+    rethrow_exception(state.error);
+  }
+}
@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/read-session.hpp"
+
+using namespace std;
+
+NDEFReadSessionCache::NDEFReadSessionCache(const ReadSessionOptions& options) : options(options)
+{
+  if (options.max_sessions == 0) {
+    throw NDEFException("Read session cache must hold at least one session");
+  }
+}
+
+/// Replaces the tag's session, evicting the oldest one when the cache is full
+void NDEFReadSessionCache::store(const vector<uint8_t>& uid, NDEFReadSession session)
+{
+  lock_guard<mutex> guard{ this->lock };
+
+  this->sessions.erase(uid);
+  if (this->sessions.size() >= this->options.max_sessions) {
+    auto oldest = min_element(this->sessions.begin(), this->sessions.end(),
+                              [](const pair<const vector<uint8_t>, Entry>& lhs,
+                                 const pair<const vector<uint8_t>, Entry>& rhs) {
+                                return lhs.second.stored < rhs.second.stored;
+                              });
+    this->sessions.erase(oldest);
+    this->counters.expired++;
+  }
+
+  this->sessions[uid] = Entry{ std::move(session), Clock::now() };
+  this->counters.stored++;
+}
+
+bool NDEFReadSessionCache::take(const vector<uint8_t>& uid, NDEFReadSession& session)
+{
+  lock_guard<mutex> guard{ this->lock };
+
+  auto entry = this->sessions.find(uid);
+  if (entry == this->sessions.end()) {
+    return false;
+  }
+
+  const bool fresh = Clock::now() - entry->second.stored <= this->options.max_age;
+  if (fresh) {
+    session = std::move(entry->second.session);
+    this->counters.resumed++;
+  } else {
+    this->counters.expired++;
+  }
+
+  this->sessions.erase(entry);
+  return fresh;
+}
+
+void NDEFReadSessionCache::mismatched()
+{
+  lock_guard<mutex> guard{ this->lock };
+  this->counters.mismatched++;
+}
+
+size_t NDEFReadSessionCache::size() const
+{
+  lock_guard<mutex> guard{ this->lock };
+  return this->sessions.size();
+}
+
+ReadSessionStats NDEFReadSessionCache::stats() const
+{
+  lock_guard<mutex> guard{ this->lock };
+  return this->counters;
+}
+
+void NDEFReadSessionCache::clear()
+{
+  lock_guard<mutex> guard{ this->lock };
+  this->sessions.clear();
+}
@@ -0,0 +1,5 @@
+#include "ndef-lite/record-layout.hpp"
+
+#ifndef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record-layout.ipp"
+#endif
@@ -0,0 +1,94 @@
+#include "ndef-lite/record-view.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+#ifndef NDEF_LITE_INLINE_HOT_PATHS
+#include "ndef-lite/impl/record-view.ipp"
+#endif
+
+using namespace std;
+
+/// Builds a record object from the view, copying each field out of the buffer exactly once
+NDEFRecord NDEFRecordView::to_record() const
+{
+  return NDEFRecord{ this->payload().to_vector(), NDEFRecordType{ this->tnf(), this->type().to_string() },
+                     this->id().to_string(), 0, this->record_layout.header.cf };
+}
+
+/// Frames all records of the message in data
+void NDEFMessageView::open(const uint8_t* data, size_t len)
+{
+  this->clear();
+  this->message_start = data;
+
+  size_t pos = 0;
+  while (pos < len) {
+    NDEFRecordLayout layout;
+    auto status = frame_record(data + pos, len - pos, layout);
+
+    if (status == FrameStatus::Malformed) {
+      throw NDEFException("Invalid character found in type field of record at byte " + to_string(pos));
+    }
+
+    if (status == FrameStatus::Incomplete) {
+      throw NDEFException("Too few bytes for record at byte " + to_string(pos) + ": have " + to_string(len - pos));
+    }
+
+    this->offsets.push_back(pos);
+    this->layouts.push_back(layout);
+    pos += layout.total_length;
+
+    // Anything after the Message End record belongs to someone else
+    if (layout.header.me) {
+      break;
+    }
+  }
+
+  this->message_length = pos;
+}
+
+/// Adopts already indexed message bytes
+void NDEFMessageView::open_indexed(const uint8_t* data, size_t len)
+{
+  this->clear();
+  this->message_start = data;
+  this->message_length = len;
+}
+
+/// Appends a record whose layout the caller computed earlier
+void NDEFMessageView::add_record(size_t offset, const NDEFRecordLayout& layout)
+{
+  this->offsets.push_back(offset);
+  this->layouts.push_back(layout);
+}
+
+/// Resets the view to an empty message without releasing index capacity
+void NDEFMessageView::clear()
+{
+  this->message_start = nullptr;
+  this->message_length = 0;
+  this->offsets.clear();
+  this->layouts.clear();
+}
+
+/// Creates a view of a single record of the message
+NDEFRecordView NDEFMessageView::record(size_t index) const
+{
+  // Have to provide bounds checking
+  if (index >= this->layouts.size()) {
+    throw std::out_of_range{ "Unable to view record. Index " + to_string(index) + " outside of range of message" };
+  }
+
+  return NDEFRecordView{ this->message_start + this->offsets[index], this->layouts[index] };
+}
+
+/// Copies every record of the view into a message object
+NDEFMessage NDEFMessageView::to_message() const
+{
+  NDEFMessage msg;
+
+  for (size_t i = 0; i < this->layouts.size(); i++) {
+    msg.append_record(this->record(i).to_record());
+  }
+
+  return msg;
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <map>
+
+#include "ndef-lite/rule-set.hpp"
+
+using namespace std;
+
+namespace {
+const size_t tnf_values = 8;
+const size_t uri_codes = 256;
+
+/// Trie node used while compiling, before the edges are flattened
+struct BuildNode
+{
+  size_t parent;
+  map<uint8_t, size_t> children;
+
+  /// Rules whose value ends at this node, split by whether they also accept longer fields
+  vector<uint64_t> prefix_rules;
+  vector<uint64_t> exact_rules;
+};
+
+inline void set_bit(uint64_t* mask, size_t bit) { mask[bit / 64] |= uint64_t{ 1 } << (bit % 64); }
+} // namespace
+
+NDEFRule& NDEFRule::tnf(NDEFRecordType::TypeID value)
+{
+  this->tnf_set = true;
+  this->tnf_value = value;
+  return *this;
+}
+
+NDEFRule& NDEFRule::uri_prefix_code(uint8_t code)
+{
+  this->uri_code_set = true;
+  this->uri_code = code;
+  return *this;
+}
+
+NDEFRule& NDEFRule::set(Field field, const string& value, bool prefix)
+{
+  auto& predicate = this->strings[static_cast<size_t>(field)];
+  predicate.active = true;
+  predicate.prefix = prefix;
+  predicate.value = value;
+  return *this;
+}
+
+NDEFRuleSet NDEFRuleSet::compile(const vector<NDEFRule>& rules)
+{
+  NDEFRuleSet set;
+  set.words = max<size_t>(1, (rules.size() + 63) / 64);
+  const size_t words = set.words;
+
+  set.tnf_masks.assign(tnf_values * words, 0);
+  set.uri_code_masks.assign(uri_codes * words, 0);
+  set.not_uri_mask.assign(words, 0);
+
+  for (size_t bit = 0; bit < rules.size(); bit++) {
+    auto& rule = rules[bit];
+    set.rule_ids.push_back(rule.id());
+
+    for (size_t tnf = 0; tnf < tnf_values; tnf++) {
+      if (!rule.tnf_set || static_cast<size_t>(rule.tnf_value) == tnf) {
+        set_bit(&set.tnf_masks[tnf * words], bit);
+      }
+    }
+
+    for (size_t code = 0; code < uri_codes; code++) {
+      if (!rule.uri_code_set || rule.uri_code == code) {
+        set_bit(&set.uri_code_masks[code * words], bit);
+      }
+    }
+
+    if (!rule.uri_code_set) {
+      set_bit(set.not_uri_mask.data(), bit);
+    }
+  }
+
+  for (size_t field = 0; field < static_cast<size_t>(NDEFRule::Field::Count); field++) {
+    auto& trie = set.tries[field];
+    trie.unconstrained.assign(words, 0);
+
+    vector<BuildNode> nodes(1);
+    nodes[0].prefix_rules.assign(words, 0);
+    nodes[0].exact_rules.assign(words, 0);
+
+    for (size_t bit = 0; bit < rules.size(); bit++) {
+      auto& predicate = rules[bit].strings[field];
+      if (!predicate.active) {
+        set_bit(trie.unconstrained.data(), bit);
+        continue;
+      }
+
+      size_t node = 0;
+      for (char chr : predicate.value) {
+        auto byte = static_cast<uint8_t>(chr);
+        auto child = nodes[node].children.find(byte);
+
+        if (child != nodes[node].children.end()) {
+          node = child->second;
+          continue;
+        }
+
+        nodes[node].children[byte] = nodes.size();
+        nodes.push_back(BuildNode{ node, {}, vector<uint64_t>(words), vector<uint64_t>(words) });
+        node = nodes.size() - 1;
+      }
+
+      set_bit((predicate.prefix ? nodes[node].prefix_rules : nodes[node].exact_rules).data(), bit);
+    }
+
+    // Children are always created after their parent, so one pass in creation order accumulates every prefix rule
+    // satisfied along the path to each node
+    trie.masks.assign(nodes.size() * 2 * words, 0);
+    for (size_t node = 0; node < nodes.size(); node++) {
+      uint64_t* ends = &trie.masks[node * 2 * words];
+      uint64_t* continues = ends + words;
+      const uint64_t* inherited =
+          node == 0 ? trie.unconstrained.data() : &trie.masks[(nodes[node].parent * 2 + 1) * words];
+
+      for (size_t w = 0; w < words; w++) {
+        continues[w] = inherited[w] | nodes[node].prefix_rules[w];
+        ends[w] = continues[w] | nodes[node].exact_rules[w];
+      }
+
+      trie.nodes.push_back(Trie::Node{ static_cast<uint32_t>(trie.edge_bytes.size()),
+                                       static_cast<uint32_t>(nodes[node].children.size()) });
+      for (auto&& child : nodes[node].children) {
+        trie.edge_bytes.push_back(child.first);
+        trie.edge_targets.push_back(static_cast<uint32_t>(child.second));
+      }
+    }
+  }
+
+  return set;
+}
+
+/// Follows \p value down the trie until it ends or no rule constrains it any further
+const uint64_t* NDEFRuleSet::Trie::walk(ByteSpan value, size_t words) const
+{
+  size_t node = 0;
+
+  for (size_t i = 0; i < value.size; i++) {
+    auto& current = this->nodes[node];
+    auto first = this->edge_bytes.begin() + current.first_edge;
+    auto last = first + current.edge_count;
+    auto edge = lower_bound(first, last, value.data[i]);
+
+    if (edge == last || *edge != value.data[i]) {
+      return &this->masks[(node * 2 + 1) * words];
+    }
+
+    node = this->edge_targets[static_cast<size_t>(edge - this->edge_bytes.begin())];
+  }
+
+  return &this->masks[node * 2 * words];
+}
+
+void NDEFRuleSet::match(const NDEFRecordView& record, vector<uint32_t>& matches) const
+{
+  matches.clear();
+
+  const uint64_t* masks[6];
+  masks[0] = &this->tnf_masks[static_cast<size_t>(record.tnf()) * this->words];
+  masks[1] = this->tries[static_cast<size_t>(NDEFRule::Field::Type)].walk(record.type(), this->words);
+  masks[2] = this->tries[static_cast<size_t>(NDEFRule::Field::Id)].walk(record.id(), this->words);
+
+  auto payload = record.payload();
+  auto& uri_trie = this->tries[static_cast<size_t>(NDEFRule::Field::UriBody)];
+  if (record.is_well_known('U') && payload.size >= 1) {
+    masks[3] = &this->uri_code_masks[payload.data[0] * this->words];
+    masks[4] = uri_trie.walk(ByteSpan{ payload.data + 1, payload.size - 1 }, this->words);
+  } else {
+    masks[3] = this->not_uri_mask.data();
+    masks[4] = uri_trie.unconstrained.data();
+  }
+
+  auto& locale_trie = this->tries[static_cast<size_t>(NDEFRule::Field::TextLocale)];
+  ByteSpan locale;
+  ByteSpan text;
+  if (record.text_span(locale, text)) {
+    masks[5] = locale_trie.walk(locale, this->words);
+  } else {
+    masks[5] = locale_trie.unconstrained.data();
+  }
+
+  for (size_t w = 0; w < this->words; w++) {
+    uint64_t bits = masks[0][w] & masks[1][w] & masks[2][w] & masks[3][w] & masks[4][w] & masks[5][w];
+
+    while (bits != 0) {
+      size_t bit = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+      matches.push_back(this->rule_ids[bit]);
+      bits &= bits - 1;
+    }
+  }
+}
+
+vector<vector<uint32_t>> NDEFRuleSet::match(const NDEFMessageView& message) const
+{
+  vector<vector<uint32_t>> matches(message.record_count());
+
+  for (size_t i = 0; i < message.record_count(); i++) {
+    this->match(message.record(i), matches[i]);
+  }
+
+  return matches;
+}
@@ -0,0 +1,410 @@
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/record-header.hpp"
+#include "ndef-lite/shm-ring.hpp"
+
+using namespace std;
+
+namespace {
+const uint32_t ring_magic = 0x4e444546; // "NDEF"
+const uint32_t ring_version = 1;
+
+/// Entries start on this alignment, which also guarantees an entry header fits before the end of the ring
+const size_t entry_alignment = 16;
+
+/// Marks an entry that only pads out the end of the ring
+const uint32_t padding_entry = UINT32_MAX;
+
+/// Bytes reserved in front of the data area for the control block
+const size_t control_size = 4096;
+
+/// Precedes every entry in the data area
+struct EntryHeader
+{
+  /// Bytes the whole entry occupies, including this header, padded to entry_alignment
+  uint32_t entry_length;
+
+  /// Bytes of encoded message, or padding_entry
+  uint32_t message_length;
+
+  uint32_t record_count;
+  uint32_t reserved;
+};
+
+/// Precomputed layout of a single record, enough to rebuild its NDEFRecordLayout without reading any length fields
+struct IndexEntry
+{
+  uint32_t offset;
+  uint32_t payload_length;
+  uint8_t header;
+  uint8_t type_offset;
+  uint8_t type_length;
+  uint8_t id_length;
+};
+
+size_t align_entry(size_t n) { return (n + entry_alignment - 1) & ~(entry_alignment - 1); }
+
+size_t round_up_pow2(size_t n)
+{
+  size_t capacity = control_size;
+  while (capacity < n) {
+    capacity <<= 1;
+  }
+
+  return capacity;
+}
+
+/// Sleeps while the futex word still holds \p expected, or until the timeout passes
+void futex_wait(atomic<uint32_t>& word, uint32_t expected, int timeout_ms)
+{
+  timespec timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, (timeout_ms < 0) ? nullptr : &timeout,
+          nullptr, 0);
+}
+
+void futex_wake(atomic<uint32_t>& word)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/// Repeats \p attempt, sleeping on \p seq in between, until it succeeds or the timeout expires
+template <typename Attempt, typename Stop>
+bool wait_for(atomic<uint32_t>& seq, atomic<uint32_t>& waiters, int timeout_ms, Attempt attempt, Stop stop)
+{
+  auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout_ms);
+
+  while (true) {
+    // Sample the sequence before checking, so a signal between the check and the sleep is not lost
+    waiters.fetch_add(1);
+    uint32_t observed = seq.load();
+
+    if (attempt()) {
+      waiters.fetch_sub(1);
+      return true;
+    }
+
+    if (stop()) {
+      waiters.fetch_sub(1);
+      return false;
+    }
+
+    int remaining = -1;
+    if (timeout_ms >= 0) {
+      auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+      if (left <= 0) {
+        waiters.fetch_sub(1);
+        return false;
+      }
+      remaining = static_cast<int>(left);
+    }
+
+    futex_wait(seq, observed, remaining);
+    waiters.fetch_sub(1);
+  }
+}
+
+/// Bumps the sequence and wakes any sleepers
+void signal(atomic<uint32_t>& seq, atomic<uint32_t>& waiters)
+{
+  seq.fetch_add(1);
+  if (waiters.load() > 0) {
+    futex_wake(seq);
+  }
+}
+} // namespace
+
+/// Shared state at the start of the mapping. Producer and consumer owned fields are kept on separate cache lines
+struct NDEFShmRing::Control
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+
+  // Consumer owned
+  alignas(64) atomic<uint64_t> head;
+  atomic<uint32_t> space_seq;
+  atomic<uint32_t> space_waiters;
+
+  // Producer owned
+  alignas(64) atomic<uint64_t> tail;
+  atomic<uint32_t> data_seq;
+  atomic<uint32_t> data_waiters;
+  atomic<uint32_t> closed;
+};
+
+/// Creates and maps the memfd, initialising the control block
+NDEFShmRing NDEFShmRing::create(size_t capacity)
+{
+  static_assert(sizeof(Control) <= control_size, "Ring control block must fit in its reserved space");
+
+  capacity = round_up_pow2(capacity);
+  size_t mapping_size = control_size + capacity;
+
+  int fd = memfd_create("ndef-lite-ring", MFD_CLOEXEC);
+  if (fd < 0) {
+    throw NDEFException("Unable to create ring memfd: " + string{ strerror(errno) });
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+    ::close(fd);
+    throw NDEFException("Unable to size ring memfd: " + string{ strerror(errno) });
+  }
+
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    ::close(fd);
+    throw NDEFException("Unable to map ring memfd: " + string{ strerror(errno) });
+  }
+
+  auto control = new (mapping) Control{};
+  control->magic = ring_magic;
+  control->version = ring_version;
+  control->capacity = capacity;
+
+  return NDEFShmRing{ fd, mapping, mapping_size };
+}
+
+/// Maps an existing ring, validating its control block
+NDEFShmRing NDEFShmRing::attach(int fd)
+{
+  int own_fd = dup(fd);
+  if (own_fd < 0) {
+    throw NDEFException("Unable to duplicate ring fd: " + string{ strerror(errno) });
+  }
+
+  struct stat info;
+  if (fstat(own_fd, &info) != 0 || static_cast<size_t>(info.st_size) <= control_size) {
+    ::close(own_fd);
+    throw NDEFException("File descriptor does not hold an NDEF ring");
+  }
+
+  size_t mapping_size = static_cast<size_t>(info.st_size);
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, own_fd, 0);
+  if (mapping == MAP_FAILED) {
+    ::close(own_fd);
+    throw NDEFException("Unable to map ring fd: " + string{ strerror(errno) });
+  }
+
+  // Constructing the handle first means the mapping is released if validation fails
+  NDEFShmRing ring{ own_fd, mapping, mapping_size };
+  auto control = ring.control();
+  if (control->magic != ring_magic || control->version != ring_version ||
+      control->capacity + control_size != mapping_size) {
+    throw NDEFException("File descriptor does not hold an NDEF ring");
+  }
+
+  return ring;
+}
+
+NDEFShmRing::NDEFShmRing(int fd, void* mapping, size_t mapping_size)
+    : ring_fd(fd), mapping(mapping), mapping_size(mapping_size)
+{
+}
+
+NDEFShmRing::NDEFShmRing(NDEFShmRing&& other) noexcept { *this = std::move(other); }
+
+NDEFShmRing& NDEFShmRing::operator=(NDEFShmRing&& other) noexcept
+{
+  swap(this->ring_fd, other.ring_fd);
+  swap(this->mapping, other.mapping);
+  swap(this->mapping_size, other.mapping_size);
+  swap(this->open_entry, other.open_entry);
+  return *this;
+}
+
+NDEFShmRing::~NDEFShmRing()
+{
+  if (this->mapping) {
+    munmap(this->mapping, this->mapping_size);
+  }
+
+  if (this->ring_fd >= 0) {
+    ::close(this->ring_fd);
+  }
+}
+
+NDEFShmRing::Control* NDEFShmRing::control() const { return static_cast<Control*>(this->mapping); }
+uint8_t* NDEFShmRing::data() const { return static_cast<uint8_t*>(this->mapping) + control_size; }
+size_t NDEFShmRing::capacity() const { return this->control()->capacity; }
+
+/// Frames the message, then publishes it with its index
+bool NDEFShmRing::try_write(const uint8_t* data, size_t len)
+{
+  NDEFMessageView view{ data, len };
+  return this->try_write(view);
+}
+
+/// Copies the entry header, record index and message bytes into the ring in one contiguous run
+bool NDEFShmRing::try_write(const NDEFMessageView& view)
+{
+  auto control = this->control();
+  const uint64_t capacity = control->capacity;
+  const size_t count = view.record_count();
+  const size_t index_size = count * sizeof(IndexEntry);
+  const size_t needed = align_entry(sizeof(EntryHeader) + index_size + view.size());
+
+  if (needed > capacity) {
+    throw NDEFException("Message of " + to_string(view.size()) + " bytes does not fit in ring of " +
+                        to_string(capacity) + " bytes");
+  }
+
+  uint64_t tail = control->tail.load(memory_order_relaxed);
+  uint64_t head = control->head.load(memory_order_acquire);
+  size_t offset = tail & (capacity - 1);
+
+  // Entries never wrap, so the consumer always sees a contiguous message. Pad out the end of the ring if needed
+  size_t room = capacity - offset;
+  size_t padding = (needed > room) ? room : 0;
+
+  if (capacity - (tail - head) < padding + needed) {
+    return false;
+  }
+
+  if (padding > 0) {
+    EntryHeader pad{ static_cast<uint32_t>(padding), padding_entry, 0, 0 };
+    memcpy(this->data() + offset, &pad, sizeof(pad));
+    tail += padding;
+    offset = 0;
+  }
+
+  uint8_t* entry = this->data() + offset;
+  EntryHeader header{ static_cast<uint32_t>(needed), static_cast<uint32_t>(view.size()), static_cast<uint32_t>(count),
+                      0 };
+  memcpy(entry, &header, sizeof(header));
+
+  auto index = reinterpret_cast<IndexEntry*>(entry + sizeof(EntryHeader));
+  for (size_t i = 0; i < count; i++) {
+    auto record = view.record(i);
+    const auto& layout = record.layout();
+
+    index[i] = IndexEntry{ static_cast<uint32_t>(record.data() - view.data()), layout.payload_length, record.data()[0],
+                           static_cast<uint8_t>(layout.type_offset), layout.type_length, layout.id_length };
+  }
+
+  memcpy(entry + sizeof(EntryHeader) + index_size, view.data(), view.size());
+
+  control->tail.store(tail + needed, memory_order_release);
+  signal(control->data_seq, control->data_waiters);
+  return true;
+}
+
+/// Retries the write whenever the consumer frees space
+bool NDEFShmRing::write(const NDEFMessageView& view, int timeout_ms)
+{
+  auto control = this->control();
+  return wait_for(
+      control->space_seq, control->space_waiters, timeout_ms, [&]() { return this->try_write(view); },
+      []() { return false; });
+}
+
+/// Flags the ring closed and wakes the consumer so it can notice
+void NDEFShmRing::close()
+{
+  auto control = this->control();
+  control->closed.store(1);
+  signal(control->data_seq, control->data_waiters);
+}
+
+/// Skips padding, then rebuilds the view of the next message from its precomputed index
+bool NDEFShmRing::try_read(NDEFMessageView& view)
+{
+  if (this->open_entry != 0) {
+    throw NDEFException("Previous ring entry must be released before reading the next");
+  }
+
+  auto control = this->control();
+  const uint64_t capacity = control->capacity;
+  uint64_t head = control->head.load(memory_order_relaxed);
+  const uint64_t tail = control->tail.load(memory_order_acquire);
+
+  while (head != tail) {
+    const uint64_t offset = head & (capacity - 1);
+    uint8_t* entry = this->data() + offset;
+    EntryHeader header;
+    memcpy(&header, entry, sizeof(header));
+
+    // The producer side of the mapping is not trusted, nothing is read outside the published entry
+    if (header.entry_length < sizeof(EntryHeader) || header.entry_length % entry_alignment != 0 ||
+        header.entry_length > tail - head || header.entry_length > capacity - offset) {
+      throw NDEFException("Corrupt ring entry of " + to_string(header.entry_length) + " bytes");
+    }
+
+    if (header.message_length == padding_entry) {
+      head += header.entry_length;
+      control->head.store(head, memory_order_release);
+      continue;
+    }
+
+    if (uint64_t{ header.record_count } * sizeof(IndexEntry) + header.message_length >
+        header.entry_length - sizeof(EntryHeader)) {
+      throw NDEFException("Ring entry index and message overrun the entry");
+    }
+
+    auto index = reinterpret_cast<const IndexEntry*>(entry + sizeof(EntryHeader));
+    const uint8_t* message = entry + sizeof(EntryHeader) + header.record_count * sizeof(IndexEntry);
+
+    view.open_indexed(message, header.message_length);
+    for (size_t i = 0; i < header.record_count; i++) {
+      NDEFRecordLayout layout;
+      layout.header = NDEFRecordHeader::from_byte(index[i].header);
+      layout.type_offset = index[i].type_offset;
+      layout.type_length = index[i].type_length;
+      layout.id_offset = layout.type_offset + layout.type_length;
+      layout.id_length = index[i].id_length;
+      layout.payload_offset = layout.id_offset + layout.id_length;
+      layout.payload_length = index[i].payload_length;
+      layout.total_length = layout.payload_offset + layout.payload_length;
+
+      if (index[i].offset > header.message_length ||
+          uint64_t{ layout.total_length } > header.message_length - index[i].offset) {
+        throw NDEFException("Ring record index entry " + to_string(i) + " lies outside its message");
+      }
+
+      view.add_record(index[i].offset, layout);
+    }
+
+    this->open_entry = header.entry_length;
+    return true;
+  }
+
+  return false;
+}
+
+/// Retries the read whenever the producer publishes, giving up once the ring is closed and drained
+bool NDEFShmRing::read(NDEFMessageView& view, int timeout_ms)
+{
+  auto control = this->control();
+  return wait_for(
+      control->data_seq, control->data_waiters, timeout_ms, [&]() { return this->try_read(view); },
+      [&]() { return control->closed.load() != 0 && control->head.load() == control->tail.load(); });
+}
+
+/// Hands the space of the open entry back to the producer
+void NDEFShmRing::release()
+{
+  if (this->open_entry == 0) {
+    return;
+  }
+
+  auto control = this->control();
+  control->head.store(control->head.load(memory_order_relaxed) + this->open_entry, memory_order_release);
+  this->open_entry = 0;
+  signal(control->space_seq, control->space_waiters);
+}
+
+#endif // __linux__
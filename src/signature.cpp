@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/signature.hpp"
+
+using namespace std;
+
+namespace {
+/// Signature RTD version written and accepted
+const uint8_t signature_version = 0x20;
+
+const uint32_t round_constants[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t value, unsigned bits) { return (value >> bits) | (value << (32 - bits)); }
+
+/// Reads a big endian 16 bit length field, throwing if the payload ends first
+uint16_t read_length(ByteSpan payload, size_t& pos, const char* field)
+{
+  if (payload.size - pos < 2) {
+    throw NDEFException(string{ "Signature record ends before the " } + field + " length");
+  }
+
+  uint16_t length = static_cast<uint16_t>((payload.data[pos] << 8) | payload.data[pos + 1]);
+  pos += 2;
+  return length;
+}
+
+/// Returns the next \p length bytes of the payload, throwing if the payload ends first
+ByteSpan read_field(ByteSpan payload, size_t& pos, size_t length, const char* field)
+{
+  if (payload.size - pos < length) {
+    throw NDEFException(string{ "Signature record " } + field + " of " + to_string(length) + " bytes is truncated");
+  }
+
+  ByteSpan span{ payload.data + pos, length };
+  pos += length;
+  return span;
+}
+
+/// Appends \p bytes preceded by its 16 bit length
+void append_field(vector<uint8_t>& payload, const vector<uint8_t>& bytes, const char* field)
+{
+  if (bytes.size() > UINT16_MAX) {
+    throw NDEFException(string{ "Signature record " } + field + " of " + to_string(bytes.size()) +
+                        " bytes is too long");
+  }
+
+  payload.push_back(static_cast<uint8_t>(bytes.size() >> 8));
+  payload.push_back(static_cast<uint8_t>(bytes.size()));
+  payload.insert(payload.end(), bytes.begin(), bytes.end());
+}
+
+/// Compares without exiting early, so the time taken does not reveal how much of a MAC matched
+bool constant_time_equal(const uint8_t* lhs, const uint8_t* rhs, size_t len)
+{
+  uint8_t difference = 0;
+  for (size_t i = 0; i < len; i++) {
+    difference |= lhs[i] ^ rhs[i];
+  }
+  return difference == 0;
+}
+
+/// Status of the Signature record at \p index, which covers records [first, index)
+SignatureStatus check_signature(const NDEFMessageView& view, size_t first, size_t index,
+                                const NDEFSignatureVerifier& verifier)
+{
+  NDEFSignature signature;
+  try {
+    signature = NDEFSignature::parse(view.record(index).payload());
+  } catch (const NDEFException&) {
+    return SignatureStatus::Malformed;
+  }
+
+  if (signature.hash_type != signature_hash_sha256 || signature.signature_is_uri ||
+      !verifier.supports(signature.signature_type)) {
+    return SignatureStatus::Unsupported;
+  }
+
+  uint8_t digest[NDEFSha256::digest_size];
+  signature_digest(view, first, index, digest);
+
+  return verifier.verify(signature, digest) ? SignatureStatus::Valid : SignatureStatus::Invalid;
+}
+
+/// Calls \p handler with the index of each Signature record and the first record it covers. A marker record, which
+/// has Signature Type None, only moves the start of the next covered range
+template <typename Handler>
+void for_each_signature(const NDEFMessageView& view, Handler handler)
+{
+  size_t first = 0;
+
+  for (size_t i = 0; i < view.record_count(); i++) {
+    auto record = view.record(i);
+    if (!is_signature_record(record)) {
+      continue;
+    }
+
+    auto payload = record.payload();
+    bool marker = payload.size >= 2 && (payload.data[1] & 0x7F) == static_cast<uint8_t>(SignatureType::None);
+
+    if (!marker && !handler(first, i)) {
+      return;
+    }
+
+    first = i + 1;
+  }
+}
+} // namespace
+
+constexpr size_t NDEFSha256::digest_size;
+
+void NDEFSha256::reset()
+{
+  const uint32_t initial[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  memcpy(this->state, initial, sizeof(initial));
+  this->total_length = 0;
+  this->block_length = 0;
+}
+
+/// Compresses whole blocks straight from \p data, buffering only the partial blocks at either end
+void NDEFSha256::update(const uint8_t* data, size_t len)
+{
+  this->total_length += len;
+
+  if (this->block_length > 0) {
+    size_t take = min(len, sizeof(this->block) - this->block_length);
+    memcpy(this->block + this->block_length, data, take);
+    this->block_length += take;
+    data += take;
+    len -= take;
+
+    if (this->block_length < sizeof(this->block)) {
+      return;
+    }
+
+    this->compress(this->block);
+    this->block_length = 0;
+  }
+
+  for (; len >= sizeof(this->block); data += sizeof(this->block), len -= sizeof(this->block)) {
+    this->compress(data);
+  }
+
+  if (len > 0) {
+    memcpy(this->block, data, len);
+    this->block_length = len;
+  }
+}
+
+void NDEFSha256::finish(uint8_t out[digest_size])
+{
+  uint64_t bit_length = this->total_length * 8;
+
+  // Terminating bit, then zeros up to the 8 byte length at the end of a block
+  uint8_t padding[72] = { 0x80 };
+  size_t pad_length = (this->block_length < 56 ? 56 : 120) - this->block_length;
+  for (int i = 0; i < 8; i++) {
+    padding[pad_length + i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+  }
+  this->update(padding, pad_length + 8);
+
+  for (int i = 0; i < 8; i++) {
+    out[4 * i] = static_cast<uint8_t>(this->state[i] >> 24);
+    out[4 * i + 1] = static_cast<uint8_t>(this->state[i] >> 16);
+    out[4 * i + 2] = static_cast<uint8_t>(this->state[i] >> 8);
+    out[4 * i + 3] = static_cast<uint8_t>(this->state[i]);
+  }
+}
+
+void NDEFSha256::compress(const uint8_t* chunk)
+{
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (static_cast<uint32_t>(chunk[4 * i]) << 24) | (static_cast<uint32_t>(chunk[4 * i + 1]) << 16) |
+           (static_cast<uint32_t>(chunk[4 * i + 2]) << 8) | static_cast<uint32_t>(chunk[4 * i + 3]);
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t a = this->state[0], b = this->state[1], c = this->state[2], d = this->state[3];
+  uint32_t e = this->state[4], f = this->state[5], g = this->state[6], h = this->state[7];
+
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + round_constants[i] + w[i];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  this->state[0] += a;
+  this->state[1] += b;
+  this->state[2] += c;
+  this->state[3] += d;
+  this->state[4] += e;
+  this->state[5] += f;
+  this->state[6] += g;
+  this->state[7] += h;
+}
+
+NDEFSignature NDEFSignature::parse(ByteSpan payload)
+{
+  if (payload.size < 3) {
+    throw NDEFException("Signature record of " + to_string(payload.size) + " bytes is too short");
+  }
+
+  NDEFSignature signature;
+  signature.version = payload.data[0];
+  if (signature.version != signature_version) {
+    throw NDEFException("Unsupported Signature record version " + to_string(signature.version));
+  }
+
+  signature.signature_is_uri = (payload.data[1] & 0x80) != 0;
+  signature.signature_type = payload.data[1] & 0x7F;
+  signature.hash_type = payload.data[2];
+
+  size_t pos = 3;
+  uint16_t signature_length = read_length(payload, pos, "signature");
+  signature.signature = read_field(payload, pos, signature_length, "signature");
+
+  // The certificate chain is optional
+  signature.certificate_format = 0;
+  signature.certificate_uri = ByteSpan{ nullptr, 0 };
+  if (pos == payload.size) {
+    return signature;
+  }
+
+  uint8_t chain = payload.data[pos++];
+  signature.certificate_format = (chain >> 4) & 0x07;
+
+  size_t certificate_count = chain & 0x0F;
+  signature.certificates.reserve(certificate_count);
+  for (size_t i = 0; i < certificate_count; i++) {
+    uint16_t length = read_length(payload, pos, "certificate");
+    signature.certificates.push_back(read_field(payload, pos, length, "certificate"));
+  }
+
+  if (chain & 0x80) {
+    uint16_t length = read_length(payload, pos, "certificate URI");
+    signature.certificate_uri = read_field(payload, pos, length, "certificate URI");
+  }
+
+  return signature;
+}
+
+NDEFRecord NDEFSignature::create_record(uint8_t signature_type, const vector<uint8_t>& signature,
+                                        const vector<vector<uint8_t>>& certificates, uint8_t certificate_format)
+{
+  if (certificates.size() > 15) {
+    throw NDEFException("Signature record can hold at most 15 certificates, not " + to_string(certificates.size()));
+  }
+
+  vector<uint8_t> payload{ signature_version, static_cast<uint8_t>(signature_type & 0x7F), signature_hash_sha256 };
+  append_field(payload, signature, "signature");
+
+  if (!certificates.empty()) {
+    payload.push_back(static_cast<uint8_t>(((certificate_format & 0x07) << 4) | certificates.size()));
+    for (auto&& certificate : certificates) {
+      append_field(payload, certificate, "certificate");
+    }
+  }
+
+  return NDEFRecord{ payload, NDEFRecordType{ NDEFRecordType::TypeID::WellKnown, "Sig" } };
+}
+
+/// Precomputes the padded key blocks so that each MAC only hashes the message
+NDEFHmacVerifier::NDEFHmacVerifier(const vector<uint8_t>& key, uint8_t signature_type) : type(signature_type & 0x7F)
+{
+  uint8_t key_block[64] = {};
+
+  // Keys longer than a block are hashed first
+  if (key.size() > sizeof(key_block)) {
+    NDEFSha256 hash;
+    hash.update(key.data(), key.size());
+    hash.finish(key_block);
+  } else if (!key.empty()) {
+    memcpy(key_block, key.data(), key.size());
+  }
+
+  for (size_t i = 0; i < sizeof(key_block); i++) {
+    this->inner_pad[i] = key_block[i] ^ 0x36;
+    this->outer_pad[i] = key_block[i] ^ 0x5C;
+  }
+}
+
+void NDEFHmacVerifier::mac(const uint8_t* data, size_t len, uint8_t out[NDEFSha256::digest_size]) const
+{
+  uint8_t inner[NDEFSha256::digest_size];
+
+  NDEFSha256 hash;
+  hash.update(this->inner_pad, sizeof(this->inner_pad));
+  hash.update(data, len);
+  hash.finish(inner);
+
+  hash.reset();
+  hash.update(this->outer_pad, sizeof(this->outer_pad));
+  hash.update(inner, sizeof(inner));
+  hash.finish(out);
+}
+
+/// The signature is the HMAC of the covered records' digest
+bool NDEFHmacVerifier::verify(const NDEFSignature& signature, const uint8_t digest[NDEFSha256::digest_size]) const
+{
+  if (signature.signature.size != NDEFSha256::digest_size) {
+    return false;
+  }
+
+  uint8_t expected[NDEFSha256::digest_size];
+  this->mac(digest, NDEFSha256::digest_size, expected);
+  return constant_time_equal(expected, signature.signature.data, sizeof(expected));
+}
+
+NDEFRecord NDEFHmacVerifier::sign(const NDEFMessage& msg) const
+{
+  auto bytes = msg.as_bytes();
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  // Cover everything after the last Signature record, marker or not
+  size_t first = 0;
+  for (size_t i = 0; i < view.record_count(); i++) {
+    if (is_signature_record(view.record(i))) {
+      first = i + 1;
+    }
+  }
+
+  if (first == view.record_count()) {
+    throw NDEFException("Message has no unsigned records to sign");
+  }
+
+  uint8_t digest[NDEFSha256::digest_size];
+  signature_digest(view, first, view.record_count(), digest);
+
+  vector<uint8_t> signature(NDEFSha256::digest_size);
+  this->mac(digest, sizeof(digest), signature.data());
+
+  return NDEFSignature::create_record(this->type, signature);
+}
+
+bool is_signature_record(const NDEFRecordView& record)
+{
+  return record.tnf() == NDEFRecordType::TypeID::WellKnown && record.type() == "Sig";
+}
+
+/// Streams each record from the byte after its header flags to the end of its payload
+void signature_digest(const NDEFMessageView& view, size_t first, size_t last, uint8_t out[NDEFSha256::digest_size])
+{
+  NDEFSha256 hash;
+
+  for (size_t i = first; i < last; i++) {
+    auto bytes = view.record(i).bytes();
+    hash.update(bytes.data + 1, bytes.size - 1);
+  }
+
+  hash.finish(out);
+}
+
+vector<SignatureStatus> verify_signatures(const NDEFMessageView& view, const NDEFSignatureVerifier& verifier)
+{
+  vector<SignatureStatus> results;
+
+  for_each_signature(view, [&](size_t first, size_t index) {
+    results.push_back(check_signature(view, first, index, verifier));
+    return true;
+  });
+
+  return results;
+}
+
+/// Stops at the first signature that does not verify. Records appended after the last signature would otherwise pass
+/// unnoticed, so they keep the message from being Valid
+SignatureStatus verify_message(const NDEFMessageView& view, const NDEFSignatureVerifier& verifier)
+{
+  SignatureStatus result = SignatureStatus::Unsigned;
+  size_t covered = 0;
+
+  for_each_signature(view, [&](size_t first, size_t index) {
+    result = check_signature(view, first, index, verifier);
+    covered = index + 1;
+    return result == SignatureStatus::Valid;
+  });
+
+  if (result == SignatureStatus::Valid && covered < view.record_count()) {
+    return SignatureStatus::PartiallySigned;
+  }
+
+  return result;
+}
+
+/// Threads claim messages from a shared counter so that a few large messages do not leave the other threads idle
+vector<SignatureStatus> verify_messages(const vector<NDEFMessageView>& messages, const NDEFSignatureVerifier& verifier,
+                                       size_t threads)
+{
+  vector<SignatureStatus> results(messages.size(), SignatureStatus::Unsigned);
+
+  if (threads == 0) {
+    threads = max(1u, thread::hardware_concurrency());
+  }
+  threads = min(threads, messages.size());
+
+  atomic<size_t> next{ 0 };
+  exception_ptr error;
+  once_flag error_flag;
+
+  auto work = [&]() {
+    try {
+      for (size_t i = next++; i < messages.size(); i = next++) {
+        results[i] = verify_message(messages[i], verifier);
+      }
+    } catch (...) {
+      call_once(error_flag, [&error]() { error = current_exception(); });
+
+      // Let the other threads run out of work
+      next = messages.size();
+    }
+  };
+
+  // The calling thread takes a share of the work rather than waiting idle
+  vector<thread> pool;
+  for (size_t i = 1; i < threads; i++) {
+    pool.emplace_back(work);
+  }
+  work();
+
+  for (auto&& worker : pool) {
+    worker.join();
+  }
+
+  if (error) {
+    rethrow_exception(error);
+  }
+
+  return results;
+}
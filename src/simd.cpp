@@ -0,0 +1,604 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NDEF_LITE_SIMD_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#define NDEF_LITE_SIMD_NEON 1
+#endif
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/simd.hpp"
+
+using namespace std;
+
+namespace {
+// --- Scalar ---
+
+size_t find_byte_scalar(const uint8_t* data, size_t len, uint8_t byte)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == byte) {
+      return i;
+    }
+  }
+
+  return len;
+}
+
+size_t ascii_length_scalar(const uint8_t* data, size_t len)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] & 0x80) {
+      return i;
+    }
+  }
+
+  return len;
+}
+
+size_t find_substring_scalar(const uint8_t* data, size_t len, const uint8_t* pattern, size_t pattern_len)
+{
+  if (pattern_len == 0) {
+    return 0;
+  }
+  if (pattern_len > len) {
+    return len;
+  }
+
+  // Every start position up to and including the last one the whole pattern still fits at
+  const size_t starts = len - pattern_len + 1;
+  for (size_t i = 0; i < starts; i++) {
+    i += find_byte_scalar(data + i, starts - i, pattern[0]);
+    if (i < starts && memcmp(data + i + 1, pattern + 1, pattern_len - 1) == 0) {
+      return i;
+    }
+  }
+
+  return len;
+}
+
+size_t widen_ascii_scalar(const uint8_t* src, size_t len, char16_t* dst)
+{
+  size_t i = 0;
+  for (; i < len && !(src[i] & 0x80); i++) {
+    dst[i] = src[i];
+  }
+
+  return i;
+}
+
+size_t narrow_ascii_scalar(const char16_t* src, size_t len, uint8_t* dst)
+{
+  size_t i = 0;
+  for (; i < len && src[i] < 0x80; i++) {
+    dst[i] = static_cast<uint8_t>(src[i]);
+  }
+
+  return i;
+}
+
+const simd::Kernels scalar_kernels{ simd::Level::Scalar, find_byte_scalar, find_substring_scalar, ascii_length_scalar,
+                                    widen_ascii_scalar, narrow_ascii_scalar };
+
+#ifdef NDEF_LITE_SIMD_X86
+// Each kernel is compiled for its own instruction set through the target attribute, so the rest of the library keeps
+// the baseline flags and only runs these once the CPU is known to support them. Every kernel hands the bytes that do
+// not fill a whole vector to the next narrower kernel.
+//
+// The substring kernels compare a vector of start positions against the first byte of the pattern, and the vector at
+// the same positions shifted by the pattern length against its last byte. Only positions where both match are checked
+// with memcmp, so ordinary data rarely leaves the vector loop
+
+// --- SSE2 ---
+
+__attribute__((target("sse2"))) size_t find_byte_sse2(const uint8_t* data, size_t len, uint8_t byte)
+{
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return i + find_byte_scalar(data + i, len - i, byte);
+}
+
+__attribute__((target("sse2"))) size_t find_substring_sse2(const uint8_t* data, size_t len, const uint8_t* pattern,
+                                                           size_t pattern_len)
+{
+  if (pattern_len < 2) {
+    return (pattern_len == 0) ? 0 : find_byte_sse2(data, len, pattern[0]);
+  }
+
+  const __m128i first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+  const __m128i last = _mm_set1_epi8(static_cast<char>(pattern[pattern_len - 1]));
+  size_t i = 0;
+
+  for (; i + pattern_len - 1 + 16 <= len; i += 16) {
+    const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern_len - 1));
+    auto mask = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last))));
+
+    for (; mask != 0; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (memcmp(data + pos + 1, pattern + 1, pattern_len - 2) == 0) {
+        return pos;
+      }
+    }
+  }
+
+  return i + find_substring_scalar(data + i, len - i, pattern, pattern_len);
+}
+
+__attribute__((target("sse2"))) size_t ascii_length_sse2(const uint8_t* data, size_t len)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return i + ascii_length_scalar(data + i, len - i);
+}
+
+__attribute__((target("sse2"))) size_t widen_ascii_sse2(const uint8_t* src, size_t len, char16_t* dst)
+{
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (_mm_movemask_epi8(block) != 0) {
+      break;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(block, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(block, zero));
+  }
+
+  return i + widen_ascii_scalar(src + i, len - i, dst + i);
+}
+
+__attribute__((target("sse2"))) size_t narrow_ascii_sse2(const char16_t* src, size_t len, uint8_t* dst)
+{
+  const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    const __m128i bits = _mm_and_si128(_mm_or_si128(low, high), non_ascii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())) != 0xFFFF) {
+      break;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+  }
+
+  return i + narrow_ascii_scalar(src + i, len - i, dst + i);
+}
+
+const simd::Kernels sse2_kernels{ simd::Level::SSE2, find_byte_sse2, find_substring_sse2, ascii_length_sse2,
+                                  widen_ascii_sse2, narrow_ascii_sse2 };
+
+// --- AVX2 ---
+
+__attribute__((target("avx2"))) size_t find_byte_avx2(const uint8_t* data, size_t len, uint8_t byte)
+{
+  const __m256i needle = _mm256_set1_epi8(static_cast<char>(byte));
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return i + find_byte_sse2(data + i, len - i, byte);
+}
+
+__attribute__((target("avx2"))) size_t find_substring_avx2(const uint8_t* data, size_t len, const uint8_t* pattern,
+                                                           size_t pattern_len)
+{
+  if (pattern_len < 2) {
+    return (pattern_len == 0) ? 0 : find_byte_avx2(data, len, pattern[0]);
+  }
+
+  const __m256i first = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+  const __m256i last = _mm256_set1_epi8(static_cast<char>(pattern[pattern_len - 1]));
+  size_t i = 0;
+
+  for (; i + pattern_len - 1 + 32 <= len; i += 32) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern_len - 1));
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last))));
+
+    for (; mask != 0; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (memcmp(data + pos + 1, pattern + 1, pattern_len - 2) == 0) {
+        return pos;
+      }
+    }
+  }
+
+  return i + find_substring_sse2(data + i, len - i, pattern, pattern_len);
+}
+
+__attribute__((target("avx2"))) size_t ascii_length_avx2(const uint8_t* data, size_t len)
+{
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(block));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return i + ascii_length_sse2(data + i, len - i);
+}
+
+__attribute__((target("avx2"))) size_t widen_ascii_avx2(const uint8_t* src, size_t len, char16_t* dst)
+{
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    if (_mm256_movemask_epi8(block) != 0) {
+      break;
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16),
+                        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1)));
+  }
+
+  return i + widen_ascii_sse2(src + i, len - i, dst + i);
+}
+
+__attribute__((target("avx2"))) size_t narrow_ascii_avx2(const char16_t* src, size_t len, uint8_t* dst)
+{
+  const __m256i non_ascii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(low, high), non_ascii)) {
+      break;
+    }
+
+    // Packing works within each 128 bit lane, so the middle quarters come out swapped
+    const __m256i packed = _mm256_packus_epi16(low, high);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+
+  return i + narrow_ascii_sse2(src + i, len - i, dst + i);
+}
+
+const simd::Kernels avx2_kernels{ simd::Level::AVX2, find_byte_avx2, find_substring_avx2, ascii_length_avx2,
+                                  widen_ascii_avx2, narrow_ascii_avx2 };
+
+// --- AVX-512 ---
+
+__attribute__((target("avx512f,avx512bw"))) size_t find_byte_avx512(const uint8_t* data, size_t len, uint8_t byte)
+{
+  const __m512i needle = _mm512_set1_epi8(static_cast<char>(byte));
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    const __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), needle);
+    if (mask != 0) {
+      return i + __builtin_ctzll(mask);
+    }
+  }
+
+  return i + find_byte_avx2(data + i, len - i, byte);
+}
+
+__attribute__((target("avx512f,avx512bw"))) size_t find_substring_avx512(const uint8_t* data, size_t len,
+                                                                         const uint8_t* pattern, size_t pattern_len)
+{
+  if (pattern_len < 2) {
+    return (pattern_len == 0) ? 0 : find_byte_avx512(data, len, pattern[0]);
+  }
+
+  const __m512i first = _mm512_set1_epi8(static_cast<char>(pattern[0]));
+  const __m512i last = _mm512_set1_epi8(static_cast<char>(pattern[pattern_len - 1]));
+  size_t i = 0;
+
+  for (; i + pattern_len - 1 + 64 <= len; i += 64) {
+    const __mmask64 first_mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), first);
+    auto mask = static_cast<uint64_t>(
+        _mm512_mask_cmpeq_epi8_mask(first_mask, _mm512_loadu_si512(data + i + pattern_len - 1), last));
+
+    for (; mask != 0; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctzll(mask);
+      if (memcmp(data + pos + 1, pattern + 1, pattern_len - 2) == 0) {
+        return pos;
+      }
+    }
+  }
+
+  return i + find_substring_avx2(data + i, len - i, pattern, pattern_len);
+}
+
+__attribute__((target("avx512f,avx512bw"))) size_t ascii_length_avx512(const uint8_t* data, size_t len)
+{
+  size_t i = 0;
+
+  for (; i + 64 <= len; i += 64) {
+    const __mmask64 mask = _mm512_movepi8_mask(_mm512_loadu_si512(data + i));
+    if (mask != 0) {
+      return i + __builtin_ctzll(mask);
+    }
+  }
+
+  return i + ascii_length_avx2(data + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) size_t widen_ascii_avx512(const uint8_t* src, size_t len, char16_t* dst)
+{
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    if (_mm256_movemask_epi8(block) != 0) {
+      break;
+    }
+
+    _mm512_storeu_si512(dst + i, _mm512_cvtepu8_epi16(block));
+  }
+
+  return i + widen_ascii_avx2(src + i, len - i, dst + i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) size_t narrow_ascii_avx512(const char16_t* src, size_t len, uint8_t* dst)
+{
+  const __m512i non_ascii = _mm512_set1_epi16(static_cast<short>(0xFF80));
+  size_t i = 0;
+
+  for (; i + 32 <= len; i += 32) {
+    const __m512i block = _mm512_loadu_si512(src + i);
+    if (_mm512_test_epi16_mask(block, non_ascii) != 0) {
+      break;
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi16_epi8(block));
+  }
+
+  return i + narrow_ascii_avx2(src + i, len - i, dst + i);
+}
+
+const simd::Kernels avx512_kernels{ simd::Level::AVX512, find_byte_avx512, find_substring_avx512, ascii_length_avx512,
+                                    widen_ascii_avx512, narrow_ascii_avx512 };
+#endif // NDEF_LITE_SIMD_X86
+
+#ifdef NDEF_LITE_SIMD_NEON
+// --- NEON ---
+
+size_t find_byte_neon(const uint8_t* data, size_t len, uint8_t byte)
+{
+  const uint8x16_t needle = vdupq_n_u8(byte);
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    if (vmaxvq_u8(vceqq_u8(vld1q_u8(data + i), needle)) != 0) {
+      return i + find_byte_scalar(data + i, 16, byte);
+    }
+  }
+
+  return i + find_byte_scalar(data + i, len - i, byte);
+}
+
+size_t find_substring_neon(const uint8_t* data, size_t len, const uint8_t* pattern, size_t pattern_len)
+{
+  if (pattern_len < 2) {
+    return (pattern_len == 0) ? 0 : find_byte_neon(data, len, pattern[0]);
+  }
+
+  const uint8x16_t first = vdupq_n_u8(pattern[0]);
+  const uint8x16_t last = vdupq_n_u8(pattern[pattern_len - 1]);
+  size_t i = 0;
+
+  for (; i + pattern_len - 1 + 16 <= len; i += 16) {
+    const uint8x16_t candidates =
+        vandq_u8(vceqq_u8(vld1q_u8(data + i), first), vceqq_u8(vld1q_u8(data + i + pattern_len - 1), last));
+    if (vmaxvq_u8(candidates) == 0) {
+      continue;
+    }
+
+    // NEON has no movemask, so the few blocks holding a candidate are checked position by position
+    for (size_t pos = i; pos < i + 16; pos++) {
+      if (data[pos] == pattern[0] && memcmp(data + pos + 1, pattern + 1, pattern_len - 1) == 0) {
+        return pos;
+      }
+    }
+  }
+
+  return i + find_substring_scalar(data + i, len - i, pattern, pattern_len);
+}
+
+size_t ascii_length_neon(const uint8_t* data, size_t len)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    if (vmaxvq_u8(vld1q_u8(data + i)) >= 0x80) {
+      return i + ascii_length_scalar(data + i, 16);
+    }
+  }
+
+  return i + ascii_length_scalar(data + i, len - i);
+}
+
+size_t widen_ascii_neon(const uint8_t* src, size_t len, char16_t* dst)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const uint8x16_t block = vld1q_u8(src + i);
+    if (vmaxvq_u8(block) >= 0x80) {
+      break;
+    }
+
+    vst1q_u16(reinterpret_cast<uint16_t*>(dst + i), vmovl_u8(vget_low_u8(block)));
+    vst1q_u16(reinterpret_cast<uint16_t*>(dst + i + 8), vmovl_high_u8(block));
+  }
+
+  return i + widen_ascii_scalar(src + i, len - i, dst + i);
+}
+
+size_t narrow_ascii_neon(const char16_t* src, size_t len, uint8_t* dst)
+{
+  size_t i = 0;
+
+  for (; i + 16 <= len; i += 16) {
+    const uint16x8_t low = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i));
+    const uint16x8_t high = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i + 8));
+    if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80) {
+      break;
+    }
+
+    vst1q_u8(dst + i, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+  }
+
+  return i + narrow_ascii_scalar(src + i, len - i, dst + i);
+}
+
+const simd::Kernels neon_kernels{ simd::Level::NEON, find_byte_neon, find_substring_neon, ascii_length_neon,
+                                  widen_ascii_neon, narrow_ascii_neon };
+#endif // NDEF_LITE_SIMD_NEON
+
+/// \return kernels for \p level, or nullptr if this build has none or the running CPU lacks the instructions
+const simd::Kernels* kernels_for(simd::Level level)
+{
+#ifdef NDEF_LITE_SIMD_X86
+  // Detection may run from a static initializer, before libgcc has initialized its CPU model
+  __builtin_cpu_init();
+#endif
+
+  switch (level) {
+  case simd::Level::Scalar:
+    return &scalar_kernels;
+#ifdef NDEF_LITE_SIMD_X86
+  case simd::Level::SSE2:
+    return __builtin_cpu_supports("sse2") ? &sse2_kernels : nullptr;
+  case simd::Level::AVX2:
+    return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+  case simd::Level::AVX512:
+    return (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) ? &avx512_kernels : nullptr;
+#endif
+#ifdef NDEF_LITE_SIMD_NEON
+  case simd::Level::NEON:
+    return (getauxval(AT_HWCAP) & HWCAP_ASIMD) ? &neon_kernels : nullptr;
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+const simd::Level all_levels[] = { simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512,
+                                   simd::Level::NEON };
+
+/// Level chosen on first use: NDEF_LITE_SIMD if it names a supported level, otherwise the widest supported level
+const simd::Kernels* default_kernels()
+{
+  static const simd::Kernels* const chosen = []() {
+    if (const char* forced = getenv("NDEF_LITE_SIMD")) {
+      for (auto level : all_levels) {
+        if (strcmp(forced, simd::level_name(level)) == 0 && kernels_for(level) != nullptr) {
+          return kernels_for(level);
+        }
+      }
+    }
+
+    return kernels_for(simd::detected_level());
+  }();
+
+  return chosen;
+}
+
+/// Kernels every call goes through, nullptr until the first call resolves them
+atomic<const simd::Kernels*> active_kernels{ nullptr };
+} // namespace
+
+namespace simd {
+const char* level_name(Level level)
+{
+  switch (level) {
+  case Level::Scalar:
+    return "scalar";
+  case Level::SSE2:
+    return "sse2";
+  case Level::AVX2:
+    return "avx2";
+  case Level::AVX512:
+    return "avx512";
+  case Level::NEON:
+    return "neon";
+  }
+
+  return "unknown";
+}
+
+Level detected_level()
+{
+  auto levels = supported_levels();
+  return levels.back();
+}
+
+vector<Level> supported_levels()
+{
+  vector<Level> levels;
+  for (auto level : all_levels) {
+    if (kernels_for(level) != nullptr) {
+      levels.push_back(level);
+    }
+  }
+
+  return levels;
+}
+
+const Kernels& kernels()
+{
+  auto active = active_kernels.load(memory_order_acquire);
+  if (active == nullptr) {
+    // Only install the default if no level was forced in the meantime
+    const Kernels* resolved = default_kernels();
+    active = active_kernels.compare_exchange_strong(active, resolved, memory_order_acq_rel) ? resolved : active;
+  }
+
+  return *active;
+}
+
+void force_level(Level level)
+{
+  auto forced = kernels_for(level);
+  if (forced == nullptr) {
+    throw NDEFException(string{ "SIMD level not supported by this CPU: " } + level_name(level));
+  }
+
+  active_kernels.store(forced, memory_order_release);
+}
+
+void reset_level() { active_kernels.store(default_kernels(), memory_order_release); }
+} // namespace simd
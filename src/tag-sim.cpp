@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/tag-sim.hpp"
+
+using namespace std;
+
+namespace {
+/// Type 2 pages holding the UID, lock bytes and Capability Container
+const size_t type2_header_size = 16;
+const size_t type2_page_size = 4;
+const size_t type2_read_size = 16;
+const size_t type2_max_capacity = 255 * 8;
+
+/// Type 4 NDEF file starts with the 2 byte NLEN field
+const size_t type4_nlen_size = 2;
+const size_t type4_max_capacity = 0xFFFE;
+
+// Command framing overhead
+const size_t type2_read_command = 2;
+const size_t type2_write_command = 2;
+const size_t type2_ack = 1;
+const size_t apdu_header = 5;
+const size_t apdu_status = 2;
+
+/// UID reported by tags created without one, with the NXP manufacturer byte
+const vector<uint8_t> default_uid{ 0x04, 0x4E, 0x44, 0x45, 0x46, 0x4C, 0x54 };
+const size_t type2_uid_size = 7;
+
+// TLV tags found in the data area of a Type 2 tag
+const uint8_t tlv_null = 0x00;
+const uint8_t tlv_ndef_message = 0x03;
+const uint8_t tlv_terminator = 0xFE;
+
+/// Wraps an encoded message in an NDEF Message TLV followed by a Terminator TLV
+vector<uint8_t> ndef_tlv(const vector<uint8_t>& message)
+{
+  vector<uint8_t> tlv{ tlv_ndef_message };
+
+  if (message.size() < 0xFF) {
+    tlv.push_back(static_cast<uint8_t>(message.size()));
+  } else {
+    tlv.push_back(0xFF);
+    tlv.push_back(static_cast<uint8_t>(message.size() >> 8));
+    tlv.push_back(static_cast<uint8_t>(message.size()));
+  }
+
+  tlv.insert(tlv.end(), message.begin(), message.end());
+  tlv.push_back(tlv_terminator);
+  return tlv;
+}
+} // namespace
+
+/// Lays out an empty tag: a Capability Container and empty NDEF TLV for Type 2, a zero NLEN for Type 4
+NDEFSimulatedTag::NDEFSimulatedTag(NFCTagType type, size_t capacity, const vector<uint8_t>& uid)
+    : tag_type(type), data_capacity(capacity), tag_uid(uid.empty() ? default_uid : uid)
+{
+  if (type == NFCTagType::Type2) {
+    if (this->tag_uid.size() != type2_uid_size) {
+      throw NDEFException("Type 2 tag UID must be " + to_string(type2_uid_size) + " bytes, not " +
+                          to_string(this->tag_uid.size()));
+    }
+
+    this->data_capacity = (capacity + 7) & ~size_t{ 7 };
+    if (this->data_capacity > type2_max_capacity) {
+      throw NDEFException("Type 2 tag capacity of " + to_string(capacity) + " bytes exceeds maximum of " +
+                          to_string(type2_max_capacity));
+    }
+
+    this->tag_memory.assign(type2_header_size + this->data_capacity, 0);
+
+    copy(this->tag_uid.begin(), this->tag_uid.end(), this->tag_memory.begin());
+
+    // Capability Container: magic, version 1.0, data area size / 8, read/write access
+    this->tag_memory[12] = 0xE1;
+    this->tag_memory[13] = 0x10;
+    this->tag_memory[14] = static_cast<uint8_t>(this->data_capacity / 8);
+    this->tag_memory[15] = 0x00;
+
+    const uint8_t empty[] = { tlv_ndef_message, 0x00, tlv_terminator };
+    copy(begin(empty), end(empty), this->tag_memory.begin() + type2_header_size);
+  } else {
+    if (capacity > type4_max_capacity || capacity < type4_nlen_size) {
+      throw NDEFException("Type 4 tag capacity of " + to_string(capacity) + " bytes must be between " +
+                          to_string(type4_nlen_size) + " and " + to_string(type4_max_capacity));
+    }
+
+    this->tag_memory.assign(capacity, 0);
+  }
+}
+
+/// Encodes the message in the platform's framing and copies it into memory
+void NDEFSimulatedTag::store(const vector<uint8_t>& message)
+{
+  if (this->tag_type == NFCTagType::Type2) {
+    auto tlv = ndef_tlv(message);
+    if (tlv.size() > this->data_capacity) {
+      throw NDEFException("Message of " + to_string(message.size()) + " bytes does not fit on tag of " +
+                          to_string(this->data_capacity) + " bytes");
+    }
+
+    this->write(type2_header_size, tlv.data(), tlv.size());
+    return;
+  }
+
+  if (message.size() + type4_nlen_size > this->data_capacity) {
+    throw NDEFException("Message of " + to_string(message.size()) + " bytes does not fit on tag of " +
+                        to_string(this->data_capacity) + " bytes");
+  }
+
+  const uint8_t nlen[] = { static_cast<uint8_t>(message.size() >> 8), static_cast<uint8_t>(message.size()) };
+  this->write(0, nlen, type4_nlen_size);
+  this->write(type4_nlen_size, message.data(), message.size());
+}
+
+/// Copies bytes out of memory, padding with zeros past the end like an unwritten tag
+vector<uint8_t> NDEFSimulatedTag::read(size_t offset, size_t len) const
+{
+  vector<uint8_t> bytes(len, 0);
+
+  if (offset < this->tag_memory.size()) {
+    size_t available = min(len, this->tag_memory.size() - offset);
+    copy_n(this->tag_memory.begin() + offset, available, bytes.begin());
+  }
+
+  return bytes;
+}
+
+void NDEFSimulatedTag::write(size_t offset, const uint8_t* data, size_t len)
+{
+  // Have to provide bounds checking
+  if (offset + len > this->tag_memory.size()) {
+    throw std::out_of_range{ "Unable to write tag memory. Index " + to_string(offset + len) +
+                             " outside of range of tag" };
+  }
+
+  copy_n(data, len, this->tag_memory.begin() + offset);
+}
+
+NDEFSimulatedReader::NDEFSimulatedReader(NDEFSimulatedTag& tag, const NFCLinkProfile& profile)
+    : tag(tag), profile(profile), tear_generator(profile.seed)
+{
+  // The first Type 4 read has to reach past NLEN to make progress
+  if (tag.type() == NFCTagType::Type4 && profile.max_fragment <= type4_nlen_size) {
+    throw NDEFException("Type 4 fragment size must be larger than " + to_string(type4_nlen_size) + " bytes");
+  }
+}
+
+/// Charges the command to the virtual clock and rolls for a tear
+bool NDEFSimulatedReader::transceive(size_t sent, size_t received)
+{
+  uint64_t cost = this->profile.command_us + (sent + received) * uint64_t{ this->profile.byte_us };
+
+  this->link_stats.commands++;
+  this->link_stats.bytes += sent + received;
+  this->link_stats.elapsed_us += cost;
+
+  if (this->profile.real_time) {
+    this_thread::sleep_for(chrono::microseconds(cost));
+  }
+
+  bool torn = this->profile.tear_rate > 0.0 &&
+              uniform_real_distribution<double>{ 0.0, 1.0 }(this->tear_generator) < this->profile.tear_rate;
+  if (torn) {
+    this->link_stats.tears++;
+  }
+
+  return torn;
+}
+
+/// Issues a single READ (Type 2) or READ BINARY (Type 4) command
+vector<uint8_t> NDEFSimulatedReader::read_fragment(size_t offset, size_t len)
+{
+  bool torn = (this->tag.type() == NFCTagType::Type2)
+                  ? this->transceive(type2_read_command, type2_read_size)
+                  : this->transceive(apdu_header, len + apdu_status);
+
+  if (torn) {
+    throw NDEFException("Tag left the field while reading byte " + to_string(offset));
+  }
+
+  return this->tag.read(offset, (this->tag.type() == NFCTagType::Type2) ? type2_read_size : len);
+}
+
+/// Issues WRITE (Type 2, one page each) or UPDATE BINARY (Type 4) commands. A torn command writes nothing
+void NDEFSimulatedReader::write_fragments(size_t offset, const uint8_t* data, size_t len)
+{
+  size_t step = (this->tag.type() == NFCTagType::Type2) ? type2_page_size : this->profile.max_fragment;
+
+  for (size_t pos = 0; pos < len; pos += step) {
+    size_t n = min(step, len - pos);
+    bool torn = (this->tag.type() == NFCTagType::Type2)
+                    ? this->transceive(type2_write_command + type2_page_size, type2_ack)
+                    : this->transceive(apdu_header + n, apdu_status);
+
+    if (torn) {
+      throw NDEFException("Tag left the field while writing byte " + to_string(offset + pos));
+    }
+
+    this->tag.write(offset + pos, data + pos, n);
+  }
+}
+
+/// Decodes each fragment as soon as it arrives so parsing overlaps the RF link
+bool NDEFSimulatedReader::consume(NDEFReadSession& session)
+{
+  size_t available = min(session.bytes.size() - session.message_offset, session.message_length);
+  if (available > session.fed) {
+    session.parser.feed(session.bytes.data() + session.message_offset + session.fed, available - session.fed);
+    session.fed = available;
+  }
+
+  return session.parser.decode() == DecodeStatus::Complete;
+}
+
+NDEFMessage NDEFSimulatedReader::read_message()
+{
+  NDEFReadSession session;
+  return this->read_session(session);
+}
+
+/// Picks up the tag's session if it still matches the tag, and keeps whatever a torn read got for the next tap
+NDEFMessage NDEFSimulatedReader::read_message(NDEFReadSessionCache& sessions)
+{
+  NDEFReadSession session;
+  const bool resuming = sessions.take(this->tag.uid(), session);
+  const uint64_t tears = this->link_stats.tears;
+
+  try {
+    if (resuming && !this->resume(session, sessions.overlap())) {
+      // The tag was rewritten since, nothing read before can be trusted
+      sessions.mismatched();
+      session = NDEFReadSession{};
+    }
+
+    return this->read_session(session);
+  } catch (const NDEFException&) {
+    // Malformed tags would fail the same way again, only torn reads are worth resuming
+    if (this->link_stats.tears != tears) {
+      sessions.store(this->tag.uid(), std::move(session));
+    }
+    throw;
+  }
+}
+
+/// Starts the next read command early, so that a single command both checks the session and makes progress
+bool NDEFSimulatedReader::resume(NDEFReadSession& session, size_t overlap)
+{
+  const size_t end = session.bytes.size();
+  size_t base = 0;
+  size_t len = 0;
+
+  if (this->tag.type() == NFCTagType::Type2) {
+    // READ addresses whole pages, and sessions always end on one
+    overlap = min(end, (overlap + type2_page_size - 1) / type2_page_size * type2_page_size);
+    base = type2_header_size;
+  } else {
+    overlap = min(end, overlap);
+    size_t file_end = (session.message_length > 0) ? type4_nlen_size + session.message_length : this->tag.capacity();
+    len = min(this->profile.max_fragment, file_end - (end - overlap));
+  }
+
+  auto fragment = this->read_fragment(base + end - overlap, len);
+  if (fragment.size() < overlap ||
+      !equal(fragment.begin(), fragment.begin() + overlap, session.bytes.end() - overlap)) {
+    return false;
+  }
+
+  session.bytes.insert(session.bytes.end(), fragment.begin() + overlap, fragment.end());
+  return true;
+}
+
+NDEFMessage NDEFSimulatedReader::read_session(NDEFReadSession& session)
+{
+  return (this->tag.type() == NFCTagType::Type2) ? this->read_type2(session) : this->read_type4(session);
+}
+
+/// Walks the TLVs of the data area to the NDEF Message TLV, then streams its value into the parser
+NDEFMessage NDEFSimulatedReader::read_type2(NDEFReadSession& session)
+{
+  // Bytes of the data area read so far
+  auto& window = session.bytes;
+  auto ensure = [&](size_t n) {
+    while (window.size() < n) {
+      auto page = this->read_fragment(type2_header_size + window.size(), type2_read_size);
+      window.insert(window.end(), page.begin(), page.end());
+    }
+  };
+
+  if (session.message_length == 0) {
+    size_t pos = 0;
+    size_t length = 0;
+    while (true) {
+      if (pos >= this->tag.capacity()) {
+        throw NDEFException("Tag does not hold an NDEF message");
+      }
+
+      ensure(pos + 1);
+      uint8_t tag = window[pos];
+
+      if (tag == tlv_null) {
+        pos++;
+        continue;
+      }
+
+      if (tag == tlv_terminator) {
+        throw NDEFException("Tag does not hold an NDEF message");
+      }
+
+      ensure(pos + 2);
+      length = window[pos + 1];
+      pos += 2;
+
+      if (length == 0xFF) {
+        ensure(pos + 2);
+        length = (size_t{ window[pos] } << 8) | window[pos + 1];
+        pos += 2;
+      }
+
+      if (tag == tlv_ndef_message) {
+        break;
+      }
+
+      // Lock Control, Memory Control or proprietary TLV
+      pos += length;
+    }
+
+    if (length == 0) {
+      throw NDEFException("Tag does not hold an NDEF message");
+    }
+
+    if (pos + length > this->tag.capacity()) {
+      throw NDEFException("NDEF Message TLV of " + to_string(length) + " bytes runs past the end of the tag");
+    }
+
+    ensure(pos);
+    session.message_offset = pos;
+    session.message_length = length;
+  }
+
+  // Whatever already arrived with the TLV header goes straight to the parser
+  while (!this->consume(session)) {
+    if (session.fed >= session.message_length) {
+      throw NDEFException("NDEF Message TLV ended before the Message End record");
+    }
+
+    ensure(window.size() + 1);
+  }
+
+  return session.parser.take_message();
+}
+
+/// Reads NLEN together with the first part of the message, then fetches exactly the remaining bytes
+NDEFMessage NDEFSimulatedReader::read_type4(NDEFReadSession& session)
+{
+  // Bytes of the NDEF file read so far
+  auto& file = session.bytes;
+  auto extend = [&]() {
+    size_t end = (session.message_length > 0) ? type4_nlen_size + session.message_length : this->tag.capacity();
+    auto fragment = this->read_fragment(file.size(), min(this->profile.max_fragment, end - file.size()));
+    file.insert(file.end(), fragment.begin(), fragment.end());
+  };
+
+  if (session.message_length == 0) {
+    if (file.size() < type4_nlen_size) {
+      extend();
+    }
+
+    size_t length = (size_t{ file[0] } << 8) | file[1];
+    if (length == 0) {
+      throw NDEFException("Tag does not hold an NDEF message");
+    }
+
+    if (length + type4_nlen_size > this->tag.capacity()) {
+      throw NDEFException("NLEN of " + to_string(length) + " bytes runs past the end of the NDEF file");
+    }
+
+    session.message_offset = type4_nlen_size;
+    session.message_length = length;
+  }
+
+  while (!this->consume(session)) {
+    if (session.fed >= session.message_length) {
+      throw NDEFException("NDEF file ended before the Message End record");
+    }
+
+    extend();
+  }
+
+  return session.parser.take_message();
+}
+
+/// Writes following each platform's update procedure
+void NDEFSimulatedReader::write_message(const NDEFMessage& msg)
+{
+  auto bytes = msg.as_bytes();
+  if (bytes.empty()) {
+    throw NDEFException("Unable to write invalid message");
+  }
+
+  if (this->tag.type() == NFCTagType::Type2) {
+    auto tlv = ndef_tlv(bytes);
+    if (tlv.size() > this->tag.capacity()) {
+      throw NDEFException("Message of " + to_string(bytes.size()) + " bytes does not fit on tag of " +
+                          to_string(this->tag.capacity()) + " bytes");
+    }
+
+    // Pages are written whole
+    tlv.resize((tlv.size() + type2_page_size - 1) / type2_page_size * type2_page_size, 0);
+    this->write_fragments(type2_header_size, tlv.data(), tlv.size());
+    return;
+  }
+
+  if (bytes.size() + type4_nlen_size > this->tag.capacity()) {
+    throw NDEFException("Message of " + to_string(bytes.size()) + " bytes does not fit on tag of " +
+                        to_string(this->tag.capacity()) + " bytes");
+  }
+
+  // Clear NLEN first, so a tear while writing the message leaves an empty tag rather than a corrupt one
+  const uint8_t empty[] = { 0x00, 0x00 };
+  this->write_fragments(0, empty, type4_nlen_size);
+  this->write_fragments(type4_nlen_size, bytes.data(), bytes.size());
+
+  const uint8_t nlen[] = { static_cast<uint8_t>(bytes.size() >> 8), static_cast<uint8_t>(bytes.size()) };
+  this->write_fragments(0, nlen, type4_nlen_size);
+}
@@ -74,11 +74,18 @@ NDEFRecord NDEFRecord::create_uri_record(const std::string& uri)
   return record;
 }
 
+/// Looks up the prefix abbreviated by a URI identifier code
+const std::string& NDEFRecord::uri_prefix(uint8_t code)
+{
+  // Reserved codes are treated as 0x00, no prefix
+  return uri_identifiers[(code < num_identifiers) ? code : 0];
+}
+
 /// Gets string form of URI protocol from URI Record payload
 std::string NDEFRecord::get_uri_protocol(const std::vector<uint8_t>& payload)
 {
   // First byte in the payload represents the URI identifier, allowing us to simply return a string
-  return uri_identifiers[payload.at(0)];
+  return NDEFRecord::uri_prefix(payload.at(0));
 }
 
 /// Gets string form of actual URI from URI Record payload
@@ -89,15 +96,7 @@ std::string NDEFRecord::get_uri(const std::vector<uint8_t>& payload)
 }
 
 /// Gets string form of URI protocol from URI Record
-std::string NDEFRecord::get_uri_protocol() const
-{
-  // First byte in the payload represents the URI identifier, allowing us to simply return a string
-  return uri_identifiers[payload_data.at(0)];
-}
+std::string NDEFRecord::get_uri_protocol() const { return NDEFRecord::get_uri_protocol(this->payload()); }
 
 /// Gets string form of actual URI from URI Record
-std::string NDEFRecord::get_uri() const
-{
-  // Bytes are encoded in ASCII/UTF-8, just create a string from them
-  return std::string{ payload_data.begin() + 1, payload_data.end() };
-}
\ No newline at end of file
+std::string NDEFRecord::get_uri() const { return NDEFRecord::get_uri(this->payload()); }
\ No newline at end of file
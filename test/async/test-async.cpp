@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/async.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+namespace {
+NDEFTask<void> write_messages(NDEFLoopbackTransport& transport, size_t count)
+{
+  NDEFAsyncWriter writer{ transport };
+
+  for (size_t i = 0; i < count; i++) {
+    NDEFMessage msg;
+    msg.append_record(NDEFRecord::create_text_record("message " + std::to_string(i), "en"));
+    msg.append_record(NDEFRecord::create_uri_record("https://example.com/" + std::to_string(i)));
+    co_await writer.write(msg);
+  }
+
+  transport.close();
+}
+
+NDEFTask<void> read_messages(NDEFLoopbackTransport& transport, size_t count, std::vector<std::string>& uris)
+{
+  // Tiny reads so that every message arrives over several resumptions
+  NDEFAsyncReader reader{ transport, 7 };
+
+  for (size_t i = 0; i < count; i++) {
+    NDEFMessage msg = co_await reader.read_message();
+    uris.push_back(msg.record(1).get_uri());
+  }
+}
+} // namespace
+
+TEST_CASE("Async reader receives messages written by async writer")
+{
+  NDEFEventLoop loop;
+  auto endpoints = NDEFLoopbackTransport::create_pair(loop);
+  std::vector<std::string> uris;
+
+  loop.spawn(write_messages(*endpoints.first, 5));
+  loop.spawn(read_messages(*endpoints.second, 5, uris));
+  loop.run();
+
+  REQUIRE(uris.size() == 5);
+  REQUIRE(uris.at(4) == "example.com/4");
+}
+
+TEST_CASE("Async reader services many connections on one thread")
+{
+  const size_t connections = 200;
+
+  NDEFEventLoop loop;
+  std::vector<std::pair<std::unique_ptr<NDEFLoopbackTransport>, std::unique_ptr<NDEFLoopbackTransport>>> endpoints;
+  std::vector<std::vector<std::string>> uris(connections);
+
+  for (size_t i = 0; i < connections; i++) {
+    endpoints.push_back(NDEFLoopbackTransport::create_pair(loop));
+    loop.spawn(read_messages(*endpoints.back().second, 3, uris.at(i)));
+  }
+  for (size_t i = 0; i < connections; i++) {
+    loop.spawn(write_messages(*endpoints.at(i).first, 3));
+  }
+  loop.run();
+
+  for (auto&& received : uris) {
+    REQUIRE(received.size() == 3);
+  }
+}
+
+TEST_CASE("Async reader throws when transport closes mid message")
+{
+  NDEFEventLoop loop;
+  auto endpoints = NDEFLoopbackTransport::create_pair(loop);
+  std::vector<std::string> uris;
+
+  auto write_partial = [](NDEFLoopbackTransport& transport) -> NDEFTask<void> {
+    co_await transport.write_some(valid_text_record_bytes_sr.data(), 5);
+    transport.close();
+  };
+
+  loop.spawn(write_partial(*endpoints.first));
+  loop.spawn(read_messages(*endpoints.second, 1, uris));
+
+  REQUIRE_THROWS_WITH(loop.run(), "Transport closed in the middle of a message");
+}
@@ -0,0 +1,282 @@
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/ndef-lite.h"
+
+namespace {
+NDEFMessage make_message(size_t i)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/" + std::to_string(i)));
+  msg.append_record(NDEFRecord{ std::vector<uint8_t>(300, static_cast<uint8_t>(i)),
+                                NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:sensor" }, "s1" });
+  return msg;
+}
+
+ndef_bytes bytes_of(const std::string& str)
+{
+  return ndef_bytes{ reinterpret_cast<const uint8_t*>(str.data()), str.size() };
+}
+
+ndef_bytes bytes_of(const std::vector<uint8_t>& bytes) { return ndef_bytes{ bytes.data(), bytes.size() }; }
+
+std::string string_of(ndef_bytes bytes) { return std::string{ bytes.data, bytes.data + bytes.size }; }
+
+std::vector<uint8_t> vector_of(ndef_bytes bytes) { return std::vector<uint8_t>{ bytes.data, bytes.data + bytes.size }; }
+
+/// Fields of \p record, viewing the strings and vectors it was built from
+struct RecordFields
+{
+  explicit RecordFields(const NDEFRecord& record)
+      : type(record.type().name()), id(record.id()), payload(record.payload())
+  {
+    info.tnf = static_cast<uint8_t>(record.type().id());
+    info.header = 0;
+    info.type = bytes_of(this->type);
+    info.id = bytes_of(this->id);
+    info.payload = bytes_of(this->payload);
+  }
+
+  std::string type;
+  std::string id;
+  std::vector<uint8_t> payload;
+  ndef_record_info info;
+};
+} // namespace
+
+TEST_CASE("C API decodes messages into borrowed views")
+{
+  REQUIRE(ndef_abi_version() == NDEF_LITE_C_ABI_VERSION);
+
+  auto expected = make_message(7);
+  auto bytes = expected.as_bytes();
+  ndef_message* msg = ndef_message_new();
+  REQUIRE(msg != nullptr);
+
+  for (bool borrow : { false, true }) {
+    CAPTURE(borrow);
+    REQUIRE((borrow ? ndef_message_borrow : ndef_message_decode)(msg, bytes.data(), bytes.size()) == NDEF_OK);
+    REQUIRE(ndef_message_record_count(msg) == 2);
+
+    ndef_record_info records[2];
+    size_t count = 0;
+    REQUIRE(ndef_message_records(msg, records, 2, &count) == NDEF_OK);
+    REQUIRE(count == 2);
+
+    for (size_t i = 0; i < count; i++) {
+      auto record = expected.record(i);
+      REQUIRE(records[i].tnf == static_cast<uint8_t>(record.type().id()));
+      REQUIRE(string_of(records[i].type) == record.type().name());
+      REQUIRE(string_of(records[i].id) == record.id());
+      REQUIRE(vector_of(records[i].payload) == record.payload());
+
+      // Borrowed messages view the caller's bytes, decoded ones their own copy
+      const bool in_caller_bytes = records[i].payload.data >= bytes.data() &&
+                                   records[i].payload.data < bytes.data() + bytes.size();
+      REQUIRE(in_caller_bytes == borrow);
+    }
+
+    ndef_record_info single;
+    REQUIRE(ndef_message_record(msg, 1, &single) == NDEF_OK);
+    REQUIRE(single.payload.data == records[1].payload.data);
+    REQUIRE((single.header & 0x40) != 0);
+    REQUIRE(ndef_message_record(msg, 2, &single) == NDEF_ERR_OUT_OF_RANGE);
+
+    REQUIRE(ndef_message_records(msg, records, 1, &count) == NDEF_ERR_BUFFER_TOO_SMALL);
+    REQUIRE(count == 2);
+
+    std::vector<uint8_t> out(bytes.size());
+    size_t written = 0;
+    REQUIRE(ndef_message_encode(msg, out.data(), out.size() - 1, &written) == NDEF_ERR_BUFFER_TOO_SMALL);
+    REQUIRE(written == bytes.size());
+    REQUIRE(ndef_message_encode(msg, out.data(), out.size(), &written) == NDEF_OK);
+    REQUIRE(out == bytes);
+  }
+
+  auto malformed = bytes;
+  malformed[3] = 0x01;
+  REQUIRE(ndef_message_decode(msg, malformed.data(), malformed.size()) == NDEF_ERR_MALFORMED);
+  REQUIRE(std::string{ ndef_last_error() }.find("Invalid character") == 0);
+  REQUIRE(ndef_message_record_count(msg) == 0);
+
+  REQUIRE(ndef_message_borrow(msg, bytes.data(), bytes.size() - 1) == NDEF_ERR_TRUNCATED);
+  REQUIRE(ndef_message_decode(nullptr, bytes.data(), bytes.size()) == NDEF_ERR_INVALID_ARGUMENT);
+
+  ndef_message_free(msg);
+  ndef_message_free(nullptr);
+}
+
+TEST_CASE("C API edits messages in place")
+{
+  auto expected = make_message(1);
+  auto bytes = expected.as_bytes();
+  const auto original = bytes;
+
+  ndef_message* msg = ndef_message_new();
+  REQUIRE(ndef_message_borrow(msg, bytes.data(), bytes.size()) == NDEF_OK);
+
+  // The first edit copies the borrowed bytes, which stay as they were
+  auto uri = NDEFRecord::create_uri_record("https://example.org/rewritten");
+  auto payload = uri.payload();
+  REQUIRE(ndef_message_replace_payload(msg, 0, payload.data(), payload.size()) == NDEF_OK);
+  expected.set_record(uri, 0);
+  REQUIRE(bytes == original);
+
+  RecordFields text{ NDEFRecord::create_text_record("hello", "en") };
+  REQUIRE(ndef_message_insert(msg, 2, &text.info) == NDEF_OK);
+  expected.append_record(NDEFRecord::create_text_record("hello", "en"));
+
+  REQUIRE(ndef_message_remove(msg, 1) == NDEF_OK);
+  expected.remove_record(1);
+
+  ndef_bytes encoded;
+  REQUIRE(ndef_message_bytes(msg, &encoded) == NDEF_OK);
+  REQUIRE(vector_of(encoded) == expected.as_bytes());
+
+  REQUIRE(ndef_message_remove(msg, 2) == NDEF_ERR_OUT_OF_RANGE);
+  REQUIRE(ndef_message_insert(msg, 3, &text.info) == NDEF_ERR_OUT_OF_RANGE);
+
+  text.info.tnf = 0x07;
+  REQUIRE(ndef_message_insert(msg, 0, &text.info) == NDEF_ERR_INVALID_ARGUMENT);
+  text.info.tnf = NDEF_TNF_WELL_KNOWN;
+  const std::string newline = "\n";
+  text.info.type = bytes_of(newline);
+  REQUIRE(ndef_message_insert(msg, 0, &text.info) == NDEF_ERR_INVALID_ARGUMENT);
+
+  // Each TNF limits which fields a record may have
+  ndef_record_info empty{ NDEF_TNF_EMPTY, 0, ndef_bytes{ nullptr, 0 }, ndef_bytes{ nullptr, 0 },
+                          ndef_bytes{ nullptr, 0 } };
+  REQUIRE(ndef_message_insert(msg, 0, &empty) == NDEF_OK);
+  REQUIRE(ndef_message_replace_payload(msg, 0, payload.data(), payload.size()) == NDEF_ERR_INVALID_ARGUMENT);
+  REQUIRE(ndef_message_replace_payload(msg, 0, nullptr, 0) == NDEF_OK);
+  REQUIRE(ndef_message_record(msg, 0, &empty) == NDEF_OK);
+  REQUIRE(empty.payload.size == 0);
+  REQUIRE(ndef_message_remove(msg, 0) == NDEF_OK);
+  empty.payload = bytes_of(newline);
+  REQUIRE(ndef_message_insert(msg, 0, &empty) == NDEF_ERR_INVALID_ARGUMENT);
+  empty.payload = ndef_bytes{ nullptr, 0 };
+  empty.id = bytes_of(newline);
+  REQUIRE(ndef_message_insert(msg, 0, &empty) == NDEF_ERR_INVALID_ARGUMENT);
+
+  RecordFields unknown{ NDEFRecord::create_text_record("hello", "en") };
+  unknown.info.type = ndef_bytes{ nullptr, 0 };
+  REQUIRE(ndef_message_insert(msg, 0, &unknown.info) == NDEF_ERR_INVALID_ARGUMENT);
+  unknown.info.tnf = NDEF_TNF_UNKNOWN;
+  REQUIRE(ndef_message_insert(msg, 0, &unknown.info) == NDEF_OK);
+  REQUIRE(ndef_message_remove(msg, 0) == NDEF_OK);
+  unknown.info.type = bytes_of(unknown.type);
+  REQUIRE(ndef_message_insert(msg, 0, &unknown.info) == NDEF_ERR_INVALID_ARGUMENT);
+  unknown.info.tnf = NDEF_TNF_UNCHANGED;
+  REQUIRE(ndef_message_insert(msg, 0, &unknown.info) == NDEF_ERR_INVALID_ARGUMENT);
+
+  // A message built up from nothing
+  ndef_message* built = ndef_message_new();
+  RecordFields first{ expected.record(0) };
+  RecordFields second{ expected.record(1) };
+  REQUIRE(ndef_message_insert(built, 0, &second.info) == NDEF_OK);
+  REQUIRE(ndef_message_insert(built, 0, &first.info) == NDEF_OK);
+  REQUIRE(ndef_message_bytes(built, &encoded) == NDEF_OK);
+  REQUIRE(vector_of(encoded) == expected.as_bytes());
+
+  ndef_message_free(built);
+  ndef_message_free(msg);
+}
+
+TEST_CASE("C API decodes and encodes batches")
+{
+  std::vector<NDEFMessage> messages;
+  std::vector<uint8_t> corpus;
+  for (size_t i = 0; i < 10; i++) {
+    messages.push_back(make_message(i));
+    if (i % 3 == 0) {
+      messages.back().append_record(NDEFRecord::create_text_record("extra " + std::to_string(i), "en"));
+    }
+
+    auto bytes = messages.back().as_bytes();
+    corpus.insert(corpus.end(), bytes.begin(), bytes.end());
+  }
+
+  std::vector<ndef_message_info> infos(10);
+  std::vector<ndef_record_info> records(24);
+  size_t message_count = 0;
+  size_t record_count = 0;
+
+  SUBCASE("all at once")
+  {
+    REQUIRE(ndef_decode_batch(corpus.data(), corpus.size(), infos.data(), infos.size(), &message_count,
+                              records.data(), records.size(), &record_count) == NDEF_OK);
+    REQUIRE(message_count == 10);
+    REQUIRE(record_count == 24);
+
+    for (size_t i = 0; i < message_count; i++) {
+      REQUIRE(infos[i].record_count == messages[i].record_count());
+      REQUIRE(std::vector<uint8_t>(corpus.begin() + infos[i].offset,
+                                   corpus.begin() + infos[i].offset + infos[i].size) == messages[i].as_bytes());
+
+      for (size_t r = 0; r < infos[i].record_count; r++) {
+        auto& record = records[infos[i].first_record + r];
+        REQUIRE(vector_of(record.payload) == messages[i].record(r).payload());
+        REQUIRE(record.payload.data >= corpus.data());
+        REQUIRE(record.payload.data < corpus.data() + corpus.size());
+      }
+    }
+
+    // Encoding the decoded records again gives back the same bytes
+    std::vector<size_t> counts;
+    for (size_t i = 0; i < message_count; i++) {
+      counts.push_back(infos[i].record_count);
+    }
+
+    std::vector<uint8_t> out(corpus.size());
+    size_t written = 0;
+    REQUIRE(ndef_encode_batch(records.data(), counts.data(), counts.size(), out.data(), 10, &written) ==
+            NDEF_ERR_BUFFER_TOO_SMALL);
+    REQUIRE(written == corpus.size());
+    REQUIRE(ndef_encode_batch(records.data(), counts.data(), counts.size(), out.data(), out.size(), &written) ==
+            NDEF_OK);
+    REQUIRE(out == corpus);
+
+    counts[0] = 0;
+    REQUIRE(ndef_encode_batch(records.data(), counts.data(), counts.size(), out.data(), out.size(), &written) ==
+            NDEF_ERR_INVALID_ARGUMENT);
+  }
+
+  SUBCASE("resumed when the arrays fill up")
+  {
+    size_t pos = 0;
+    size_t decoded = 0;
+    size_t calls = 0;
+    while (true) {
+      calls++;
+      auto status = ndef_decode_batch(corpus.data() + pos, corpus.size() - pos, infos.data(), 4, &message_count,
+                                      records.data(), 5, &record_count);
+
+      for (size_t i = 0; i < message_count; i++) {
+        REQUIRE(infos[i].record_count == messages[decoded + i].record_count());
+      }
+      decoded += message_count;
+
+      if (status == NDEF_OK) {
+        break;
+      }
+      REQUIRE(status == NDEF_ERR_BUFFER_TOO_SMALL);
+      REQUIRE(message_count > 0);
+      pos += infos[message_count - 1].offset + infos[message_count - 1].size;
+    }
+
+    REQUIRE(decoded == 10);
+    REQUIRE(calls > 2);
+  }
+
+  SUBCASE("stops at a broken message")
+  {
+    corpus.resize(corpus.size() - 1);
+    REQUIRE(ndef_decode_batch(corpus.data(), corpus.size(), infos.data(), infos.size(), &message_count,
+                              records.data(), records.size(), &record_count) == NDEF_ERR_TRUNCATED);
+    REQUIRE(message_count == 9);
+    REQUIRE(record_count == 21);
+  }
+}
@@ -0,0 +1,212 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/codec-service.hpp"
+#include "ndef-lite/compression.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/record-view.hpp"
+
+namespace {
+std::vector<uint8_t> to_bytes(const std::string& text) { return std::vector<uint8_t>{ text.begin(), text.end() }; }
+
+std::string socket_path() { return "/tmp/ndef-codec-" + std::to_string(getpid()) + ".sock"; }
+
+NDEFRecordList sample_records()
+{
+  std::string json;
+  for (int i = 0; i < 40; i++) {
+    json += "{\"sensor\":" + std::to_string(i) + ",\"status\":\"ok\"}";
+  }
+
+  NDEFRecord chunk{ to_bytes("part"), NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "text/plain" } };
+  chunk.set_chunked(true);
+
+  return NDEFRecordList{ NDEFRecord::create_uri_record("https://acme.com"),
+                         NDEFRecord{ to_bytes(json), NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia,
+                                                                     "application/json" },
+                                     "reading" },
+                         chunk,
+                         NDEFRecord{ to_bytes("end"), NDEFRecordType{ NDEFRecordType::TypeID::Unchanged } } };
+}
+
+std::vector<uint8_t> with_mode(TranscodeMode mode, const std::vector<uint8_t>& message)
+{
+  std::vector<uint8_t> body{ static_cast<uint8_t>(mode) };
+  body.insert(body.end(), message.begin(), message.end());
+  return body;
+}
+} // namespace
+
+TEST_CASE("Codec requests are processed without a socket")
+{
+  auto records = sample_records();
+  auto message = NDEFMessage{ records }.as_bytes();
+
+  auto decoded = NDEFCodecServer::process(CodecOp::Decode, message.data(), message.size());
+  REQUIRE(decoded.status == CodecStatus::Ok);
+  REQUIRE(decoded.body == NDEFCodecClient::pack_records(records));
+
+  auto unpacked = NDEFCodecClient::unpack_records(decoded.body);
+  REQUIRE(unpacked.size() == records.size());
+  REQUIRE(unpacked[1].id() == "reading");
+  REQUIRE(unpacked[2].is_chunked());
+
+  auto encoded = NDEFCodecServer::process(CodecOp::Encode, decoded.body.data(), decoded.body.size());
+  REQUIRE(encoded.status == CodecStatus::Ok);
+  REQUIRE(encoded.body == message);
+
+  auto validated = NDEFCodecServer::process(CodecOp::Validate, message.data(), message.size());
+  REQUIRE(validated.status == CodecStatus::Ok);
+  REQUIRE(validated.body == std::vector<uint8_t>{ 4, 0, 0, 0 });
+
+  SUBCASE("transcoding")
+  {
+    auto body = with_mode(TranscodeMode::Canonical, message);
+    auto canonical = NDEFCodecServer::process(CodecOp::Transcode, body.data(), body.size());
+    REQUIRE(canonical.status == CodecStatus::Ok);
+    REQUIRE(canonical.body == message);
+
+    body = with_mode(TranscodeMode::Compress, message);
+    auto compressed = NDEFCodecServer::process(CodecOp::Transcode, body.data(), body.size());
+    REQUIRE(compressed.status == CodecStatus::Ok);
+    REQUIRE(compressed.body.size() < message.size());
+    REQUIRE(NDEFMessage::from_bytes(compressed.body).record(1).type().name() == compressed_record_type);
+
+    body = with_mode(TranscodeMode::Decompress, compressed.body);
+    auto decompressed = NDEFCodecServer::process(CodecOp::Transcode, body.data(), body.size());
+    REQUIRE(decompressed.status == CodecStatus::Ok);
+    REQUIRE(decompressed.body == message);
+
+    body = with_mode(static_cast<TranscodeMode>(9), message);
+    REQUIRE(NDEFCodecServer::process(CodecOp::Transcode, body.data(), body.size()).status == CodecStatus::Unsupported);
+  }
+
+  SUBCASE("failures carry an error message")
+  {
+    auto truncated = NDEFCodecServer::process(CodecOp::Validate, message.data(), message.size() - 1);
+    REQUIRE(truncated.status == CodecStatus::Malformed);
+    REQUIRE(!truncated.body.empty());
+
+    auto trailing = message;
+    trailing.push_back(0x00);
+    REQUIRE(NDEFCodecServer::process(CodecOp::Decode, trailing.data(), trailing.size()).status ==
+            CodecStatus::Malformed);
+
+    REQUIRE(NDEFCodecServer::process(CodecOp::Encode, nullptr, 0).status == CodecStatus::Malformed);
+    REQUIRE(NDEFCodecServer::process(static_cast<CodecOp>(0x7F), nullptr, 0).status == CodecStatus::Unsupported);
+
+    auto list = NDEFCodecClient::pack_records(records);
+    list[0] = 0x07;
+    REQUIRE(NDEFCodecServer::process(CodecOp::Encode, list.data(), list.size()).status == CodecStatus::Malformed);
+    list.pop_back();
+    REQUIRE_THROWS_AS(NDEFCodecClient::unpack_records(list), NDEFException);
+  }
+}
+
+TEST_CASE("Codec server answers batches over a Unix socket")
+{
+  CodecServerOptions options;
+  options.workers = 3;
+  options.max_frame = 1024 * 1024;
+  NDEFCodecServer server{ socket_path(), options };
+  server.start();
+  REQUIRE_THROWS_AS(server.start(), NDEFException);
+
+  auto records = sample_records();
+  auto message = NDEFMessage{ records }.as_bytes();
+
+  SUBCASE("one batch of every op")
+  {
+    NDEFCodecClient client{ socket_path() };
+    auto responses = client.call({ CodecRequest{ CodecOp::Decode, message },
+                                   CodecRequest{ CodecOp::Encode, NDEFCodecClient::pack_records(records) },
+                                   CodecRequest{ CodecOp::Validate, { 0x01, 0x02 } },
+                                   CodecRequest{ CodecOp::Transcode, with_mode(TranscodeMode::Canonical, message) } });
+
+    REQUIRE(responses.size() == 4);
+    REQUIRE(responses[0].status == CodecStatus::Ok);
+    REQUIRE(NDEFCodecClient::unpack_records(responses[0].body).size() == records.size());
+    REQUIRE(responses[1].status == CodecStatus::Ok);
+    REQUIRE(responses[1].body == message);
+    REQUIRE(responses[2].status == CodecStatus::Malformed);
+    REQUIRE(responses[3].body == message);
+
+    REQUIRE(client.call(CodecOp::Validate, message).body == std::vector<uint8_t>{ 4, 0, 0, 0 });
+    REQUIRE(client.call({}).empty());
+  }
+
+  SUBCASE("large payloads arrive in one piece")
+  {
+    std::vector<uint8_t> big(300 * 1024);
+    for (size_t i = 0; i < big.size(); i++) {
+      big[i] = static_cast<uint8_t>(i * 31);
+    }
+    NDEFRecord image{ big, NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "image/png" } };
+    auto big_message = NDEFMessage{ image }.as_bytes();
+
+    NDEFCodecClient client{ socket_path() };
+    auto decoded = client.call(CodecOp::Decode, big_message);
+    REQUIRE(decoded.status == CodecStatus::Ok);
+    REQUIRE(NDEFCodecClient::unpack_records(decoded.body).at(0).payload() == big);
+  }
+
+  SUBCASE("pipelined batches from several connections")
+  {
+    const int num_clients = 4;
+    const uint32_t num_batches = 50;
+    std::vector<int> mismatches(num_clients, 0);
+
+    std::vector<std::thread> clients;
+    for (int c = 0; c < num_clients; c++) {
+      clients.emplace_back([&, c]() {
+        NDEFCodecClient client{ socket_path() };
+        std::vector<CodecRequest> batch(8, CodecRequest{ CodecOp::Decode, message });
+        for (uint32_t id = 0; id < num_batches; id++) {
+          client.send(id, batch);
+        }
+
+        // Responses may arrive in any order, but every batch is answered exactly once
+        std::vector<int> seen(num_batches, 0);
+        std::vector<CodecResponse> responses;
+        for (uint32_t i = 0; i < num_batches; i++) {
+          auto id = client.receive(responses);
+          seen.at(id)++;
+          for (auto&& response : responses) {
+            mismatches[c] += (response.body == NDEFCodecClient::pack_records(records)) ? 0 : 1;
+          }
+          mismatches[c] += (responses.size() == 8) ? 0 : 1;
+        }
+        for (auto count : seen) {
+          mismatches[c] += (count == 1) ? 0 : 1;
+        }
+      });
+    }
+    for (auto&& client : clients) {
+      client.join();
+    }
+
+    for (auto count : mismatches) {
+      REQUIRE(count == 0);
+    }
+    REQUIRE(server.stats().requests == num_clients * num_batches * 8);
+  }
+
+  SUBCASE("oversized frames close the connection")
+  {
+    NDEFCodecClient client{ socket_path() };
+    std::vector<uint8_t> huge(options.max_frame + 1);
+    REQUIRE_THROWS_AS(client.call(CodecOp::Validate, huge), NDEFException);
+
+    // Other connections are unaffected
+    NDEFCodecClient other{ socket_path() };
+    REQUIRE(other.call(CodecOp::Validate, message).status == CodecStatus::Ok);
+  }
+
+  server.stop();
+  REQUIRE_THROWS_AS(NDEFCodecClient{ socket_path() }, NDEFException);
+}
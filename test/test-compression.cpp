@@ -0,0 +1,233 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/compression.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message.hpp"
+
+namespace {
+std::vector<uint8_t> to_bytes(const std::string& text) { return std::vector<uint8_t>{ text.begin(), text.end() }; }
+
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& data, const std::vector<uint8_t>& dictionary = {})
+{
+  auto block = lz4::compress(data.data(), data.size(), dictionary);
+  std::vector<uint8_t> out(data.size());
+  lz4::decompress(block.data(), block.size(), out.data(), out.size(), dictionary);
+  return out;
+}
+
+/// JSON-like payload of the kind the dictionary is meant for
+std::string sensor_json(int i)
+{
+  return "{\"device\":\"acme-sensor-" + std::to_string(i * 7919 % 1000) + "\",\"firmware\":\"2.4." +
+         std::to_string(i % 10) + "\",\"reading\":{\"temperature\":" + std::to_string(i % 40) +
+         ",\"humidity\":" + std::to_string(i % 100) + "},\"status\":\"ok\"}";
+}
+
+const NDEFRecordType json_type{ NDEFRecordType::TypeID::MIMEMedia, "application/json" };
+} // namespace
+
+TEST_CASE("LZ4 blocks round trip")
+{
+  std::mt19937 rng{ 42 };
+
+  for (size_t size = 0; size < 64; size++) {
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+      byte = static_cast<uint8_t>(rng() % 4);
+    }
+    CAPTURE(size);
+    REQUIRE(round_trip(data) == data);
+  }
+
+  std::vector<uint8_t> random(100000);
+  for (auto& byte : random) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  REQUIRE(round_trip(random) == random);
+
+  // Long runs exercise overlapping matches and multi-byte lengths, and the repeat lies beyond the match window
+  std::vector<uint8_t> runs(std::vector<uint8_t>(5000, 'a'));
+  runs.insert(runs.end(), random.begin(), random.begin() + 70000);
+  runs.insert(runs.end(), random.begin(), random.begin() + 1000);
+  auto block = lz4::compress(runs.data(), runs.size());
+  REQUIRE(block.size() < runs.size());
+  REQUIRE(round_trip(runs) == runs);
+
+  auto text = to_bytes(sensor_json(1) + sensor_json(2) + sensor_json(3));
+  REQUIRE(lz4::compress(text.data(), text.size()).size() < text.size());
+}
+
+TEST_CASE("LZ4 decoder reads standard blocks")
+{
+  // 3 literals, match of 7 at offset 3, then 5 closing literals
+  std::vector<uint8_t> block{ 0x33, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'x', 'y', 'z', 'x', 'y' };
+  std::string expected = "abcabcabcaxyzxy";
+  std::vector<uint8_t> out(expected.size());
+  lz4::decompress(block.data(), block.size(), out.data(), out.size());
+  REQUIRE(out == to_bytes(expected));
+
+  // Output size must match exactly
+  std::vector<uint8_t> short_out(expected.size() - 1);
+  REQUIRE_THROWS_AS(lz4::decompress(block.data(), block.size(), short_out.data(), short_out.size()), NDEFException);
+  std::vector<uint8_t> long_out(expected.size() + 1);
+  REQUIRE_THROWS_AS(lz4::decompress(block.data(), block.size(), long_out.data(), long_out.size()), NDEFException);
+
+  // Offsets before the start of the data are rejected without a dictionary
+  block[4] = 0x04;
+  REQUIRE_THROWS_AS(lz4::decompress(block.data(), block.size(), out.data(), out.size()), NDEFException);
+}
+
+TEST_CASE("Corrupt LZ4 blocks are rejected without reading or writing out of bounds")
+{
+  auto data = to_bytes(sensor_json(5) + sensor_json(6) + sensor_json(7));
+  auto block = lz4::compress(data.data(), data.size());
+  std::vector<uint8_t> out(data.size());
+
+  for (size_t len = 0; len < block.size(); len++) {
+    CAPTURE(len);
+    REQUIRE_THROWS_AS(lz4::decompress(block.data(), len, out.data(), out.size()), NDEFException);
+  }
+
+  std::mt19937 rng{ 7 };
+  for (int i = 0; i < 2000; i++) {
+    auto corrupt = block;
+    corrupt[rng() % corrupt.size()] ^= static_cast<uint8_t>(1 + rng() % 255);
+    try {
+      lz4::decompress(corrupt.data(), corrupt.size(), out.data(), out.size());
+    } catch (const NDEFException&) {
+    }
+  }
+}
+
+TEST_CASE("Trained dictionaries shrink small payloads")
+{
+  std::vector<std::vector<uint8_t>> samples;
+  for (int i = 0; i < 200; i++) {
+    samples.push_back(to_bytes(sensor_json(i)));
+  }
+
+  auto dictionary = NDEFCompressionDictionary::train(samples, 7, 1024);
+  REQUIRE(dictionary.id == 7);
+  REQUIRE(!dictionary.bytes.empty());
+  REQUIRE(dictionary.bytes.size() <= 1024);
+
+  auto payload = to_bytes(sensor_json(1234));
+  auto plain = lz4::compress(payload.data(), payload.size());
+  auto trained = lz4::compress(payload.data(), payload.size(), dictionary.bytes);
+  REQUIRE(trained.size() * 2 < plain.size());
+  REQUIRE(round_trip(payload, dictionary.bytes) == payload);
+
+  REQUIRE(NDEFCompressionDictionary::train({}, 1).bytes.empty());
+}
+
+TEST_CASE("Messages compress records transparently through the codec")
+{
+  std::vector<std::vector<uint8_t>> samples;
+  for (int i = 0; i < 100; i++) {
+    samples.push_back(to_bytes(sensor_json(i)));
+  }
+  auto dictionary =
+      std::make_shared<const NDEFCompressionDictionary>(NDEFCompressionDictionary::train(samples, 0xACE, 2048));
+  auto codec = std::make_shared<const NDEFCompressionCodec>(dictionary);
+
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord{ to_bytes(sensor_json(500)), json_type, "reading" });
+  msg.append_record(NDEFRecord::create_uri_record("https://acme.com"));
+  msg.append_record(NDEFRecord{ to_bytes(sensor_json(501)), json_type });
+  auto plain = msg.as_bytes();
+
+  msg.set_codec(codec);
+  auto compressed = msg.as_bytes();
+  REQUIRE(compressed.size() * 4 < plain.size() * 3);
+
+  // Without the codec the compressed records are ordinary External records that keep their ID
+  auto raw = NDEFMessage::from_bytes(compressed);
+  REQUIRE(raw.record(0).type() == NDEFRecordType{ NDEFRecordType::TypeID::External, compressed_record_type });
+  REQUIRE(raw.record(0).id() == "reading");
+  REQUIRE(raw.record(1).payload() == msg.record(1).payload());
+
+  auto decoded = NDEFMessage::from_bytes(compressed, codec);
+  REQUIRE(decoded.codec().get() == codec.get());
+  REQUIRE(decoded.record_count() == 3);
+  for (size_t i = 0; i < 3; i++) {
+    CAPTURE(i);
+    REQUIRE(decoded.record(i).as_bytes() == msg.record(i).as_bytes());
+  }
+
+  // Re-encoding with the codec set gives the same bytes
+  REQUIRE(decoded.as_bytes() == compressed);
+
+  SUBCASE("payloads that do not shrink stay as they are")
+  {
+    std::mt19937 rng{ 3 };
+    std::vector<uint8_t> noise(300);
+    for (auto& byte : noise) {
+      byte = static_cast<uint8_t>(rng());
+    }
+
+    NDEFMessage noisy{ NDEFRecord{ noise, json_type } };
+    noisy.set_codec(codec);
+    REQUIRE(noisy.as_bytes() == NDEFMessage{ NDEFRecord{ noise, json_type } }.as_bytes());
+  }
+
+  SUBCASE("a different dictionary cannot decode")
+  {
+    auto other = std::make_shared<const NDEFCompressionDictionary>(NDEFCompressionDictionary{ 1, { 'x' } });
+    auto other_codec = std::make_shared<const NDEFCompressionCodec>(other);
+    REQUIRE_THROWS_AS(NDEFMessage::from_bytes(compressed, other_codec), NDEFException);
+  }
+
+  SUBCASE("codec without a dictionary")
+  {
+    NDEFMessage repeated{ NDEFRecord{ to_bytes(sensor_json(1) + sensor_json(1) + sensor_json(1)), json_type } };
+    repeated.set_codec(std::make_shared<const NDEFCompressionCodec>());
+    auto bytes = repeated.as_bytes();
+    repeated.set_codec(nullptr);
+    REQUIRE(bytes.size() < repeated.as_bytes().size());
+
+    auto back = NDEFMessage::from_bytes(bytes, std::make_shared<const NDEFCompressionCodec>());
+    REQUIRE(back.record().payload() == repeated.record().payload());
+  }
+}
+
+TEST_CASE("Compressed records are checked before decompressing")
+{
+  const NDEFRecordType lz4_type{ NDEFRecordType::TypeID::External, compressed_record_type };
+  NDEFCompressionCodec codec;
+  NDEFRecord decoded;
+
+  // Flags, TNF, TYPE, original length, then a block of one literal
+  auto framed = [](uint8_t tnf, uint32_t length) {
+    return std::vector<uint8_t>{ 0x00,
+                                 tnf,
+                                 0x01,
+                                 'T',
+                                 static_cast<uint8_t>(length >> 24),
+                                 static_cast<uint8_t>(length >> 16),
+                                 static_cast<uint8_t>(length >> 8),
+                                 static_cast<uint8_t>(length),
+                                 0x10,
+                                 'a' };
+  };
+
+  REQUIRE(codec.decode(NDEFRecord{ framed(0x01, 1), lz4_type }, decoded));
+  REQUIRE(decoded.payload() == to_bytes("a"));
+
+  // A tiny record claiming a huge payload is rejected without allocating for it
+  REQUIRE_THROWS_AS(codec.decode(NDEFRecord{ framed(0x01, UINT32_MAX), lz4_type }, decoded), NDEFException);
+  REQUIRE_THROWS_AS(NDEFCompressionCodec{}.decode(NDEFRecord{ framed(0x01, UINT32_MAX), lz4_type }, decoded),
+                    NDEFException);
+  REQUIRE_THROWS_AS(NDEFCompressionCodec{}.decode(NDEFRecord{ framed(0x01, 2 * 255 + 1), lz4_type }, decoded),
+                    NDEFException);
+  REQUIRE_THROWS_AS(NDEFCompressionCodec(nullptr, 16, 100).decode(NDEFRecord{ framed(0x01, 101), lz4_type }, decoded),
+                    NDEFException);
+
+  for (uint8_t tnf : { 0x00, 0x06, 0x07, 0x09 }) {
+    CAPTURE(tnf);
+    REQUIRE_THROWS_AS(codec.decode(NDEFRecord{ framed(tnf, 1), lz4_type }, decoded), NDEFException);
+  }
+}
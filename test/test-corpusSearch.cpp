@@ -0,0 +1,187 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/corpus-search.hpp"
+#include "ndef-lite/exceptions.hpp"
+
+namespace {
+/// Capture file that deletes itself
+struct CaptureFile
+{
+  explicit CaptureFile(const std::vector<uint8_t>& bytes)
+  {
+    char name[] = "/tmp/ndef-corpus-XXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    close(fd);
+    path = name;
+  }
+  ~CaptureFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+/// Messages of a Text record, a URI record and a MIME record, with every tenth one pointing at evil.example
+std::vector<uint8_t> make_corpus(size_t count)
+{
+  std::vector<uint8_t> bytes;
+
+  for (size_t i = 0; i < count; i++) {
+    auto host = (i % 10 == 3) ? "evil.example" : "example.com";
+    std::string body = "{\"reading\":" + std::to_string(i) + "}";
+
+    NDEFMessage msg;
+    msg.append_record(NDEFRecord::create_text_record("tag number " + std::to_string(i), "en"));
+    msg.append_record(NDEFRecord::create_uri_record("https://www." + std::string{ host } + "/t/" + std::to_string(i)));
+    msg.append_record(NDEFRecord{ std::vector<uint8_t>{ body.begin(), body.end() },
+                                  NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "application/json" },
+                                  "tag-" + std::to_string(i) });
+
+    auto encoded = msg.as_bytes();
+    bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+  }
+
+  return bytes;
+}
+
+/// \return message of the exception thrown opening \p path as a corpus
+std::string open_error(const std::string& path)
+{
+  try {
+    NDEFCorpus corpus{ path };
+  } catch (const NDEFException& e) {
+    return e.what();
+  }
+
+  return "";
+}
+} // namespace
+
+TEST_CASE("Corpus search finds records by field")
+{
+  auto bytes = make_corpus(200);
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  REQUIRE(corpus.message_count() == 200);
+  REQUIRE(corpus.size() == bytes.size());
+  REQUIRE(corpus.message(7).record(2).id() == "tag-7");
+  REQUIRE(corpus.to_message(7).record(2).id() == "tag-7");
+  REQUIRE(corpus.to_message(199).as_bytes() ==
+          std::vector<uint8_t>(bytes.begin() + corpus.message_offset(199), bytes.end()));
+
+  SUBCASE("URIs are matched with their prefix expanded")
+  {
+    auto hits = corpus.search(SearchField::Uri, "https://www.evil.example/");
+    REQUIRE(hits.size() == 20);
+    for (size_t i = 0; i < hits.size(); i++) {
+      REQUIRE(hits[i].message == i * 10 + 3);
+      REQUIRE(hits[i].record == 1);
+      REQUIRE(hits[i].offset == corpus.message_offset(hits[i].message));
+      REQUIRE(hits[i].position == 0);
+    }
+
+    // Matches inside the prefix, across the end of the prefix and inside the body
+    REQUIRE(corpus.search(SearchField::Uri, "//www").size() == 200);
+    REQUIRE(corpus.search(SearchField::Uri, "www.evil").at(0).position == 8);
+    REQUIRE(corpus.search(SearchField::Uri, "/t/13").at(0).position == 24);
+
+    // The abbreviated prefix is not part of any other field
+    REQUIRE(corpus.search(SearchField::Payload, "https").empty());
+  }
+
+  SUBCASE("other fields")
+  {
+    auto text = corpus.search(SearchField::Text, "number 42");
+    REQUIRE(text.size() == 1);
+    REQUIRE(text[0].message == 42);
+    REQUIRE(text[0].position == 4);
+
+    REQUIRE(corpus.search(SearchField::Type, "json").size() == 200);
+    REQUIRE(corpus.search(SearchField::Id, "tag-19").size() == 11);
+    REQUIRE(corpus.search(SearchField::Payload, std::vector<uint8_t>{ '1', '9', '9', '}' }).size() == 1);
+    REQUIRE(corpus.search(SearchField::Payload, "nowhere").empty());
+
+    // An empty pattern matches every record with the field
+    REQUIRE(corpus.search(SearchField::Text, "").size() == 200);
+  }
+
+  SUBCASE("thread counts do not change the hits")
+  {
+    auto expected = corpus.search(SearchField::Uri, "evil", SearchOptions{ 1 });
+    for (size_t threads : { 2, 3, 16, 500 }) {
+      auto hits = corpus.search(SearchField::Uri, "evil", SearchOptions{ threads });
+      REQUIRE(hits.size() == expected.size());
+      for (size_t i = 0; i < hits.size(); i++) {
+        REQUIRE(hits[i].message == expected[i].message);
+        REQUIRE(hits[i].position == expected[i].position);
+      }
+    }
+  }
+}
+
+TEST_CASE("Corpus search decodes UTF-16 text and absolute URIs")
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record(u"caf\u00E9 menu", "fr"));
+  msg.append_record(NDEFRecord{ std::vector<uint8_t>{}, NDEFRecordType{ NDEFRecordType::TypeID::AbsoluteURI,
+                                                                        "http://absolute.example/x" } });
+  auto bytes = msg.as_bytes();
+
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  auto text = corpus.search(SearchField::Text, "\xC3\xA9 menu");
+  REQUIRE(text.size() == 1);
+  REQUIRE(text[0].position == 3);
+
+  auto uri = corpus.search(SearchField::Uri, "absolute.example");
+  REQUIRE(uri.size() == 1);
+  REQUIRE(uri[0].record == 1);
+}
+
+TEST_CASE("Corpus search finds text after locales of 32 characters or more")
+{
+  const std::string locale = "x-" + std::string(38, 'a');
+  std::vector<uint8_t> payload{ static_cast<uint8_t>(locale.size()) };
+  payload.insert(payload.end(), locale.begin(), locale.end());
+  payload.insert(payload.end(), { 'n', 'e', 'e', 'd', 'l', 'e' });
+  auto bytes = NDEFMessage{ NDEFRecord{ payload, NDEFRecordType::text_record_type() } }.as_bytes();
+
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  auto text = corpus.search(SearchField::Text, "needle");
+  REQUIRE(text.size() == 1);
+  REQUIRE(text[0].position == 0);
+}
+
+TEST_CASE("Corpus files are mapped and framed up front")
+{
+  auto bytes = make_corpus(50);
+  CaptureFile file{ bytes };
+  NDEFCorpus corpus{ file.path };
+  REQUIRE(corpus.message_count() == 50);
+  REQUIRE(corpus.search(SearchField::Uri, "evil.example").size() == 5);
+
+  CaptureFile empty{ {} };
+  REQUIRE(NDEFCorpus{ empty.path }.search(SearchField::Payload, "x").empty());
+
+  bytes.pop_back();
+  REQUIRE_THROWS_AS(NDEFCorpus(bytes.data(), bytes.size()), NDEFException);
+  REQUIRE_THROWS_AS(NDEFCorpus{ "/nonexistent/corpus" }, NDEFException);
+}
+
+TEST_CASE("Corpus files are not limited to the size of one record")
+{
+  if (sizeof(size_t) <= 4) {
+    return;
+  }
+
+  // A sparse file just over 4 GiB whose first record has a newline in its type
+  CaptureFile file{ { 0xD1, 0x01, 0x00, '\n' } };
+  REQUIRE(truncate(file.path.c_str(), (off_t{ 1 } << 32) + 16) == 0);
+
+  // Framing reaches the bad record instead of the file being turned away for its size
+  REQUIRE(open_error(file.path) == "Malformed message in corpus at byte 0");
+}
@@ -0,0 +1,232 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/corpus-snapshot.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/payload-store.hpp"
+
+namespace {
+/// Snapshot path that deletes whatever was written to it
+struct SnapshotFile
+{
+  SnapshotFile()
+  {
+    char name[] = "/tmp/ndef-snapshot-XXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    close(fd);
+    path = name;
+  }
+  ~SnapshotFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+/// Messages of a Text record, in UTF-16 every fifth time, a URI record, a MIME record and sometimes an Absolute URI
+std::vector<uint8_t> make_corpus(size_t count)
+{
+  std::vector<uint8_t> bytes;
+
+  for (size_t i = 0; i < count; i++) {
+    std::string body = "{\"reading\":" + std::to_string(i) + "}";
+
+    NDEFMessage msg;
+    if (i % 5 == 0) {
+      msg.append_record(NDEFRecord::create_text_record(u"café " + std::u16string(i % 10, u'x'), "fr"));
+    } else {
+      msg.append_record(NDEFRecord::create_text_record("tag number " + std::to_string(i), "en-US"));
+    }
+    msg.append_record(NDEFRecord::create_uri_record("https://www.example.com/t/" + std::to_string(i)));
+    msg.append_record(NDEFRecord{ std::vector<uint8_t>{ body.begin(), body.end() },
+                                  NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "application/json" },
+                                  "tag-" + std::to_string(i) });
+    if (i % 7 == 0) {
+      msg.append_record(NDEFRecord{ std::vector<uint8_t>{},
+                                    NDEFRecordType{ NDEFRecordType::TypeID::AbsoluteURI,
+                                                    "urn:nfc:" + std::to_string(i) } });
+    }
+
+    auto encoded = msg.as_bytes();
+    bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+  }
+
+  return bytes;
+}
+
+/// \return message of the exception thrown opening the snapshot, empty if it opens
+std::string open_error(const std::string& path, const uint8_t* data, size_t len)
+{
+  try {
+    NDEFCorpusSnapshot snapshot{ path, data, len };
+  } catch (const NDEFException& e) {
+    return e.what();
+  }
+
+  return "";
+}
+
+void overwrite(const std::string& path, size_t offset, uint8_t value)
+{
+  std::fstream file{ path, std::ios::in | std::ios::out | std::ios::binary };
+  file.seekp(static_cast<std::streamoff>(offset));
+  file.put(static_cast<char>(value));
+}
+
+/// Overwrites a byte of the body and fixes up the body hash, as a crafted snapshot would
+void forge(const std::string& path, size_t offset, uint8_t value)
+{
+  // The header is 80 bytes long and ends with the body hash
+  const size_t header_size = 80;
+
+  std::ifstream in{ path, std::ios::binary };
+  std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+  in.close();
+
+  bytes.at(offset) = value;
+  uint64_t body_hash = NDEFPayloadStore::hash(bytes.data() + header_size, bytes.size() - header_size);
+  std::memcpy(bytes.data() + header_size - sizeof(body_hash), &body_hash, sizeof(body_hash));
+
+  std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+  out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+} // namespace
+
+TEST_CASE("Corpus snapshot reads back every record without decoding")
+{
+  auto bytes = make_corpus(100);
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  SnapshotFile file;
+
+  NDEFCorpusSnapshot::write(file.path, corpus);
+  NDEFCorpusSnapshot snapshot{ file.path, corpus };
+
+  REQUIRE(snapshot.message_count() == corpus.message_count());
+  REQUIRE(snapshot.type_count() == 3 + 15);
+
+  size_t record = 0;
+  for (size_t i = 0; i < corpus.message_count(); i++) {
+    auto message = corpus.message(i);
+    auto decoded = corpus.to_message(i);
+    auto indexed = snapshot.message(i);
+
+    REQUIRE(snapshot.message_offset(i) == corpus.message_offset(i));
+    REQUIRE(snapshot.first_record(i) == record);
+    REQUIRE(snapshot.end_record(i) == record + message.record_count());
+    REQUIRE(indexed.size() == message.size());
+    REQUIRE(indexed.to_message().as_bytes() == decoded.as_bytes());
+
+    for (size_t r = 0; r < message.record_count(); r++, record++) {
+      auto view = snapshot.view(record);
+      auto expected = decoded.record(r);
+
+      REQUIRE(view.data() == message.record(r).data());
+      REQUIRE(view.header() == message.record(r).header());
+      REQUIRE(view.type() == expected.type().name());
+      REQUIRE(view.id() == expected.id());
+      REQUIRE(view.payload().to_vector() == expected.payload());
+      REQUIRE(snapshot.type(snapshot.record(record).type) == expected.type());
+      REQUIRE(snapshot.record(record).message == i);
+
+      if (r == 0) {
+        REQUIRE(snapshot.value(record) == expected.get_text());
+        REQUIRE(snapshot.locale(record) == expected.get_text_locale());
+      } else if (r == 1) {
+        REQUIRE(snapshot.uri(record) == expected.get_uri_protocol() + expected.get_uri());
+        REQUIRE(snapshot.locale(record).empty());
+      } else if (r == 2) {
+        REQUIRE(snapshot.value(record).empty());
+        REQUIRE_THROWS_AS(snapshot.uri(record), NDEFException);
+      } else {
+        REQUIRE(snapshot.uri(record) == "urn:nfc:" + std::to_string(i));
+      }
+    }
+  }
+
+  REQUIRE(snapshot.record_count() == record);
+  REQUIRE(snapshot.record(1).type == snapshot.record(5).type);
+  REQUIRE_THROWS_AS(snapshot.record(record), std::out_of_range);
+  REQUIRE_THROWS_AS(snapshot.message(corpus.message_count()), std::out_of_range);
+}
+
+TEST_CASE("Corpus snapshots are rejected once they no longer match")
+{
+  auto bytes = make_corpus(20);
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  SnapshotFile file;
+  NDEFCorpusSnapshot::write(file.path, corpus);
+
+  SUBCASE("changed corpus")
+  {
+    auto changed = bytes;
+    changed[changed.size() - 1] ^= 0x01;
+    REQUIRE(open_error(file.path, changed.data(), changed.size()).find("different corpus") != std::string::npos);
+    REQUIRE_THROWS_AS(NDEFCorpusSnapshot(file.path, bytes.data(), bytes.size() - 1), NDEFException);
+  }
+
+  SUBCASE("corrupt snapshot")
+  {
+    overwrite(file.path, 100, 0xFF);
+    REQUIRE(open_error(file.path, bytes.data(), bytes.size()).find("corrupt") != std::string::npos);
+  }
+
+  SUBCASE("truncated snapshot")
+  {
+    REQUIRE(truncate(file.path.c_str(), 200) == 0);
+    REQUIRE(open_error(file.path, bytes.data(), bytes.size()).find("truncated") != std::string::npos);
+  }
+
+  SUBCASE("snapshot larger than a record payload")
+  {
+    // Grown past 4 GiB, the snapshot is mapped and found not to match its header rather than turned away for its size
+    if (sizeof(size_t) > 4) {
+      REQUIRE(truncate(file.path.c_str(), (off_t{ 1 } << 32) + 16) == 0);
+      REQUIRE(open_error(file.path, bytes.data(), bytes.size()).find("truncated or corrupt") != std::string::npos);
+    }
+  }
+
+  SUBCASE("locale longer than its record")
+  {
+    // The first record of the first message is a Text record. Records follow the header and the message table
+    const size_t record_table = 80 + (corpus.message_count() + 1) * 16;
+    forge(file.path, record_table + offsetof(SnapshotRecord, locale_length), 0xFF);
+    REQUIRE(open_error(file.path, bytes.data(), bytes.size()).find("Snapshot record 0 is corrupt") !=
+            std::string::npos);
+  }
+
+  SUBCASE("not a snapshot")
+  {
+    overwrite(file.path, 0, 'X');
+    REQUIRE(open_error(file.path, bytes.data(), bytes.size()).find("not a corpus snapshot") != std::string::npos);
+  }
+
+  // Whatever went wrong, the snapshot is written again
+  auto snapshot = NDEFCorpusSnapshot::open_or_write(file.path, corpus);
+  REQUIRE(snapshot->message_count() == 20);
+  REQUIRE(snapshot->view(0).payload().to_vector() == corpus.to_message(0).record(0).payload());
+}
+
+TEST_CASE("Corpus snapshot is written for a missing file")
+{
+  auto bytes = make_corpus(3);
+  NDEFCorpus corpus{ bytes.data(), bytes.size() };
+  SnapshotFile file;
+  std::remove(file.path.c_str());
+
+  REQUIRE_THROWS_AS(NDEFCorpusSnapshot(file.path, corpus), NDEFException);
+  REQUIRE(NDEFCorpusSnapshot::open_or_write(file.path, corpus)->record_count() == 10);
+
+  NDEFCorpus empty{ nullptr, 0 };
+  NDEFCorpusSnapshot::write(file.path, empty);
+  NDEFCorpusSnapshot snapshot{ file.path, empty };
+  REQUIRE(snapshot.message_count() == 0);
+  REQUIRE(snapshot.record_count() == 0);
+}
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/exemplar-recorder.hpp"
+
+namespace {
+using Clock = ExemplarRecorder::Clock;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+/// Uninstalls the recorder at the end of a test, even a failing one
+struct InstalledRecorder
+{
+  explicit InstalledRecorder(std::shared_ptr<ExemplarRecorder> recorder) { ExemplarRecorder::install(recorder); }
+  ~InstalledRecorder() { ExemplarRecorder::install(nullptr); }
+};
+
+std::vector<uint8_t> make_bytes(size_t len, uint8_t value) { return std::vector<uint8_t>(len, value); }
+} // namespace
+
+TEST_CASE("Exemplar recorder keeps the slowest operations of each window")
+{
+  ExemplarOptions options;
+  options.slowest = 3;
+  options.window = milliseconds{ 1000 };
+  options.windows_kept = 2;
+  options.max_input_bytes = 8;
+  ExemplarRecorder recorder{ options };
+
+  const auto origin = Clock::now();
+  auto offer = [&](CodecOperation operation, int64_t finished_ms, int64_t duration_ns, uint8_t marker) {
+    auto end = origin + milliseconds{ finished_ms };
+    auto bytes = make_bytes(16, marker);
+    recorder.offer(operation, end - nanoseconds{ duration_ns }, end, bytes.data(), bytes.size(), nullptr);
+  };
+
+  // Window 0: six decodes, of which the three slowest are kept, and one encode
+  offer(CodecOperation::Decode, 0, 500, 1);
+  offer(CodecOperation::Decode, 10, 900, 2);
+  offer(CodecOperation::Decode, 20, 100, 3);
+  offer(CodecOperation::Decode, 30, 700, 4);
+  offer(CodecOperation::Decode, 40, 300, 5);
+  offer(CodecOperation::Decode, 50, 800, 6);
+  offer(CodecOperation::Encode, 60, 50, 7);
+
+  auto decodes = recorder.exemplars(CodecOperation::Decode);
+  REQUIRE(decodes.size() == 3);
+  REQUIRE(decodes[0].duration == nanoseconds{ 900 });
+  REQUIRE(decodes[1].duration == nanoseconds{ 800 });
+  REQUIRE(decodes[2].duration == nanoseconds{ 700 });
+  REQUIRE(decodes[0].bytes == make_bytes(8, 2));
+  REQUIRE(decodes[0].input_length == 16);
+  REQUIRE(decodes[0].failed);
+  REQUIRE(decodes[0].window == 0);
+  REQUIRE(recorder.exemplars(CodecOperation::Encode).size() == 1);
+
+  SUBCASE("windows roll over and only the newest are kept")
+  {
+    offer(CodecOperation::Decode, 1500, 10, 8);
+    offer(CodecOperation::Decode, 2500, 20, 9);
+
+    decodes = recorder.exemplars(CodecOperation::Decode);
+    REQUIRE(decodes.size() == 2);
+    REQUIRE(decodes[0].window == 2);
+    REQUIRE(decodes[0].bytes[0] == 9);
+    REQUIRE(decodes[1].window == 1);
+    REQUIRE(recorder.exemplars(CodecOperation::Encode).empty());
+  }
+
+  SUBCASE("clear drops every kept operation")
+  {
+    recorder.clear();
+    REQUIRE(recorder.exemplars(CodecOperation::Decode).empty());
+
+    offer(CodecOperation::Decode, 100, 1, 10);
+    REQUIRE(recorder.exemplars(CodecOperation::Decode).size() == 1);
+  }
+
+  options.slowest = 0;
+  REQUIRE_THROWS_AS(ExemplarRecorder{ options }, NDEFException);
+}
+
+TEST_CASE("Installed exemplar recorder sees from_bytes and as_bytes")
+{
+  ExemplarOptions options;
+  options.slowest = 4;
+  auto recorder = std::make_shared<ExemplarRecorder>(options);
+
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/tag"));
+  msg.append_record(NDEFRecord{ make_bytes(300, 0x5A), NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:x" },
+                                "id-1" });
+
+  REQUIRE(ExemplarRecorder::installed() == nullptr);
+  const auto bytes = msg.as_bytes();
+  REQUIRE(NDEFMessage::from_bytes(bytes).record_count() == 2);
+
+  {
+    InstalledRecorder installed{ recorder };
+    REQUIRE(ExemplarRecorder::installed() == recorder);
+
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(NDEFMessage::from_bytes(bytes).record_count() == 2);
+      REQUIRE(msg.as_bytes() == bytes);
+    }
+
+    std::vector<uint8_t> truncated{ bytes.begin(), bytes.begin() + 40 };
+    REQUIRE_THROWS_AS(NDEFMessage::from_bytes(truncated), NDEFException);
+  }
+
+  REQUIRE(ExemplarRecorder::installed() == nullptr);
+  auto decodes = recorder->exemplars(CodecOperation::Decode);
+  auto encodes = recorder->exemplars(CodecOperation::Encode);
+  REQUIRE(decodes.size() == 4);
+  REQUIRE(encodes.size() == 4);
+
+  for (size_t i = 1; i < decodes.size(); i++) {
+    REQUIRE(decodes[i - 1].duration >= decodes[i].duration);
+  }
+
+  auto& encoded = encodes[0];
+  REQUIRE(encoded.bytes == bytes);
+  REQUIRE(encoded.input_length == bytes.size());
+  REQUIRE_FALSE(encoded.failed);
+  REQUIRE(encoded.records.size() == 2);
+  REQUIRE(encoded.records[0].tnf == NDEFRecordType::TypeID::WellKnown);
+  REQUIRE(encoded.records[0].type_length == 1);
+  REQUIRE(encoded.records[1].tnf == NDEFRecordType::TypeID::External);
+  REQUIRE(encoded.records[1].type_length == 10);
+  REQUIRE(encoded.records[1].id_length == 4);
+  REQUIRE(encoded.records[1].payload_length == 300);
+
+  // Calls made once the recorder is uninstalled are not seen
+  recorder->clear();
+  msg.as_bytes();
+  REQUIRE(recorder->exemplars(CodecOperation::Encode).empty());
+}
+
+TEST_CASE("Exemplar recorder dumps kept operations as text")
+{
+  ExemplarOptions options;
+  options.max_input_bytes = 3;
+  ExemplarRecorder recorder{ options };
+
+  NDEFRecordList records{ NDEFRecord::create_uri_record("https://example.com") };
+  const std::vector<uint8_t> bytes{ 0xD1, 0x01, 0x0C, 0x55 };
+  const auto end = Clock::now();
+  recorder.offer(CodecOperation::Decode, end - nanoseconds{ 1234 }, end, bytes.data(), bytes.size(), &records);
+
+  std::string path = "/tmp/ndef-exemplars-" + std::to_string(end.time_since_epoch().count()) + ".txt";
+  recorder.dump(path);
+
+  std::ifstream file{ path };
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::remove(path.c_str());
+
+  std::string header, record, hex;
+  std::getline(contents, header);
+  std::getline(contents, record);
+  std::getline(contents, hex);
+
+  REQUIRE(header.find("exemplar operation=decode window=0 ") == 0);
+  REQUIRE(header.find(" duration_ns=1234 failed=0 input_length=4 records=1") != std::string::npos);
+  REQUIRE(record == "record tnf=1 type_length=1 id_length=0 payload_length=12");
+  REQUIRE(hex == "bytes d1010c");
+
+  REQUIRE_THROWS_AS(recorder.dump("/nonexistent-dir/exemplars.txt"), NDEFException);
+}
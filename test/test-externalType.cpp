@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/external-type.hpp"
+#include "ndef-lite/message.hpp"
+
+namespace {
+using TypeID = NDEFRecordType::TypeID;
+
+NDEFRecord external_record(const std::string& name, const std::string& payload = "")
+{
+  return NDEFRecord{ std::vector<uint8_t>{ payload.begin(), payload.end() }, NDEFRecordType{ TypeID::External, name } };
+}
+
+ByteSpan span(const std::string& value)
+{
+  return ByteSpan{ reinterpret_cast<const uint8_t*>(value.data()), value.size() };
+}
+} // namespace
+
+TEST_CASE("External type names split into domain and type views")
+{
+  NDEFExternalType name;
+
+  std::string full = "Acme.COM:sensor:v2";
+  REQUIRE(NDEFExternalType::parse(span(full), name));
+  REQUIRE(name.domain.data == reinterpret_cast<const uint8_t*>(full.data()));
+  REQUIRE(name.domain == "Acme.COM");
+  REQUIRE(name.type == "sensor:v2");
+  REQUIRE(name.domain_is("acme.com"));
+  REQUIRE_FALSE(name.domain_is("acme.co"));
+
+  REQUIRE(NDEFExternalType::parse(span("example.com:"), name));
+  REQUIRE(name.type.empty());
+
+  REQUIRE_FALSE(NDEFExternalType::parse(span("no-colon"), name));
+  REQUIRE_FALSE(NDEFExternalType::parse(span(":type"), name));
+  REQUIRE_FALSE(NDEFExternalType::parse(span(""), name));
+}
+
+TEST_CASE("External records dispatch by domain and type")
+{
+  std::vector<std::string> calls;
+  auto record_call = [&calls](const std::string& label) {
+    return [&calls, label](const NDEFRecordView& record, const NDEFExternalType& name) {
+      calls.push_back(label + " " + name.type.to_string() + " " + record.payload().to_string());
+    };
+  };
+
+  auto table = NDEFExternalDispatch::compile({
+      { "android.com", "pkg", record_call("launch") },
+      { "ACME.com", "sensor", record_call("sensor") },
+      { "acme.com", "*", record_call("acme") },
+  });
+
+  NDEFMessage msg;
+  msg.append_record(external_record("android.com:pkg", "com.example.app"));
+  msg.append_record(external_record("acme.com:sensor", "21C"));
+  msg.append_record(external_record("Acme.Com:door", "open"));
+  msg.append_record(external_record("acme.com:Sensor", "case"));
+  msg.append_record(external_record("other.com:pkg", "x"));
+  msg.append_record(NDEFRecord::create_uri_record("https://acme.com"));
+  msg.append_record(NDEFRecord{ std::vector<uint8_t>{ 1 }, NDEFRecordType{ TypeID::MIMEMedia, "android.com:pkg" } });
+  auto bytes = msg.as_bytes();
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  std::vector<bool> handled;
+  for (size_t i = 0; i < view.record_count(); i++) {
+    handled.push_back(table.dispatch(view.record(i)));
+  }
+
+  REQUIRE(handled == std::vector<bool>{ true, true, true, true, false, false, false });
+  REQUIRE(calls == std::vector<std::string>{ "launch pkg com.example.app", "sensor sensor 21C", "acme door open",
+                                             "acme Sensor case" });
+
+  REQUIRE(is_android_application_record(view.record(0)));
+  REQUIRE_FALSE(is_android_application_record(view.record(4)));
+  REQUIRE_FALSE(is_android_application_record(view.record(6)));
+
+  REQUIRE(NDEFExternalDispatch{}.lookup(view.record(0)) == nullptr);
+  REQUIRE_THROWS_AS(NDEFExternalDispatch::compile({ { "a.com", "x", {} }, { "A.com", "x", {} } }), NDEFException);
+}
+
+TEST_CASE("Dispatch table holds many routes")
+{
+  std::vector<NDEFExternalDispatch::Route> routes;
+  std::vector<int> hits(500, 0);
+  for (int i = 0; i < 500; i++) {
+    routes.push_back({ "d" + std::to_string(i % 50) + ".com", "t" + std::to_string(i / 50),
+                       [&hits, i](const NDEFRecordView&, const NDEFExternalType&) { hits[i]++; } });
+  }
+  auto table = NDEFExternalDispatch::compile(routes);
+
+  NDEFMessage msg;
+  for (int i = 0; i < 500; i++) {
+    msg.append_record(external_record("D" + std::to_string(i % 50) + ".COM:t" + std::to_string(i / 50)));
+  }
+  auto bytes = msg.as_bytes();
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  for (size_t i = 0; i < view.record_count(); i++) {
+    REQUIRE(table.dispatch(view.record(i)));
+  }
+  REQUIRE(std::all_of(hits.begin(), hits.end(), [](int count) { return count == 1; }));
+}
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/ingest.hpp"
+
+namespace {
+/// Capture file that deletes itself
+struct CaptureFile
+{
+  explicit CaptureFile(const std::vector<uint8_t>& bytes)
+  {
+    char name[] = "/tmp/ndef-ingest-XXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    close(fd);
+    path = name;
+  }
+  ~CaptureFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+std::vector<uint8_t> make_capture(size_t first, size_t count)
+{
+  std::vector<uint8_t> bytes;
+
+  for (size_t i = first; i < first + count; i++) {
+    NDEFMessage msg;
+    msg.append_record(NDEFRecord::create_text_record(std::string(i % 300, 'a'), "en"));
+    msg.append_record(NDEFRecord::create_uri_record("https://example.com/" + std::to_string(i)));
+
+    auto encoded = msg.as_bytes();
+    bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+  }
+
+  return bytes;
+}
+} // namespace
+
+TEST_CASE("Ingest frames messages that straddle blocks in file order")
+{
+  CaptureFile first{ make_capture(0, 400) };
+  CaptureFile empty{ {} };
+  CaptureFile second{ make_capture(400, 100) };
+
+  for (bool use_io_uring : { true, false }) {
+    IngestOptions options;
+    options.block_size = 100;
+    options.queue_depth = 4;
+    options.use_io_uring = use_io_uring;
+
+    std::vector<std::string> uris;
+    NDEFCaptureIngest ingest{ options };
+    auto stats = ingest.ingest({ first.path, empty.path, second.path }, [&uris](const NDEFMessageView& view) {
+      uris.push_back(view.to_message().record(1).get_uri());
+    });
+
+    REQUIRE(uris.size() == 500);
+    for (size_t i = 0; i < uris.size(); i++) {
+      REQUIRE(uris[i] == "example.com/" + std::to_string(i));
+    }
+
+    CHECK(stats.files == 3);
+    CHECK(stats.messages == 500);
+    CHECK(stats.bytes_read == make_capture(0, 500).size());
+    CHECK(stats.submissions > 0);
+    if (!use_io_uring) {
+      CHECK_FALSE(stats.used_io_uring);
+    }
+  }
+}
+
+TEST_CASE("Ingest hands messages to decode workers")
+{
+  CaptureFile capture{ make_capture(0, 1000) };
+
+  IngestOptions options;
+  options.block_size = 4096;
+  options.workers = 3;
+
+  std::atomic<size_t> messages{ 0 };
+  std::atomic<size_t> records{ 0 };
+  NDEFCaptureIngest ingest{ options };
+  ingest.ingest({ capture.path }, [&](const NDEFMessageView& view) {
+    messages++;
+    records += view.record_count();
+  });
+
+  REQUIRE(messages == 1000);
+  REQUIRE(records == 2000);
+}
+
+TEST_CASE("Ingest rethrows handler failures from workers")
+{
+  CaptureFile capture{ make_capture(0, 200) };
+
+  IngestOptions options;
+  options.block_size = 512;
+  options.workers = 2;
+
+  NDEFCaptureIngest ingest{ options };
+  REQUIRE_THROWS_WITH(ingest.ingest({ capture.path }, [](const NDEFMessageView&) { throw NDEFException("handler"); }),
+                      "handler");
+}
+
+TEST_CASE("Ingest rejects bad capture files")
+{
+  NDEFCaptureIngest ingest;
+  auto ignore = [](const NDEFMessageView&) {};
+
+  auto truncated = make_capture(0, 3);
+  truncated.pop_back();
+  CaptureFile truncated_file{ truncated };
+  auto expected = "Capture file " + truncated_file.path + " ends in the middle of a message";
+  REQUIRE_THROWS_WITH(ingest.ingest({ truncated_file.path }, ignore), expected.c_str());
+
+  CaptureFile malformed_file{ invalid_record_bytes };
+  REQUIRE_THROWS_AS(ingest.ingest({ malformed_file.path }, ignore), NDEFException);
+
+  REQUIRE_THROWS_AS(ingest.ingest({ "/nonexistent/capture" }, ignore), NDEFException);
+}
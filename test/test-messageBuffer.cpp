@@ -0,0 +1,207 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message-buffer.hpp"
+
+namespace {
+NDEFMessage make_message()
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/"));
+  msg.append_record(NDEFRecord::create_text_record("hello", "en"));
+  msg.append_record(NDEFRecord{ std::vector<uint8_t>(300, 0x5A),
+                                NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:sensor" }, "s1" });
+  return msg;
+}
+
+/// Checks the edited bytes against the encoding of \p expected, and the edited index against framing them afresh
+void check_buffer(const NDEFMessageBuffer& buffer, const NDEFMessage& expected)
+{
+  auto& view = buffer.view();
+  std::vector<uint8_t> bytes{ buffer.bytes().begin(), buffer.bytes().begin() + view.size() };
+  REQUIRE(bytes == expected.as_bytes());
+  REQUIRE(view.data() == buffer.bytes().data());
+
+  NDEFMessageView framed{ buffer.bytes().data(), buffer.bytes().size() };
+  REQUIRE(framed.size() == view.size());
+  REQUIRE(framed.record_count() == view.record_count());
+  for (size_t i = 0; i < view.record_count(); i++) {
+    REQUIRE(framed.record(i).data() == view.record(i).data());
+    REQUIRE(framed.record(i).header() == view.record(i).header());
+    REQUIRE(framed.record(i).layout().payload_offset == view.record(i).layout().payload_offset);
+    REQUIRE(framed.record(i).layout().total_length == view.record(i).layout().total_length);
+  }
+}
+} // namespace
+
+TEST_CASE("Message buffer replaces record fields in place")
+{
+  auto expected = make_message();
+  NDEFMessageBuffer buffer;
+  buffer.assign(expected.as_bytes());
+
+  SUBCASE("payload")
+  {
+    auto uri = NDEFRecord::create_uri_record("https://example.org/a/much/longer/path");
+    buffer.replace_payload(0, uri.payload());
+    expected.set_record(uri, 0);
+    check_buffer(buffer, expected);
+
+    // Growing past 255 bytes switches the record to a long payload length, and back
+    NDEFRecord text = NDEFRecord::create_text_record(std::string(400, 'x'), "en");
+    buffer.replace_payload(1, text.payload());
+    expected.set_record(text, 1);
+    check_buffer(buffer, expected);
+    REQUIRE_FALSE(buffer.view().record(1).header().sr);
+
+    text = NDEFRecord::create_text_record("bye", "en");
+    buffer.replace_payload(1, text.payload());
+    expected.set_record(text, 1);
+    check_buffer(buffer, expected);
+
+    buffer.replace_payload(2, std::vector<uint8_t>{});
+    expected.set_record(NDEFRecord{ std::vector<uint8_t>{}, expected.record(2).type(), "s1" }, 2);
+    check_buffer(buffer, expected);
+  }
+
+  SUBCASE("type")
+  {
+    NDEFRecordType type{ NDEFRecordType::TypeID::MIMEMedia, "application/octet-stream" };
+    buffer.replace_type(2, type);
+    expected.set_record(NDEFRecord{ std::vector<uint8_t>(300, 0x5A), type, "s1" }, 2);
+    check_buffer(buffer, expected);
+
+    REQUIRE_THROWS_AS(buffer.replace_type(0, NDEFRecordType{ NDEFRecordType::TypeID::External, "a\nb" }),
+                      NDEFException);
+    REQUIRE_THROWS_AS(buffer.replace_type(0, NDEFRecordType{ NDEFRecordType::TypeID::External, std::string(256, 'a') }),
+                      NDEFException);
+    check_buffer(buffer, expected);
+  }
+
+  SUBCASE("TNF field rules")
+  {
+    // Empty records hold nothing, Unknown and Unchanged records have no TYPE
+    REQUIRE_THROWS_AS(buffer.replace_type(2, NDEFRecordType{ NDEFRecordType::TypeID::Empty }), NDEFException);
+    REQUIRE_THROWS_AS(buffer.replace_type(0, NDEFRecordType{ NDEFRecordType::TypeID::Unknown, "U" }), NDEFException);
+    REQUIRE_THROWS_AS(buffer.replace_type(0, NDEFRecordType{ NDEFRecordType::TypeID::Unchanged, "U" }), NDEFException);
+    check_buffer(buffer, expected);
+
+    NDEFRecordType unknown{ NDEFRecordType::TypeID::Unknown };
+    buffer.replace_type(0, unknown);
+    expected.set_record(NDEFRecord{ expected.record(0).payload(), unknown }, 0);
+    check_buffer(buffer, expected);
+
+    buffer.replace_payload(0, std::vector<uint8_t>{});
+    buffer.replace_type(0, NDEFRecordType{ NDEFRecordType::TypeID::Empty });
+    expected.set_record(NDEFRecord{}, 0);
+    check_buffer(buffer, expected);
+
+    REQUIRE_THROWS_AS(buffer.replace_payload(0, std::vector<uint8_t>{ 1 }), NDEFException);
+    REQUIRE_THROWS_AS(buffer.replace_id(0, "id"), NDEFException);
+    check_buffer(buffer, expected);
+  }
+
+  SUBCASE("id")
+  {
+    buffer.replace_id(0, "link");
+    auto uri = expected.record(0);
+    expected.set_record(NDEFRecord{ uri.payload(), uri.type(), "link" }, 0);
+    check_buffer(buffer, expected);
+
+    buffer.replace_id(2, "");
+    expected.set_record(NDEFRecord{ std::vector<uint8_t>(300, 0x5A), expected.record(2).type() }, 2);
+    check_buffer(buffer, expected);
+    REQUIRE_FALSE(buffer.view().record(2).header().il);
+
+    REQUIRE_THROWS_AS(buffer.replace_id(1, std::string(256, 'a')), NDEFException);
+  }
+
+  REQUIRE_THROWS_AS(buffer.replace_payload(3, std::vector<uint8_t>{ 1 }), std::out_of_range);
+}
+
+TEST_CASE("Message buffer inserts, removes and reorders records")
+{
+  auto expected = make_message();
+  NDEFMessageBuffer buffer;
+  buffer.assign(expected.as_bytes());
+
+  auto record = NDEFRecord::create_text_record("inserted", "en");
+  for (size_t index : { 0, 2, 5 }) {
+    buffer.insert_record(index, record);
+    expected.insert_record(record, index);
+    check_buffer(buffer, expected);
+  }
+
+  // Records can be copied from any view, this one included
+  buffer.insert_record(1, buffer.view().record(4));
+  expected.insert_record(expected.record(4), 1);
+  check_buffer(buffer, expected);
+
+  for (auto move : { std::make_pair(0, 6), std::make_pair(6, 0), std::make_pair(2, 4), std::make_pair(5, 1) }) {
+    buffer.move_record(move.first, move.second);
+    auto moved = expected.record(move.first);
+    expected.remove_record(move.first);
+    expected.insert_record(moved, move.second);
+    check_buffer(buffer, expected);
+  }
+
+  for (size_t index : { 6, 0, 2 }) {
+    buffer.remove_record(index);
+    expected.remove_record(index);
+    check_buffer(buffer, expected);
+  }
+
+  REQUIRE_THROWS_AS(buffer.insert_record(5, record), std::out_of_range);
+  REQUIRE_THROWS_AS(buffer.move_record(0, 4), std::out_of_range);
+
+  while (buffer.view().record_count() > 0) {
+    buffer.remove_record(0);
+  }
+  REQUIRE(buffer.view().size() == 0);
+
+  buffer.insert_record(0, record);
+  check_buffer(buffer, NDEFMessage{ record });
+}
+
+TEST_CASE("Message buffer concatenates and splits messages")
+{
+  auto first = make_message();
+  NDEFMessage second{ NDEFRecord::create_text_record("second", "en") };
+
+  NDEFMessageBuffer buffer;
+  buffer.assign(first.as_bytes());
+  NDEFMessageBuffer other;
+  other.assign(second.as_bytes());
+
+  buffer.append(other);
+  auto expected = first;
+  expected.append_record(second.record(0));
+  check_buffer(buffer, expected);
+
+  auto tail = buffer.split(3);
+  check_buffer(buffer, first);
+  check_buffer(tail, second);
+
+  tail = buffer.split(1);
+  check_buffer(buffer, NDEFMessage{ first.record(0) });
+  check_buffer(tail, NDEFMessage{ NDEFRecordList{ first.record(1), first.record(2) } });
+
+  REQUIRE(buffer.split(1).view().record_count() == 0);
+  REQUIRE_THROWS_AS(buffer.split(2), std::out_of_range);
+
+  buffer.append(buffer);
+  check_buffer(buffer, NDEFMessage{ NDEFRecordList{ first.record(0), first.record(0) } });
+
+  // Bytes after the message are left alone by every edit
+  auto bytes = second.as_bytes();
+  bytes.push_back(0xEE);
+  other.assign(bytes);
+  other.append(tail);
+  other.replace_payload(0, std::vector<uint8_t>(20, 'a'));
+  REQUIRE(other.bytes().size() == other.view().size() + 1);
+  REQUIRE(other.bytes().back() == 0xEE);
+}
@@ -0,0 +1,105 @@
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/parser.hpp"
+
+namespace {
+/// Builds a message of n copies of the short text record, correctly flagged
+std::vector<uint8_t> repeated_text_message(size_t n)
+{
+  NDEFMessage msg;
+  for (size_t i = 0; i < n; i++) {
+    msg.append_record(NDEFRecord::from_bytes(valid_text_record_bytes_sr));
+  }
+
+  return msg.as_bytes();
+}
+} // namespace
+
+TEST_CASE("Parser decodes whole message fed at once")
+{
+  NDEFMessageParser parser;
+  parser.feed(valid_text_record_bytes_sr);
+
+  REQUIRE(parser.decode() == DecodeStatus::Complete);
+  REQUIRE(parser.is_complete());
+  REQUIRE(parser.record_count() == 1);
+  REQUIRE(parser.bytes_consumed() == valid_text_record_bytes_sr.size());
+  REQUIRE(parser.message().as_bytes() == valid_text_record_bytes_sr);
+}
+
+TEST_CASE("Parser decodes message fed one byte at a time")
+{
+  auto bytes = repeated_text_message(3);
+  NDEFMessageParser parser;
+
+  for (size_t i = 0; i < bytes.size() - 1; i++) {
+    parser.feed(&bytes.at(i), 1);
+    REQUIRE(parser.decode() == DecodeStatus::NeedMoreData);
+  }
+
+  parser.feed(&bytes.back(), 1);
+  REQUIRE(parser.decode() == DecodeStatus::Complete);
+  REQUIRE(parser.message().as_bytes() == bytes);
+}
+
+TEST_CASE("Parser record budget resumes without re-decoding")
+{
+  auto bytes = repeated_text_message(5);
+  NDEFMessageParser parser;
+  parser.feed(bytes);
+
+  REQUIRE(parser.decode(DecodeBudget::records(2)) == DecodeStatus::BudgetExhausted);
+  REQUIRE(parser.record_count() == 2);
+  REQUIRE(parser.decode(DecodeBudget::records(2)) == DecodeStatus::BudgetExhausted);
+  REQUIRE(parser.record_count() == 4);
+  REQUIRE(parser.decode(DecodeBudget::records(2)) == DecodeStatus::Complete);
+  REQUIRE(parser.record_count() == 5);
+  REQUIRE(parser.message().as_bytes() == bytes);
+}
+
+TEST_CASE("Parser byte budget always makes progress")
+{
+  auto bytes = repeated_text_message(3);
+  NDEFMessageParser parser;
+  parser.feed(bytes);
+
+  // Budget is smaller than a single record, each call must still decode one
+  REQUIRE(parser.decode(DecodeBudget::bytes(1)) == DecodeStatus::BudgetExhausted);
+  REQUIRE(parser.record_count() == 1);
+
+  // Budget fits exactly two records
+  REQUIRE(parser.decode(DecodeBudget::bytes(2 * valid_text_record_bytes_sr.size())) == DecodeStatus::Complete);
+  REQUIRE(parser.record_count() == 3);
+}
+
+TEST_CASE("Parser take_message keeps bytes of the following message")
+{
+  auto bytes = repeated_text_message(2);
+  bytes.insert(bytes.end(), valid_text_record_bytes_sr.begin(), valid_text_record_bytes_sr.end());
+
+  NDEFMessageParser parser;
+  parser.feed(bytes);
+
+  REQUIRE(parser.decode() == DecodeStatus::Complete);
+  REQUIRE(parser.take_message().record_count() == 2);
+  REQUIRE_FALSE(parser.is_complete());
+  REQUIRE(parser.bytes_buffered() == valid_text_record_bytes_sr.size());
+
+  REQUIRE(parser.decode() == DecodeStatus::Complete);
+  REQUIRE(parser.take_message().record_count() == 1);
+}
+
+TEST_CASE("Parser throws on malformed type field")
+{
+  auto bytes = valid_text_record_bytes_sr;
+  bytes.at(3) = 0x7f;
+
+  NDEFMessageParser parser;
+  parser.feed(bytes);
+
+  REQUIRE_THROWS_AS(parser.decode(), NDEFException);
+}
@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/payload-source.hpp"
+
+namespace {
+/// Temporary file that deletes itself
+struct TempFile
+{
+  explicit TempFile(const std::vector<uint8_t>& bytes = {})
+  {
+    char name[] = "/tmp/ndef-payload-XXXXXX";
+    fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    path = name;
+  }
+  ~TempFile()
+  {
+    close(fd);
+    std::remove(path.c_str());
+  }
+
+  std::vector<uint8_t> contents() const
+  {
+    std::vector<uint8_t> bytes(lseek(fd, 0, SEEK_END));
+    REQUIRE(pread(fd, bytes.data(), bytes.size(), 0) == static_cast<ssize_t>(bytes.size()));
+    return bytes;
+  }
+
+  std::string path;
+  int fd;
+};
+
+std::vector<uint8_t> make_blob(size_t size)
+{
+  std::vector<uint8_t> blob(size);
+  for (size_t i = 0; i < size; i++) {
+    blob[i] = static_cast<uint8_t>(i * 31 + i / 251);
+  }
+  return blob;
+}
+
+const NDEFRecordType firmware_type{ NDEFRecordType::TypeID::MIMEMedia, "application/octet-stream" };
+} // namespace
+
+TEST_CASE("File backed payload encodes like an in-memory payload")
+{
+  auto blob = make_blob(300000);
+  TempFile file{ blob };
+
+  NDEFRecord external{ NDEFPayloadSource::from_file(file.path, 1000, 5000), firmware_type };
+  NDEFRecord internal{ std::vector<uint8_t>(blob.begin() + 1000, blob.begin() + 6000), firmware_type };
+
+  REQUIRE(external.payload_length() == 5000);
+  REQUIRE_FALSE(external.is_short());
+  REQUIRE(external.payload() == internal.payload());
+  REQUIRE(external.as_bytes() == internal.as_bytes());
+
+  // Replacing the payload drops the source
+  external.set_payload({ 1, 2, 3 });
+  REQUIRE(external.payload_source().get() == nullptr);
+  REQUIRE(external.payload_length() == 3);
+}
+
+TEST_CASE("Mapped payload exposes the region in memory")
+{
+  auto blob = make_blob(20000);
+  TempFile file{ blob };
+
+  auto source = NDEFPayloadSource::map_file(file.path, 4097);
+  REQUIRE(source->size() == blob.size() - 4097);
+  REQUIRE(std::vector<uint8_t>(source->data(), source->data() + source->size()) ==
+          std::vector<uint8_t>(blob.begin() + 4097, blob.end()));
+
+  auto empty = NDEFPayloadSource::map_file(file.path, blob.size());
+  REQUIRE(empty->size() == 0);
+  REQUIRE(empty->data() != nullptr);
+}
+
+TEST_CASE("Message with external payloads writes the same bytes as as_bytes")
+{
+  auto blob = make_blob(200000);
+  TempFile source_file{ blob };
+
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record("firmware", "en"));
+  msg.append_record(NDEFRecord{ NDEFPayloadSource::from_file(source_file.path), firmware_type, "fw" });
+  msg.append_record(NDEFRecord{ NDEFPayloadSource::map_file(source_file.path, 10, 100), firmware_type });
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/firmware"));
+  auto expected = msg.as_bytes();
+
+  SUBCASE("to a file")
+  {
+    TempFile out;
+    msg.write_to(out.fd);
+    REQUIRE(out.contents() == expected);
+  }
+
+  SUBCASE("to a pipe")
+  {
+    // Small enough to fit in the pipe buffer
+    NDEFMessage small;
+    small.append_record(NDEFRecord{ NDEFPayloadSource::from_file(source_file.path, 0, 1000), firmware_type });
+    small.append_record(NDEFRecord::create_text_record("done", "en"));
+    auto small_expected = small.as_bytes();
+
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    small.write_to(fds[1]);
+    close(fds[1]);
+
+    std::vector<uint8_t> received(small_expected.size() + 1);
+    size_t total = 0;
+    ssize_t n;
+    while ((n = read(fds[0], received.data() + total, received.size() - total)) > 0) {
+      total += static_cast<size_t>(n);
+    }
+    close(fds[0]);
+
+    received.resize(total);
+    REQUIRE(received == small_expected);
+  }
+
+  REQUIRE(NDEFMessage::from_bytes(expected).record(1).payload() == blob);
+}
+
+TEST_CASE("Payload regions outside of the file are rejected")
+{
+  auto blob = make_blob(100);
+  TempFile file{ blob };
+
+  REQUIRE_THROWS_AS(NDEFPayloadSource::from_file(file.path, 101), NDEFException);
+  REQUIRE_THROWS_AS(NDEFPayloadSource::from_file(file.path, 50, 51), NDEFException);
+  REQUIRE_THROWS_AS(NDEFPayloadSource::map_file(file.path, 0, 101), NDEFException);
+  REQUIRE_THROWS_AS(NDEFPayloadSource::from_file("/nonexistent/firmware"), NDEFException);
+  REQUIRE(NDEFPayloadSource::from_fd(file.fd, 50, 50)->read() == std::vector<uint8_t>(blob.begin() + 50, blob.end()));
+}
+
+TEST_CASE("Only record payloads are limited to 32 bit lengths")
+{
+  if (sizeof(size_t) <= 4) {
+    return;
+  }
+
+  TempFile file;
+  const uint64_t size = (uint64_t{ 1 } << 32) + 16;
+  REQUIRE(ftruncate(file.fd, static_cast<off_t>(size)) == 0);
+
+  REQUIRE_THROWS_AS(NDEFPayloadSource::from_fd(file.fd), NDEFException);
+  REQUIRE_THROWS_AS(NDEFPayloadSource::from_file(file.path), NDEFException);
+  REQUIRE_THROWS_AS(NDEFPayloadSource::map_file(file.path), NDEFException);
+  REQUIRE(NDEFPayloadSource::map_large_file(file.path)->size() == size);
+  REQUIRE(NDEFPayloadSource::map_large_file(file.path, 16)->size() == size - 16);
+}
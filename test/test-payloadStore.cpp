@@ -0,0 +1,172 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/compression.hpp"
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/payload-store.hpp"
+#include "ndef-lite/record-view.hpp"
+
+namespace {
+std::vector<uint8_t> to_bytes(const std::string& text) { return std::vector<uint8_t>{ text.begin(), text.end() }; }
+
+const NDEFRecordType vcard_type{ NDEFRecordType::TypeID::MIMEMedia, "text/vcard" };
+} // namespace
+
+TEST_CASE("Equal payloads share one stored copy")
+{
+  NDEFPayloadStore store;
+  auto card = to_bytes("BEGIN:VCARD\nFN:Acme Support\nTEL:555-0100\nEND:VCARD");
+
+  auto first = store.intern(card.data(), card.size());
+  auto second = store.intern(std::vector<uint8_t>{ card });
+  auto other = store.intern(to_bytes("something else"));
+
+  REQUIRE(first.get() == second.get());
+  REQUIRE(first.get() != other.get());
+  REQUIRE(first->read() == card);
+
+  auto stats = store.stats();
+  REQUIRE(stats.payloads == 2);
+  REQUIRE(stats.bytes == card.size() + 14);
+  REQUIRE(stats.hits == 1);
+  REQUIRE(stats.misses == 2);
+
+  // Empty payloads are interned like any other
+  auto empty = store.intern(nullptr, 0);
+  REQUIRE(empty->size() == 0);
+  REQUIRE(store.intern(std::vector<uint8_t>{}).get() == empty.get());
+
+  // Hashes depend on every byte
+  auto flipped = card;
+  flipped.back() ^= 1;
+  REQUIRE(NDEFPayloadStore::hash(card.data(), card.size()) != NDEFPayloadStore::hash(flipped.data(), flipped.size()));
+}
+
+TEST_CASE("Records intern their payloads")
+{
+  NDEFPayloadStore store{ 3 };
+  auto card = to_bytes("BEGIN:VCARD\nFN:Acme Support\nEND:VCARD");
+
+  NDEFRecord a{ card, vcard_type, "a" };
+  NDEFRecord b{ card, vcard_type, "b" };
+  REQUIRE(a.payload_handle().get() != b.payload_handle().get());
+
+  auto before = a.as_bytes();
+  store.intern(a);
+  store.intern(b);
+  REQUIRE(a.payload_handle().get() == b.payload_handle().get());
+  REQUIRE(a.as_bytes() == before);
+  REQUIRE(b.payload() == card);
+
+  // Interned payloads are still held in memory rather than coming from a source, so codecs handle them as usual
+  REQUIRE(a.payload_source().get() == nullptr);
+  NDEFRecord repeated{ to_bytes(std::string(200, 'v')), vcard_type };
+  store.intern(repeated);
+  NDEFRecord compressed;
+  REQUIRE(NDEFCompressionCodec{}.encode(repeated, compressed));
+
+  // Copies of a record share its handle without going through the store
+  auto copy = a;
+  REQUIRE(copy.payload_handle().get() == a.payload_handle().get());
+  REQUIRE(store.stats().payloads == 2);
+
+  SUBCASE("setting a new payload leaves the stored copy alone")
+  {
+    copy.set_payload(to_bytes("changed"));
+    REQUIRE(copy.payload() == to_bytes("changed"));
+    REQUIRE(a.payload() == card);
+  }
+}
+
+TEST_CASE("Stored payloads leave the store with their last handle")
+{
+  NDEFPayloadStore store;
+  auto payload = to_bytes("https://acme.com/promo");
+
+  {
+    NDEFRecord record{ store.intern(payload.data(), payload.size()), vcard_type };
+    auto copy = record;
+    REQUIRE(store.stats().payloads == 1);
+  }
+  REQUIRE(store.stats().payloads == 0);
+  REQUIRE(store.stats().bytes == 0);
+
+  // Interning again after release stores a fresh copy
+  store.intern(payload.data(), payload.size());
+  REQUIRE(store.stats().misses == 2);
+
+  // Handles may outlive the store
+  std::shared_ptr<const NDEFPayloadSource> survivor;
+  {
+    NDEFPayloadStore scoped;
+    survivor = scoped.intern(payload.data(), payload.size());
+  }
+  REQUIRE(survivor->read() == payload);
+  survivor.reset();
+}
+
+TEST_CASE("Views decode into records backed by the store")
+{
+  std::vector<uint8_t> encoded;
+  for (int i = 0; i < 20; i++) {
+    NDEFMessage msg{ NDEFRecord::create_uri_record("https://acme.com/" + std::to_string(i % 4)) };
+    auto bytes = msg.as_bytes();
+    encoded.insert(encoded.end(), bytes.begin(), bytes.end());
+  }
+
+  NDEFPayloadStore store;
+  std::vector<NDEFRecord> records;
+  size_t offset = 0;
+  while (offset < encoded.size()) {
+    NDEFMessageView view{ encoded.data() + offset, encoded.size() - offset };
+    records.push_back(store.to_record(view.record(0)));
+    REQUIRE(records.back().as_bytes() == view.record(0).to_record().as_bytes());
+    offset += view.size();
+  }
+
+  REQUIRE(records.size() == 20);
+  REQUIRE(records[0].payload_handle().get() == records[4].payload_handle().get());
+  REQUIRE(records[0].payload_source().get() == nullptr);
+  REQUIRE(records[0].get_uri() == "acme.com/0");
+
+  auto stats = store.stats();
+  REQUIRE(stats.payloads == 4);
+  REQUIRE(stats.hits == 16);
+}
+
+TEST_CASE("Threads intern into the store concurrently")
+{
+  NDEFPayloadStore store{ 4 };
+  const int num_threads = 4;
+  const int num_payloads = 64;
+
+  std::vector<std::vector<std::shared_ptr<const NDEFPayloadSource>>> handles(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&store, &handles, t]() {
+      for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < num_payloads; i++) {
+          auto handle = store.intern(to_bytes("payload-" + std::to_string(i)));
+          // Only the last round is kept, so earlier handles come and go while other threads look them up
+          if (round == 49) {
+            handles[t].push_back(handle);
+          }
+        }
+      }
+    });
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  REQUIRE(store.stats().payloads == num_payloads);
+  for (int i = 0; i < num_payloads; i++) {
+    for (int t = 1; t < num_threads; t++) {
+      REQUIRE(handles[t][i].get() == handles[0][i].get());
+    }
+    REQUIRE(handles[0][i]->read() == to_bytes("payload-" + std::to_string(i)));
+  }
+}
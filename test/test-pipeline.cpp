@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/pipeline.hpp"
+
+namespace {
+/// Message with a text record followed by a URI record
+std::vector<uint8_t> text_and_uri_message(size_t i)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record("message " + std::to_string(i), "en"));
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/" + std::to_string(i)));
+
+  return msg.as_bytes();
+}
+
+/// Source producing \p count messages back to back, cut into chunks of \p chunk_size bytes
+NDEFPipeline::Source chunked_source(size_t count, size_t chunk_size)
+{
+  auto stream = std::make_shared<std::vector<uint8_t>>();
+  for (size_t i = 0; i < count; i++) {
+    auto bytes = text_and_uri_message(i);
+    stream->insert(stream->end(), bytes.begin(), bytes.end());
+  }
+
+  auto pos = std::make_shared<size_t>(0);
+  return [stream, pos, chunk_size](std::vector<uint8_t>& chunk) {
+    if (*pos >= stream->size()) {
+      return false;
+    }
+
+    size_t n = std::min(chunk_size, stream->size() - *pos);
+    chunk.assign(stream->begin() + *pos, stream->begin() + *pos + n);
+    *pos += n;
+    return true;
+  };
+}
+} // namespace
+
+TEST_CASE("Pipeline passes messages through unchanged")
+{
+  std::vector<std::vector<uint8_t>> received;
+
+  NDEFPipeline pipeline;
+  pipeline.source(chunked_source(10, 7)).sink([&](const NDEFMessageBuffer& msg) { received.push_back(msg.bytes()); });
+
+  CooperativeExecutor executor;
+  pipeline.run(executor);
+
+  REQUIRE(received.size() == 10);
+  REQUIRE(received.at(3) == text_and_uri_message(3));
+  REQUIRE(pipeline.stats().messages_in == 10);
+  REQUIRE(pipeline.stats().messages_out == 10);
+}
+
+TEST_CASE("Pipeline filter by type splices out other records")
+{
+  std::vector<std::string> uris;
+
+  NDEFPipeline pipeline;
+  pipeline.source(chunked_source(5, 64))
+      .filter_type(NDEFRecordType::uri_record_type())
+      .sink([&](const NDEFMessageBuffer& msg) {
+        REQUIRE(msg.view().record_count() == 1);
+        REQUIRE(msg.view().record(0).header().mb);
+        REQUIRE(msg.view().record(0).header().me);
+        uris.push_back(msg.view().record(0).to_record().get_uri());
+      });
+
+  CooperativeExecutor executor;
+  pipeline.run(executor);
+
+  REQUIRE(uris.size() == 5);
+  REQUIRE(uris.at(4) == "example.com/4");
+}
+
+TEST_CASE("Pipeline drops messages with no matching records")
+{
+  size_t received = 0;
+
+  NDEFPipeline pipeline;
+  pipeline.source(chunked_source(5, 64))
+      .filter_type(NDEFRecordType{ NDEFRecordType::TypeID::External, "acme.com:x" })
+      .sink([&](const NDEFMessageBuffer&) { received++; });
+
+  CooperativeExecutor executor;
+  pipeline.run(executor);
+
+  REQUIRE(received == 0);
+  REQUIRE(pipeline.stats().messages_dropped == 5);
+}
+
+TEST_CASE("Pipeline transform re-encodes messages on stage threads with backpressure")
+{
+  std::vector<size_t> counts;
+  PipelineOptions options;
+  options.queue_capacity = 2;
+  options.batch_size = 3;
+
+  NDEFPipeline pipeline{ options };
+  pipeline.source(chunked_source(200, 33))
+      .transform([](NDEFMessage& msg) { msg.append_record(NDEFRecord::create_text_record("added", "en")); })
+      .sink([&](const NDEFMessageBuffer& msg) { counts.push_back(msg.view().record_count()); });
+
+  ThreadPerStageExecutor executor;
+  pipeline.run(executor);
+
+  REQUIRE(counts.size() == 200);
+  REQUIRE(std::all_of(counts.begin(), counts.end(), [](size_t n) { return n == 3; }));
+}
+
+TEST_CASE("Pipeline rethrows stage failures")
+{
+  auto bytes = valid_text_record_bytes_sr;
+  bytes.at(3) = 0x01;
+
+  bool sent = false;
+  NDEFPipeline pipeline;
+  pipeline
+      .source([&](std::vector<uint8_t>& chunk) {
+        chunk = bytes;
+        bool first = !sent;
+        sent = true;
+        return first;
+      })
+      .sink([](const NDEFMessageBuffer&) {});
+
+  ThreadPerStageExecutor executor;
+  REQUIRE_THROWS_AS(pipeline.run(executor), NDEFException);
+}
+
+TEST_CASE("Pipeline rejects truncated source stream")
+{
+  // Cut the stream short after two chunks
+  auto inner = chunked_source(1, 5);
+  size_t chunks = 0;
+
+  NDEFPipeline pipeline;
+  pipeline.source([&](std::vector<uint8_t>& chunk) { return chunks++ < 2 && inner(chunk); })
+      .sink([](const NDEFMessageBuffer&) {});
+
+  CooperativeExecutor executor;
+  REQUIRE_THROWS_WITH(pipeline.run(executor), "Source ended in the middle of a message, 10 bytes left over");
+}
+
+TEST_CASE("Pipeline requires source and sink")
+{
+  NDEFPipeline pipeline;
+  CooperativeExecutor executor;
+
+  REQUIRE_THROWS_AS(pipeline.run(executor), NDEFException);
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/queue.hpp"
+
+TEST_CASE("SPSC queue capacity rounds up to power of two")
+{
+  SPSCQueue<int> queue{ 5 };
+
+  REQUIRE(queue.capacity() == 8);
+}
+
+TEST_CASE("SPSC queue is FIFO and bounded")
+{
+  SPSCQueue<int> queue{ 4 };
+
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(queue.try_push(int{ i }));
+  }
+  REQUIRE_FALSE(queue.try_push(4));
+
+  int value = -1;
+  for (int i = 0; i < 4; i++) {
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(value == i);
+  }
+  REQUIRE_FALSE(queue.try_pop(value));
+}
+
+TEST_CASE("SPSC queue batch push and pop are partial when bounded")
+{
+  SPSCQueue<int> queue{ 4 };
+  std::vector<int> in{ 0, 1, 2, 3, 4, 5 };
+  std::vector<int> out(6, -1);
+
+  REQUIRE(queue.try_push_batch(in.begin(), in.size()) == 4);
+  REQUIRE(queue.try_pop_batch(out.begin(), out.size()) == 4);
+  REQUIRE(out.at(3) == 3);
+  REQUIRE(out.at(4) == -1);
+}
+
+TEST_CASE("SPSC queue preserves order across threads")
+{
+  SPSCQueue<size_t> queue{ 64 };
+  const size_t count = 20000;
+
+  std::thread producer([&]() {
+    for (size_t i = 0; i < count; i++) {
+      while (!queue.try_push(size_t{ i })) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  bool in_order = true;
+  size_t value;
+  for (size_t expected = 0; expected < count;) {
+    if (queue.try_pop(value)) {
+      in_order &= (value == expected++);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  REQUIRE(in_order);
+}
+
+TEST_CASE("MPMC queue delivers every item exactly once")
+{
+  MPMCQueue<size_t> queue{ 128 };
+  const size_t producers = 4;
+  const size_t per_producer = 4000;
+
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]() {
+      // Alternate between single and batch pushes to exercise both claim paths
+      std::vector<size_t> batch;
+      for (size_t i = 0; i < per_producer; i += 4) {
+        batch = { p * per_producer + i, p * per_producer + i + 1, p * per_producer + i + 2,
+                  p * per_producer + i + 3 };
+        size_t pushed = 0;
+        while (pushed < batch.size()) {
+          size_t n = queue.try_push_batch(batch.begin() + pushed, batch.size() - pushed);
+          if (n == 0) {
+            std::this_thread::yield();
+          }
+          pushed += n;
+        }
+      }
+    });
+  }
+
+  std::atomic<size_t> total_received{ 0 };
+  std::vector<std::vector<size_t>> received(2);
+  for (size_t c = 0; c < received.size(); c++) {
+    threads.emplace_back([&, c]() {
+      size_t buf[8];
+      while (total_received.load() < producers * per_producer) {
+        size_t n = queue.try_pop_batch(buf, (c == 0) ? 1 : 8);
+        received.at(c).insert(received.at(c).end(), buf, buf + n);
+        total_received += n;
+        if (n == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<bool> seen(producers * per_producer, false);
+  bool duplicate = false;
+  for (auto&& values : received) {
+    for (auto&& v : values) {
+      duplicate |= seen.at(v);
+      seen.at(v) = true;
+    }
+  }
+
+  REQUIRE_FALSE(duplicate);
+  REQUIRE(std::find(seen.begin(), seen.end(), false) == seen.end());
+}
+
+TEST_CASE("Recycling channel returns buffers to the producer")
+{
+  RecyclingChannel<NDEFMessageBuffer> channel{ 4 };
+
+  auto buffer = channel.acquire();
+  buffer.assign(valid_text_record_bytes_sr);
+  const uint8_t* storage = buffer.bytes().data();
+  REQUIRE(channel.try_send(std::move(buffer)));
+
+  NDEFMessageBuffer received;
+  REQUIRE(channel.try_receive(received));
+  REQUIRE(received.view().record(0).type() == "T");
+  channel.release(std::move(received));
+
+  // The same storage comes back for the next message
+  auto reused = channel.acquire();
+  reused.assign(valid_text_record_bytes_sr);
+  REQUIRE(reused.bytes().data() == storage);
+}
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/read-session.hpp"
+#include "ndef-lite/tag-sim.hpp"
+
+namespace {
+NDEFMessage make_message(size_t text_length)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record(std::string(text_length, 'a'), "en"));
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/"));
+  msg.append_record(NDEFRecord::create_text_record(std::string(text_length, 'b'), "en"));
+  return msg;
+}
+
+NDEFReadSession session_of(size_t len)
+{
+  NDEFReadSession session;
+  session.bytes.assign(len, 0xAA);
+  return session;
+}
+} // namespace
+
+TEST_CASE("Read session cache keeps sessions by UID")
+{
+  ReadSessionOptions options;
+  options.max_sessions = 2;
+  NDEFReadSessionCache sessions{ options };
+
+  const std::vector<uint8_t> first{ 1 }, second{ 2 }, third{ 3 };
+  sessions.store(first, session_of(10));
+  sessions.store(second, session_of(20));
+  sessions.store(first, session_of(11));
+  REQUIRE(sessions.size() == 2);
+
+  // The cache is full, so the session stored longest ago goes
+  sessions.store(third, session_of(30));
+  REQUIRE(sessions.size() == 2);
+
+  NDEFReadSession session;
+  REQUIRE_FALSE(sessions.take(second, session));
+  REQUIRE(sessions.take(first, session));
+  REQUIRE(session.bytes.size() == 11);
+  REQUIRE_FALSE(sessions.take(first, session));
+  REQUIRE(sessions.size() == 1);
+
+  auto stats = sessions.stats();
+  REQUIRE(stats.stored == 4);
+  REQUIRE(stats.resumed == 1);
+  REQUIRE(stats.expired == 1);
+
+  SUBCASE("old sessions are not resumed")
+  {
+    options.max_age = std::chrono::milliseconds{ 1 };
+    NDEFReadSessionCache short_lived{ options };
+    short_lived.store(first, session_of(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+
+    REQUIRE_FALSE(short_lived.take(first, session));
+    REQUIRE(short_lived.size() == 0);
+    REQUIRE(short_lived.stats().expired == 1);
+  }
+
+  options.max_sessions = 0;
+  REQUIRE_THROWS_AS(NDEFReadSessionCache{ options }, NDEFException);
+}
+
+TEST_CASE("Torn reads resume where they stopped on the next tap")
+{
+  for (auto type : { NFCTagType::Type2, NFCTagType::Type4 }) {
+    NDEFSimulatedTag tag{ type, 2040 };
+    auto msg = make_message(400);
+    tag.store(msg.as_bytes());
+
+    // Reference cost of reading the tag in one go
+    NFCLinkProfile profile;
+    profile.max_fragment = 32;
+    NDEFSimulatedReader clean{ tag, profile };
+    clean.read_message();
+    const auto clean_bytes = clean.stats().bytes;
+
+    // Pull the tag away often enough that no single tap can read it whole
+    profile.tear_rate = 0.15;
+    profile.seed = 7;
+    NDEFSimulatedReader reader{ tag, profile };
+    NDEFReadSessionCache sessions;
+
+    size_t taps = 0;
+    NDEFMessage read;
+    while (true) {
+      taps++;
+      REQUIRE(taps < 200);
+      try {
+        read = reader.read_message(sessions);
+        break;
+      } catch (const NDEFException& e) {
+        REQUIRE(std::string{ e.what() }.find("Tag left the field") == 0);
+        REQUIRE(sessions.size() == 1);
+      }
+    }
+
+    REQUIRE(taps > 2);
+    REQUIRE(read.as_bytes() == msg.as_bytes());
+    REQUIRE(sessions.size() == 0);
+    REQUIRE(sessions.stats().resumed == taps - 1);
+
+    // Each tap only re-reads the overlap and the command that tore, never the whole tag
+    REQUIRE(reader.stats().bytes < clean_bytes + taps * (2 * 32 + 16));
+  }
+}
+
+TEST_CASE("Sessions of rewritten tags are dropped")
+{
+  for (auto type : { NFCTagType::Type2, NFCTagType::Type4 }) {
+    NDEFSimulatedTag tag{ type, 1024 };
+    tag.store(make_message(300).as_bytes());
+
+    NFCLinkProfile profile;
+    profile.max_fragment = 16;
+    NDEFSimulatedReader reader{ tag, profile };
+    NDEFReadSessionCache sessions;
+
+    // A session for the first 48 bytes of the old contents, as a torn read would leave behind
+    NDEFReadSession session;
+    session.bytes = tag.read(type == NFCTagType::Type2 ? 16 : 0, 48);
+    sessions.store(tag.uid(), session);
+
+    NDEFMessage rewritten{ NDEFRecord::create_text_record(std::string(200, 'z'), "en") };
+    tag.store(rewritten.as_bytes());
+
+    REQUIRE(reader.read_message(sessions).as_bytes() == rewritten.as_bytes());
+    REQUIRE(sessions.stats().mismatched == 1);
+  }
+}
+
+TEST_CASE("Malformed tags leave no session behind")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type4, 64, { 0x04, 0x01, 0x02, 0x03 } };
+  REQUIRE(tag.uid() == std::vector<uint8_t>{ 0x04, 0x01, 0x02, 0x03 });
+
+  NDEFSimulatedReader reader{ tag };
+  NDEFReadSessionCache sessions;
+  REQUIRE_THROWS_WITH(reader.read_message(sessions), "Tag does not hold an NDEF message");
+  REQUIRE(sessions.size() == 0);
+
+  REQUIRE_THROWS_AS(NDEFSimulatedTag(NFCTagType::Type2, 64, { 0x04, 0x01 }), NDEFException);
+}
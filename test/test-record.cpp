@@ -263,4 +263,73 @@ TEST_CASE("NDEF Record with Empty type and payload data doesn't validate")
   record.set_payload(valid_text_record_bytes_sr);
 
   REQUIRE(record.type().id() == NDEFRecordType::TypeID::Unknown);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Checked and trusted decoding agree on well formed bytes")
+{
+  NDEFRecord chunk{ vector<uint8_t>(300, 0x5a), NDEFRecordType{ NDEFRecordType::TypeID::MIMEMedia, "image/png" },
+                    "part-1" };
+  chunk.set_chunked(true);
+
+  for (auto&& bytes : { valid_text_record_bytes_sr, valid_text_record_bytes_sr_id, chunk.as_bytes() }) {
+    size_t checked_used = 0;
+    size_t trusted_used = 0;
+    auto checked = NDEFRecord::decode<CheckedDecode>(bytes.data(), bytes.size(), checked_used);
+    auto trusted = NDEFRecord::decode<TrustedDecode>(bytes.data(), bytes.size(), trusted_used);
+
+    REQUIRE(checked_used == bytes.size());
+    REQUIRE(trusted_used == bytes.size());
+    REQUIRE(checked.type() == trusted.type());
+    REQUIRE(checked.id() == trusted.id());
+    REQUIRE(checked.is_chunked() == trusted.is_chunked());
+    REQUIRE(checked.payload() == trusted.payload());
+    REQUIRE(trusted.as_bytes() == bytes);
+  }
+
+  // The chunk flag is kept, and the payload is not shortened by it
+  auto decoded = NDEFRecord::from_bytes(chunk.as_bytes());
+  REQUIRE(decoded.is_chunked());
+  REQUIRE(decoded.payload_length() == 300);
+}
+
+TEST_CASE("Checked decoding rejects truncated records")
+{
+  auto bytes = valid_text_record_bytes_sr_id;
+  size_t bytes_used = 0;
+
+  for (size_t len = 4; len < bytes.size(); len++) {
+    CAPTURE(len);
+    REQUIRE_THROWS_AS(NDEFRecord::decode<CheckedDecode>(bytes.data(), len, bytes_used), NDEFException);
+  }
+
+  REQUIRE_THROWS_WITH(NDEFRecord::decode<CheckedDecode>(bytes.data(), bytes.size() - 1, bytes_used),
+                      "Too few bytes for payload field: require 19 have 18");
+}
+
+TEST_CASE("Moved-from record is left empty")
+{
+  vector<uint8_t> payload(300, 0x5A);
+  NDEFRecordType type{ NDEFRecordType::TypeID::MIMEMedia, "application/octet-stream" };
+  NDEFRecord record{ payload, type, "id" };
+
+  NDEFRecord moved{ std::move(record) };
+  REQUIRE(moved.payload() == payload);
+  REQUIRE(moved.payload_length() == 300);
+  REQUIRE(moved.id() == "id");
+
+  REQUIRE(record.payload_handle().get() != nullptr);
+  REQUIRE(record.payload_length() == 0);
+  REQUIRE(record.payload().empty());
+  REQUIRE(record.type().id() == NDEFRecordType::TypeID::Empty);
+  REQUIRE(record.as_bytes() == NDEFRecord{}.as_bytes());
+
+  record = std::move(moved);
+  REQUIRE(record.payload_length() == 300);
+  REQUIRE(record.id() == "id");
+  REQUIRE(moved.payload_handle().get() != nullptr);
+  REQUIRE(moved.payload_length() == 0);
+
+  // Copies still share the payload
+  NDEFRecord copy = record;
+  REQUIRE(copy.payload_handle().get() == record.payload_handle().get());
+}
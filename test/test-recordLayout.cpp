@@ -0,0 +1,100 @@
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/record-layout.hpp"
+
+TEST_CASE("Frame short record from known valid bytes")
+{
+  NDEFRecordLayout layout;
+
+  REQUIRE(frame_record(valid_text_record_bytes_sr.data(), valid_text_record_bytes_sr.size(), layout) ==
+          FrameStatus::Complete);
+  CHECK(layout.header.sr);
+  CHECK(layout.header.mb);
+  CHECK(layout.header.me);
+  CHECK(layout.type_offset == 3);
+  CHECK(layout.type_length == 1);
+  CHECK(layout.id_length == 0);
+  CHECK(layout.payload_offset == 4);
+  CHECK(layout.payload_length == 19);
+  CHECK(layout.total_length == valid_text_record_bytes_sr.size());
+}
+
+TEST_CASE("Frame short record with ID from known valid bytes")
+{
+  NDEFRecordLayout layout;
+
+  REQUIRE(frame_record(valid_text_record_bytes_sr_id.data(), valid_text_record_bytes_sr_id.size(), layout) ==
+          FrameStatus::Complete);
+  CHECK(layout.header.il);
+  CHECK(layout.type_offset == 4);
+  CHECK(layout.id_offset == 5);
+  CHECK(layout.id_length == 4);
+  CHECK(layout.payload_offset == 9);
+  CHECK(layout.total_length == valid_text_record_bytes_sr_id.size());
+}
+
+TEST_CASE("Frame long record from known valid bytes")
+{
+  NDEFRecordLayout layout;
+
+  REQUIRE(frame_record(valid_text_record_bytes_nosr.data(), valid_text_record_bytes_nosr.size(), layout) ==
+          FrameStatus::Complete);
+  CHECK_FALSE(layout.header.sr);
+  CHECK(layout.payload_offset == 7);
+  CHECK(layout.payload_length == 263);
+}
+
+TEST_CASE("Frame long record with the high bit of its length set")
+{
+  std::vector<uint8_t> bytes = valid_text_record_bytes_nosr;
+  bytes.at(2) = 0x80;
+
+  NDEFRecordLayout layout;
+
+  REQUIRE(frame_record(bytes.data(), bytes.size(), layout) == FrameStatus::Incomplete);
+  CHECK(layout.payload_length == 0x80000107);
+}
+
+TEST_CASE("Frame truncated record is incomplete at every length")
+{
+  NDEFRecordLayout layout;
+
+  for (size_t len = 0; len < valid_text_record_bytes_sr_id.size(); len++) {
+    INFO("Length: " << len);
+    REQUIRE(frame_record(valid_text_record_bytes_sr_id.data(), len, layout) == FrameStatus::Incomplete);
+  }
+}
+
+TEST_CASE("Frame record with control character in type is malformed")
+{
+  std::vector<uint8_t> bytes = valid_text_record_bytes_sr;
+  bytes.at(3) = 0x1f;
+
+  NDEFRecordLayout layout;
+
+  // Malformed is reported as soon as the type byte is available, even before the payload
+  REQUIRE(frame_record(bytes.data(), 4, layout) == FrameStatus::Malformed);
+  REQUIRE(frame_record(bytes.data(), bytes.size(), layout) == FrameStatus::Malformed);
+}
+
+TEST_CASE("Frame message stops at Message End record")
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::from_bytes(valid_text_record_bytes_sr));
+  msg.append_record(NDEFRecord::from_bytes(valid_text_record_bytes_sr_id));
+  auto bytes = msg.as_bytes();
+  const size_t msg_length = bytes.size();
+  bytes.insert(bytes.end(), valid_text_record_bytes_sr.begin(), valid_text_record_bytes_sr.end());
+
+  size_t length = 0;
+  REQUIRE(frame_message(bytes.data(), bytes.size(), length) == FrameStatus::Complete);
+  REQUIRE(length == msg_length);
+
+  // Without the Message End record the message can not be complete yet
+  REQUIRE(frame_message(bytes.data(), msg_length - 1, length) == FrameStatus::Incomplete);
+  REQUIRE(frame_message(bytes.data(), valid_text_record_bytes_sr.size(), length) == FrameStatus::Incomplete);
+}
@@ -0,0 +1,101 @@
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message-buffer.hpp"
+#include "ndef-lite/record-view.hpp"
+
+TEST_CASE("Record view fields match decoded record")
+{
+  NDEFMessageView view{ valid_text_record_bytes_sr_id.data(), valid_text_record_bytes_sr_id.size() };
+  REQUIRE(view.record_count() == 1);
+
+  auto record_view = view.record(0);
+  auto record = NDEFRecord::from_bytes(valid_text_record_bytes_sr_id);
+
+  CHECK(record_view.tnf() == NDEFRecordType::TypeID::WellKnown);
+  CHECK(record_view.type() == "T");
+  CHECK(record_view.is_well_known('T'));
+  CHECK_FALSE(record_view.is_well_known('U'));
+  CHECK(record_view.id() == "test");
+  CHECK(record_view.payload().to_vector() == record.payload());
+  CHECK(record_view.to_record().payload() == record.payload());
+  CHECK(record_view.to_record().id() == record.id());
+}
+
+TEST_CASE("Record view splits Text payloads after the locale")
+{
+  // create_text_record() keeps at most 5 characters of the locale, so longer ones are encoded by hand
+  for (const std::string& locale : { std::string{ "en" }, "x-" + std::string(38, 'a') }) {
+    CAPTURE(locale);
+    std::vector<uint8_t> payload{ static_cast<uint8_t>(locale.size()) };
+    payload.insert(payload.end(), locale.begin(), locale.end());
+    payload.insert(payload.end(), { 'h', 'e', 'l', 'l', 'o' });
+    auto bytes = NDEFMessage{ NDEFRecord{ payload, NDEFRecordType::text_record_type() } }.as_bytes();
+    NDEFMessageView view{ bytes.data(), bytes.size() };
+
+    ByteSpan locale_span;
+    ByteSpan text_span;
+    REQUIRE(view.record(0).text_span(locale_span, text_span));
+    CHECK(locale_span == locale);
+    CHECK(text_span == "hello");
+  }
+
+  // Too short for the locale length in the status byte
+  std::vector<uint8_t> truncated{ 0xD1, 0x01, 0x03, 'T', 0x05, 'e', 'n' };
+  NDEFMessageView view{ truncated.data(), truncated.size() };
+  ByteSpan locale_span;
+  ByteSpan text_span;
+  CHECK_FALSE(view.record(0).text_span(locale_span, text_span));
+
+  auto uri = NDEFMessage{ NDEFRecord::create_uri_record("https://example.com") }.as_bytes();
+  NDEFMessageView uri_view{ uri.data(), uri.size() };
+  CHECK_FALSE(uri_view.record(0).text_span(locale_span, text_span));
+}
+
+TEST_CASE("Message view stops after Message End record")
+{
+  auto bytes = valid_text_record_bytes_sr;
+  bytes.insert(bytes.end(), valid_text_record_bytes_sr.begin(), valid_text_record_bytes_sr.end());
+
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  REQUIRE(view.record_count() == 1);
+  REQUIRE(view.size() == valid_text_record_bytes_sr.size());
+}
+
+TEST_CASE("Message view round trips multiple records")
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record("hello", "en"));
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com"));
+  auto bytes = msg.as_bytes();
+
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  REQUIRE(view.record_count() == 2);
+  REQUIRE(view.record(1).type() == "U");
+  REQUIRE(view.to_message().as_bytes() == bytes);
+  REQUIRE_THROWS_AS(view.record(2), std::out_of_range);
+}
+
+TEST_CASE("Message view throws on truncated bytes")
+{
+  NDEFMessageView view;
+
+  REQUIRE_THROWS_AS(view.open(valid_text_record_bytes_sr.data(), valid_text_record_bytes_sr.size() - 1),
+                    NDEFException);
+}
+
+TEST_CASE("Message buffer view survives a move")
+{
+  NDEFMessageBuffer buffer;
+  buffer.assign(valid_text_record_bytes_sr);
+
+  NDEFMessageBuffer moved{ std::move(buffer) };
+
+  REQUIRE(moved.view().data() == moved.bytes().data());
+  REQUIRE(moved.view().record(0).type() == "T");
+}
@@ -0,0 +1,159 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/rule-set.hpp"
+
+namespace {
+using TypeID = NDEFRecordType::TypeID;
+
+NDEFMessage make_message()
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_uri_record("https://shop.example.com/item/7"));
+  msg.append_record(NDEFRecord::create_uri_record("http://example.org"));
+  msg.append_record(NDEFRecord::create_text_record("Hallo", "de-DE"));
+  msg.append_record(NDEFRecord{ { 1, 2, 3 }, NDEFRecordType{ TypeID::External, "acme.com:sensor" }, "unit-9" });
+  msg.append_record(NDEFRecord{ { '{', '}' }, NDEFRecordType{ TypeID::MIMEMedia, "application/json" } });
+  return msg;
+}
+} // namespace
+
+TEST_CASE("Rules match on raw record fields")
+{
+  std::vector<NDEFRule> rules;
+  rules.push_back(NDEFRule{ 10 }.tnf(TypeID::External).type_starts_with("acme.com:"));
+  rules.push_back(NDEFRule{ 11 }.uri_prefix_code(0x04).uri_body_starts_with("shop.example.com/"));
+  rules.push_back(NDEFRule{ 12 }.uri_body_is("example.org"));
+  rules.push_back(NDEFRule{ 13 }.text_locale_is("de-DE"));
+  rules.push_back(NDEFRule{ 14 }.id_is("unit-9"));
+  rules.push_back(NDEFRule{ 15 }.type_is("application/json"));
+  rules.push_back(NDEFRule{ 16 }.tnf(TypeID::WellKnown));
+  rules.push_back(NDEFRule{ 17 });
+  rules.push_back(NDEFRule{ 18 }.uri_body_is("example"));
+  rules.push_back(NDEFRule{ 19 }.id_starts_with(""));
+
+  auto rule_set = NDEFRuleSet::compile(rules);
+  REQUIRE(rule_set.rule_count() == rules.size());
+
+  auto bytes = make_message().as_bytes();
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  auto matches = rule_set.match(view);
+  REQUIRE(matches.size() == 5);
+  REQUIRE(matches[0] == std::vector<uint32_t>{ 11, 16, 17, 19 });
+  REQUIRE(matches[1] == std::vector<uint32_t>{ 12, 16, 17, 19 });
+  REQUIRE(matches[2] == std::vector<uint32_t>{ 13, 16, 17, 19 });
+  REQUIRE(matches[3] == std::vector<uint32_t>{ 10, 14, 17, 19 });
+  REQUIRE(matches[4] == std::vector<uint32_t>{ 15, 17, 19 });
+
+  auto empty = NDEFRuleSet::compile({});
+  std::vector<uint32_t> none{ 1 };
+  empty.match(view.record(0), none);
+  REQUIRE(none.empty());
+}
+
+TEST_CASE("Compiled rules agree with evaluating every rule in turn")
+{
+  const std::vector<std::string> types{ "U", "T", "acme.com:sensor", "acme.com:door", "acme.org:x", "text/plain" };
+  const std::vector<std::string> uris{ "https://acme.com/a", "https://acme.com/ab", "http://acme.com/a",
+                                       "tel:+123", "https://other.net" };
+  const std::vector<std::string> ids{ "", "a", "ab", "abc", "b" };
+
+  std::mt19937 rng{ 1234 };
+  auto pick = [&rng](const std::vector<std::string>& values) { return values[rng() % values.size()]; };
+  auto cut = [&rng](const std::string& value) { return value.substr(0, rng() % (value.size() + 1)); };
+
+  // Enough rules to need several mask words
+  struct Expected
+  {
+    int tnf = -1, uri_code = -1;
+    std::string type, id, body;
+    int type_mode = 0, id_mode = 0, body_mode = 0;
+  };
+  std::vector<NDEFRule> rules;
+  std::vector<Expected> expected;
+
+  for (uint32_t i = 0; i < 300; i++) {
+    NDEFRule rule{ i };
+    Expected e;
+
+    if (rng() % 3 == 0) {
+      e.tnf = static_cast<int>(rng() % 2 == 0 ? TypeID::WellKnown : TypeID::External);
+      rule.tnf(static_cast<TypeID>(e.tnf));
+    }
+    if (rng() % 3 == 0) {
+      e.type_mode = 1 + rng() % 2;
+      e.type = cut(pick(types));
+      e.type_mode == 1 ? rule.type_is(e.type) : rule.type_starts_with(e.type);
+    }
+    if (rng() % 4 == 0) {
+      e.id_mode = 1 + rng() % 2;
+      e.id = cut(pick(ids));
+      e.id_mode == 1 ? rule.id_is(e.id) : rule.id_starts_with(e.id);
+    }
+    if (rng() % 4 == 0) {
+      e.uri_code = rng() % 2 == 0 ? 0x04 : 0x03;
+      rule.uri_prefix_code(static_cast<uint8_t>(e.uri_code));
+    }
+    if (rng() % 3 == 0) {
+      e.body_mode = 1 + rng() % 2;
+      e.body = cut("acme.com/ab");
+      e.body_mode == 1 ? rule.uri_body_is(e.body) : rule.uri_body_starts_with(e.body);
+    }
+
+    rules.push_back(rule);
+    expected.push_back(e);
+  }
+
+  auto rule_set = NDEFRuleSet::compile(rules);
+
+  NDEFMessage msg;
+  for (auto&& uri : uris) {
+    msg.append_record(NDEFRecord::create_uri_record(uri));
+  }
+  for (auto&& type : types) {
+    for (auto&& id : ids) {
+      msg.append_record(NDEFRecord{ std::vector<uint8_t>{ 0x00 }, NDEFRecordType{ TypeID::External, type }, id });
+    }
+  }
+  auto bytes = msg.as_bytes();
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+
+  auto check = [](int mode, const std::string& want, const std::string& have) {
+    return mode == 0 || (mode == 1 ? have == want : have.compare(0, want.size(), want) == 0);
+  };
+
+  std::vector<uint32_t> matches;
+  for (size_t r = 0; r < view.record_count(); r++) {
+    auto record = view.record(r);
+    bool is_uri = record.tnf() == TypeID::WellKnown && record.type() == "U";
+    auto payload = record.payload();
+
+    std::vector<uint32_t> want;
+    for (uint32_t i = 0; i < expected.size(); i++) {
+      auto& e = expected[i];
+      bool ok = (e.tnf < 0 || e.tnf == static_cast<int>(record.tnf())) &&
+                check(e.type_mode, e.type, record.type().to_string()) &&
+                check(e.id_mode, e.id, record.id().to_string());
+
+      if (e.uri_code >= 0) {
+        ok = ok && is_uri && payload.data[0] == e.uri_code;
+      }
+      if (e.body_mode != 0) {
+        ok = ok && is_uri && check(e.body_mode, e.body, std::string(payload.begin() + 1, payload.end()));
+      }
+
+      if (ok) {
+        want.push_back(i);
+      }
+    }
+
+    CAPTURE(r);
+    rule_set.match(record, matches);
+    REQUIRE(matches == want);
+  }
+}
@@ -0,0 +1,173 @@
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/shm-ring.hpp"
+
+namespace {
+std::vector<uint8_t> make_message(size_t i)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record("message " + std::to_string(i), "en"));
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/" + std::to_string(i)));
+  return msg.as_bytes();
+}
+
+/// Overwrites a 32-bit field of the first ring entry, as a misbehaving producer could
+void corrupt_entry(const NDEFShmRing& ring, size_t offset, uint32_t value)
+{
+  struct stat st;
+  REQUIRE(fstat(ring.fd(), &st) == 0);
+  const off_t entries = st.st_size - static_cast<off_t>(ring.capacity());
+  REQUIRE(pwrite(ring.fd(), &value, sizeof(value), entries + static_cast<off_t>(offset)) == sizeof(value));
+}
+} // namespace
+
+TEST_CASE("Shared memory ring delivers indexed message views")
+{
+  auto ring = NDEFShmRing::create(4096);
+  auto bytes = make_message(1);
+  REQUIRE(ring.try_write(bytes.data(), bytes.size()));
+
+  NDEFMessageView view;
+  REQUIRE(ring.try_read(view));
+  REQUIRE(view.record_count() == 2);
+  REQUIRE(std::vector<uint8_t>(view.data(), view.data() + view.size()) == bytes);
+  CHECK(view.record(0).type() == "T");
+  CHECK(view.record(1).to_record().get_uri() == "example.com/1");
+  CHECK(view.to_message().as_bytes() == bytes);
+
+  // Reading again before releasing is a usage error
+  REQUIRE_THROWS_AS(ring.try_read(view), NDEFException);
+
+  ring.release();
+  REQUIRE_FALSE(ring.try_read(view));
+}
+
+TEST_CASE("Shared memory ring wraps around and reports when full")
+{
+  auto ring = NDEFShmRing::create(4096);
+  NDEFMessageView view;
+
+  size_t written = 0;
+  auto bytes = make_message(written);
+  while (ring.try_write(bytes.data(), bytes.size())) {
+    bytes = make_message(++written);
+  }
+  REQUIRE(written > 1);
+
+  // Keep the ring near full while cycling through it several times. Padding at the end of the ring may need more
+  // than one entry to be freed before the next write fits
+  size_t read = 0;
+  const size_t rounds = written * 4;
+  for (size_t round = 0; round < rounds; round++) {
+    do {
+      REQUIRE(ring.try_read(view));
+      REQUIRE(view.to_message().record(1).get_uri() == "example.com/" + std::to_string(read++));
+      ring.release();
+    } while (!ring.try_write(bytes.data(), bytes.size()));
+
+    bytes = make_message(++written);
+  }
+
+  while (ring.try_read(view)) {
+    REQUIRE(view.to_message().record(1).get_uri() == "example.com/" + std::to_string(read++));
+    ring.release();
+  }
+  REQUIRE(read == written);
+}
+
+TEST_CASE("Shared memory ring rejects messages larger than the ring")
+{
+  auto ring = NDEFShmRing::create(4096);
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record(std::string(5000, 'a'), "en"));
+  auto bytes = msg.as_bytes();
+
+  REQUIRE_THROWS_AS(ring.try_write(bytes.data(), bytes.size()), NDEFException);
+}
+
+TEST_CASE("Shared memory ring drains messages written before it was closed")
+{
+  auto ring = NDEFShmRing::create(4096);
+  auto bytes = make_message(1);
+  REQUIRE(ring.try_write(bytes.data(), bytes.size()));
+  ring.close();
+
+  NDEFMessageView view;
+  REQUIRE(ring.read(view, 0));
+  REQUIRE(view.size() == bytes.size());
+  ring.release();
+  REQUIRE_FALSE(ring.read(view));
+}
+
+TEST_CASE("Shared memory ring rejects corrupt entries instead of reading past them")
+{
+  auto ring = NDEFShmRing::create(4096);
+  auto bytes = make_message(1);
+  REQUIRE(ring.try_write(bytes.data(), bytes.size()));
+  NDEFMessageView view;
+
+  // Entry header is entry length, message length and record count. The record index follows it
+  SUBCASE("entry longer than what was published") { corrupt_entry(ring, 0, 4096); }
+  SUBCASE("message longer than the entry") { corrupt_entry(ring, 4, 4096); }
+  SUBCASE("record count overruns the entry") { corrupt_entry(ring, 8, 0x10000000); }
+  SUBCASE("record offset past the message") { corrupt_entry(ring, 16 + 12, static_cast<uint32_t>(bytes.size())); }
+  SUBCASE("record payload past the message") { corrupt_entry(ring, 16 + 12 + 4, 0xFFFFFFF0); }
+
+  REQUIRE_THROWS_AS(ring.try_read(view), NDEFException);
+}
+
+TEST_CASE("Shared memory ring refuses descriptors that do not hold a ring")
+{
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  REQUIRE_THROWS_AS(NDEFShmRing::attach(fds[0]), NDEFException);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_CASE("Shared memory ring passes messages between processes")
+{
+  const size_t count = 500;
+  auto ring = NDEFShmRing::create(4096);
+
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+
+  if (child == 0) {
+    // Producer, blocking whenever the parent falls behind
+    auto producer = NDEFShmRing::attach(ring.fd());
+    for (size_t i = 0; i < count; i++) {
+      auto bytes = make_message(i);
+      NDEFMessageView view{ bytes.data(), bytes.size() };
+      producer.write(view);
+    }
+    producer.close();
+    _exit(0);
+  }
+
+  NDEFMessageView view;
+  size_t read = 0;
+  bool in_order = true;
+  while (ring.read(view, 5000)) {
+    in_order = in_order && view.to_message().record(1).get_uri() == "example.com/" + std::to_string(read);
+    read++;
+    ring.release();
+  }
+
+  int status = 0;
+  waitpid(child, &status, 0);
+
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  REQUIRE(in_order);
+  REQUIRE(read == count);
+}
@@ -0,0 +1,224 @@
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/message.hpp"
+#include "ndef-lite/signature.hpp"
+
+namespace {
+std::string to_hex(const uint8_t* bytes, size_t len)
+{
+  static const char digits[] = "0123456789abcdef";
+  std::string hex;
+  for (size_t i = 0; i < len; i++) {
+    hex += digits[bytes[i] >> 4];
+    hex += digits[bytes[i] & 0x0F];
+  }
+  return hex;
+}
+
+/// Hashes \p text, feeding it to the digest \p step bytes at a time
+std::string sha256_hex(const std::string& text, size_t step)
+{
+  NDEFSha256 hash;
+  auto data = reinterpret_cast<const uint8_t*>(text.data());
+  for (size_t pos = 0; pos < text.size(); pos += step) {
+    hash.update(data + pos, std::min(step, text.size() - pos));
+  }
+
+  uint8_t digest[NDEFSha256::digest_size];
+  hash.finish(digest);
+  return to_hex(digest, sizeof(digest));
+}
+
+std::vector<uint8_t> to_bytes(const std::string& text) { return std::vector<uint8_t>{ text.begin(), text.end() }; }
+
+NDEFMessage make_message(const std::string& uri)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_uri_record(uri));
+  msg.append_record(NDEFRecord::create_text_record("Genuine part", "en"));
+  return msg;
+}
+} // namespace
+
+TEST_CASE("SHA-256 matches the FIPS 180-4 test vectors")
+{
+  for (size_t step : { 1, 3, 63, 64, 65, 1000 }) {
+    CAPTURE(step);
+    REQUIRE(sha256_hex("", step) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(sha256_hex("abc", step) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", step) ==
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  }
+
+  REQUIRE(sha256_hex(std::string(1000000, 'a'), 4096) ==
+          "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_CASE("HMAC-SHA-256 matches the RFC 4231 test vectors")
+{
+  uint8_t out[NDEFSha256::digest_size];
+
+  auto data = to_bytes("what do ya want for nothing?");
+  NDEFHmacVerifier{ to_bytes("Jefe") }.mac(data.data(), data.size(), out);
+  REQUIRE(to_hex(out, sizeof(out)) == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+  // Keys longer than a block are hashed first
+  data = to_bytes("Test Using Larger Than Block-Size Key - Hash Key First");
+  NDEFHmacVerifier{ std::vector<uint8_t>(131, 0xaa) }.mac(data.data(), data.size(), out);
+  REQUIRE(to_hex(out, sizeof(out)) == "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+TEST_CASE("Signature record payload round trips")
+{
+  std::vector<uint8_t> signature(70, 0x11);
+  std::vector<std::vector<uint8_t>> certificates{ std::vector<uint8_t>(300, 0x22), { 0x33 } };
+
+  auto record = NDEFSignature::create_record(static_cast<uint8_t>(SignatureType::ECDSA_P256), signature, certificates,
+                                             0x01);
+  REQUIRE(record.type().name() == "Sig");
+
+  auto payload = record.payload();
+  auto parsed = NDEFSignature::parse(ByteSpan{ payload.data(), payload.size() });
+  REQUIRE(parsed.version == 0x20);
+  REQUIRE(parsed.signature_type == static_cast<uint8_t>(SignatureType::ECDSA_P256));
+  REQUIRE(parsed.hash_type == signature_hash_sha256);
+  REQUIRE_FALSE(parsed.signature_is_uri);
+  REQUIRE(parsed.signature.to_vector() == signature);
+  REQUIRE(parsed.certificate_format == 0x01);
+  REQUIRE(parsed.certificates.size() == 2);
+  REQUIRE(parsed.certificates[0].to_vector() == certificates[0]);
+  REQUIRE(parsed.certificates[1].to_vector() == certificates[1]);
+  REQUIRE(parsed.certificate_uri.empty());
+
+  // Every truncation is rejected
+  for (size_t len = 0; len < payload.size(); len++) {
+    if (len == 3 + 2 + signature.size()) {
+      // Ends cleanly without a certificate chain
+      continue;
+    }
+    CAPTURE(len);
+    REQUIRE_THROWS_AS(NDEFSignature::parse(ByteSpan{ payload.data(), len }), NDEFException);
+  }
+
+  REQUIRE_THROWS_AS(NDEFSignature::create_record(0x0B, signature, std::vector<std::vector<uint8_t>>(16)),
+                    NDEFException);
+}
+
+TEST_CASE("Signed messages verify from their raw bytes")
+{
+  NDEFHmacVerifier verifier{ to_bytes("provisioned key") };
+
+  auto msg = make_message("https://example.com/part/1234");
+  msg.append_record(verifier.sign(msg));
+  auto bytes = msg.as_bytes();
+
+  NDEFMessageView view{ bytes.data(), bytes.size() };
+  REQUIRE(verify_message(view, verifier) == SignatureStatus::Valid);
+
+  SUBCASE("covered ranges end at the previous signature")
+  {
+    auto second = make_message("https://example.com/part/5678");
+    for (size_t i = 0; i < second.record_count(); i++) {
+      msg.append_record(second.record(i));
+    }
+    msg.append_record(verifier.sign(msg));
+    auto two_signatures = msg.as_bytes();
+
+    NDEFMessageView two_view{ two_signatures.data(), two_signatures.size() };
+    REQUIRE(verify_signatures(two_view, verifier) ==
+            std::vector<SignatureStatus>{ SignatureStatus::Valid, SignatureStatus::Valid });
+
+    // The first Signature record lost its Message End flag, which is not covered by any signature
+    REQUIRE(two_view.record(2).data()[0] != view.record(2).data()[0]);
+  }
+
+  SUBCASE("records appended after the last signature are not covered")
+  {
+    msg.append_record(NDEFRecord::create_uri_record("https://attacker.example"));
+    auto appended = msg.as_bytes();
+
+    NDEFMessageView appended_view{ appended.data(), appended.size() };
+    REQUIRE(verify_signatures(appended_view, verifier) == std::vector<SignatureStatus>{ SignatureStatus::Valid });
+    REQUIRE(verify_message(appended_view, verifier) == SignatureStatus::PartiallySigned);
+  }
+
+  SUBCASE("tampering is detected")
+  {
+    auto tampered = bytes;
+    tampered[10] ^= 0x01;
+
+    NDEFMessageView tampered_view{ tampered.data(), tampered.size() };
+    REQUIRE(verify_message(tampered_view, verifier) == SignatureStatus::Invalid);
+  }
+
+  SUBCASE("wrong key or type is not accepted")
+  {
+    REQUIRE(verify_message(view, NDEFHmacVerifier{ to_bytes("other key") }) == SignatureStatus::Invalid);
+    REQUIRE(verify_message(view, NDEFHmacVerifier{ to_bytes("provisioned key"), 0x70 }) ==
+            SignatureStatus::Unsupported);
+  }
+
+  SUBCASE("messages without signatures are unsigned")
+  {
+    auto unsigned_bytes = make_message("https://example.com").as_bytes();
+    NDEFMessageView unsigned_view{ unsigned_bytes.data(), unsigned_bytes.size() };
+    REQUIRE(verify_message(unsigned_view, verifier) == SignatureStatus::Unsigned);
+  }
+
+  SUBCASE("malformed signatures are reported")
+  {
+    auto broken = make_message("https://example.com");
+    broken.append_record(NDEFRecord{ { 0x20, 0x7F }, NDEFRecordType{ NDEFRecordType::TypeID::WellKnown, "Sig" } });
+    auto broken_bytes = broken.as_bytes();
+
+    NDEFMessageView broken_view{ broken_bytes.data(), broken_bytes.size() };
+    REQUIRE(verify_message(broken_view, verifier) == SignatureStatus::Malformed);
+  }
+}
+
+TEST_CASE("Batch verification keeps message order")
+{
+  NDEFHmacVerifier verifier{ to_bytes("batch key") };
+
+  std::vector<std::vector<uint8_t>> buffers;
+  for (int i = 0; i < 200; i++) {
+    auto msg = make_message("https://example.com/part/" + std::to_string(i));
+    if (i % 7 != 0) {
+      msg.append_record(verifier.sign(msg));
+    }
+    buffers.push_back(msg.as_bytes());
+
+    // Corrupt the URI of every 11th signed message
+    if (i % 7 != 0 && i % 11 == 0) {
+      buffers.back()[8] ^= 0x20;
+    }
+  }
+
+  std::vector<NDEFMessageView> views;
+  for (auto&& buffer : buffers) {
+    views.emplace_back(buffer.data(), buffer.size());
+  }
+
+  for (size_t threads : { 1, 4 }) {
+    CAPTURE(threads);
+    auto results = verify_messages(views, verifier, threads);
+    REQUIRE(results.size() == views.size());
+
+    for (size_t i = 0; i < results.size(); i++) {
+      CAPTURE(i);
+      if (i % 7 == 0) {
+        REQUIRE(results[i] == SignatureStatus::Unsigned);
+      } else if (i % 11 == 0) {
+        REQUIRE(results[i] == SignatureStatus::Invalid);
+      } else {
+        REQUIRE(results[i] == SignatureStatus::Valid);
+      }
+    }
+  }
+
+  REQUIRE(verify_messages({}, verifier).empty());
+}
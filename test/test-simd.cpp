@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+
+#include "ndef-lite/encoding.hpp"
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/simd.hpp"
+
+namespace {
+/// Lengths around every vector width, plus some longer ones
+const std::vector<size_t> lengths{ 0, 1, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 200, 1000 };
+
+std::vector<uint8_t> ascii_bytes(size_t len, std::mt19937& rng)
+{
+  std::vector<uint8_t> bytes(len);
+  for (auto& byte : bytes) {
+    byte = static_cast<uint8_t>(rng() % 0x80);
+  }
+
+  return bytes;
+}
+} // namespace
+
+TEST_CASE("Every supported SIMD level matches the scalar kernels")
+{
+  auto levels = simd::supported_levels();
+  REQUIRE(levels.front() == simd::Level::Scalar);
+  REQUIRE(levels.back() == simd::detected_level());
+
+  std::mt19937 rng{ 11 };
+
+  for (auto level : levels) {
+    simd::ScopedLevel scoped{ level };
+    REQUIRE(simd::active_level() == level);
+    std::string name = simd::level_name(level);
+    CAPTURE(name);
+
+    for (size_t len : lengths) {
+      CAPTURE(len);
+
+      // Unaligned starts catch kernels that assume aligned loads
+      for (size_t offset = 0; offset < 3; offset++) {
+        auto buffer = ascii_bytes(len + offset, rng);
+        const uint8_t* data = buffer.data() + offset;
+
+        REQUIRE(simd::find_byte(data, len, 0xFF) == len);
+        REQUIRE(simd::ascii_length(data, len) == len);
+
+        std::u16string wide(len, u'\0');
+        REQUIRE(simd::widen_ascii(data, len, &wide[0]) == len);
+        REQUIRE(wide == std::u16string(data, data + len));
+
+        std::vector<uint8_t> narrow(len);
+        REQUIRE(simd::narrow_ascii(wide.data(), len, narrow.data()) == len);
+        REQUIRE(std::equal(narrow.begin(), narrow.end(), data));
+      }
+
+      // A marker at every position is found exactly there, by every kernel
+      auto base = ascii_bytes(len, rng);
+      for (size_t pos = 0; pos < len; pos++) {
+        auto bytes = base;
+        bytes[pos] = 0xC3;
+
+        REQUIRE(simd::find_byte(bytes.data(), len, 0xC3) == pos);
+        REQUIRE(simd::ascii_length(bytes.data(), len) == pos);
+
+        std::u16string wide(len, u'\0');
+        REQUIRE(simd::widen_ascii(bytes.data(), len, &wide[0]) == pos);
+
+        std::u16string text(base.begin(), base.end());
+        text[pos] = (pos % 2) ? u'\u00E9' : u'\u0100';
+        std::vector<uint8_t> narrow(len);
+        REQUIRE(simd::narrow_ascii(text.data(), len, narrow.data()) == pos);
+        REQUIRE(std::equal(narrow.begin(), narrow.begin() + pos, base.begin()));
+      }
+    }
+  }
+}
+
+TEST_CASE("Substring kernels match std::search at every level")
+{
+  std::mt19937 rng{ 23 };
+
+  // A three letter alphabet leaves many partial matches for the kernels to reject
+  std::vector<uint8_t> haystack(300);
+  for (auto& byte : haystack) {
+    byte = static_cast<uint8_t>('a' + rng() % 3);
+  }
+
+  for (auto level : simd::supported_levels()) {
+    simd::ScopedLevel scoped{ level };
+    std::string name = simd::level_name(level);
+    CAPTURE(name);
+
+    for (size_t len : lengths) {
+      const size_t size = std::min(len, haystack.size());
+
+      for (size_t pattern_len : { 0, 1, 2, 3, 5, 8, 17, 40, 70 }) {
+        CAPTURE(size);
+        CAPTURE(pattern_len);
+
+        // Patterns cut from the haystack are always found, random ones usually are not
+        for (int attempt = 0; attempt < 4; attempt++) {
+          std::vector<uint8_t> pattern(pattern_len);
+          if (attempt % 2 == 0 && pattern_len <= size) {
+            auto start = haystack.begin() + rng() % (size - pattern_len + 1);
+            std::copy(start, start + pattern_len, pattern.begin());
+          } else {
+            for (auto& byte : pattern) {
+              byte = static_cast<uint8_t>('a' + rng() % 3);
+            }
+          }
+
+          auto expected = std::search(haystack.begin(), haystack.begin() + size, pattern.begin(), pattern.end());
+          const size_t expected_pos = (expected == haystack.begin() + size && pattern_len != 0)
+                                          ? size
+                                          : static_cast<size_t>(expected - haystack.begin());
+          REQUIRE(simd::find_substring(haystack.data(), size, pattern.data(), pattern_len) == expected_pos);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Text conversions agree across SIMD levels")
+{
+  std::string long_ascii(100, 'x');
+  const std::vector<std::string> samples{ "", "hello", long_ascii + "\xC3\xA9t\xC3\xA9", "\xE2\x82\xAC" + long_ascii,
+                                          long_ascii + "\xF0\x9F\x98\x80" + long_ascii };
+
+  for (auto level : simd::supported_levels()) {
+    simd::ScopedLevel scoped{ level };
+    std::string name = simd::level_name(level);
+    CAPTURE(name);
+
+    for (auto&& sample : samples) {
+      auto wide = encoding::to_utf16(sample);
+      REQUIRE(encoding::to_utf8(wide) == sample);
+      REQUIRE(encoding::to_utf16(std::vector<uint8_t>{ sample.begin(), sample.end() }) == wide);
+    }
+
+    REQUIRE(encoding::to_utf16(long_ascii + "\xC3\xA9").size() == 101);
+
+    // A leading byte order mark is consumed, one after ASCII text is kept
+    std::vector<uint8_t> bom{ 0xEF, 0xBB, 0xBF, 'h', 'i' };
+    REQUIRE(encoding::to_utf16(bom) == u"hi");
+    std::vector<uint8_t> late_bom{ 'h', 0xEF, 0xBB, 0xBF };
+    REQUIRE(encoding::to_utf16(late_bom) == u"h\uFEFF");
+  }
+}
+
+TEST_CASE("Forcing a SIMD level")
+{
+  auto before = simd::active_level();
+
+  {
+    simd::ScopedLevel scoped{ simd::Level::Scalar };
+    REQUIRE(simd::kernels().level == simd::Level::Scalar);
+  }
+  REQUIRE(simd::active_level() == before);
+
+  // Each build only carries kernels for its own architecture
+#if defined(__x86_64__) || defined(__i386__)
+  REQUIRE_THROWS_AS(simd::force_level(simd::Level::NEON), NDEFException);
+#elif defined(__aarch64__)
+  REQUIRE_THROWS_AS(simd::force_level(simd::Level::AVX2), NDEFException);
+#endif
+  REQUIRE(simd::active_level() == before);
+
+  simd::force_level(simd::Level::Scalar);
+  simd::reset_level();
+  REQUIRE(simd::active_level() == before);
+}
@@ -0,0 +1,154 @@
+#include <string>
+#include <vector>
+
+#include "doctest.hpp"
+#include "test-constants.hpp"
+
+#include "ndef-lite/exceptions.hpp"
+#include "ndef-lite/tag-sim.hpp"
+
+namespace {
+NDEFMessage make_message(size_t text_length)
+{
+  NDEFMessage msg;
+  msg.append_record(NDEFRecord::create_text_record(std::string(text_length, 'a'), "en"));
+  msg.append_record(NDEFRecord::create_uri_record("https://example.com/"));
+  return msg;
+}
+} // namespace
+
+TEST_CASE("Simulated tags round trip messages of every size")
+{
+  for (auto type : { NFCTagType::Type2, NFCTagType::Type4 }) {
+    for (size_t fragment : { 3, 16, 59, 255 }) {
+      for (size_t text_length : { 0, 200, 300, 1500 }) {
+        NDEFSimulatedTag tag{ type, 2040 };
+        NFCLinkProfile profile;
+        profile.max_fragment = fragment;
+
+        NDEFSimulatedReader reader{ tag, profile };
+        auto msg = make_message(text_length);
+        reader.write_message(msg);
+
+        REQUIRE(reader.read_message().as_bytes() == msg.as_bytes());
+      }
+    }
+  }
+}
+
+TEST_CASE("Simulated Type 2 tag uses standard memory layout")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type2, 44 };
+  REQUIRE(tag.capacity() == 48);
+
+  tag.store(valid_text_record_bytes_sr);
+  auto memory = tag.memory();
+
+  REQUIRE(memory.at(12) == 0xE1);
+  REQUIRE(memory.at(14) == 6);
+  REQUIRE(memory.at(16) == 0x03);
+  REQUIRE(memory.at(17) == valid_text_record_bytes_sr.size());
+  REQUIRE(memory.at(18 + valid_text_record_bytes_sr.size()) == 0xFE);
+
+  NDEFSimulatedReader reader{ tag };
+  REQUIRE(reader.read_message().as_bytes() == valid_text_record_bytes_sr);
+}
+
+TEST_CASE("Simulated Type 2 reader skips leading TLVs")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type2, 64 };
+  auto message = NDEFMessage{ NDEFRecord::create_uri_record("https://test.com") }.as_bytes();
+
+  // NULL TLV, then a Lock Control TLV ahead of the NDEF Message TLV
+  std::vector<uint8_t> data{ 0x00, 0x01, 0x03, 0xA0, 0x0C, 0x34, 0x03, static_cast<uint8_t>(message.size()) };
+  data.insert(data.end(), message.begin(), message.end());
+  data.push_back(0xFE);
+  tag.write(16, data.data(), data.size());
+
+  NDEFSimulatedReader reader{ tag };
+  REQUIRE(reader.read_message().record().get_uri() == "test.com");
+}
+
+TEST_CASE("Simulated reader charges time per command and byte")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type4, 512 };
+  tag.store(make_message(200).as_bytes());
+
+  NFCLinkProfile profile;
+  profile.max_fragment = 64;
+  profile.command_us = 1000;
+  profile.byte_us = 10;
+
+  NDEFSimulatedReader reader{ tag, profile };
+  reader.read_message();
+
+  auto stats = reader.stats();
+  REQUIRE(stats.commands > 1);
+  REQUIRE(stats.elapsed_us == stats.commands * 1000 + stats.bytes * 10);
+}
+
+TEST_CASE("Simulated reader reports torn reads")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type2, 1024 };
+  tag.store(make_message(800).as_bytes());
+
+  NFCLinkProfile profile;
+  profile.tear_rate = 0.01;
+
+  NDEFSimulatedReader reader{ tag, profile };
+  size_t failures = 0;
+  for (size_t i = 0; i < 20; i++) {
+    try {
+      reader.read_message();
+    } catch (const NDEFException& e) {
+      REQUIRE(std::string{ e.what() }.find("Tag left the field") == 0);
+      failures++;
+    }
+  }
+
+  REQUIRE(failures > 0);
+  REQUIRE(failures < 20);
+  REQUIRE(reader.stats().tears == failures);
+}
+
+TEST_CASE("Torn Type 4 write never leaves a corrupt message")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type4, 1024 };
+  tag.store(valid_text_record_bytes_sr);
+
+  NFCLinkProfile profile;
+  profile.max_fragment = 16;
+  profile.tear_rate = 0.05;
+
+  NDEFSimulatedReader writer{ tag, profile };
+  NDEFSimulatedReader reader{ tag };
+  auto previous = valid_text_record_bytes_sr;
+
+  for (size_t i = 0; i < 50; i++) {
+    auto msg = make_message(i * 10);
+
+    try {
+      writer.write_message(msg);
+      previous = msg.as_bytes();
+    } catch (const NDEFException&) {
+      // Either the tear hit before NLEN was cleared and the old message survives, or the tag reads as empty
+      if (tag.memory().at(0) == 0 && tag.memory().at(1) == 0) {
+        REQUIRE_THROWS_WITH(reader.read_message(), "Tag does not hold an NDEF message");
+        continue;
+      }
+    }
+
+    REQUIRE(reader.read_message().as_bytes() == previous);
+  }
+
+  REQUIRE(writer.stats().tears > 0);
+}
+
+TEST_CASE("Simulated tag rejects messages that do not fit")
+{
+  NDEFSimulatedTag tag{ NFCTagType::Type2, 48 };
+  NDEFSimulatedReader reader{ tag };
+
+  REQUIRE_THROWS_AS(reader.write_message(make_message(100)), NDEFException);
+  REQUIRE_THROWS_WITH(reader.read_message(), "Tag does not hold an NDEF message");
+}